@@ -113,8 +113,9 @@ static int rafind_open(char *file);
 static int rafind_open_file(char *file) {
 	const char *kw;
 	RListIter *iter;
-	bool last = false;
-	int ret;
+	RIOReadAhead *ra;
+	const ut8 *data;
+	int len;
 
 	if (!quiet) {
 		printf ("File: %s\n", file);
@@ -193,28 +194,29 @@ static int rafind_open_file(char *file) {
 	r_search_begin (rs);
 	(void) r_io_seek (io, from, R_IO_SEEK_SET);
 	//printf("; %s 0x%08"PFMT64x"-0x%08"PFMT64x"\n", file, from, to);
-	for (cur = from; !last && cur < to; cur += bsize) {
-		if ((cur + bsize) > to) {
-			bsize = to - cur;
-			last = true;
-		}
-		ret = r_io_pread_at (io, cur, buf, bsize);
-		if (ret == 0) {
+	// the next blocks are read while this one is searched
+	ra = r_io_ra_new (io, from, R_MIN (to, r_io_size (io)), bsize, 0);
+	while ((data = r_io_ra_next (ra, &cur, &len))) {
+		if (r_io_ra_failed (ra)) {
 			if (nonstop) {
 				continue;
 			}
 		//	eprintf ("Error reading at 0x%08"PFMT64x"\n", cur);
+			r_io_ra_free (ra);
+			rs = r_search_free (rs);
+			free (buf);
 			return 1;
 		}
-		if (ret != bsize && ret > 0) {
-			bsize = ret;
+		if (showstr || pr) {
+			// hits print from buf, which outlives the block
+			memcpy (buf, data, len);
 		}
-
-		if (r_search_update (rs, cur, buf, ret) == -1) {
+		if (r_search_update (rs, cur, data, len) == -1) {
 			eprintf ("search: update read error at 0x%08"PFMT64x"\n", cur);
 			break;
 		}
 	}
+	r_io_ra_free (ra);
 	rs = r_search_free (rs);
 	free (buf);
 	return 0;
@@ -141,7 +141,6 @@ static int do_hash_internal(RHash *ctx, ut64 hash, const ut8 *buf, int len, int
 static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int rad, int ule, const ut8 *compare) {
 	ut64 j, fsize, algobit = r_hash_name_to_bits (algo);
 	RHash *ctx;
-	ut8 *buf;
 	int ret = 0;
 	ut64 i;
 	bool first = true;
@@ -171,10 +170,6 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 		eprintf ("rahash2: Unknown file size\n");
 		return 1;
 	}
-	buf = calloc (1, bsize + 1);
-	if (!buf) {
-		return 1;
-	}
 	ctx = r_hash_new (true, algobit);
 
 	if (rad == 'j') {
@@ -189,11 +184,13 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 				if (s.buf && s.prefix) {
 					do_hash_internal (ctx, hashbit, s.buf, s.len, rad, 0, ule);
 				}
-				for (j = from; j < to; j += bsize) {
-					int len = ((j + bsize) > to)? (to - j): bsize;
-					r_io_pread_at (io, j, buf, len);
-					do_hash_internal (ctx, hashbit, buf, len, rad, 0, ule);
+				RIOReadAhead *ra = r_io_ra_new (io, from, to, bsize, 0);
+				const ut8 *data;
+				int len;
+				while ((data = r_io_ra_next (ra, NULL, &len))) {
+					do_hash_internal (ctx, hashbit, data, len, rad, 0, ule);
 				}
+				r_io_ra_free (ra);
 				if (s.buf && !s.prefix) {
 					do_hash_internal (ctx, hashbit, s.buf, s.len, rad, 0, ule);
 				}
@@ -240,16 +237,17 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 				oto = to;
 				f = from;
 				t = to;
-				for (j = f; j < t; j += bsize) {
-					int nsize = (j + bsize < fsize)? bsize: (fsize - j);
-					r_io_pread_at (io, j, buf, bsize);
+				// every block starting before t is hashed whole
+				ut64 end = (t > f)? f + ((t - f + bsize - 1) / bsize) * bsize: f;
+				RIOReadAhead *ra = r_io_ra_new (io, f, R_MIN (end, fsize), bsize, 0);
+				const ut8 *data;
+				int nsize;
+				while ((data = r_io_ra_next (ra, &j, &nsize))) {
 					from = j;
-					to = j + bsize;
-					if (to > fsize) {
-						to = fsize;
-					}
-					do_hash_internal (ctx, hashbit, buf, nsize, rad, 1, ule);
+					to = j + nsize;
+					do_hash_internal (ctx, hashbit, data, nsize, rad, 1, ule);
 				}
+				r_io_ra_free (ra);
 				from = ofrom;
 				to = oto;
 			}
@@ -261,7 +259,6 @@ static int do_hash(const char *file, const char *algo, RIO *io, int bsize, int r
 
 	compare_hashes (ctx, compare, r_hash_size (algobit), &ret);
 	r_hash_free (ctx);
-	free (buf);
 	return ret;
 }
 
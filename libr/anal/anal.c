@@ -77,7 +77,6 @@ R_API RAnal *r_anal_new() {
 	r_space_new (&anal->zign_spaces, "zs", zign_unset_for, zign_count_for, zign_rename_for, anal);
 	anal->sdb_fcns = sdb_ns (anal->sdb, "fcns", 1);
 	anal->sdb_meta = sdb_ns (anal->sdb, "meta", 1);
-	anal->sdb_hints = sdb_ns (anal->sdb, "hints", 1);
 	anal->sdb_types = sdb_ns (anal->sdb, "types", 1);
 	anal->sdb_fmts = sdb_ns (anal->sdb, "spec", 1);
 	anal->sdb_cc = sdb_ns (anal->sdb, "cc", 1);
@@ -125,7 +124,9 @@ R_API RAnal *r_anal_free(RAnal *a) {
 	R_FREE (a->zign_path);
 	r_list_free (a->plugins);
 	a->fcns->free = r_anal_fcn_free;
+	r_anal_bb_index_reset (a);
 	r_list_free (a->fcns);
+	r_meta_free (a);
 	r_space_free (&a->meta_spaces);
 	r_space_free (&a->zign_spaces);
 	r_anal_pin_fini (a);
@@ -133,9 +134,10 @@ R_API RAnal *r_anal_free(RAnal *a) {
 	r_syscall_free (a->syscall);
 	r_reg_free (a->reg);
 	r_anal_op_free (a->queued);
+	r_anal_op_cache_enable (a, false);
 	r_list_free (a->bits_ranges);
-	ht_free (a->dict_refs);
-	ht_free (a->dict_xrefs);
+	r_anal_xrefs_fini (a);
+	r_anal_hint_clear (a);
 	a->sdb = NULL;
 	sdb_ns_free (a->sdb);
 	if (a->esil) {
@@ -210,6 +212,7 @@ R_API char *r_anal_get_reg_profile(RAnal *anal) {
 // deprecate.. or at least reuse get_reg_profile...
 R_API bool r_anal_set_reg_profile(RAnal *anal) {
 	bool ret = false;
+	char *oprofile = (anal && anal->opcache && anal->reg)? strdup (r_str_get (anal->reg->reg_profile_str)): NULL;
 	if (anal && anal->cur && anal->cur->set_reg_profile) {
 		ret = anal->cur->set_reg_profile (anal);
 	} else {
@@ -220,6 +223,13 @@ R_API bool r_anal_set_reg_profile(RAnal *anal) {
 		}
 		free (p);
 	}
+	if (oprofile) {
+		if (strcmp (oprofile, r_str_get (anal->reg->reg_profile_str))) {
+			// the cached ops point to the old RRegItems
+			r_anal_op_cache_reset (anal);
+		}
+		free (oprofile);
+	}
 	return ret;
 }
 
@@ -287,6 +297,7 @@ R_API bool r_anal_set_bits(RAnal *anal, int bits) {
 R_API void r_anal_set_cpu(RAnal *anal, const char *cpu) {
 	free (anal->cpu);
 	anal->cpu = cpu ? strdup (cpu) : NULL;
+	r_anal_op_cache_reset (anal);
 	int v = r_anal_archinfo (anal, R_ANAL_ARCHINFO_ALIGN);
 	if (v != -1) {
 		anal->pcalign = v;
@@ -295,6 +306,7 @@ R_API void r_anal_set_cpu(RAnal *anal, const char *cpu) {
 
 R_API int r_anal_set_big_endian(RAnal *anal, int bigend) {
 	anal->big_endian = bigend;
+	r_anal_op_cache_reset (anal);
 	anal->reg->big_endian = bigend;
 	return true;
 }
@@ -398,10 +410,11 @@ R_API bool r_anal_op_is_eob (RAnalOp *op) {
 
 R_API int r_anal_purge (RAnal *anal) {
 	sdb_reset (anal->sdb_fcns);
-	sdb_reset (anal->sdb_meta);
-	sdb_reset (anal->sdb_hints);
+	r_meta_del (anal, R_META_TYPE_ANY, 0, UT64_MAX);
+	r_anal_hint_clear (anal);
 	sdb_reset (anal->sdb_types);
 	sdb_reset (anal->sdb_zigns);
+	r_anal_bb_index_reset (anal);
 	r_list_free (anal->fcns);
 	anal->fcns = r_anal_fcn_list_new ();
 	anal->fcn_tree = NULL;
@@ -635,42 +648,57 @@ R_API bool r_anal_noreturn_at(RAnal *anal, ut64 addr) {
 
 // based on anal hint we construct a list of RAnalRange to handle
 // better arm/thumb though maybe handy in other contexts
+typedef struct {
+	RAnal *anal;
+	int bits;
+	RList *dead;
+} BitsRangeState;
+
+static bool build_range_cb(void *user, const RAnalHint *hint) {
+	BitsRangeState *st = user;
+	//just grab when hint->bit changes with the previous one
+	if (hint->bits && st->bits != hint->bits) {
+		RAnalRange *range = R_NEW0 (RAnalRange);
+		if (range) {
+			range->bits = hint->bits;
+			range->from = hint->addr;
+			range->to = UT64_MAX;
+			r_list_append (st->anal->bits_ranges, range);
+		}
+	} else if (hint->bits) {
+		//remove this hint is not needed
+		ut64 *addr = R_NEW (ut64);
+		if (addr) {
+			*addr = hint->addr;
+			r_list_append (st->dead, addr);
+		}
+	}
+	if (hint->bits) {
+		st->bits = hint->bits;
+	}
+	return true;
+}
+
 R_API void r_anal_build_range_on_hints(RAnal *a) {
 	if (a->bits_hints_changed) {
-		SdbListIter *iter;
 		RListIter *it;
-		SdbKv *kv;
 		RAnalRange *range;
-		int range_bits = 0;
+		ut64 *addr;
+		BitsRangeState st = { a, 0, r_list_newf (free) };
 		// construct again the range from hint to handle properly arm/thumb
 		r_list_free (a->bits_ranges);
 		a->bits_ranges = r_list_newf ((RListFree)free);
-		SdbList *sdb_range = sdb_foreach_list (a->sdb_hints, true);
-		//just grab when hint->bit changes with the previous one
-		ls_foreach (sdb_range, iter, kv) {
-			RAnalHint *hint = r_anal_hint_from_string (a, sdb_atoi (kv->key + 5), kv->value);
-			if (hint->bits && range_bits != hint->bits) {
-				RAnalRange *range = R_NEW0 (RAnalRange);
-				if (range) {
-					range->bits = hint->bits;
-					range->from = hint->addr;
-					range->to = UT64_MAX;
-					r_list_append (a->bits_ranges, range);
-				}
-			} else {
-				//remove this hint is not needed
-				r_anal_hint_unset_bits (a, hint->addr);
-			}
-			range_bits = hint->bits;
-			r_anal_hint_free (hint);
+		r_anal_hint_foreach (a, build_range_cb, &st);
+		r_list_foreach (st.dead, it, addr) {
+			r_anal_hint_unset_bits (a, *addr);
 		}
+		r_list_free (st.dead);
 		//close ranges addr
 		r_list_foreach (a->bits_ranges, it, range) {
 			if (it->n && it->n->data) {
 				range->to = ((RAnalRange *)(it->n->data))->from;
 			}
 		}
-		ls_free (sdb_range);
 		a->bits_hints_changed = false;
 	}
 }
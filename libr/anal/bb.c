@@ -66,6 +66,7 @@ R_API void r_anal_bb_free(RAnalBlock *bb) {
 		// avoid double free
 		bb->next->prev = NULL;
 	}
+	r_anal_bb_index_del (bb);
 	R_FREE (bb); // double free
 }
 
@@ -166,20 +167,154 @@ R_API inline int r_anal_bb_is_in_offset (RAnalBlock *bb, ut64 off) {
 	return (off >= bb->addr && off < bb->addr + bb->size);
 }
 
-R_API RAnalBlock *r_anal_bb_from_offset(RAnal *anal, ut64 off) {
-	RListIter *iter, *iter2;
-	RAnalFunction *fcn;
-	RAnalBlock *bb;
-	r_list_foreach (anal->fcns, iter, fcn) {
-		r_list_foreach (fcn->bbs, iter2, bb) {
-			if (r_anal_bb_is_in_offset (bb, off)) {
-				return bb;
+// anal->bb_tree is an interval tree of the blocks of every function in
+// anal->fcns, shared blocks included, ordered by (addr, pointer). The blocks
+// are added by r_anal_fcn_insert and r_anal_fcn_bbadd, and leave it when
+// freed. Code changing the size of an indexed block calls
+// r_anal_bb_index_update or r_anal_fcn_update_tinyrange_bbs after it.
+#define BB_CONTAINER(x) container_of ((RBNode *)(x), RAnalBlock, rb)
+
+static ut64 bb_end(const RAnalBlock *bb) {
+	return bb->addr + (bb->size > 0? bb->size: 0);
+}
+
+static int bb_tree_cmp(const void *incoming, const RBNode *in_tree) {
+	const RAnalBlock *a = incoming, *b = BB_CONTAINER (in_tree);
+	if (a->addr != b->addr) {
+		return (a->addr < b->addr)? -1: 1;
+	}
+	return (a < b)? -1: (a > b)? 1: 0;
+}
+
+static int bb_tree_cmp_addr(const void *incoming, const RBNode *in_tree) {
+	ut64 addr = *(const ut64 *)incoming;
+	const RAnalBlock *b = BB_CONTAINER (in_tree);
+	return (addr < b->addr)? -1: (addr > b->addr)? 1: 0;
+}
+
+static void bb_tree_calc_max_addr(RBNode *node) {
+	RAnalBlock *bb = BB_CONTAINER (node);
+	int i;
+	bb->rb_max_addr = bb_end (bb);
+	for (i = 0; i < 2; i++) {
+		if (node->child[i]) {
+			RAnalBlock *bb1 = BB_CONTAINER (node->child[i]);
+			if (bb1->rb_max_addr > bb->rb_max_addr) {
+				bb->rb_max_addr = bb1->rb_max_addr;
 			}
 		}
 	}
+}
+
+// the block containing addr with the highest start, of fcn if not NULL
+static RAnalBlock *bb_tree_stab(RBNode *node, ut64 addr, RAnalFunction *fcn) {
+	while (node) {
+		RAnalBlock *bb = BB_CONTAINER (node);
+		if (addr >= bb->rb_max_addr) {
+			return NULL;
+		}
+		if (addr < bb->addr) {
+			node = node->child[0];
+			continue;
+		}
+		RAnalBlock *ret = bb_tree_stab (node->child[1], addr, fcn);
+		if (ret) {
+			return ret;
+		}
+		if (addr < bb_end (bb) && (!fcn || bb->fcn == fcn)) {
+			return bb;
+		}
+		node = node->child[0];
+	}
 	return NULL;
 }
 
+static void bb_tree_intersect(RBNode *node, ut64 from, ut64 to, RList *list) {
+	if (!node) {
+		return;
+	}
+	RAnalBlock *bb = BB_CONTAINER (node);
+	if (from >= bb->rb_max_addr) {
+		return;
+	}
+	bb_tree_intersect (node->child[0], from, to, list);
+	if (bb->addr < to) {
+		if (from < bb_end (bb)) {
+			r_list_append (list, bb);
+		}
+		bb_tree_intersect (node->child[1], from, to, list);
+	}
+}
+
+R_API void r_anal_bb_index_add(RAnal *anal, RAnalBlock *bb) {
+	if (!anal || bb->anal == anal) {
+		return;
+	}
+	r_anal_bb_index_del (bb);
+	bb->anal = anal;
+	r_rbtree_aug_insert (&anal->bb_tree, bb, &bb->rb, bb_tree_cmp, bb_tree_calc_max_addr);
+}
+
+R_API void r_anal_bb_index_del(RAnalBlock *bb) {
+	if (bb->anal) {
+		r_rbtree_aug_delete (&bb->anal->bb_tree, bb, bb_tree_cmp, NULL, bb_tree_calc_max_addr);
+		bb->anal = NULL;
+	}
+}
+
+// to be called after the size of bb changed
+R_API void r_anal_bb_index_update(RAnalBlock *bb) {
+	if (bb->anal) {
+		r_rbtree_aug_update_sum (bb->anal->bb_tree, bb, &bb->rb, bb_tree_cmp, bb_tree_calc_max_addr);
+	}
+}
+
+// drops the whole index in one go, before freeing all the functions
+R_API void r_anal_bb_index_reset(RAnal *anal) {
+	RAnalBlock *bb;
+	RBIter it;
+	r_rbtree_foreach (anal->bb_tree, it, bb, RAnalBlock, rb) {
+		bb->anal = NULL;
+	}
+	anal->bb_tree = NULL;
+}
+
+R_API RAnalBlock *r_anal_bb_index_in(RAnal *anal, ut64 addr, RAnalFunction *fcn) {
+	return anal? bb_tree_stab (anal->bb_tree, addr, fcn): NULL;
+}
+
+// the indexed blocks overlapping [from, to) sorted by address, the list
+// doesn't own them
+R_API RList *r_anal_bb_index_intersect(RAnal *anal, ut64 from, ut64 to) {
+	RList *list = r_list_new ();
+	if (anal && list && from < to) {
+		bb_tree_intersect (anal->bb_tree, from, to, list);
+	}
+	return list;
+}
+
+R_API RAnalBlock *r_anal_bb_index_at(RAnal *anal, ut64 addr, RAnalFunction *fcn) {
+	RAnalBlock *bb;
+	RBIter it;
+	if (!anal) {
+		return NULL;
+	}
+	it = r_rbtree_lower_bound_forward (anal->bb_tree, &addr, bb_tree_cmp_addr);
+	r_rbtree_iter_while (it, bb, RAnalBlock, rb) {
+		if (bb->addr != addr) {
+			break;
+		}
+		if (!fcn || bb->fcn == fcn) {
+			return bb;
+		}
+	}
+	return NULL;
+}
+
+R_API RAnalBlock *r_anal_bb_from_offset(RAnal *anal, ut64 off) {
+	return r_anal_bb_index_in (anal, off, NULL);
+}
+
 R_API RAnalBlock *r_anal_bb_get_jumpbb(RAnalFunction *fcn, RAnalBlock *bb) {
 	if (bb->jump == UT64_MAX) {
 		return NULL;
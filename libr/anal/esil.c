@@ -65,15 +65,18 @@ static bool isregornum(RAnalEsil *esil, const char *str, ut64 *num) {
 	return true;
 }
 
+static bool regornum(RAnalEsil *esil, RAnalEsilValue *v, ut64 *num) {
+	if (v->type == R_ANAL_ESIL_VAL_NUM) {
+		*num = v->num;
+		return true;
+	}
+	return isregornum (esil, v->str, num);
+}
+
 /* pop Register or Number */
 static bool popRN(RAnalEsil *esil, ut64 *n) {
-	char *str = r_anal_esil_pop (esil);
-	if (str) {
-		bool ret = isregornum (esil, str, n);
-		free (str);
-		return ret;
-	}
-	return false;
+	RAnalEsilValue v;
+	return r_anal_esil_pop_value (esil, &v) && regornum (esil, &v, n);
 }
 
 /* R_ANAL_ESIL API */
@@ -87,47 +90,109 @@ R_API RAnalEsil *r_anal_esil_new(int stacksize, int iotrap, unsigned int addrsiz
 		free (esil);
 		return NULL;
 	}
-	if (!(esil->stack = calloc (sizeof (char *), stacksize))) {
+	if (!(esil->stack = calloc (sizeof (RAnalEsilValue), stacksize))) {
 		free (esil);
 		return NULL;
 	}
 	esil->verbose = false;
 	esil->stacksize = stacksize;
 	esil->parse_goto_count = R_ANAL_ESIL_GOTO_LIMIT;
-	esil->ops = sdb_new0 ();
+	if (!(esil->ops = R_NEW0 (RAnalEsilOps))) {
+		free (esil->stack);
+		free (esil);
+		return NULL;
+	}
 	esil->iotrap = iotrap;
-	esil->interrupts = sdb_new0 ();
 	esil->sessions = r_list_newf (r_anal_esil_session_free);
 	esil->addrmask = genmask (addrsize - 1);
 	return esil;
 }
 
+static inline ut32 ophash(const char *s) {
+	ut32 h = 5381;
+	for (; *s; s++) {
+		h = (h * 33) ^ (ut8)*s;
+	}
+	return h;
+}
+
+static inline ut32 opslot(ut32 h, ut32 disp) {
+	return ((h ^ (disp * 0x9e3779b1)) * 0x85ebca6b) >> (32 - R_ANAL_ESIL_OPS_BITS);
+}
+
+static RAnalEsilOpSlot *builtin_op(RAnalEsil *esil, const char *op, ut32 h) {
+	RAnalEsilOps *ops = esil->ops;
+	RAnalEsilOpSlot *s = &ops->slots[opslot (h, ops->disp[h % R_ANAL_ESIL_OPS_BUCKETS])];
+	return (s->name && s->hash == h && !strcmp (s->name, op))? s: NULL;
+}
+
+static RAnalEsilOpSlot *user_op(RAnalEsil *esil, const char *op, ut32 h) {
+	int i;
+	for (i = 0; i < esil->nuserops; i++) {
+		RAnalEsilOpSlot *s = &esil->userops[i];
+		if (s->hash == h && !strcmp (s->name, op)) {
+			return s;
+		}
+	}
+	return NULL;
+}
+
 R_API int r_anal_esil_set_op(RAnalEsil *esil, const char *op, RAnalEsilOp code) {
-	char t[128];
-	if (!code || !op || !strlen (op) || !esil || !esil->ops) {
+	RAnalEsilOpSlot *s;
+	if (!code || !op || !*op || !esil || !esil->ops) {
 		return false;
 	}
-	char *h = sdb_itoa (sdb_hash (op), t, 16);
-	sdb_num_set (esil->ops, h, (ut64)(size_t)code, 0);
-	if (!sdb_num_exists (esil->ops, h)) {
-		eprintf ("can't set esil-op %s\n", op);
-		return false;
+	ut32 h = ophash (op);
+	if (!(s = builtin_op (esil, op, h)) && !(s = user_op (esil, op, h))) {
+		char *name = strdup (op);
+		s = realloc (esil->userops, (esil->nuserops + 1) * sizeof (RAnalEsilOpSlot));
+		if (!name || !s) {
+			eprintf ("can't set esil-op %s\n", op);
+			free (name);
+			return false;
+		}
+		esil->userops = s;
+		s = &esil->userops[esil->nuserops++];
+		s->hash = h;
+		s->name = name;
 	}
+	s->op = code;
+	// the compiled expressions may have the word as an operand
+	r_anal_esil_prog_reset (esil);
 	return true;
 }
 
+R_API RAnalEsilOp r_anal_esil_get_op(RAnalEsil *esil, const char *op) {
+	RAnalEsilOpSlot *s;
+	ut32 h = ophash (op);
+	if ((s = builtin_op (esil, op, h))) {
+		return s->op;
+	}
+	if (esil->nuserops && (s = user_op (esil, op, h))) {
+		return s->op;
+	}
+	return NULL;
+}
+
 R_API int r_anal_esil_set_interrupt(RAnalEsil *esil, int interrupt, RAnalEsilInterruptCB interruptcb) {
-	char t[128];
-	char *i;
-	if (!esil || !esil->interrupts) {
+	if (!esil) {
 		return false;
 	}
-	i = sdb_itoa ((ut64)interrupt, t, 16);
-	sdb_num_set (esil->interrupts, i, (ut64)(size_t)interruptcb, 0);
-	if (!sdb_num_exists (esil->interrupts, i)) {
+	if (interrupt < 0 || interrupt >= R_ANAL_ESIL_INTERRUPTS_MAX) {
 		eprintf ("can't set interrupt-handler for interrupt %d\n", interrupt);
 		return false;
 	}
+	if (interrupt >= esil->ninterrupts) {
+		RAnalEsilInterruptCB *intrs = realloc (esil->interrupts, (interrupt + 1) * sizeof (RAnalEsilInterruptCB));
+		if (!intrs) {
+			eprintf ("can't set interrupt-handler for interrupt %d\n", interrupt);
+			return false;
+		}
+		memset (intrs + esil->ninterrupts, 0, (interrupt + 1 - esil->ninterrupts) * sizeof (RAnalEsilInterruptCB));
+		esil->interrupts = intrs;
+		esil->ninterrupts = interrupt + 1;
+	}
+	esil->interrupts[interrupt] = interruptcb;
 	return true;
 }
 
@@ -157,8 +222,6 @@ R_API int r_anal_esil_fire_trap(RAnalEsil *esil, int trap_type, int trap_code) {
 }
 
 R_API int r_anal_esil_fire_interrupt(RAnalEsil *esil, int interrupt) {
-	char t[128];
-	char *i;
 	RAnalEsilInterruptCB icb;
 	if (!esil) {
 		return false;
@@ -173,14 +236,11 @@ R_API int r_anal_esil_fire_interrupt(RAnalEsil *esil, int interrupt) {
 				return true;
 		}
 	}
-	if (!esil->interrupts)
-		return false;
-	i = sdb_itoa ((ut64)interrupt, t, 16);
-	if (!sdb_num_exists (esil->interrupts, i)) {
+	if (interrupt < 0 || interrupt >= esil->ninterrupts) {
 		//eprintf ("0x%08"PFMT64x" Invalid interrupt/syscall 0x%08x\n", esil->address, interrupt);
 		return false;
 	}
-	icb = (RAnalEsilInterruptCB)sdb_ptr_get (esil->interrupts, i, 0);
+	icb = esil->interrupts[interrupt];
 	if (icb) return icb (esil, interrupt);
 	return false;
 }
@@ -194,20 +254,27 @@ R_API bool r_anal_esil_set_pc(RAnalEsil *esil, ut64 addr) {
 }
 
 R_API void r_anal_esil_free(RAnalEsil *esil) {
+	int i;
 	if (!esil) {
 		return;
 	}
 	if (esil->anal && esil == esil->anal->esil) {
 		esil->anal->esil = NULL;
 	}
-	sdb_free (esil->ops);
-	esil->ops = NULL;
-	sdb_free (esil->interrupts);
-	esil->interrupts = NULL;
+	r_anal_esil_prog_reset (esil);
+	R_FREE (esil->progs);
+	R_FREE (esil->ops);
+	for (i = 0; i < esil->nuserops; i++) {
+		free ((char *)esil->userops[i].name);
+	}
+	R_FREE (esil->userops);
+	esil->nuserops = 0;
+	R_FREE (esil->interrupts);
+	esil->ninterrupts = 0;
 	sdb_free (esil->stats);
 	esil->stats = NULL;
-	sdb_free (esil->db_trace);
-	esil->db_trace = NULL;
+	r_anal_esil_trace_free (esil->trace);
+	esil->trace = NULL;
 	r_anal_esil_stack_free (esil);
 	free (esil->stack);
 	if (esil->anal && esil->anal->cur && esil->anal->cur->esil_fini) {
@@ -488,49 +555,154 @@ static bool esil_internal_overflow_check(RAnalEsil *esil) {
 	return (esil_internal_carry_check (esil, esil->lastsz - 1) ^ esil_internal_carry_check (esil, esil->lastsz - 2));
 }
 
+/* what r_anal_esil_get_parm_type takes as R_ANAL_ESIL_PARM_NUM */
+static bool isparmnum(const char *str) {
+	int i;
+	if (!strncmp (str, "0x", 2)) {
+		return true;
+	}
+	if (!((IS_DIGIT(str[0])) || str[0] == '-')) {
+		return false;
+	}
+	for (i = 1; str[i]; i++) {
+		if (!(IS_DIGIT(str[i]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline bool isinternal(const RAnalEsilValue *v) {
+	return v->type == R_ANAL_ESIL_VAL_STR && v->str[0] == ESIL_INTERNAL_PREFIX && v->str[1];
+}
+
+// Numbers are parsed here, the rest is looked up when it's used. Words
+// longer than the value can't be pushed, like in r_anal_esil_parse
+R_API bool r_anal_esil_value_set(RAnalEsil *esil, RAnalEsilValue *v, const char *str) {
+	size_t len = strlen (str);
+	if (!len || len >= sizeof (v->str)) {
+		return false;
+	}
+	memcpy (v->str, str, len + 1);
+	if (isparmnum (str)) {
+		v->type = R_ANAL_ESIL_VAL_NUM;
+		v->num = r_num_get (NULL, str);
+	} else {
+		v->type = R_ANAL_ESIL_VAL_STR;
+		v->num = 0;
+	}
+	return true;
+}
+
+// numbers pushed with r_anal_esil_pushnum are printed the first time
+R_API const char *r_anal_esil_value_str(RAnalEsilValue *v) {
+	if (!*v->str) {
+		snprintf (v->str, sizeof (v->str), "0x%" PFMT64x, v->num);
+	}
+	return v->str;
+}
+
+// same as r_anal_esil_get_parm_size on the string of v
+R_API bool r_anal_esil_value_num(RAnalEsil *esil, RAnalEsilValue *v, ut64 *num, int *size) {
+	switch (v->type) {
+	case R_ANAL_ESIL_VAL_NUM:
+		*num = v->num;
+		if (size) {
+			*size = esil->anal->bits;
+		}
+		return true;
+	case R_ANAL_ESIL_VAL_REG:
+		// read by index unless something hooks the reads or the profile changed
+		if (esil->cb.reg_read == internal_esil_reg_read && !esil->cb.hook_reg_read) {
+			RRegItem *ri = r_reg_index_get (esil->anal->reg, v->reg);
+			if (ri && !strcmp (ri->name, v->str)) {
+				*num = r_reg_get_value (esil->anal->reg, ri);
+				if (size) {
+					*size = ri->size;
+				}
+				return true;
+			}
+		}
+		if (r_anal_esil_reg_read (esil, v->str, num, size)) {
+			return true;
+		}
+		break;
+	}
+	return r_anal_esil_get_parm_size (esil, r_anal_esil_value_str (v), num, size);
+}
+
+R_API bool r_anal_esil_push_value(RAnalEsil *esil, const RAnalEsilValue *v) {
+	if (!esil || esil->stackptr > (esil->stacksize - 1)) {
+		return false;
+	}
+	RAnalEsilValue *top = &esil->stack[esil->stackptr++];
+	top->type = v->type;
+	top->num = v->num;
+	top->reg = v->reg;
+	strcpy (top->str, v->str);
+	return true;
+}
+
+R_API bool r_anal_esil_pop_value(RAnalEsil *esil, RAnalEsilValue *v) {
+	if (!esil || esil->stackptr < 1) {
+		return false;
+	}
+	RAnalEsilValue *top = &esil->stack[--esil->stackptr];
+	v->type = top->type;
+	v->num = top->num;
+	v->reg = top->reg;
+	strcpy (v->str, top->str);
+	return true;
+}
+
 R_API int r_anal_esil_pushnum(RAnalEsil *esil, ut64 num) {
-	char str[64];
-	snprintf (str, sizeof (str) - 1, "0x%" PFMT64x, num);
-	return r_anal_esil_push (esil, str);
+	if (!esil || esil->stackptr > (esil->stacksize - 1)) {
+		return false;
+	}
+	RAnalEsilValue *top = &esil->stack[esil->stackptr++];
+	top->type = R_ANAL_ESIL_VAL_NUM;
+	top->num = num;
+	top->str[0] = 0;
+	return true;
 }
 
 R_API bool r_anal_esil_push(RAnalEsil *esil, const char *str) {
 	if (!str || !esil || !*str || esil->stackptr > (esil->stacksize - 1)) {
 		return false;
 	}
-	esil->stack[esil->stackptr++] = strdup (str);
+	if (!r_anal_esil_value_set (esil, &esil->stack[esil->stackptr], str)) {
+		return false;
+	}
+	esil->stackptr++;
 	return true;
 }
 
+// the value as a string, for the ops and plugins working on strings
 R_API char *r_anal_esil_pop(RAnalEsil *esil) {
 	if (!esil || esil->stackptr < 1) {
 		return NULL;
 	}
-	return esil->stack[--esil->stackptr];
+	return strdup (r_anal_esil_value_str (&esil->stack[--esil->stackptr]));
 }
 
-R_API int r_anal_esil_get_parm_type(RAnalEsil *esil, const char *str) {
-	int len, i;
+static RAnalEsilValue *popv(RAnalEsil *esil, RAnalEsilValue *v) {
+	return r_anal_esil_pop_value (esil, v)? v: NULL;
+}
 
-	if (!str || !(len = strlen (str))) {
+static inline bool getnum(RAnalEsil *esil, RAnalEsilValue *v, ut64 *num) {
+	return r_anal_esil_value_num (esil, v, num, NULL);
+}
+
+R_API int r_anal_esil_get_parm_type(RAnalEsil *esil, const char *str) {
+	if (!str || !*str) {
 		return R_ANAL_ESIL_PARM_INVALID;
 	}
 	if (str[0] == ESIL_INTERNAL_PREFIX && str[1]) {
 		return R_ANAL_ESIL_PARM_INTERNAL;
 	}
-	if (!strncmp (str, "0x", 2)) {
+	if (isparmnum (str)) {
 		return R_ANAL_ESIL_PARM_NUM;
 	}
-	if (!((IS_DIGIT(str[0])) || str[0] == '-')) {
-		goto not_a_number;
-	}
-	for (i = 1; i < len; i++) {
-		if (!(IS_DIGIT(str[i]))) {
-			goto not_a_number;
-		}
-	}
-	return R_ANAL_ESIL_PARM_NUM;
-not_a_number:
 	if (r_reg_get (esil->anal->reg, str, -1))
 		return R_ANAL_ESIL_PARM_REG;
 	return R_ANAL_ESIL_PARM_INVALID;
@@ -696,6 +868,18 @@ R_API int r_anal_esil_reg_write(RAnalEsil *esil, const char *dst, ut64 num) {
 	return ret;
 }
 
+// the registers are accessed with the callbacks of r_anal_esil_setup and
+// nothing hooks the accesses or the ops. *nonull is set when writing zero
+// to the pc, sp or bp is ignored
+R_API bool r_anal_esil_reg_cb_internal(RAnalEsil *esil, bool *nonull) {
+	RAnalEsilCallbacks *cb = &esil->cb;
+	if (cb->hook_reg_read || cb->hook_reg_write || cb->hook_command || cb->reg_read != internal_esil_reg_read) {
+		return false;
+	}
+	*nonull = cb->reg_write == internal_esil_reg_write_no_null;
+	return *nonull || cb->reg_write == internal_esil_reg_write;
+}
+
 R_API int r_anal_esil_reg_read_nocallback(RAnalEsil *esil, const char *regname, ut64 *num, int *size) {
 	int ret;
 	void *old_hook_reg_read = (void *) esil->cb.hook_reg_read;
@@ -734,24 +918,28 @@ R_API int r_anal_esil_reg_read(RAnalEsil *esil, const char *regname, ut64 *num,
 static int esil_eq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (ispackedreg (esil, dst)) {
-		char *src2 = r_anal_esil_pop (esil);
-		char *newreg = r_str_newf ("%sl", dst);
-		if (r_anal_esil_get_parm (esil, src2, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && ispackedreg (esil, dst->str)) {
+		RAnalEsilValue vsrc2, *src2 = popv (esil, &vsrc2);
+		if (!src2) {
+			ERR ("esil_eq: missing the low part of the packed register");
+			return 0;
+		}
+		char *newreg = r_str_newf ("%sl", dst->str);
+		if (getnum (esil, src2, &num2)) {
 			ret = r_anal_esil_reg_write (esil, newreg, num2);
 		}
 		free (newreg);
 	}
 
-	if (src && dst && r_anal_esil_reg_read_nocallback (esil, dst, &num, NULL)) {
-		if (r_anal_esil_get_parm (esil, src, &num2)) {
-			ret = r_anal_esil_reg_write (esil, dst, num2);
-			if (ret && r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) { //necessary for some flag-things
+	if (src && dst && r_anal_esil_reg_read_nocallback (esil, dst->str, &num, NULL)) {
+		if (getnum (esil, src, &num2)) {
+			ret = r_anal_esil_reg_write (esil, dst->str, num2);
+			if (ret && !isinternal (src)) { //necessary for some flag-things
 				esil->cur = num2;
 				esil->old = num;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
 		} else {
 			ERR ("esil_eq: invalid src");
@@ -759,46 +947,42 @@ static int esil_eq(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_eq: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_neg(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num;
-	char *src = r_anal_esil_pop (esil);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
 	if (src) {
-		if (r_anal_esil_get_parm (esil, src, &num)) {
+		if (getnum (esil, src, &num)) {
 			r_anal_esil_pushnum (esil, !num);
 			ret = 1;
 		} else {
-			if (isregornum (esil, src, &num)) {
+			if (regornum (esil, src, &num)) {
 				ret = 1;
 				r_anal_esil_pushnum (esil, !num);
 			} else {
-				eprintf ("0x%08"PFMT64x" esil_neg: unknown reg %s\n", esil->address, src);
+				eprintf ("0x%08"PFMT64x" esil_neg: unknown reg %s\n", esil->address, src->str);
 			}
 		}
 	} else {
 		ERR ("esil_neg: empty stack");
 	}
-	free (src);
 	return ret;
 }
 
 static int esil_negeq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num;
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_reg_read (esil, src, &num, NULL)) {
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && r_anal_esil_reg_read (esil, src->str, &num, NULL)) {
 		num = !num;
-		r_anal_esil_reg_write (esil, src, num);
+		r_anal_esil_reg_write (esil, src->str, num);
 		ret = 1;
 	} else {
 		ERR ("esil_negeq: empty stack");
 	}
-	free (src);
 	//r_anal_esil_pushnum (esil, ret);
 	return ret;
 }
@@ -810,69 +994,63 @@ static int esil_nop(RAnalEsil *esil) {
 static int esil_andeq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_reg_read (esil, dst, &num, NULL)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_reg_read (esil, dst->str, &num, NULL)) {
+		if (src && getnum (esil, src, &num2)) {
+			if (!isinternal (src)) {
 				esil->old = num;
 				esil->cur = num & num2;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, num & num2);
+			r_anal_esil_reg_write (esil, dst->str, num & num2);
 			ret = 1;
 		} else {
 			ERR ("esil_andeq: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_oreq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_reg_read (esil, dst, &num, NULL)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_reg_read (esil, dst->str, &num, NULL)) {
+		if (src && getnum (esil, src, &num2)) {
+			if (!isinternal (src)) {
 				esil->old = num;
 				esil->cur = num | num2;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, num | num2);
+			r_anal_esil_reg_write (esil, dst->str, num | num2);
 			ret = 1;
 		} else {
 			ERR ("esil_ordeq: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_xoreq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_reg_read (esil, dst, &num, NULL)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_reg_read (esil, dst->str, &num, NULL)) {
+		if (src && getnum (esil, src, &num2)) {
+			if (!isinternal (src)) {
 				esil->old = num;
 				esil->cur = num ^ num2;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, num ^ num2);
+			r_anal_esil_reg_write (esil, dst->str, num ^ num2);
 			ret = 1;
 		} else {
 			ERR ("esil_xoreq: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
@@ -968,17 +1146,17 @@ static int esil_interrupt(RAnalEsil *esil) {
 static int esil_cmp(RAnalEsil *esil) {
 	ut64 num, num2;
 	int ret = 0;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			esil->old = num;
 			esil->cur = num - num2;
 			ret = 1;
-			if (r_reg_get (esil->anal->reg, dst, -1)) {
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
-			} else if (r_reg_get (esil->anal->reg, src, -1)) {
-				esil->lastsz = esil_internal_sizeof_reg (esil, src);
+			if (dst->type != R_ANAL_ESIL_VAL_NUM && r_reg_get (esil->anal->reg, dst->str, -1)) {
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
+			} else if (src->type != R_ANAL_ESIL_VAL_NUM && r_reg_get (esil->anal->reg, src->str, -1)) {
+				esil->lastsz = esil_internal_sizeof_reg (esil, src->str);
 			} else {
 				// default size is set to 64 as internally operands are ut64
 				esil->lastsz = 64;
@@ -986,8 +1164,6 @@ static int esil_cmp(RAnalEsil *esil) {
 			r_anal_esil_pushnum (esil, num == num2);
 		}
 	}
-	free (dst);
-	free (src);
 	return ret;
 }
 
@@ -1052,15 +1228,14 @@ static int esil_ifset(RAnalEsil *esil) {
 
 static int esil_if(RAnalEsil *esil) {
 	ut64 num = 0LL;
-	char *src = r_anal_esil_pop (esil);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
 	if (src) {
 		// TODO: check return value
-		(void)r_anal_esil_get_parm (esil, src, &num);
+		(void)getnum (esil, src, &num);
 		// condition not matching, skipping until }
 		if (!num) {
 			esil->skip = true;
 		}
-		free (src);
 		return true;
 	}
 	return false;
@@ -1069,10 +1244,10 @@ static int esil_if(RAnalEsil *esil) {
 static int esil_lsl(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			if (num2 > sizeof (ut64) * 8) {
 				ERR ("esil_lsl: shift is too big");
 			} else {
@@ -1087,18 +1262,16 @@ static int esil_lsl(RAnalEsil *esil) {
 			ERR ("esil_lsl: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_lsleq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_reg_read (esil, dst, &num, NULL)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_reg_read (esil, dst->str, &num, NULL)) {
+		if (src && getnum (esil, src, &num2)) {
 			if (num2 > sizeof (ut64) * 8) {
 				ERR ("esil_lsleq: shift is too big");
 			} else {
@@ -1109,26 +1282,24 @@ static int esil_lsleq(RAnalEsil *esil) {
 					num <<= num2;
 				}
 				esil->cur = num;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
-				r_anal_esil_reg_write (esil, dst, num);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
+				r_anal_esil_reg_write (esil, dst->str, num);
 				ret = 1;
 			}
 		} else {
 			ERR ("esil_lsleq: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_lsr(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			ut64 res = num >> R_MIN(num2, 63);
 			r_anal_esil_pushnum (esil, res);
 			ret = 1;
@@ -1136,30 +1307,26 @@ static int esil_lsr(RAnalEsil *esil) {
 			ERR ("esil_lsr: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_lsreq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_reg_read (esil, dst, &num, NULL)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_reg_read (esil, dst->str, &num, NULL)) {
+		if (src && getnum (esil, src, &num2)) {
 			esil->old = num;
 			num >>= num2;
 			esil->cur = num;
-			esil->lastsz = esil_internal_sizeof_reg (esil, dst);
-			r_anal_esil_reg_write (esil, dst, num);
+			esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
+			r_anal_esil_reg_write (esil, dst->str, num);
 			ret = 1;
 		} else {
 			ERR ("esil_lsreq: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
@@ -1259,10 +1426,10 @@ static int esil_asr(RAnalEsil *esil) {
 static int esil_ror(RAnalEsil *esil) {
 	int regsize, ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm_size (esil, dst, &num, &regsize)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_value_num (esil, dst, &num, &regsize)) {
+		if (src && getnum (esil, src, &num2)) {
 			ut64 mask = (regsize - 1);
 			num2 &= mask;
 			ut64 res = (num >> num2) | (num << ((-(st64)num2) & mask));
@@ -1272,18 +1439,16 @@ static int esil_ror(RAnalEsil *esil) {
 			ERR ("esil_ror: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_rol(RAnalEsil *esil) {
 	int regsize, ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm_size (esil, dst, &num, &regsize)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && r_anal_esil_value_num (esil, dst, &num, &regsize)) {
+		if (src && getnum (esil, src, &num2)) {
 			ut64 mask = (regsize - 1);
 			num2 &= mask;
 			ut64 res = (num << num2) | (num >> ((-(st64)num2) & mask));
@@ -1293,18 +1458,16 @@ static int esil_rol(RAnalEsil *esil) {
 			ERR ("esil_rol: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_and(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			num &= num2;
 			r_anal_esil_pushnum (esil, num);
 			ret = 1;
@@ -1312,18 +1475,16 @@ static int esil_and(RAnalEsil *esil) {
 			ERR ("esil_and: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_xor(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			num ^= num2;
 			r_anal_esil_pushnum (esil, num);
 			ret = 1;
@@ -1331,18 +1492,16 @@ static int esil_xor(RAnalEsil *esil) {
 			ERR ("esil_xor: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_or(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 num, num2;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (dst && r_anal_esil_get_parm (esil, dst, &num)) {
-		if (src && r_anal_esil_get_parm (esil, src, &num2)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (dst && getnum (esil, dst, &num)) {
+		if (src && getnum (esil, src, &num2)) {
 			num |= num2;
 			r_anal_esil_pushnum (esil, num);
 			ret = 1;
@@ -1350,8 +1509,6 @@ static int esil_or(RAnalEsil *esil) {
 			ERR ("esil_xor: empty stack");
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
@@ -1392,7 +1549,7 @@ R_API int r_anal_esil_dumpstack(RAnalEsil *esil) {
 		return 0;
 	}
 	for (i = esil->stackptr - 1; i >= 0; i--) {
-		esil->anal->cb_printf ("%s\n", esil->stack[i]);
+		esil->anal->cb_printf ("%s\n", r_anal_esil_value_str (&esil->stack[i]));
 	}
 	return 1;
 }
@@ -1403,9 +1560,7 @@ static int esil_break(RAnalEsil *esil) {
 }
 
 static int esil_clear(RAnalEsil *esil) {
-	char *r;
-	while ((r = r_anal_esil_pop (esil)))
-		free (r);
+	esil->stackptr = 0;
 	return 1;
 }
 
@@ -1416,11 +1571,10 @@ static int esil_todo(RAnalEsil *esil) {
 
 static int esil_goto(RAnalEsil *esil) {
 	ut64 num = 0;
-	char *src = r_anal_esil_pop (esil);
-	if (src && *src && r_anal_esil_get_parm (esil, src, &num)) {
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &num)) {
 		esil->parse_goto = num;
 	}
-	free (src);
 	return 1;
 }
 
@@ -1440,18 +1594,19 @@ static int esil_repeat(RAnalEsil *esil) {
 }
 
 static int esil_pop(RAnalEsil *esil) {
-	char *dst = r_anal_esil_pop (esil);
-	free (dst);
+	if (esil->stackptr > 0) {
+		esil->stackptr--;
+	}
 	return 1;
 }
 
 static int esil_mod(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_get_parm (esil, dst, &d)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && getnum (esil, dst, &d)) {
 			if (s == 0) {
 				if (esil->verbose > 0) {
 					eprintf ("0x%08"PFMT64x" esil_mod: Division by zero!\n", esil->address);
@@ -1466,25 +1621,23 @@ static int esil_mod(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_mod: invalid parameters");
 	}
-	free (dst);
-	free (src);
 	return ret;
 }
 
 static int esil_modeq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_reg_read (esil, dst, &d, NULL)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && r_anal_esil_reg_read (esil, dst->str, &d, NULL)) {
 			if (s) {
-				if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+				if (!isinternal (src)) {
 					esil->old = d;
 					esil->cur = d % s;
-					esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+					esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 				}
-				r_anal_esil_reg_write (esil, dst, d % s);
+				r_anal_esil_reg_write (esil, dst->str, d % s);
 			} else {
 				ERR ("esil_modeq: Division by zero!");
 				esil->trap = R_ANAL_TRAP_DIVBYZERO;
@@ -1497,18 +1650,16 @@ static int esil_modeq(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_modeq: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_div(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_get_parm (esil, dst, &d)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && getnum (esil, dst, &d)) {
 			if (s == 0) {
 				ERR ("esil_div: Division by zero!");
 				esil->trap = R_ANAL_TRAP_DIVBYZERO;
@@ -1521,25 +1672,23 @@ static int esil_div(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_div: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_diveq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_reg_read (esil, dst, &d, NULL)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && r_anal_esil_reg_read (esil, dst->str, &d, NULL)) {
 			if (s) {
-				if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+				if (!isinternal (src)) {
 					esil->old = d;
 					esil->cur = d / s;
-					esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+					esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 				}
-				r_anal_esil_reg_write (esil, dst, d / s);
+				r_anal_esil_reg_write (esil, dst->str, d / s);
 			} else {
 				// eprintf ("0x%08"PFMT64x" esil_diveq: Division by zero!\n", esil->address);
 				esil->trap = R_ANAL_TRAP_DIVBYZERO;
@@ -1552,18 +1701,16 @@ static int esil_diveq(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_diveq: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_mul(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_get_parm (esil, dst, &d)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && getnum (esil, dst, &d)) {
 			r_anal_esil_pushnum (esil, d * s);
 			ret = 1;
 		} else {
@@ -1572,24 +1719,22 @@ static int esil_mul(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_mul: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_muleq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_reg_read (esil, dst, &d, NULL)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && r_anal_esil_reg_read (esil, dst->str, &d, NULL)) {
+			if (!isinternal (src)) {
 				esil->old = d;
 				esil->cur = d * s;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, s * d);
+			r_anal_esil_reg_write (esil, dst->str, s * d);
 			ret = true;
 		} else {
 			ERR ("esil_muleq: empty stack");
@@ -1597,101 +1742,94 @@ static int esil_muleq(RAnalEsil *esil) {
 	} else {
 		ERR ("esil_muleq: invalid parameters");
 	}
-	free (dst);
-	free (src);
 	return ret;
 }
 
 static int esil_add(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_get_parm (esil, dst, &d)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && getnum (esil, dst, &d)) {
 			r_anal_esil_pushnum (esil, s + d);
 			ret = true;
 		}
 	} else {
 		ERR ("esil_add: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_addeq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_reg_read (esil, dst, &d, NULL)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && r_anal_esil_reg_read (esil, dst->str, &d, NULL)) {
+			if (!isinternal (src)) {
 				esil->old = d;
 				esil->cur = d + s;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, s + d);
+			r_anal_esil_reg_write (esil, dst->str, s + d);
 			ret = true;
 		}
 	} else {
 		ERR ("esil_addeq: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_inc(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s;
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
 		s++;
 		r_anal_esil_pushnum (esil, s);
 		ret = true;
 	} else {
 		ERR ("esil_inc: invalid parameters");
 	}
-	free (src);
 	return ret;
 }
 
 static int esil_inceq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 sd;
-	char *src_dst = r_anal_esil_pop (esil);
-	if (src_dst && (r_anal_esil_get_parm_type (esil, src_dst) == R_ANAL_ESIL_PARM_REG) && r_anal_esil_get_parm (esil, src_dst, &sd)) {
+	RAnalEsilValue vsrc_dst, *src_dst = popv (esil, &vsrc_dst);
+	if (src_dst && (r_anal_esil_get_parm_type (esil, src_dst->str) == R_ANAL_ESIL_PARM_REG) && getnum (esil, src_dst, &sd)) {
 		// inc rax
 		esil->old = sd++;
 		esil->cur = sd;
-		r_anal_esil_reg_write (esil, src_dst, sd);
-		esil->lastsz = esil_internal_sizeof_reg (esil, src_dst);
+		r_anal_esil_reg_write (esil, src_dst->str, sd);
+		esil->lastsz = esil_internal_sizeof_reg (esil, src_dst->str);
 		ret = true;
 	} else {
 		ERR ("esil_inceq: invalid parameters");
 	}
-	free (src_dst);
 	return ret;
 }
 
 static int esil_sub(RAnalEsil *esil) {
 	ut64 s = 0, d = 0;
-	char * dst = r_anal_esil_pop (esil);
-	if (!dst) {
+	RAnalEsilValue dst;
+	if (!r_anal_esil_pop_value (esil, &dst)) {
 		goto dst_broken;
 	}
-	if (r_anal_esil_reg_read (esil, dst, &d, NULL)) {
-		esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+	if (dst.type == R_ANAL_ESIL_VAL_NUM) {
+		d = dst.num;
+		esil->lastsz = 64;
+	} else if (r_anal_esil_reg_read (esil, dst.str, &d, NULL)) {
+		esil->lastsz = esil_internal_sizeof_reg (esil, dst.str);
 	} else {
-		if (!isnum (esil, dst, &d)) {
-			free (dst);
+		if (!isnum (esil, dst.str, &d)) {
 			goto dst_broken;
 		}
 		esil->lastsz = 64;
 	}
-	free (dst);
 
 	if (!popRN (esil, &s)) {
 		ERR ("esil_sub: src is broken");
@@ -1710,56 +1848,52 @@ dst_broken:
 static int esil_subeq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
-		if (dst && r_anal_esil_reg_read (esil, dst, &d, NULL)) {
-			if (r_anal_esil_get_parm_type (esil, src) != R_ANAL_ESIL_PARM_INTERNAL) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
+		if (dst && r_anal_esil_reg_read (esil, dst->str, &d, NULL)) {
+			if (!isinternal (src)) {
 				esil->old = d;
 				esil->cur = d - s;
-				esil->lastsz = esil_internal_sizeof_reg (esil, dst);
+				esil->lastsz = esil_internal_sizeof_reg (esil, dst->str);
 			}
-			r_anal_esil_reg_write (esil, dst, d - s);
+			r_anal_esil_reg_write (esil, dst->str, d - s);
 			ret = true;
 		}
 	} else {
 		ERR ("esil_subeq: invalid parameters");
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
 static int esil_dec(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 s;
-	char *src = r_anal_esil_pop (esil);
-	if (src && r_anal_esil_get_parm (esil, src, &s)) {
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
+	if (src && getnum (esil, src, &s)) {
 		s--;
 		r_anal_esil_pushnum (esil, s);
 		ret = true;
 	} else {
 		ERR ("esil_dec: invalid parameters");
 	}
-	free (src);
 	return ret;
 }
 
 static int esil_deceq(RAnalEsil *esil) {
 	int ret = 0;
 	ut64 sd;
-	char *src_dst = r_anal_esil_pop (esil);
-	if (src_dst && (r_anal_esil_get_parm_type (esil, src_dst) == R_ANAL_ESIL_PARM_REG) && r_anal_esil_get_parm (esil, src_dst, &sd)) {
+	RAnalEsilValue vsrc_dst, *src_dst = popv (esil, &vsrc_dst);
+	if (src_dst && (r_anal_esil_get_parm_type (esil, src_dst->str) == R_ANAL_ESIL_PARM_REG) && getnum (esil, src_dst, &sd)) {
 		esil->old = sd;
 		sd--;
 		esil->cur = sd;
-		r_anal_esil_reg_write (esil, src_dst, sd);
-		esil->lastsz = esil_internal_sizeof_reg (esil, src_dst);
+		r_anal_esil_reg_write (esil, src_dst->str, sd);
+		esil->lastsz = esil_internal_sizeof_reg (esil, src_dst->str);
 		ret = true;
 	} else {
 		ERR ("esil_deceq: invalid parameters");
 	}
-	free (src_dst);
 	return ret;
 }
 
@@ -1769,20 +1903,17 @@ static int esil_poke_n(RAnalEsil *esil, int bits) {
 	ut64 num, num2, addr;
 	ut8 b[8] = {0};
 	ut64 n;
-	char *dst = r_anal_esil_pop (esil);
-	char *src = r_anal_esil_pop (esil);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc, *src = popv (esil, &vsrc);
 	int bytes = R_MIN (sizeof (b), bits / 8), ret = 0;
 	if (bits % 8) {
-		free (src);
-		free (dst);
 		return 0;
 	}
-	//eprintf ("GONA POKE %d src:%s dst:%s\n", bits, src, dst);
-	if (src && r_anal_esil_get_parm (esil, src, &num)) {
-		if (dst && r_anal_esil_get_parm (esil, dst, &addr)) {
+	if (src && getnum (esil, src, &num)) {
+		if (dst && getnum (esil, dst, &addr)) {
 			if (bits == 128) {
-				char *src2 = r_anal_esil_pop (esil);
-				if (src2 && r_anal_esil_get_parm (esil, src2, &num2)) {
+				RAnalEsilValue vsrc2, *src2 = popv (esil, &vsrc2);
+				if (src2 && getnum (esil, src2, &num2)) {
 					r_write_ble (b, num, esil->anal->big_endian, 64);
 					ret = r_anal_esil_mem_write (esil, addr, b, bytes);
 					r_write_ble (b, num2, esil->anal->big_endian, 64);
@@ -1791,8 +1922,7 @@ static int esil_poke_n(RAnalEsil *esil, int bits) {
 				}
 				return -1;
 			}
-			int type = r_anal_esil_get_parm_type (esil, src);
-			if (type != R_ANAL_ESIL_PARM_INTERNAL) {
+			if (!isinternal (src)) {
 				// this is a internal peek performed before a poke
 				// we disable hooks to avoid run hooks on internal peeks
 				void * oldhook = (void*)esil->cb.hook_mem_read;
@@ -1809,8 +1939,6 @@ static int esil_poke_n(RAnalEsil *esil, int bits) {
 			ret = r_anal_esil_mem_write (esil, addr, b, bytes);
 		}
 	}
-	free (src);
-	free (dst);
 	return ret;
 }
 
@@ -1846,26 +1974,25 @@ static int esil_poke_some(RAnalEsil *esil) {
 	int i, ret = 0;
 	int regsize;
 	ut64 ptr, regs = 0, tmp;
-	char *count, *dst = r_anal_esil_pop (esil);
+	RAnalEsilValue vcount, *count;
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
 #define BYTES_SIZE 64
-	if (dst && r_anal_esil_get_parm_size (esil, dst, &tmp, &regsize)) {
+	if (dst && r_anal_esil_value_num (esil, dst, &tmp, &regsize)) {
 		// reg
-		isregornum (esil, dst, &ptr);
-		count = r_anal_esil_pop (esil);
+		regornum (esil, dst, &ptr);
+		count = popv (esil, &vcount);
 		if (count) {
-			isregornum (esil, count, &regs);
+			regornum (esil, count, &regs);
 			if (regs > 0) {
 				ut8 b[BYTES_SIZE];
 				ut64 num64;
 				for (i = 0; i < regs; i++) {
-					char *foo = r_anal_esil_pop (esil);
+					RAnalEsilValue vfoo, *foo = popv (esil, &vfoo);
 					if (!foo) {
 						// avoid looping out of stack
-						free (dst);
-						free (count);
 						return 1;
 					}
-					isregornum (esil, foo, &num64);
+					regornum (esil, foo, &num64);
 					/* TODO: implement peek here */
 					// read from $dst
 					r_write_ble (b, num64, esil->anal->big_endian, regsize);
@@ -1875,14 +2002,10 @@ static int esil_poke_some(RAnalEsil *esil) {
 						esil->trap = 1;
 					}
 					ptr += BYTES_SIZE;
-					free (foo);
 				}
 			}
-			free (dst);
-			free (count);
 			return 1;
 		}
-		free (dst);
 	}
 	return 0;
 }
@@ -1893,22 +2016,17 @@ static int esil_peek_n(RAnalEsil *esil, int bits) {
 	if (bits & 7) {
 		return 0;
 	}
-	char res[32];
 	ut64 addr;
 	int ret = 0, bytes = bits / 8;
-	char *dst = r_anal_esil_pop (esil);
-	//eprintf ("GONA PEEK %d dst:%s\n", bits, dst);
-	if (dst && isregornum (esil, dst, &addr)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	if (dst && regornum (esil, dst, &addr)) {
 		if (bits == 128) {
 			ut8 a[sizeof(ut64) * 2] = {0};
 			ret = r_anal_esil_mem_read (esil, addr, a, bytes);
 			ut64 b = r_read_ble64 (&a, 0); //esil->anal->big_endian);
 			ut64 c = r_read_ble64 (&a[8], 0); //esil->anal->big_endian);
-			snprintf (res, sizeof (res), "0x%" PFMT64x, b);
-			r_anal_esil_push (esil, res);
-			snprintf (res, sizeof (res), "0x%" PFMT64x, c);
-			r_anal_esil_push (esil, res);
-			free (dst);
+			r_anal_esil_pushnum (esil, b);
+			r_anal_esil_pushnum (esil, c);
 			return ret;
 		}
 		ut64 bitmask = genmask (bits - 1);
@@ -1918,11 +2036,9 @@ static int esil_peek_n(RAnalEsil *esil, int bits) {
 		if (esil->anal->big_endian) {
 			r_mem_swapendian ((ut8*)&b, (const ut8*)&b, bytes);
 		}
-		snprintf (res, sizeof (res), "0x%" PFMT64x, b & bitmask);
-		r_anal_esil_push (esil, res);
+		r_anal_esil_pushnum (esil, b & bitmask);
 		esil->lastsz = bits;
 	}
-	free (dst);
 	return ret;
 }
 
@@ -1959,18 +2075,19 @@ static int esil_peek_some(RAnalEsil *esil) {
 	int i, ret = 0;
 	ut64 ptr, regs;
 	// pop ptr
-	char *count, *dst = r_anal_esil_pop (esil);
+	RAnalEsilValue vcount, *count;
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
 	if (dst) {
 		// reg
-		isregornum (esil, dst, &ptr);
-		count = r_anal_esil_pop (esil);
+		regornum (esil, dst, &ptr);
+		count = popv (esil, &vcount);
 		if (count) {
-			isregornum (esil, count, &regs);
+			regornum (esil, count, &regs);
 			if (regs > 0) {
 				ut32 num32;
 				ut8 a[sizeof (ut32)];
 				for (i = 0; i < regs; i++) {
-					char *foo = r_anal_esil_pop (esil);
+					RAnalEsilValue vfoo, *foo = popv (esil, &vfoo);
 					if (!foo) {
 						ERR ("Cannot pop in peek");
 						return 0;
@@ -1978,21 +2095,17 @@ static int esil_peek_some(RAnalEsil *esil) {
 					ret = r_anal_esil_mem_read (esil, ptr, a, 4);
 					if (ret == sizeof (ut32)) {
 						num32 = r_read_ble32 (a, esil->anal->big_endian);
-						r_anal_esil_reg_write (esil, foo, num32);
+						r_anal_esil_reg_write (esil, r_anal_esil_value_str (foo), num32);
 					} else {
 						if (esil->verbose) {
 							eprintf ("Cannot peek from 0x%08" PFMT64x "\n", ptr);
 						}
 					}
 					ptr += sizeof (ut32);
-					free (foo);
 				}
 			}
-			free (dst);
-			free (count);
 			return 1;
 		}
-		free (dst);
 	}
 	return 0;
 }
@@ -2002,26 +2115,23 @@ static int esil_peek_some(RAnalEsil *esil) {
 static int esil_mem_oreq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);  //save the dst-addr
-	char *src0 = r_anal_esil_pop (esil); //get the src
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) { 	//get the src
-		r_anal_esil_push (esil, dst);			//push the dst-addr
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) { 	//get the src
+		r_anal_esil_push_value (esil, dst);		//push the dst-addr
 		ret = (!!esil_peek_n (esil, bits));		//read
-		src1 = r_anal_esil_pop (esil);			//get the old dst-value
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) { //get the old dst-value
+		src1 = popv (esil, &vsrc1);			//get the old dst-value
+		if (src1 && getnum (esil, src1, &d)) { //get the old dst-value
 			d |= s;					//calculate the new dst-value
 			r_anal_esil_pushnum (esil, d);		//push the new dst-value
-			r_anal_esil_push (esil, dst);		//push the dst-addr
+			r_anal_esil_push_value (esil, dst);	//push the dst-addr
 			ret &= (!!esil_poke_n (esil, bits));	//write
 		} else ret = 0;
 	}
 	if (!ret) {
 		ERR ("esil_mem_oreq_n: invalid parameters");
 	}
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2046,26 +2156,23 @@ static int esil_mem_oreq(RAnalEsil *esil) {
 static int esil_mem_xoreq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d ^= s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret) {
 		ERR ("esil_mem_xoreq_n: invalid parameters");
 	}
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2090,26 +2197,23 @@ static int esil_mem_xoreq(RAnalEsil *esil) {
 static int esil_mem_andeq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d &= s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret) {
 		ERR ("esil_mem_andeq_n: invalid parameters");
 	}
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2134,25 +2238,22 @@ static int esil_mem_andeq(RAnalEsil *esil) {
 static int esil_mem_addeq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d += s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_addeq_n: invalid parameters");
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2177,25 +2278,22 @@ static int esil_mem_addeq(RAnalEsil *esil) {
 static int esil_mem_subeq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d -= s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_subeq_n: invalid parameters");
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2220,23 +2318,23 @@ static int esil_mem_subeq(RAnalEsil *esil) {
 static int esil_mem_modeq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
 		if (s == 0) {
 			ERR ("esil_mem_modeq4: Division by zero!");
 			esil->trap = R_ANAL_TRAP_DIVBYZERO;
 			esil->trap_code = 0;
 		} else {
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret = (!!esil_peek_n (esil, bits));
-			src1 = r_anal_esil_pop (esil);
-			if (src1 && r_anal_esil_get_parm (esil, src1, &d) && s >= 1) {
+			src1 = popv (esil, &vsrc1);
+			if (src1 && getnum (esil, src1, &d) && s >= 1) {
 				r_anal_esil_pushnum (esil, d % s);
 				d = d % s;
 				r_anal_esil_pushnum (esil, d);
-				r_anal_esil_push (esil, dst);
+				r_anal_esil_push_value (esil, dst);
 				ret &= (!!esil_poke_n (esil, bits));
 			} else {
 				ret = 0;
@@ -2246,9 +2344,6 @@ static int esil_mem_modeq_n(RAnalEsil *esil, int bits) {
 	if (!ret) {
 		ERR ("esil_mem_modeq_n: invalid parameters");
 	}
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2273,31 +2368,28 @@ static int esil_mem_modeq(RAnalEsil *esil) {
 static int esil_mem_diveq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
 		if (s == 0) {
 			ERR ("esil_mem_diveq8: Division by zero!");
 			esil->trap = R_ANAL_TRAP_DIVBYZERO;
 			esil->trap_code = 0;
 		} else {
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret = (!!esil_peek_n (esil, bits));
-			src1 = r_anal_esil_pop (esil);
-			if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+			src1 = popv (esil, &vsrc1);
+			if (src1 && getnum (esil, src1, &d)) {
 				d = d / s;
 				r_anal_esil_pushnum (esil, d);
-				r_anal_esil_push (esil, dst);
+				r_anal_esil_push_value (esil, dst);
 				ret &= (!!esil_poke_n (esil, bits));
 			} else ret = 0;
 		}
 	}
 	if (!ret)
 		ERR ("esil_mem_diveq_n: invalid parameters");
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2322,25 +2414,22 @@ static int esil_mem_diveq(RAnalEsil *esil) {
 static int esil_mem_muleq_n(RAnalEsil *esil, int bits, ut64 bitmask) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d *= s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_muleq_n: invalid parameters");
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2372,23 +2461,21 @@ static int esil_mem_muleq(RAnalEsil *esil) {
 static int esil_mem_inceq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s;
-	char *off = r_anal_esil_pop (esil);
-	char *src = NULL;
+	RAnalEsilValue voff, *off = popv (esil, &voff);
+	RAnalEsilValue vsrc, *src = NULL;
 	if (off) {
-		r_anal_esil_push (esil, off);
+		r_anal_esil_push_value (esil, off);
 		ret = (!!esil_peek_n (esil, bits));
-		src = r_anal_esil_pop (esil);
-		if (src && r_anal_esil_get_parm (esil, src, &s)) {
+		src = popv (esil, &vsrc);
+		if (src && getnum (esil, src, &s)) {
 			s++;
 			r_anal_esil_pushnum (esil, s);
-			r_anal_esil_push (esil, off);
+			r_anal_esil_push_value (esil, off);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_inceq_n: invalid parameters");
-	free (src);
-	free (off);
 	return ret;
 }
 
@@ -2413,23 +2500,21 @@ static int esil_mem_inceq(RAnalEsil *esil) {
 static int esil_mem_deceq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s;
-	char *off = r_anal_esil_pop (esil);
-	char *src = NULL;
+	RAnalEsilValue voff, *off = popv (esil, &voff);
+	RAnalEsilValue vsrc, *src = NULL;
 	if (off) {
-		r_anal_esil_push (esil, off);
+		r_anal_esil_push_value (esil, off);
 		ret = (!!esil_peek_n (esil, bits));
-		src = r_anal_esil_pop (esil);
-		if (src && r_anal_esil_get_parm (esil, src, &s)) {
+		src = popv (esil, &vsrc);
+		if (src && getnum (esil, src, &s)) {
 			s--;
 			r_anal_esil_pushnum (esil, s);
-			r_anal_esil_push (esil, off);
+			r_anal_esil_push_value (esil, off);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_deceq_n: invalid parameters");
-	free (src);
-	free (off);
 	return ret;
 }
 
@@ -2454,24 +2539,24 @@ static int esil_mem_deceq(RAnalEsil *esil) {
 static int esil_mem_lsleq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
 		if (s > sizeof (ut64) * 8) {
 			ERR ("esil_mem_lsleq_n: shift is too big");
 		} else {
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret = (!!esil_peek_n (esil, bits));
-			src1 = r_anal_esil_pop (esil);
-			if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+			src1 = popv (esil, &vsrc1);
+			if (src1 && getnum (esil, src1, &d)) {
 				if (s > 63) {
 					d = 0;
 				} else {
 					d <<= s;
 				}
 				r_anal_esil_pushnum (esil, d);
-				r_anal_esil_push (esil, dst);
+				r_anal_esil_push_value (esil, dst);
 				ret &= (!!esil_poke_n (esil, bits));
 			} else {
 				ret = 0;
@@ -2481,9 +2566,6 @@ static int esil_mem_lsleq_n(RAnalEsil *esil, int bits) {
 	if (!ret) {
 		ERR ("esil_mem_lsleq_n: invalid parameters");
 	}
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2508,25 +2590,22 @@ static int esil_mem_lsleq(RAnalEsil *esil) {
 static int esil_mem_lsreq_n(RAnalEsil *esil, int bits) {
 	int ret = 0;
 	ut64 s, d;
-	char *dst = r_anal_esil_pop (esil);
-	char *src0 = r_anal_esil_pop (esil);
-	char *src1 = NULL;
-	if (src0 && r_anal_esil_get_parm (esil, src0, &s)) {
-		r_anal_esil_push (esil, dst);
+	RAnalEsilValue vdst, *dst = popv (esil, &vdst);
+	RAnalEsilValue vsrc0, *src0 = popv (esil, &vsrc0);
+	RAnalEsilValue vsrc1, *src1 = NULL;
+	if (src0 && getnum (esil, src0, &s)) {
+		r_anal_esil_push_value (esil, dst);
 		ret = (!!esil_peek_n (esil, bits));
-		src1 = r_anal_esil_pop (esil);
-		if (src1 && r_anal_esil_get_parm (esil, src1, &d)) {
+		src1 = popv (esil, &vsrc1);
+		if (src1 && getnum (esil, src1, &d)) {
 			d >>= s;
 			r_anal_esil_pushnum (esil, d);
-			r_anal_esil_push (esil, dst);
+			r_anal_esil_push_value (esil, dst);
 			ret &= (!!esil_poke_n (esil, bits));
 		} else ret = 0;
 	}
 	if (!ret)
 		ERR ("esil_mem_lsreq_n: invalid parameters");
-	free (dst);
-	free (src0);
-	free (src1);
 	return ret;
 }
 
@@ -2566,15 +2645,13 @@ static int esil_num(RAnalEsil *esil) {
 static int esil_dup(RAnalEsil *esil) {
 	if (!esil || !esil->stack || esil->stackptr < 1 || esil->stackptr > (esil->stacksize - 1))
 		return false;
-	return r_anal_esil_push (esil, esil->stack[esil->stackptr-1]);
+	return r_anal_esil_push_value (esil, &esil->stack[esil->stackptr-1]);
 }
 
 static int esil_swap(RAnalEsil *esil) {
-	char *tmp;
+	RAnalEsilValue tmp;
 	if (!esil || !esil->stack || esil->stackptr < 2)
 		return false;
-	if (!esil->stack[esil->stackptr-1] || !esil->stack[esil->stackptr-2])
-		return false;
 	tmp = esil->stack[esil->stackptr-1];
 	esil->stack[esil->stackptr-1] = esil->stack[esil->stackptr-2];
 	esil->stack[esil->stackptr-2] = tmp;
@@ -2600,11 +2677,11 @@ static int __esil_generic_pick(RAnalEsil *esil, int rev) {
 		ERR ("esil_pick: index out of stack bounds");
 		goto end;
 	}
-	if (!esil->stack[esil->stackptr-i]) {
+	if (i < 1) {
 		ERR ("esil_pick: undefined element");
 		goto end;
 	}
-	if (!r_anal_esil_push (esil, esil->stack[esil->stackptr-i])) {
+	if (!r_anal_esil_push_value (esil, &esil->stack[esil->stackptr-i])) {
 		ERR ("ESIL stack is full");
 		esil->trap = 1;
 		esil->trap_code = 1;
@@ -2756,13 +2833,8 @@ static int esil_bigger_equal(RAnalEsil *esil) { // 'dst >= src' => 'src,dst,>='
 }
 
 static int iscommand(RAnalEsil *esil, const char *word, RAnalEsilOp *op) {
-	char t[128];
-	char *h = sdb_itoa (sdb_hash (word), t, 16);
-	if (sdb_num_exists (esil->ops, h)) {
-		*op = (RAnalEsilOp)(size_t)sdb_num_get (esil->ops, h, 0);
-		return true;
-	}
-	return false;
+	*op = r_anal_esil_get_op (esil, word);
+	return *op != NULL;
 }
 
 static int runword(RAnalEsil *esil, const char *word) {
@@ -2905,6 +2977,15 @@ R_API int r_anal_esil_parse(RAnalEsil *esil, const char *str) {
 			esil->cmd (esil, esil->cmd_todo, esil->address, 0);
 		}
 	}
+	if (!esil->Reil) {
+		ut64 key = esil->progs_by_expr? sdb_hash (str): esil->address;
+		RAnalEsilProg *prog = r_anal_esil_prog_get (esil, key, str);
+		if (prog) {
+			int ret = r_anal_esil_prog_run (esil, prog);
+			r_anal_esil_prog_unref (prog);
+			return ret;
+		}
+	}
 loop:
 	esil->repeat = 0;
 	esil->skip = 0;
@@ -2989,11 +3070,7 @@ R_API int r_anal_esil_runword(RAnalEsil *esil, const char *word) {
 //frees all elements from the stack, not the stack itself
 //rename to stack_empty() ?
 R_API void r_anal_esil_stack_free(RAnalEsil *esil) {
-	int i;
 	if (esil) {
-		for (i = 0; i < esil->stackptr; i++) {
-			R_FREE (esil->stack[i]);
-		}
 		esil->stackptr = 0;
 	}
 }
@@ -3022,137 +3099,205 @@ R_API int r_anal_esil_condition(RAnalEsil *esil, const char *str) {
 	return ret;
 }
 
+static const struct {
+	const char *name;
+	RAnalEsilOp op;
+} esil_builtin_ops[] = {
+	{ "$", esil_interrupt },
+	{ "==", esil_cmp },
+	{ "<", esil_smaller },
+	{ ">", esil_bigger },
+	{ "<=", esil_smaller_equal },
+	{ ">=", esil_bigger_equal },
+	{ "?{", esil_if },
+	{ "<<", esil_lsl },
+	{ "<<=", esil_lsleq },
+	{ ">>", esil_lsr },
+	{ ">>=", esil_lsreq },
+	{ ">>>>", esil_asr },
+	{ ">>>>=", esil_asreq },
+	{ ">>>", esil_ror },
+	{ "<<<", esil_rol },
+	{ "&", esil_and },
+	{ "&=", esil_andeq },
+	{ "}", esil_nop }, // just to avoid push
+	{ "|", esil_or },
+	{ "|=", esil_oreq },
+	{ "!", esil_neg },
+	{ "!=", esil_negeq },
+	{ "=", esil_eq },
+	{ "*", esil_mul },
+	{ "*=", esil_muleq },
+	{ "^", esil_xor },
+	{ "^=", esil_xoreq },
+	{ "+", esil_add },
+	{ "+=", esil_addeq },
+	{ "++", esil_inc },
+	{ "++=", esil_inceq },
+	{ "-", esil_sub },
+	{ "-=", esil_subeq },
+	{ "--", esil_dec },
+	{ "--=", esil_deceq },
+	{ "/", esil_div },
+	{ "/=", esil_diveq },
+	{ "%", esil_mod },
+	{ "%=", esil_modeq },
+	{ "=[]", esil_poke },
+	{ "=[1]", esil_poke1 },
+	{ "=[2]", esil_poke2 },
+	{ "=[3]", esil_poke3 },
+	{ "=[4]", esil_poke4 },
+	{ "=[8]", esil_poke8 },
+	{ "=[16]", esil_poke16 },
+	{ "|=[]", esil_mem_oreq },
+	{ "|=[1]", esil_mem_oreq1 },
+	{ "|=[2]", esil_mem_oreq2 },
+	{ "|=[4]", esil_mem_oreq4 },
+	{ "|=[8]", esil_mem_oreq8 },
+	{ "^=[]", esil_mem_xoreq },
+	{ "^=[1]", esil_mem_xoreq1 },
+	{ "^=[2]", esil_mem_xoreq2 },
+	{ "^=[4]", esil_mem_xoreq4 },
+	{ "^=[8]", esil_mem_xoreq8 },
+	{ "&=[]", esil_mem_andeq },
+	{ "&=[1]", esil_mem_andeq1 },
+	{ "&=[2]", esil_mem_andeq2 },
+	{ "&=[4]", esil_mem_andeq4 },
+	{ "&=[8]", esil_mem_andeq8 },
+	{ "+=[]", esil_mem_addeq },
+	{ "+=[1]", esil_mem_addeq1 },
+	{ "+=[2]", esil_mem_addeq2 },
+	{ "+=[4]", esil_mem_addeq4 },
+	{ "+=[8]", esil_mem_addeq8 },
+	{ "-=[]", esil_mem_subeq },
+	{ "-=[1]", esil_mem_subeq1 },
+	{ "-=[2]", esil_mem_subeq2 },
+	{ "-=[4]", esil_mem_subeq4 },
+	{ "-=[8]", esil_mem_subeq8 },
+	{ "%=[]", esil_mem_modeq },
+	{ "%=[1]", esil_mem_modeq1 },
+	{ "%=[2]", esil_mem_modeq2 },
+	{ "%=[4]", esil_mem_modeq4 },
+	{ "%=[8]", esil_mem_modeq8 },
+	{ "/=[]", esil_mem_diveq },
+	{ "/=[1]", esil_mem_diveq1 },
+	{ "/=[2]", esil_mem_diveq2 },
+	{ "/=[4]", esil_mem_diveq4 },
+	{ "/=[8]", esil_mem_diveq8 },
+	{ "*=[]", esil_mem_muleq },
+	{ "*=[1]", esil_mem_muleq1 },
+	{ "*=[2]", esil_mem_muleq2 },
+	{ "*=[4]", esil_mem_muleq4 },
+	{ "*=[8]", esil_mem_muleq8 },
+	{ "++=[]", esil_mem_inceq },
+	{ "++=[1]", esil_mem_inceq1 },
+	{ "++=[2]", esil_mem_inceq2 },
+	{ "++=[4]", esil_mem_inceq4 },
+	{ "++=[8]", esil_mem_inceq8 },
+	{ "--=[]", esil_mem_deceq },
+	{ "--=[1]", esil_mem_deceq1 },
+	{ "--=[2]", esil_mem_deceq2 },
+	{ "--=[4]", esil_mem_deceq4 },
+	{ "--=[8]", esil_mem_deceq8 },
+	{ "<<=[]", esil_mem_lsleq },
+	{ "<<=[1]", esil_mem_lsleq1 },
+	{ "<<=[2]", esil_mem_lsleq2 },
+	{ "<<=[4]", esil_mem_lsleq4 },
+	{ "<<=[8]", esil_mem_lsleq8 },
+	{ ">>=[]", esil_mem_lsreq },
+	{ ">>=[1]", esil_mem_lsreq1 },
+	{ ">>=[2]", esil_mem_lsreq2 },
+	{ ">>=[4]", esil_mem_lsreq4 },
+	{ ">>=[8]", esil_mem_lsreq8 },
+	{ "[]", esil_peek },
+	{ "[*]", esil_peek_some },
+	{ "=[*]", esil_poke_some },
+	{ "[1]", esil_peek1 },
+	{ "[2]", esil_peek2 },
+	{ "[3]", esil_peek3 },
+	{ "[4]", esil_peek4 },
+	{ "[8]", esil_peek8 },
+	{ "[16]", esil_peek16 },
+	{ "STACK", r_anal_esil_dumpstack },
+	{ "REPEAT", esil_repeat },
+	{ "POP", esil_pop },
+	{ "TODO", esil_todo },
+	{ "GOTO", esil_goto },
+	{ "BREAK", esil_break },
+	{ "CLEAR", esil_clear },
+	{ "DUP", esil_dup },
+	{ "NUM", esil_num },
+	{ "PICK", esil_pick },
+	{ "RPICK", esil_rpick },
+	{ "SWAP", esil_swap },
+	{ "TRAP", esil_trap },
+	{ "BITS", esil_bits },
+};
+
+// what name does when r_anal_esil_set_op didn't replace it
+R_API RAnalEsilOp r_anal_esil_builtin_op(const char *name) {
+	int i;
+	for (i = 0; i < R_ARRAY_SIZE (esil_builtin_ops); i++) {
+		if (!strcmp (esil_builtin_ops[i].name, name)) {
+			return esil_builtin_ops[i].op;
+		}
+	}
+	return NULL;
+}
+
+// fits the names of a bucket with the first displacement that doesn't
+// collide with the names already in the table
+static bool ops_fit_bucket(RAnalEsilOps *ops, int bucket) {
+	ut8 placed[R_ANAL_ESIL_OPS_SLOTS];
+	int i, n, disp;
+	for (disp = 0; disp < 256; disp++) {
+		for (i = n = 0; i < R_ARRAY_SIZE (esil_builtin_ops); i++) {
+			ut32 h = ophash (esil_builtin_ops[i].name);
+			if (h % R_ANAL_ESIL_OPS_BUCKETS != bucket) {
+				continue;
+			}
+			RAnalEsilOpSlot *s = &ops->slots[opslot (h, disp)];
+			if (s->name) {
+				break;
+			}
+			s->hash = h;
+			s->name = esil_builtin_ops[i].name;
+			s->op = esil_builtin_ops[i].op;
+			placed[n++] = s - ops->slots;
+		}
+		if (i == R_ARRAY_SIZE (esil_builtin_ops)) {
+			ops->disp[bucket] = disp;
+			return true;
+		}
+		while (n-- > 0) {
+			ops->slots[placed[n]].name = NULL;
+		}
+	}
+	return false;
+}
+
 static void r_anal_esil_setup_ops(RAnalEsil *esil) {
-#define OP(x, y) r_anal_esil_set_op (esil, x, y)
-	OP ("$", esil_interrupt);
-	OP ("==", esil_cmp);
-	OP ("<", esil_smaller);
-	OP (">", esil_bigger);
-	OP ("<=", esil_smaller_equal);
-	OP (">=", esil_bigger_equal);
-	OP ("?{", esil_if);
-	OP ("<<", esil_lsl);
-	OP ("<<=", esil_lsleq);
-	OP (">>", esil_lsr);
-	OP (">>=", esil_lsreq);
-	OP (">>>>", esil_asr);
-	OP (">>>>=", esil_asreq);
-	OP (">>>", esil_ror);
-	OP ("<<<", esil_rol);
-	OP ("&", esil_and);
-	OP ("&=", esil_andeq);
-	OP ("}", esil_nop); // just to avoid push
-	OP ("|", esil_or);
-	OP ("|=", esil_oreq);
-	OP ("!", esil_neg);
-	OP ("!=", esil_negeq);
-	OP ("=", esil_eq);
-	OP ("*", esil_mul);
-	OP ("*=", esil_muleq);
-	OP ("^", esil_xor);
-	OP ("^=", esil_xoreq);
-	OP ("+", esil_add);
-	OP ("+=", esil_addeq);
-	OP ("++", esil_inc);
-	OP ("++=", esil_inceq);
-	OP ("-", esil_sub);
-	OP ("-=", esil_subeq);
-	OP ("--", esil_dec);
-	OP ("--=", esil_deceq);
-	OP ("/", esil_div);
-	OP ("/=", esil_diveq);
-	OP ("%", esil_mod);
-	OP ("%=", esil_modeq);
-	OP ("=[]", esil_poke);
-	OP ("=[1]", esil_poke1);
-	OP ("=[2]", esil_poke2);
-	OP ("=[3]", esil_poke3);
-	OP ("=[4]", esil_poke4);
-	OP ("=[8]", esil_poke8);
-	OP ("=[16]", esil_poke16);
-	OP ("|=[]", esil_mem_oreq);
-	OP ("|=[1]", esil_mem_oreq1);
-	OP ("|=[2]", esil_mem_oreq2);
-	OP ("|=[4]", esil_mem_oreq4);
-	OP ("|=[8]", esil_mem_oreq8);
-	OP ("^=[]", esil_mem_xoreq);
-	OP ("^=[1]", esil_mem_xoreq1);
-	OP ("^=[2]", esil_mem_xoreq2);
-	OP ("^=[4]", esil_mem_xoreq4);
-	OP ("^=[8]", esil_mem_xoreq8);
-	OP ("&=[]", esil_mem_andeq);
-	OP ("&=[1]", esil_mem_andeq1);
-	OP ("&=[2]", esil_mem_andeq2);
-	OP ("&=[4]", esil_mem_andeq4);
-	OP ("&=[8]", esil_mem_andeq8);
-	OP ("+=[]", esil_mem_addeq);
-	OP ("+=[1]", esil_mem_addeq1);
-	OP ("+=[2]", esil_mem_addeq2);
-	OP ("+=[4]", esil_mem_addeq4);
-	OP ("+=[8]", esil_mem_addeq8);
-	OP ("-=[]", esil_mem_subeq);
-	OP ("-=[1]", esil_mem_subeq1);
-	OP ("-=[2]", esil_mem_subeq2);
-	OP ("-=[4]", esil_mem_subeq4);
-	OP ("-=[8]", esil_mem_subeq8);
-	OP ("%=[]", esil_mem_modeq);
-	OP ("%=[1]", esil_mem_modeq1);
-	OP ("%=[2]", esil_mem_modeq2);
-	OP ("%=[4]", esil_mem_modeq4);
-	OP ("%=[8]", esil_mem_modeq8);
-	OP ("/=[]", esil_mem_diveq);
-	OP ("/=[1]", esil_mem_diveq1);
-	OP ("/=[2]", esil_mem_diveq2);
-	OP ("/=[4]", esil_mem_diveq4);
-	OP ("/=[8]", esil_mem_diveq8);
-	OP ("*=[]", esil_mem_muleq);
-	OP ("*=[1]", esil_mem_muleq1);
-	OP ("*=[2]", esil_mem_muleq2);
-	OP ("*=[4]", esil_mem_muleq4);
-	OP ("*=[8]", esil_mem_muleq8);
-	OP ("++=[]", esil_mem_inceq);
-	OP ("++=[1]", esil_mem_inceq1);
-	OP ("++=[2]", esil_mem_inceq2);
-	OP ("++=[4]", esil_mem_inceq4);
-	OP ("++=[8]", esil_mem_inceq8);
-	OP ("--=[]", esil_mem_deceq);
-	OP ("--=[1]", esil_mem_deceq1);
-	OP ("--=[2]", esil_mem_deceq2);
-	OP ("--=[4]", esil_mem_deceq4);
-	OP ("--=[8]", esil_mem_deceq8);
-        OP ("<<=[]", esil_mem_lsleq);
-	OP ("<<=[1]", esil_mem_lsleq1);
-	OP ("<<=[2]", esil_mem_lsleq2);
-	OP ("<<=[4]", esil_mem_lsleq4);
-	OP ("<<=[8]", esil_mem_lsleq8);
-	OP (">>=[]", esil_mem_lsreq);
-	OP (">>=[1]", esil_mem_lsreq1);
-	OP (">>=[2]", esil_mem_lsreq2);
-	OP (">>=[4]", esil_mem_lsreq4);
-	OP (">>=[8]", esil_mem_lsreq8);
-	OP ("[]", esil_peek);
-	OP ("[*]", esil_peek_some);
-	OP ("=[*]", esil_poke_some);
-	OP ("[1]", esil_peek1);
-	OP ("[2]", esil_peek2);
-	OP ("[3]", esil_peek3);
-	OP ("[4]", esil_peek4);
-	OP ("[8]", esil_peek8);
-	OP ("[16]", esil_peek16);
-	OP ("STACK", r_anal_esil_dumpstack);
-	OP ("REPEAT", esil_repeat);
-	OP ("POP", esil_pop);
-	OP ("TODO", esil_todo);
-	OP ("GOTO", esil_goto);
-	OP ("BREAK", esil_break);
-	OP ("CLEAR", esil_clear);
-	OP ("DUP", esil_dup);
-	OP ("NUM", esil_num);
-	OP ("PICK", esil_pick);
-	OP ("RPICK", esil_rpick);
-	OP ("SWAP", esil_swap);
-	OP ("TRAP", esil_trap);
-	OP ("BITS", esil_bits);
+	int count[R_ANAL_ESIL_OPS_BUCKETS] = {0};
+	int i, b, size;
+	memset (esil->ops, 0, sizeof (RAnalEsilOps));
+	for (i = 0; i < R_ARRAY_SIZE (esil_builtin_ops); i++) {
+		count[ophash (esil_builtin_ops[i].name) % R_ANAL_ESIL_OPS_BUCKETS]++;
+	}
+	// the fullest buckets go first, they are the hardest to fit
+	for (size = R_ARRAY_SIZE (esil_builtin_ops); size > 0; size--) {
+		for (b = 0; b < R_ANAL_ESIL_OPS_BUCKETS; b++) {
+			if (count[b] != size || ops_fit_bucket (esil->ops, b)) {
+				continue;
+			}
+			// only if the table gets too full: run them from the other ops
+			for (i = 0; i < R_ARRAY_SIZE (esil_builtin_ops); i++) {
+				if (ophash (esil_builtin_ops[i].name) % R_ANAL_ESIL_OPS_BUCKETS == b) {
+					r_anal_esil_set_op (esil, esil_builtin_ops[i].name, esil_builtin_ops[i].op);
+				}
+			}
+		}
+	}
+	r_anal_esil_prog_reset (esil);
 }
 
 /* register callbacks using this anal module. */
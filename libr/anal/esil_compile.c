@@ -0,0 +1,208 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// r_anal_esil_parse splits the expression in words and looks every word up
+// in esil->ops each time it runs. Here the expression is split once into
+// instructions with the op handlers already resolved and the operands
+// already parsed into stack values, and the result is kept per address in
+// esil->progs, so emulating the same instruction again only walks the
+// array. With esil->progs_by_expr the key is the hash of the expression,
+// so /E and ae don't compile again at every address. The expressions
+// using ';' or '#!' aren't compiled, r_anal_esil_parse runs those as text.
+
+#include <r_anal.h>
+
+#define PROG_WORD_MAX 63 // same limit as r_anal_esil_parse
+
+static inline ut32 prog_slot(ut64 addr) {
+	ut64 h = addr * 0x9e3779b97f4a7c15ULL;
+	return (ut32)(h >> 32) & (R_ANAL_ESIL_PROGS - 1);
+}
+
+static void prog_free(RAnalEsilProg *prog) {
+	r_anal_esil_jit_free (prog->jit);
+	free (prog->expr);
+	free (prog->words);
+	free (prog->insns);
+	free (prog);
+}
+
+R_API void r_anal_esil_prog_unref(RAnalEsilProg *prog) {
+	if (prog && --prog->refs < 1) {
+		prog_free (prog);
+	}
+}
+
+// NULL when the expression can't be compiled
+R_API RAnalEsilProg *r_anal_esil_compile(RAnalEsil *esil, const char *expr) {
+	int i, n = 1;
+	char *w;
+	if (!esil || !expr || !*expr || strchr (expr, ';') || strstr (expr, "#!")) {
+		return NULL;
+	}
+	for (i = 0; expr[i]; i++) {
+		if (expr[i] == ',') {
+			n++;
+		}
+	}
+	RAnalEsilProg *prog = R_NEW0 (RAnalEsilProg);
+	if (!prog) {
+		return NULL;
+	}
+	prog->expr = strdup (expr);
+	prog->words = strdup (expr);
+	prog->insns = calloc (n, sizeof (RAnalEsilInsn));
+	if (!prog->expr || !prog->words || !prog->insns) {
+		prog_free (prog);
+		return NULL;
+	}
+	prog->refs = 1;
+	for (w = prog->words, i = 0; i < n; i++) {
+		RAnalEsilInsn *in = &prog->insns[i];
+		char *next = strchr (w, ',');
+		if (next) {
+			*next++ = 0;
+		}
+		if (strlen (w) > PROG_WORD_MAX - 1) {
+			prog_free (prog);
+			return NULL;
+		}
+		in->word = w;
+		if (!*w) {
+			in->kind = R_ANAL_ESIL_INSN_NOP;
+		} else if (!strcmp (w, "}{")) {
+			in->kind = R_ANAL_ESIL_INSN_ELSE;
+		} else if (!strcmp (w, "}")) {
+			in->kind = R_ANAL_ESIL_INSN_ENDIF;
+		} else if ((in->op = r_anal_esil_get_op (esil, w))) {
+			in->kind = R_ANAL_ESIL_INSN_OP;
+		} else {
+			RRegItem *ri;
+			in->kind = R_ANAL_ESIL_INSN_PUSH;
+			r_anal_esil_value_set (esil, &in->val, w);
+			// a register that goes away is still found by name when popped
+			if (in->val.type == R_ANAL_ESIL_VAL_STR && *w != ESIL_INTERNAL_PREFIX
+					&& esil->anal && (ri = r_reg_get (esil->anal->reg, w, -1))) {
+				in->val.type = R_ANAL_ESIL_VAL_REG;
+				in->val.reg = ri->index;
+			}
+		}
+		w = next;
+	}
+	// a trailing comma is not a word GOTO can reach
+	prog->ninsns = (n > 1 && !*prog->insns[n - 1].word)? n - 1: n;
+	return prog;
+}
+
+// runs prog the way r_anal_esil_parse runs its text
+R_API int r_anal_esil_prog_run(RAnalEsil *esil, RAnalEsilProg *prog) {
+	int pc, ret;
+	if (esil->jit && r_anal_esil_jit_run (esil, prog, &ret)) {
+		return ret;
+	}
+loop:
+	esil->repeat = 0;
+	esil->skip = 0;
+	esil->parse_goto = -1;
+	esil->parse_stop = 0;
+	esil->parse_goto_count = esil->anal? esil->anal->esil_goto_limit: R_ANAL_ESIL_GOTO_LIMIT;
+	for (pc = 0; pc < prog->ninsns; pc++) {
+		RAnalEsilInsn *in = &prog->insns[pc];
+		if (in->kind == R_ANAL_ESIL_INSN_NOP) {
+			continue;
+		}
+		if (--esil->parse_goto_count < 1) {
+			if (esil->verbose) {
+				eprintf ("0x%08"PFMT64x" ESIL infinite loop detected\n", esil->address);
+			}
+			esil->trap = 1;
+			esil->parse_stop = 1;
+			return 0;
+		}
+		switch (in->kind) {
+		case R_ANAL_ESIL_INSN_ELSE:
+			esil->skip = esil->skip? 0: 1;
+			break;
+		case R_ANAL_ESIL_INSN_ENDIF:
+			esil->skip = 0;
+			break;
+		case R_ANAL_ESIL_INSN_OP:
+			if (esil->skip) {
+				break;
+			}
+			if (esil->cb.hook_command && esil->cb.hook_command (esil, in->word)) {
+				break;
+			}
+			if (!in->op (esil)) {
+				return 0;
+			}
+			break;
+		default:
+			if (esil->skip) {
+				break;
+			}
+			if (!r_anal_esil_push_value (esil, &in->val)) {
+				if (esil->verbose) {
+					eprintf ("0x%08"PFMT64x" ESIL stack is full\n", esil->address);
+				}
+				esil->trap = 1;
+				esil->trap_code = 1;
+			}
+			break;
+		}
+		if (esil->repeat) {
+			goto loop;
+		}
+		if (esil->parse_goto != -1) {
+			if (esil->parse_goto < 0 || esil->parse_goto >= prog->ninsns) {
+				if (esil->verbose) {
+					eprintf ("Cannot find word %d\n", esil->parse_goto);
+				}
+				return 0;
+			}
+			pc = esil->parse_goto - 1;
+			esil->parse_goto = -1;
+			continue;
+		}
+		if (esil->parse_stop) {
+			if (esil->parse_stop == 2) {
+				const char *rest = prog->expr + (in->word - prog->words) + strlen (in->word);
+				eprintf ("ESIL TODO: %s\n", *rest? rest + 1: rest);
+			}
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// the program of expr at addr, compiled on the first use. The caller owns
+// a reference, drop it with r_anal_esil_prog_unref
+R_API RAnalEsilProg *r_anal_esil_prog_get(RAnalEsil *esil, ut64 addr, const char *expr) {
+	if (!esil->progs && !(esil->progs = calloc (R_ANAL_ESIL_PROGS, sizeof (RAnalEsilProg *)))) {
+		return NULL;
+	}
+	RAnalEsilProg **slot = &esil->progs[prog_slot (addr)];
+	RAnalEsilProg *prog = *slot;
+	if (prog && prog->addr == addr && !strcmp (prog->expr, expr)) {
+		prog->refs++;
+		return prog;
+	}
+	if (!(prog = r_anal_esil_compile (esil, expr))) {
+		return NULL;
+	}
+	prog->addr = addr;
+	r_anal_esil_prog_unref (*slot);
+	*slot = prog;
+	prog->refs++;
+	return prog;
+}
+
+R_API void r_anal_esil_prog_reset(RAnalEsil *esil) {
+	int i;
+	if (!esil || !esil->progs) {
+		return;
+	}
+	for (i = 0; i < R_ANAL_ESIL_PROGS; i++) {
+		r_anal_esil_prog_unref (esil->progs[i]);
+		esil->progs[i] = NULL;
+	}
+}
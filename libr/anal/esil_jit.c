@@ -0,0 +1,276 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Translation of the hot esil programs (e esil.jit). shlr/tcc only has
+// the C parser, so instead of native code a program is translated to a
+// short list of register operations: the esil stack is resolved when
+// translating, numbers are folded, and the registers are accessed through
+// their RRegItem without looking them up by name. Only the straight-line
+// programs using the arithmetic, logic and assignment ops are translated,
+// the rest keep running in r_anal_esil_prog_run. A translation is used
+// while the registers are accessed with the internal callbacks, nothing
+// hooks them (traces, stats, hook_command) and the register profile is the
+// one it was translated for; it goes away with its program, which is
+// dropped when the expression at the address changes.
+
+#include <r_anal.h>
+
+enum {
+	JIT_CONST,
+	JIT_REG,
+	JIT_TEMP,
+};
+
+enum {
+	JIT_MOV, // =
+	JIT_ADD,
+	JIT_SUB,
+	JIT_MUL,
+	JIT_AND,
+	JIT_OR,
+	JIT_XOR,
+	JIT_SHL,
+	JIT_SHR,
+};
+
+typedef struct {
+	int kind;
+	int temp;
+	ut64 num;
+	RRegItem *ri;
+} JitArg;
+
+typedef struct {
+	int op;
+	int temp; // written when ri is NULL
+	int words; // words run when it is done, for parse_goto_count
+	bool guard; // the pc, sp or bp, not written with zero when nonull
+	RRegItem *ri; // the register assigned
+	JitArg a; // the top of the stack, the dst of the esil op
+	JitArg b;
+} JitInsn;
+
+struct r_anal_esil_jit_t {
+	RReg *reg;
+	ut32 gen;
+	int words;
+	int depth; // max esil stack entries the program would use
+	int ntemps;
+	int ninsns;
+	JitInsn *insns;
+};
+
+typedef struct r_anal_esil_jit_t RAnalEsilJit;
+
+static const struct {
+	const char *name;
+	int op;
+	bool assign;
+} jit_ops[] = {
+	{ "=", JIT_MOV, true },
+	{ "+=", JIT_ADD, true },
+	{ "-=", JIT_SUB, true },
+	{ "*=", JIT_MUL, true },
+	{ "&=", JIT_AND, true },
+	{ "|=", JIT_OR, true },
+	{ "^=", JIT_XOR, true },
+	{ "+", JIT_ADD, false },
+	{ "-", JIT_SUB, false },
+	{ "*", JIT_MUL, false },
+	{ "&", JIT_AND, false },
+	{ "|", JIT_OR, false },
+	{ "^", JIT_XOR, false },
+	{ "<<", JIT_SHL, false },
+	{ ">>", JIT_SHR, false },
+};
+
+R_API void r_anal_esil_jit_free(RAnalEsilJit *jit) {
+	if (jit) {
+		free (jit->insns);
+		free (jit);
+	}
+}
+
+static inline ut64 jit_compute(int op, ut64 d, ut64 s) {
+	switch (op) {
+	case JIT_ADD: return d + s;
+	case JIT_SUB: return d - s;
+	case JIT_MUL: return d * s;
+	case JIT_AND: return d & s;
+	case JIT_OR: return d | s;
+	case JIT_XOR: return d ^ s;
+	case JIT_SHL: return (s > 63)? 0: d << s;
+	case JIT_SHR: return d >> R_MIN (s, 63);
+	}
+	return s;
+}
+
+static bool is_guarded(RReg *reg, RRegItem *ri) {
+	const char *pc = r_reg_get_name (reg, R_REG_NAME_PC);
+	const char *sp = r_reg_get_name (reg, R_REG_NAME_SP);
+	const char *bp = r_reg_get_name (reg, R_REG_NAME_BP);
+	return !strcmp (ri->name, pc? pc: "pc") || !strcmp (ri->name, sp? sp: "sp")
+		|| !strcmp (ri->name, bp? bp: "bp");
+}
+
+// NULL when prog uses something that isn't translated
+static RAnalEsilJit *jit_translate(RAnalEsil *esil, RAnalEsilProg *prog) {
+	RReg *reg = esil->anal->reg;
+	JitArg stack[32];
+	int i, j, sp = 0, words = 0;
+	RAnalEsilJit *jit = R_NEW0 (RAnalEsilJit);
+	if (!jit || !(jit->insns = calloc (prog->ninsns, sizeof (JitInsn)))) {
+		free (jit);
+		return NULL;
+	}
+	jit->reg = reg;
+	jit->gen = reg->profile_gen;
+	for (i = 0; i < prog->ninsns; i++) {
+		RAnalEsilInsn *in = &prog->insns[i];
+		JitArg *arg;
+		if (in->kind == R_ANAL_ESIL_INSN_NOP) {
+			continue;
+		}
+		words++;
+		switch (in->kind) {
+		case R_ANAL_ESIL_INSN_PUSH:
+			if (sp >= R_ARRAY_SIZE (stack)) {
+				goto fail;
+			}
+			arg = &stack[sp++];
+			memset (arg, 0, sizeof (JitArg));
+			if (in->val.type == R_ANAL_ESIL_VAL_NUM) {
+				arg->kind = JIT_CONST;
+				arg->num = in->val.num;
+			} else if (in->val.type == R_ANAL_ESIL_VAL_REG && (arg->ri = r_reg_get (reg, in->val.str, -1))) {
+				arg->kind = JIT_REG;
+			} else {
+				goto fail;
+			}
+			jit->depth = R_MAX (jit->depth, sp);
+			continue;
+		case R_ANAL_ESIL_INSN_OP:
+			break;
+		default:
+			goto fail;
+		}
+		for (j = 0; j < R_ARRAY_SIZE (jit_ops); j++) {
+			if (!strcmp (jit_ops[j].name, in->word)) {
+				break;
+			}
+		}
+		if (j == R_ARRAY_SIZE (jit_ops) || sp < 2 || in->op != r_anal_esil_builtin_op (in->word)) {
+			goto fail;
+		}
+		JitInsn *ji = &jit->insns[jit->ninsns];
+		ji->op = jit_ops[j].op;
+		ji->a = stack[--sp];
+		ji->b = stack[--sp];
+		ji->words = words;
+		if (jit_ops[j].assign) {
+			if (ji->a.kind != JIT_REG || (ji->op == JIT_MOV && ji->a.ri->packed_size > 0)) {
+				goto fail;
+			}
+			ji->ri = ji->a.ri;
+			ji->guard = is_guarded (reg, ji->ri);
+			jit->ninsns++;
+			continue;
+		}
+		if (ji->op == JIT_SHL && (ji->b.kind != JIT_CONST || ji->b.num > 64)) {
+			// a bigger shift fails and stops the expression
+			goto fail;
+		}
+		arg = &stack[sp++];
+		memset (arg, 0, sizeof (JitArg));
+		if (ji->op != JIT_SUB && ji->a.kind == JIT_CONST && ji->b.kind == JIT_CONST) {
+			arg->kind = JIT_CONST;
+			arg->num = jit_compute (ji->op, ji->a.num, ji->b.num);
+			continue;
+		}
+		arg->kind = JIT_TEMP;
+		arg->temp = ji->temp = jit->ntemps++;
+		jit->ninsns++;
+	}
+	// what is left would stay in the esil stack
+	if (sp || !jit->ninsns) {
+		goto fail;
+	}
+	jit->words = words;
+	return jit;
+fail:
+	r_anal_esil_jit_free (jit);
+	return NULL;
+}
+
+static inline ut64 jit_arg(RReg *reg, JitArg *arg, ut64 *temps) {
+	switch (arg->kind) {
+	case JIT_REG: return r_reg_get_value (reg, arg->ri);
+	case JIT_TEMP: return temps[arg->temp];
+	}
+	return arg->num;
+}
+
+// runs what the program does in r_anal_esil_prog_run, false when it can't
+R_API bool r_anal_esil_jit_run(RAnalEsil *esil, RAnalEsilProg *prog, int *ret) {
+	RAnalEsilJit *jit = prog->jit;
+	int i, limit = esil->anal? esil->anal->esil_goto_limit: R_ANAL_ESIL_GOTO_LIMIT;
+	bool nonull;
+	ut64 stemps[32], *temps = stemps;
+	if (!jit) {
+		if (prog->nojit || ++prog->runs < R_ANAL_ESIL_JIT_HOT || !esil->anal || !esil->anal->reg) {
+			return false;
+		}
+		if (!(jit = prog->jit = jit_translate (esil, prog))) {
+			prog->nojit = true;
+			return false;
+		}
+	}
+	RReg *reg = esil->anal->reg;
+	if (reg != jit->reg || reg->profile_gen != jit->gen || jit->words >= limit
+			|| esil->stackptr + jit->depth > esil->stacksize || !r_anal_esil_reg_cb_internal (esil, &nonull)) {
+		return false;
+	}
+	if (jit->ntemps > R_ARRAY_SIZE (stemps) && !(temps = malloc (jit->ntemps * sizeof (ut64)))) {
+		return false;
+	}
+	esil->repeat = 0;
+	esil->skip = 0;
+	esil->parse_goto = -1;
+	esil->parse_stop = 0;
+	esil->parse_goto_count = limit - jit->words;
+	*ret = 1;
+	for (i = 0; i < jit->ninsns; i++) {
+		JitInsn *ji = &jit->insns[i];
+		ut64 d, s = jit_arg (reg, &ji->b, temps);
+		if (!ji->ri) {
+			d = jit_arg (reg, &ji->a, temps);
+			temps[ji->temp] = jit_compute (ji->op, d, s);
+			if (ji->op == JIT_SUB) {
+				esil->old = d;
+				esil->cur = temps[ji->temp];
+				esil->lastsz = (ji->a.kind == JIT_REG)? ji->a.ri->size: 64;
+			}
+			continue;
+		}
+		d = r_reg_get_value (reg, ji->ri);
+		ut64 res = jit_compute (ji->op, d, s);
+		bool written = !(nonull && ji->guard && !res);
+		if (written) {
+			r_reg_set_value (reg, ji->ri, res);
+		}
+		if (written || ji->op != JIT_MOV) {
+			esil->old = d;
+			esil->cur = res;
+			esil->lastsz = ji->ri->size;
+		}
+		if (!written && ji->op == JIT_MOV) {
+			// esil_eq fails and stops the expression
+			esil->parse_goto_count = limit - ji->words;
+			*ret = 0;
+			break;
+		}
+	}
+	if (temps != stemps) {
+		free (temps);
+	}
+	return true;
+}
@@ -1,112 +1,455 @@
 /* radare - LGPL - Copyright 2015-2018 - pancake */
 
+// r_anal_esil_trace records the register and memory accesses of every
+// traced instruction as fixed size events. The events are appended to a
+// ring of R_ANAL_ESIL_TRACE_CHUNKS chunks, an instruction starts with its
+// R_ANAL_ESIL_TRACE_STEP event followed by its accesses. Registers are
+// stored as an index in trace->regs. trace->steps finds the events of a
+// step and trace->addrs the last step at an address, each step linking
+// to the previous one at the same address. When the ring is full the
+// oldest chunk is dropped, or lz4 compressed to the spill file when
+// esil.trace.spill is set, and read back from there when queried. The
+// steps whose events are gone are dropped from both indexes too, only a
+// spilled trace keeps the index of all its steps.
+
 #include <r_anal.h>
+#include <lz4.h>
+
+#define CHUNK_SIZE (R_ANAL_ESIL_TRACE_CHUNK * sizeof (RAnalEsilTraceEvent))
+
+typedef struct {
+	ut64 off;
+	int size;
+} TraceSpill;
+
+static inline ut32 addr_hash(ut64 addr) {
+	ut64 h = addr * 0x9e3779b97f4a7c15ULL;
+	return (ut32)(h >> 32);
+}
+
+static inline ut32 name_hash(const char *s) {
+	ut32 h = 5381;
+	for (; *s; s++) {
+		h = (h * 33) ^ (ut8)*s;
+	}
+	return h;
+}
+
+static RAnalEsilTrace *trace_new(void) {
+	RAnalEsilTrace *t = R_NEW0 (RAnalEsilTrace);
+	if (!t) {
+		return NULL;
+	}
+	if (!(t->chunks = calloc (R_ANAL_ESIL_TRACE_CHUNKS, sizeof (RAnalEsilTraceEvent *)))) {
+		free (t);
+		return NULL;
+	}
+	r_vector_init (&t->steps, sizeof (RAnalEsilTraceStep), NULL, NULL);
+	r_vector_init (&t->spilled, sizeof (TraceSpill), NULL, NULL);
+	return t;
+}
+
+static void spill_close(RAnalEsilTrace *t) {
+	if (t->spill) {
+		fclose (t->spill);
+		r_file_rm (t->spill_path);
+		t->spill = NULL;
+	}
+	R_FREE (t->spill_path);
+	r_vector_clear (&t->spilled);
+	R_FREE (t->cache);
+}
+
+R_API void r_anal_esil_trace_free(RAnalEsilTrace *t) {
+	int i;
+	if (!t) {
+		return;
+	}
+	spill_close (t);
+	for (i = 0; i < R_ANAL_ESIL_TRACE_CHUNKS; i++) {
+		free (t->chunks[i]);
+	}
+	free (t->chunks);
+	r_vector_clear (&t->steps);
+	free (t->addrs);
+	for (i = 0; i < t->nregs; i++) {
+		free (t->regs[i]);
+	}
+	free (t->regs);
+	free (t->regids);
+	free (t);
+}
+
+// drops the events and restarts the step numbers, the chunks are kept
+R_API void r_anal_esil_trace_reset(RAnalEsil *esil) {
+	RAnalEsilTrace *t = esil? esil->trace: NULL;
+	if (!t) {
+		return;
+	}
+	t->nevents = 0;
+	t->first = 0;
+	r_vector_clear (&t->steps);
+	t->steps_base = t->steps_first = 0;
+	R_FREE (t->addrs);
+	t->saddrs = t->naddrs = 0;
+	if (t->spill) {
+		char *path = strdup (t->spill_path);
+		spill_close (t);
+		r_anal_esil_trace_spill (esil, path);
+		free (path);
+	}
+	esil->trace_idx = 0;
+}
+
+// chunks dropped from the ring go to path, an empty path stops spilling
+R_API bool r_anal_esil_trace_spill(RAnalEsil *esil, const char *path) {
+	if (!esil->trace && !(esil->trace = trace_new ())) {
+		return false;
+	}
+	RAnalEsilTrace *t = esil->trace;
+	spill_close (t);
+	if (!path || !*path) {
+		return true;
+	}
+	if (!(t->spill = r_sandbox_fopen (path, "wb+"))) {
+		eprintf ("Cannot open %s for the esil trace\n", path);
+		return false;
+	}
+	t->spill_path = strdup (path);
+	return true;
+}
+
+// a failed write ends the spilled range, the next chunks are dropped
+static void spill_chunk(RAnalEsilTrace *t, ut64 c, RAnalEsilTraceEvent *chunk) {
+	int bound = LZ4_compressBound (CHUNK_SIZE);
+	char *z;
+	if (t->spilled.len && c != t->spill_first + t->spilled.len) {
+		return;
+	}
+	if (!(z = malloc (bound))) {
+		return;
+	}
+	TraceSpill s = { 0, LZ4_compress_default ((const char *)chunk, z, CHUNK_SIZE, bound) };
+	if (s.size > 0 && !fseek (t->spill, 0, SEEK_END)) {
+		s.off = ftell (t->spill);
+		if (fwrite (z, 1, s.size, t->spill) == (size_t)s.size) {
+			if (!t->spilled.len) {
+				t->spill_first = c;
+			}
+			r_vector_push (&t->spilled, &s);
+		}
+	}
+	free (z);
+}
+
+static RAnalEsilTraceEvent *spilled_chunk(RAnalEsilTrace *t, ut64 c) {
+	if (!t->spill || c < t->spill_first || c - t->spill_first >= t->spilled.len) {
+		return NULL;
+	}
+	if (t->cache && t->cache_chunk == c) {
+		return t->cache;
+	}
+	TraceSpill *s = r_vector_index_ptr (&t->spilled, c - t->spill_first);
+	char *z = malloc (s->size);
+	if (!z || (!t->cache && !(t->cache = malloc (CHUNK_SIZE)))) {
+		free (z);
+		return NULL;
+	}
+	t->cache_chunk = UT64_MAX;
+	if (!fseek (t->spill, s->off, SEEK_SET) && fread (z, 1, s->size, t->spill) == (size_t)s->size
+			&& LZ4_decompress_safe (z, (char *)t->cache, s->size, CHUNK_SIZE) == CHUNK_SIZE) {
+		t->cache_chunk = c;
+	}
+	free (z);
+	return (t->cache_chunk == c)? t->cache: NULL;
+}
+
+// the pointer is valid until the next event is read or recorded
+static RAnalEsilTraceEvent *trace_event(RAnalEsilTrace *t, ut64 seq) {
+	ut64 c = seq / R_ANAL_ESIL_TRACE_CHUNK;
+	if (seq >= t->nevents) {
+		return NULL;
+	}
+	if (c >= t->first) {
+		return &t->chunks[c % R_ANAL_ESIL_TRACE_CHUNKS][seq % R_ANAL_ESIL_TRACE_CHUNK];
+	}
+	RAnalEsilTraceEvent *chunk = spilled_chunk (t, c);
+	return chunk? &chunk[seq % R_ANAL_ESIL_TRACE_CHUNK]: NULL;
+}
+
+static inline int trace_nsteps(RAnalEsilTrace *t) {
+	return t->steps_base + t->steps.len;
+}
+
+// also the dropped steps not compacted yet, for the entries in t->addrs
+static inline RAnalEsilTraceStep *step_at(RAnalEsilTrace *t, int step) {
+	return r_vector_index_ptr (&t->steps, step - t->steps_base);
+}
+
+static RAnalEsilTraceEvent *trace_push(RAnalEsilTrace *t, int kind) {
+	ut64 c = t->nevents / R_ANAL_ESIL_TRACE_CHUNK;
+	RAnalEsilTraceEvent **chunk = &t->chunks[c % R_ANAL_ESIL_TRACE_CHUNKS];
+	if (!(t->nevents % R_ANAL_ESIL_TRACE_CHUNK)) {
+		if (c - t->first >= R_ANAL_ESIL_TRACE_CHUNKS) {
+			if (t->spill) {
+				spill_chunk (t, t->first, *chunk);
+			}
+			t->first++;
+		}
+		if (!*chunk && !(*chunk = malloc (CHUNK_SIZE))) {
+			return NULL;
+		}
+	}
+	RAnalEsilTraceEvent *ev = &(*chunk)[t->nevents % R_ANAL_ESIL_TRACE_CHUNK];
+	memset (ev, 0, sizeof (RAnalEsilTraceEvent));
+	ev->kind = kind;
+	ev->step = trace_nsteps (t) - 1;
+	t->nevents++;
+	return ev;
+}
+
+static RAnalEsilTraceStep *trace_step(RAnalEsilTrace *t, int step) {
+	if (!t || step < t->steps_first || step >= trace_nsteps (t)) {
+		return NULL;
+	}
+	return step_at (t, step);
+}
+
+// slot of addr in t->addrs, free when it holds -1
+static int *addr_slot(RAnalEsilTrace *t, ut64 addr) {
+	ut32 i, mask = t->saddrs - 1;
+	for (i = addr_hash (addr) & mask;; i = (i + 1) & mask) {
+		if (t->addrs[i] == -1 || step_at (t, t->addrs[i])->addr == addr) {
+			return &t->addrs[i];
+		}
+	}
+}
+
+static bool addrs_grow(RAnalEsilTrace *t) {
+	int i, *old = t->addrs, sold = t->saddrs;
+	int size = sold? sold * 2: 1024;
+	int *addrs = malloc (size * sizeof (int));
+	if (!addrs) {
+		return false;
+	}
+	memset (addrs, -1, size * sizeof (int));
+	t->addrs = addrs;
+	t->saddrs = size;
+	for (i = 0; i < sold; i++) {
+		if (old[i] != -1) {
+			*addr_slot (t, step_at (t, old[i])->addr) = old[i];
+		}
+	}
+	free (old);
+	return true;
+}
+
+// forgets the steps whose events were dropped with their chunk. They are
+// removed from t->steps and t->addrs once they are half of t->steps
+static void trace_trim(RAnalEsilTrace *t) {
+	ut64 seq = (t->spilled.len? t->spill_first: t->first) * R_ANAL_ESIL_TRACE_CHUNK;
+	int i, n = trace_nsteps (t);
+	while (t->steps_first < n && step_at (t, t->steps_first)->seq < seq) {
+		t->steps_first++;
+	}
+	int dropped = t->steps_first - t->steps_base;
+	if (!dropped || dropped < t->steps.len / 2) {
+		return;
+	}
+	memmove (t->steps.a, step_at (t, t->steps_first), (n - t->steps_first) * sizeof (RAnalEsilTraceStep));
+	t->steps.len -= dropped;
+	t->steps_base = t->steps_first;
+	if (!t->addrs) {
+		return;
+	}
+	memset (t->addrs, -1, t->saddrs * sizeof (int));
+	t->naddrs = 0;
+	for (i = t->steps_first; i < n; i++) {
+		int *slot = addr_slot (t, step_at (t, i)->addr);
+		if (*slot == -1) {
+			t->naddrs++;
+		}
+		*slot = i;
+	}
+}
+
+static bool trace_add_step(RAnalEsilTrace *t, ut64 addr, int size) {
+	trace_trim (t);
+	if (t->naddrs * 2 >= t->saddrs && !addrs_grow (t)) {
+		return false;
+	}
+	RAnalEsilTraceStep s = { t->nevents, addr, -1 };
+	if (!r_vector_push (&t->steps, &s)) {
+		return false;
+	}
+	RAnalEsilTraceEvent *ev = trace_push (t, R_ANAL_ESIL_TRACE_STEP);
+	if (!ev) {
+		r_vector_pop (&t->steps, NULL);
+		return false;
+	}
+	ev->addr = addr;
+	ev->size = R_MIN (size, UT8_MAX);
+	int step = trace_nsteps (t) - 1, *slot = addr_slot (t, addr);
+	if (*slot == -1) {
+		t->naddrs++;
+	} else {
+		step_at (t, step)->prev = *slot;
+	}
+	*slot = step;
+	return true;
+}
 
-#define DB esil->db_trace
-#define KEY(x) sdb_fmt ("%d."x, esil->trace_idx)
-#define KEYAT(x,y) sdb_fmt ("%d."x".0x%"PFMT64x, esil->trace_idx, y)
-#define KEYREG(x,y) sdb_fmt ("%d."x".%s", esil->trace_idx, y)
+// index of name in t->regs, -1 when it isn't there and add is false
+static int trace_reg_id(RAnalEsilTrace *t, const char *name, bool add) {
+	ut32 i, mask = t->sregids - 1;
+	if (t->sregids) {
+		for (i = name_hash (name) & mask; t->regids[i]; i = (i + 1) & mask) {
+			if (!strcmp (t->regs[t->regids[i] - 1], name)) {
+				return t->regids[i] - 1;
+			}
+		}
+	}
+	if (!add || t->nregs >= UT16_MAX - 1) {
+		return -1;
+	}
+	if (t->nregs * 2 >= t->sregids) {
+		int size = t->sregids? t->sregids * 2: 256;
+		ut16 *ids = calloc (size, sizeof (ut16));
+		char **regs = realloc (t->regs, (size / 2) * sizeof (char *));
+		if (!ids || !regs) {
+			free (ids);
+			if (regs) {
+				t->regs = regs;
+			}
+			return -1;
+		}
+		t->regs = regs;
+		free (t->regids);
+		t->regids = ids;
+		t->sregids = size;
+		mask = size - 1;
+		for (i = 0; i < t->nregs; i++) {
+			ut32 j = name_hash (t->regs[i]) & mask;
+			while (ids[j]) {
+				j = (j + 1) & mask;
+			}
+			ids[j] = i + 1;
+		}
+	}
+	if (!(t->regs[t->nregs] = strdup (name))) {
+		return -1;
+	}
+	i = name_hash (name) & mask;
+	while (t->regids[i]) {
+		i = (i + 1) & mask;
+	}
+	t->regids[i] = ++t->nregs;
+	return t->nregs - 1;
+}
 
-static int ocbs_set = false;
-static RAnalEsilCallbacks ocbs = {0};
+static void trace_reg(RAnalEsilTrace *t, int kind, const char *name, ut64 val) {
+	int id = trace_reg_id (t, name, true);
+	RAnalEsilTraceEvent *ev;
+	if (id != -1 && (ev = trace_push (t, kind))) {
+		ev->reg = id;
+		ev->value = val;
+	}
+}
+
+// one event for every 8 bytes
+static void trace_mem(RAnalEsilTrace *t, int kind, ut64 addr, const ut8 *buf, int len) {
+	RAnalEsilTraceEvent *ev;
+	int i;
+	for (i = 0; i < len; i += sizeof (ev->value)) {
+		if (!(ev = trace_push (t, kind))) {
+			return;
+		}
+		ev->addr = addr + i;
+		ev->size = R_MIN (len - i, sizeof (ev->value));
+		memcpy (&ev->value, buf + i, ev->size);
+	}
+}
 
 static int trace_hook_reg_read(RAnalEsil *esil, const char *name, ut64 *res, int *size) {
+	RAnalEsilTrace *t = esil->trace;
 	int ret = 0;
 	if (*name=='0') {
 		//eprintf ("Register not found in profile\n");
 		return 0;
 	}
-	if (ocbs.hook_reg_read) {
+	if (t->ocbs.hook_reg_read) {
 		RAnalEsilCallbacks cbs = esil->cb;
-		esil->cb = ocbs;
-		ret = ocbs.hook_reg_read (esil, name, res, size);
+		esil->cb = t->ocbs;
+		ret = t->ocbs.hook_reg_read (esil, name, res, size);
 		esil->cb = cbs;
 	}
 	if (!ret && esil->cb.reg_read) {
 		ret = esil->cb.reg_read (esil, name, res, size);
 	}
 	if (ret) {
-		ut64 val = *res;
-		//eprintf ("[ESIL] REG READ %s 0x%08"PFMT64x"\n", name, val);
-		sdb_array_add (DB, KEY ("reg.read"), name, 0);
-		sdb_num_set (DB, KEYREG ("reg.read", name), val, 0);
-	} //else {
-		//eprintf ("[ESIL] REG READ %s FAILED\n", name);
-	//}
+		trace_reg (t, R_ANAL_ESIL_TRACE_REG_READ, name, *res);
+	}
 	return ret;
 }
 
 static int trace_hook_reg_write(RAnalEsil *esil, const char *name, ut64 *val) {
+	RAnalEsilTrace *t = esil->trace;
 	int ret = 0;
-	//eprintf ("[ESIL] REG WRITE %s 0x%08"PFMT64x"\n", name, *val);
-	sdb_array_add (DB, KEY ("reg.write"), name, 0);
-	sdb_num_set (DB, KEYREG ("reg.write", name), *val, 0);
-	if (ocbs.hook_reg_write) {
+	trace_reg (t, R_ANAL_ESIL_TRACE_REG_WRITE, name, *val);
+	if (t->ocbs.hook_reg_write) {
 		RAnalEsilCallbacks cbs = esil->cb;
-		esil->cb = ocbs;
-		ret = ocbs.hook_reg_write (esil, name, val);
+		esil->cb = t->ocbs;
+		ret = t->ocbs.hook_reg_write (esil, name, val);
 		esil->cb = cbs;
 	}
 	return ret;
 }
 
 static int trace_hook_mem_read(RAnalEsil *esil, ut64 addr, ut8 *buf, int len) {
-	char *hexbuf = calloc ((1 + len), 4);
+	RAnalEsilTrace *t = esil->trace;
 	int ret = 0;
 	if (esil->cb.mem_read) {
 		ret = esil->cb.mem_read (esil, addr, buf, len);
 	}
-	sdb_array_add_num (DB, KEY ("mem.read"), addr, 0);
-	r_hex_bin2str (buf, len, hexbuf);
-	sdb_set (DB, KEYAT ("mem.read.data", addr), hexbuf, 0);
-	//eprintf ("[ESIL] MEM READ 0x%08"PFMT64x" %s\n", addr, hexbuf);
-	free (hexbuf);
-
-	if (ocbs.hook_mem_read) {
+	trace_mem (t, R_ANAL_ESIL_TRACE_MEM_READ, addr, buf, len);
+	if (t->ocbs.hook_mem_read) {
 		RAnalEsilCallbacks cbs = esil->cb;
-		esil->cb = ocbs;
-		ret = ocbs.hook_mem_read (esil, addr, buf, len);
+		esil->cb = t->ocbs;
+		ret = t->ocbs.hook_mem_read (esil, addr, buf, len);
 		esil->cb = cbs;
 	}
 	return ret;
 }
 
 static int trace_hook_mem_write(RAnalEsil *esil, ut64 addr, const ut8 *buf, int len) {
+	RAnalEsilTrace *t = esil->trace;
 	int ret = 0;
-	char *hexbuf = malloc ((1+len)*3);
-	sdb_array_add_num (DB, KEY ("mem.write"), addr, 0);
-	r_hex_bin2str (buf, len, hexbuf);
-	sdb_set (DB, KEYAT ("mem.write.data", addr), hexbuf, 0);
-	//eprintf ("[ESIL] MEM WRITE 0x%08"PFMT64x" %s\n", addr, hexbuf);
-	free (hexbuf);
-
-	if (ocbs.hook_mem_write) {
+	trace_mem (t, R_ANAL_ESIL_TRACE_MEM_WRITE, addr, buf, len);
+	if (t->ocbs.hook_mem_write) {
 		RAnalEsilCallbacks cbs = esil->cb;
-		esil->cb = ocbs;
-		ret = ocbs.hook_mem_write (esil, addr, buf, len);
+		esil->cb = t->ocbs;
+		ret = t->ocbs.hook_mem_write (esil, addr, buf, len);
 		esil->cb = cbs;
 	}
 	return ret;
 }
 
-R_API void r_anal_esil_trace (RAnalEsil *esil, RAnalOp *op) {
+R_API void r_anal_esil_trace(RAnalEsil *esil, RAnalOp *op) {
 	const char *expr = r_strbuf_get (&op->esil);
 	int esil_verbose = esil->verbose;
-	if (ocbs_set) {
+	if (!esil->trace && !(esil->trace = trace_new ())) {
+		return;
+	}
+	RAnalEsilTrace *t = esil->trace;
+	if (t->busy) {
 		eprintf ("cannot call recursively\n");
+		return;
 	}
-	ocbs = esil->cb;
-	ocbs_set = true;
-	if (!DB) DB = sdb_new0 ();
-
-	sdb_num_set (DB, "idx", esil->trace_idx, 0);
-	sdb_num_set (DB, KEY ("addr"), op->addr, 0);
-//	sdb_set (DB, KEY ("opcode"), op->mnemonic, 0);
-//	sdb_set (DB, KEY ("addr"), expr, 0);
-
-	//eprintf ("[ESIL] ADDR 0x%08"PFMT64x"\n", op->addr);
-	//eprintf ("[ESIL] OPCODE %s\n", op->mnemonic);
-	//eprintf ("[ESIL] EXPR = %s\n", expr);
+	if (!trace_add_step (t, op->addr, op->size)) {
+		return;
+	}
+	t->ocbs = esil->cb;
+	t->busy = true;
 	/* set hooks */
 	esil->verbose = 0;
 	esil->cb.hook_reg_read = trace_hook_reg_read;
@@ -116,77 +459,189 @@ R_API void r_anal_esil_trace (RAnalEsil *esil, RAnalOp *op) {
 	/* evaluate esil expression */
 	r_anal_esil_parse (esil, expr);
 	/* restore hooks */
-	esil->cb = ocbs;
-	ocbs_set = false;
+	esil->cb = t->ocbs;
+	t->busy = false;
 	esil->verbose = esil_verbose;
-	esil->trace_idx ++;
+	esil->trace_idx = trace_nsteps (t);
+}
+
+// UT64_MAX when the step wasn't traced
+R_API ut64 r_anal_esil_trace_addr(RAnalEsil *esil, int step) {
+	RAnalEsilTraceStep *s = trace_step (esil->trace, step);
+	return s? s->addr: UT64_MAX;
 }
 
-R_API void r_anal_esil_trace_list (RAnalEsil *esil) {
-	SdbKv *kv;
-	SdbListIter *iter;
-	SdbList *list = sdb_foreach_list (esil->db_trace, true);
-	ls_foreach (list, iter, kv) {
-		eprintf ("%s=%s\n", kv->key, kv->value);
+// calls cb for the accesses of step in order until it returns false,
+// false when the events of step are gone
+R_API bool r_anal_esil_trace_foreach(RAnalEsil *esil, int step, RAnalEsilTraceCB cb, void *user) {
+	RAnalEsilTrace *t = esil->trace;
+	RAnalEsilTraceStep *s = trace_step (t, step);
+	RAnalEsilTraceEvent *ev;
+	ut64 seq;
+	if (!s || !trace_event (t, s->seq)) {
+		return false;
+	}
+	for (seq = s->seq + 1; (ev = trace_event (t, seq)); seq++) {
+		if (ev->kind == R_ANAL_ESIL_TRACE_STEP || !cb (user, ev)) {
+			break;
+		}
 	}
-	ls_free (list);
+	return true;
 }
 
-R_API void r_anal_esil_trace_show(RAnalEsil *esil, int idx) {
+typedef struct {
+	int kind;
+	int reg;
+	bool found;
+	ut64 val;
+} TraceQuery;
+
+static bool query_reg_cb(void *user, RAnalEsilTraceEvent *ev) {
+	TraceQuery *q = user;
+	if (ev->kind == q->kind && ev->reg == q->reg) {
+		q->found = true;
+		q->val = ev->value;
+	}
+	return true;
+}
+
+// the last value of name read or written at step
+R_API bool r_anal_esil_trace_reg(RAnalEsil *esil, int step, int kind, const char *name, ut64 *val) {
+	TraceQuery q = { kind, -1, false, 0 };
+	if (!esil->trace || !name || (q.reg = trace_reg_id (esil->trace, name, false)) == -1) {
+		return false;
+	}
+	r_anal_esil_trace_foreach (esil, step, query_reg_cb, &q);
+	if (q.found && val) {
+		*val = q.val;
+	}
+	return q.found;
+}
+
+static bool query_mem_cb(void *user, RAnalEsilTraceEvent *ev) {
+	TraceQuery *q = user;
+	if (ev->kind == q->kind) {
+		q->found = true;
+		q->val = ev->addr;
+		return false;
+	}
+	return true;
+}
+
+// the address of the first memory access of kind at step
+R_API bool r_anal_esil_trace_mem(RAnalEsil *esil, int step, int kind, ut64 *addr) {
+	TraceQuery q = { kind, -1, false, 0 };
+	r_anal_esil_trace_foreach (esil, step, query_mem_cb, &q);
+	if (q.found && addr) {
+		*addr = q.val;
+	}
+	return q.found;
+}
+
+// the last step at addr before step, -1 when there is none
+R_API int r_anal_esil_trace_prev_at(RAnalEsil *esil, ut64 addr, int step) {
+	RAnalEsilTrace *t = esil->trace;
+	int i;
+	if (!t || !t->saddrs) {
+		return -1;
+	}
+	i = *addr_slot (t, addr);
+	while (i >= step && i >= t->steps_first) {
+		i = step_at (t, i)->prev;
+	}
+	return (i < t->steps_first)? -1: i;
+}
+
+R_API const char *r_anal_esil_trace_reg_name(RAnalEsil *esil, int reg) {
+	RAnalEsilTrace *t = esil->trace;
+	return (t && reg >= 0 && reg < t->nregs)? t->regs[reg]: NULL;
+}
+
+static char *event_hex(RAnalEsilTraceEvent *ev, char *hex) {
+	r_hex_bin2str ((const ut8 *)&ev->value, ev->size, hex);
+	return hex;
+}
+
+static bool list_event_cb(void *user, RAnalEsilTraceEvent *ev) {
+	RAnalEsil *esil = user;
 	PrintfCallback p = esil->anal->cb_printf;
-	const char *str2;
-	const char *str;
-	int trace_idx = esil->trace_idx;
-	esil->trace_idx = idx;
+	const char *name = r_anal_esil_trace_reg_name (esil, ev->reg);
+	char hex[sizeof (ev->value) * 2 + 1];
+	switch (ev->kind) {
+	case R_ANAL_ESIL_TRACE_REG_READ:
+		p ("  reg.read %s = 0x%"PFMT64x"\n", name, ev->value);
+		break;
+	case R_ANAL_ESIL_TRACE_REG_WRITE:
+		p ("  reg.write %s = 0x%"PFMT64x"\n", name, ev->value);
+		break;
+	case R_ANAL_ESIL_TRACE_MEM_READ:
+		p ("  mem.read 0x%08"PFMT64x" %s\n", ev->addr, event_hex (ev, hex));
+		break;
+	case R_ANAL_ESIL_TRACE_MEM_WRITE:
+		p ("  mem.write 0x%08"PFMT64x" %s\n", ev->addr, event_hex (ev, hex));
+		break;
+	}
+	return true;
+}
 
-	str2 = sdb_const_get (DB, KEY ("addr"), 0);
-	if (!str2) {
+// like aets, mode 'q' lists only the steps
+R_API void r_anal_esil_trace_list(RAnalEsil *esil, int mode) {
+	RAnalEsilTrace *t = esil->trace;
+	int i;
+	if (!t || !esil->anal) {
 		return;
 	}
-	p ("dr pc = %s\n", str2);
-	/* registers */
-	str = sdb_const_get (DB, KEY ("reg.read"), 0);
-	if (str) {
-		char regname[32];
-		const char *next, *ptr = str;
-		if (ptr && *ptr) {
-			do {
-				const char *ztr = sdb_const_anext (ptr, &next);
-				int len = next? (int)(size_t)(next-ztr)-1 : strlen (ztr);
-				if (len <sizeof(regname)) {
-					memcpy (regname, ztr, len);
-					regname[len] = 0;
-					str2 = sdb_const_get (DB, KEYREG ("reg.read", regname), 0);
-					p ("dr %s = %s\n", regname, str2);
-				} else {
-					eprintf ("Invalid entry in reg.read\n");
-				}
-				ptr = next;
-			} while (next);
+	for (i = t->steps_first; i < trace_nsteps (t); i++) {
+		RAnalEsilTraceStep *s = trace_step (t, i);
+		esil->anal->cb_printf ("[%d] 0x%08"PFMT64x"\n", i, s->addr);
+		if (mode != 'q') {
+			r_anal_esil_trace_foreach (esil, i, list_event_cb, esil);
 		}
 	}
-	/* memory */
-	str = sdb_const_get (DB, KEY ("mem.read"), 0);
-	if (str) {
-		char addr[64];
-		const char *next, *ptr = str;
-		if (ptr && *ptr) {
-			do {
-				const char *ztr = sdb_const_anext (ptr, &next);
-				int len = next? (int)(size_t)(next-ztr)-1 : strlen (ztr);
-				if (len <sizeof(addr)) {
-					memcpy (addr, ztr, len);
-					addr[len] = 0;
-					str2 = sdb_const_get (DB, KEYAT ("mem.read.data",
-						r_num_get (NULL, addr)), 0);
-					p ("wx %s @ %s\n", str2, addr);
-				} else {
-					eprintf ("Invalid entry in reg.read\n");
-				}
-				ptr = next;
-			} while (next);
-		}
+}
+
+typedef struct {
+	RAnalEsil *esil;
+	ut8 *seen;
+} TraceShow;
+
+static bool show_reg_cb(void *user, RAnalEsilTraceEvent *ev) {
+	TraceShow *ts = user;
+	// the first read has the value before the instruction
+	if (ev->kind == R_ANAL_ESIL_TRACE_REG_READ && !(ts->seen[ev->reg / 8] & (1 << (ev->reg % 8)))) {
+		ts->seen[ev->reg / 8] |= 1 << (ev->reg % 8);
+		ts->esil->anal->cb_printf ("dr %s = 0x%"PFMT64x"\n",
+			r_anal_esil_trace_reg_name (ts->esil, ev->reg), ev->value);
 	}
+	return true;
+}
 
-	esil->trace_idx = trace_idx;
+static bool show_mem_cb(void *user, RAnalEsilTraceEvent *ev) {
+	TraceShow *ts = user;
+	char hex[sizeof (ev->value) * 2 + 1];
+	if (ev->kind == R_ANAL_ESIL_TRACE_MEM_READ) {
+		ts->esil->anal->cb_printf ("wx %s @ 0x%"PFMT64x"\n", event_hex (ev, hex), ev->addr);
+	}
+	return true;
+}
+
+// the commands setting what the instruction at idx read
+R_API void r_anal_esil_trace_show(RAnalEsil *esil, int idx) {
+	RAnalEsilTrace *t = esil->trace;
+	ut64 addr = r_anal_esil_trace_addr (esil, idx);
+	if (addr == UT64_MAX || !esil->anal) {
+		return;
+	}
+	TraceShow ts = { esil, calloc (t->nregs / 8 + 1, 1) };
+	if (!ts.seen) {
+		return;
+	}
+	esil->anal->cb_printf ("dr pc = 0x%"PFMT64x"\n", addr);
+	/* registers */
+	if (!r_anal_esil_trace_foreach (esil, idx, show_reg_cb, &ts)) {
+		eprintf ("The events of %d are not in the trace anymore\n", idx);
+	}
+	/* memory */
+	r_anal_esil_trace_foreach (esil, idx, show_mem_cb, &ts);
+	free (ts.seen);
 }
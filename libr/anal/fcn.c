@@ -76,6 +76,7 @@ R_API void r_anal_fcn_update_tinyrange_bbs(RAnalFunction *fcn) {
 	r_tinyrange_fini (&fcn->bbr);
 	r_list_foreach (fcn->bbs, iter, bb) {
 		r_tinyrange_add (&fcn->bbr, bb->addr, bb->addr + bb->size);
+		r_anal_bb_index_update (bb);
 	}
 }
 
@@ -251,6 +252,23 @@ static void _fcn_tree_iter_next(FcnTreeIter *it, ut64 from, ut64 to) {
 	}
 }
 
+// the anal whose bb_tree has the blocks of fcn, NULL if fcn is not in it
+static RAnal *fcn_bb_index(RAnalFunction *fcn) {
+	RAnalBlock *bb = fcn->bbs? r_list_first (fcn->bbs): NULL;
+	return bb? bb->anal: NULL;
+}
+
+static bool fcn_listed(RAnal *anal, RAnalFunction *fcn) {
+	RAnalFunction *f;
+	FcnTreeIter it;
+	fcn_tree_foreach_intersect (anal->fcn_tree, it, f, fcn->addr, fcn->addr + 1) {
+		if (f == fcn) {
+			return true;
+		}
+	}
+	return false;
+}
+
 R_API int r_anal_fcn_resize(const RAnal *anal, RAnalFunction *fcn, int newsize) {
 	ut64 eof; /* end of function */
 	RAnalBlock *bb;
@@ -299,6 +317,8 @@ R_API RAnalFunction *r_anal_fcn_new() {
 	fcn->fingerprint = NULL;
 	fcn->diff = r_anal_diff_new ();
 	r_tinyrange_init (&fcn->bbr);
+	r_pvector_init (&fcn->vars, NULL);
+	r_vector_init (&fcn->var_uses, sizeof (RAnalVarUse), NULL, NULL);
 	return fcn;
 }
 
@@ -329,6 +349,7 @@ R_API void r_anal_fcn_free(void *_fcn) {
 	}
 	free (fcn->fingerprint);
 	r_anal_diff_free (fcn->diff);
+	r_anal_fcn_vars_fini (fcn);
 	free (fcn->args);
 	free (fcn);
 }
@@ -1571,6 +1592,12 @@ R_API int r_anal_fcn_insert(RAnal *anal, RAnalFunction *fcn) {
 	/* TODO: sdbization */
 	r_list_append (anal->fcns, fcn);
 	r_anal_fcn_tree_insert (&anal->fcn_tree, fcn);
+	RListIter *iter;
+	RAnalBlock *bb;
+	r_list_foreach (fcn->bbs, iter, bb) {
+		bb->fcn = fcn;
+		r_anal_bb_index_add (anal, bb);
+	}
 	if (anal->cb.on_fcn_new) {
 		anal->cb.on_fcn_new (anal, anal->user, fcn);
 	}
@@ -1633,6 +1660,7 @@ R_API int r_anal_fcn_del_locs(RAnal *anal, ut64 addr) {
 
 R_API int r_anal_fcn_del(RAnal *a, ut64 addr) {
 	if (addr == UT64_MAX) {
+		r_anal_bb_index_reset (a);
 		r_list_free (a->fcns);
 		a->fcn_tree = NULL;
 		if (!(a->fcns = r_anal_fcn_list_new ())) {
@@ -1763,6 +1791,10 @@ R_API int r_anal_fcn_add_bb(RAnal *anal, RAnalFunction *fcn, ut64 addr, ut64 siz
 			eprintf ("appendBasicBlock failed\n");
 			return false;
 		}
+		if (!bb->anal && fcn_listed (anal, fcn)) {
+			// first block of a function made with af+
+			r_anal_bb_index_add (anal, bb);
+		}
 	}
 	bb->addr = addr;
 	bb->size = size;
@@ -1840,6 +1872,8 @@ R_API int r_anal_fcn_split_bb(RAnal *anal, RAnalFunction *fcn, RAnalBlock *bb, u
 				}
 			}
 			bbi->ninstr = new_bbi_instr;
+			r_anal_bb_index_update (bbi);
+			r_anal_bb_index_update (bb);
 			return R_ANAL_RET_END;
 		}
 	}
@@ -1862,7 +1896,7 @@ R_API int r_anal_fcn_bb_overlaps(RAnalFunction *fcn, RAnalBlock *bb) {
 			} else {
 				bb->type = R_ANAL_BB_TYPE_BODY;
 			}
-			r_list_append (fcn->bbs, bb);
+			r_anal_fcn_bbadd (fcn, bb);
 			return R_ANAL_RET_END;
 		}
 	}
@@ -2027,6 +2061,10 @@ R_API RAnalBlock *r_anal_fcn_bbget_in(RAnalFunction *fcn, ut64 addr) {
 	if (!fcn || addr == UT64_MAX) {
 		return NULL;
 	}
+	RAnal *anal = fcn_bb_index (fcn);
+	if (anal) {
+		return r_anal_bb_index_in (anal, addr, fcn);
+	}
 	RListIter *iter;
 	RAnalBlock *bb;
 	r_list_foreach (fcn->bbs, iter, bb) {
@@ -2044,6 +2082,10 @@ R_API RAnalBlock *r_anal_fcn_bbget_at(RAnalFunction *fcn, ut64 addr) {
 #if USE_SDB_CACHE
 	return sdb_ptr_get (HB, sdb_fmt (SDB_KEY_BB, fcn->addr, addr), NULL);
 #else
+	RAnal *anal = fcn_bb_index (fcn);
+	if (anal) {
+		return r_anal_bb_index_at (anal, addr, fcn);
+	}
 	RListIter *iter;
 	RAnalBlock *bb;
 	r_list_foreach (fcn->bbs, iter, bb) {
@@ -2060,7 +2102,13 @@ R_API bool r_anal_fcn_bbadd(RAnalFunction *fcn, RAnalBlock *bb) {
 #if USE_SDB_CACHE
 	return sdb_ptr_set (HB, sdb_fmt (SDB_KEY_BB, fcn->addr, bb->addr), bb, NULL);
 #endif
+	RAnal *anal = fcn_bb_index (fcn);
 	r_list_append (fcn->bbs, bb);
+	bb->fcn = fcn;
+	// the blocks of a function in anal->fcns are all indexed
+	if (anal) {
+		r_anal_bb_index_add (anal, bb);
+	}
 	return true;
 }
 
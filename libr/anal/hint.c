@@ -1,240 +1,437 @@
-/* radare - LGPL - Copyright 2013-2016 - pancake */
+/* radare - LGPL - Copyright 2013-2018 - pancake */
 
 #include <r_anal.h>
 
-#define DB a->sdb_hints
-#define setf(x,...) snprintf(x,sizeof(x)-1,##__VA_ARGS__)
+// Hints are kept parsed. Point hints live in a tree ordered by address and
+// range hints in one tree per kind, where the ranges never overlap and a new
+// one replaces whatever it covers. Projects save them as ah* commands.
 
-R_API void r_anal_hint_clear(RAnal *a) {
-	sdb_reset (a->sdb_hints);
+typedef struct {
+	RBNode rb;
+	RAnalHint hint;
+} RAnalHintNode;
+
+#define HINT_NODE(x) container_of ((RBNode*)x, RAnalHintNode, rb)
+#define RANGE_HINT(x) container_of ((RBNode*)x, RAnalRangeHint, rb)
+
+static int hint_cmp(const void *incoming, const RBNode *in_tree) {
+	ut64 addr = *(const ut64 *)incoming;
+	ut64 at = HINT_NODE (in_tree)->hint.addr;
+	return (addr < at)? -1: (addr > at)? 1: 0;
 }
 
-R_API void r_anal_hint_del(RAnal *a, ut64 addr, int size) {
-	char key[128];
-	if (size > 1) {
-		eprintf ("TODO: r_anal_hint_del: in range\n");
-	} else {
-		setf (key, "hint.0x%08"PFMT64x, addr);
-		sdb_unset (a->sdb_hints, key, 0);
-		a->bits_hints_changed = true;
+static int range_cmp(const void *incoming, const RBNode *in_tree) {
+	ut64 addr = *(const ut64 *)incoming;
+	ut64 from = RANGE_HINT (in_tree)->from;
+	return (addr < from)? -1: (addr > from)? 1: 0;
+}
+
+static void hint_fini(RAnalHint *h) {
+	free (h->arch);
+	free (h->esil);
+	free (h->opcode);
+	free (h->syntax);
+	free (h->offset);
+}
+
+static void hint_node_free(RBNode *node) {
+	RAnalHintNode *hn = HINT_NODE (node);
+	hint_fini (&hn->hint);
+	free (hn);
+}
+
+static void range_free(RBNode *node) {
+	RAnalRangeHint *r = RANGE_HINT (node);
+	free (r->arch);
+	free (r);
+}
+
+static void hint_init(RAnalHint *h, ut64 addr) {
+	memset (h, 0, sizeof (RAnalHint));
+	h->addr = addr;
+	h->jump = UT64_MAX;
+	h->fail = UT64_MAX;
+	h->ret = UT64_MAX;
+}
+
+static RAnalHint *hint_find(RAnal *a, ut64 addr) {
+	RBNode *node = r_rbtree_find (a->hints, &addr, hint_cmp);
+	return node? &HINT_NODE (node)->hint: NULL;
+}
+
+static RAnalHint *hint_get(RAnal *a, ut64 addr) {
+	RAnalHint *h = hint_find (a, addr);
+	if (!h) {
+		RAnalHintNode *hn = R_NEW0 (RAnalHintNode);
+		if (!hn) {
+			return NULL;
+		}
+		hint_init (&hn->hint, addr);
+		r_rbtree_insert (&a->hints, &addr, &hn->rb, hint_cmp);
+		h = &hn->hint;
 	}
+	return h;
 }
 
-static void unsetHint(RAnal *a, const char *type, ut64 addr) {
-	int idx;
-	char key[128];
-	setf (key, "hint.0x%08"PFMT64x, addr);
-	idx = sdb_array_indexof (DB, key, type, 0);
-	if (idx != -1) {
-		sdb_array_delete (DB, key, idx, 0);
-		sdb_array_delete (DB, key, idx, 0);
+// drops the node once the last of its hints is unset
+static void hint_gc(RAnal *a, RAnalHint *h) {
+	if (!h->ptr && h->jump == UT64_MAX && h->fail == UT64_MAX && h->ret == UT64_MAX
+			&& !h->arch && !h->opcode && !h->syntax && !h->esil && !h->offset
+			&& !h->size && !h->bits && !h->new_bits && !h->immbase && !h->high) {
+		ut64 addr = h->addr;
+		r_rbtree_delete (&a->hints, &addr, hint_cmp, hint_node_free);
 	}
 }
 
-static void setHint(RAnal *a, const char *type, ut64 addr, const char *s, ut64 ptr) {
-	int idx;
-	char key[128], val[128], *nval = NULL;
-	setf (key, "hint.0x%08"PFMT64x, addr);
-	idx = sdb_array_indexof (DB, key, type, 0);
-	if (s) {
-		nval = sdb_encode ((const ut8*)s, -1);
-	} else {
-		nval = sdb_itoa (ptr, val, 16);
+static void hint_set_str(char **dst, const char *s) {
+	free (*dst);
+	*dst = s? strdup (s): NULL;
+}
+
+// last range starting at or before addr
+static RAnalRangeHint *range_floor(RBNode *x, ut64 addr) {
+	RAnalRangeHint *ret = NULL;
+	while (x) {
+		RAnalRangeHint *r = RANGE_HINT (x);
+		if (r->from <= addr) {
+			ret = r;
+			x = x->child[1];
+		} else {
+			x = x->child[0];
+		}
 	}
-	if (idx != -1) {
-		if (!s) {
-			nval = sdb_itoa (ptr, val, 16);
+	return ret;
+}
+
+static RAnalRangeHint *range_at(RBNode *root, ut64 addr) {
+	RAnalRangeHint *r = range_floor (root, addr);
+	return (r && addr < r->to)? r: NULL;
+}
+
+static RAnalRangeHint *range_new(ut64 from, ut64 to, int bits, const char *arch) {
+	RAnalRangeHint *r = R_NEW0 (RAnalRangeHint);
+	if (r) {
+		r->from = from;
+		r->to = to;
+		r->bits = bits;
+		r->arch = arch? strdup (arch): NULL;
+	}
+	return r;
+}
+
+// leaves [from, to) free of ranges, trimming and splitting the ones crossing it
+static void range_cut(RBNode **root, ut64 from, ut64 to) {
+	RAnalRangeHint *r = range_floor (*root, from);
+	if (r && r->from < from && r->to > from) {
+		if (r->to > to) {
+			RAnalRangeHint *tail = range_new (to, r->to, r->bits, r->arch);
+			if (tail) {
+				r_rbtree_insert (root, &tail->from, &tail->rb, range_cmp);
+			}
 		}
-		sdb_array_set (DB, key, idx + 1, nval, 0);
-	} else {
-		sdb_array_push (DB, key, nval, 0);
-		sdb_array_push (DB, key, type, 0);
+		r->to = from;
+	}
+	RBNode *node;
+	while ((node = r_rbtree_lower_bound (*root, &from, range_cmp))
+			&& (r = RANGE_HINT (node))->from < to) {
+		ut64 key = r->from;
+		if (r->to > to) {
+			// starts inside, keeps its tail
+			r_rbtree_delete (root, &key, range_cmp, NULL);
+			r->from = to;
+			r_rbtree_insert (root, &r->from, &r->rb, range_cmp);
+			break;
+		}
+		r_rbtree_delete (root, &key, range_cmp, range_free);
+	}
+}
+
+static void range_set(RBNode **root, ut64 from, ut64 to, int bits, const char *arch) {
+	range_cut (root, from, to);
+	RAnalRangeHint *r = range_new (from, to, bits, arch);
+	if (r) {
+		r_rbtree_insert (root, &r->from, &r->rb, range_cmp);
 	}
-	if (s) {
-		free (nval);
+}
+
+R_API void r_anal_hint_clear(RAnal *a) {
+	r_rbtree_free (a->hints, hint_node_free);
+	r_rbtree_free (a->hint_bits, range_free);
+	r_rbtree_free (a->hint_arch, range_free);
+	a->hints = NULL;
+	a->hint_bits = NULL;
+	a->hint_arch = NULL;
+	a->bits_hints_changed = true;
+	r_anal_op_cache_reset (a);
+}
+
+// size > 1 removes every hint in [addr, addr + size), otherwise the hints
+// at addr and the ranges starting there
+R_API void r_anal_hint_del(RAnal *a, ut64 addr, int size) {
+	ut64 to = addr + R_MAX (size, 1);
+	RAnalHintNode *hn;
+	RBIter it;
+	if (size > 1) {
+		RList *dead = r_list_new ();
+		r_rbtree_foreach (a->hints, it, hn, RAnalHintNode, rb) {
+			if (hn->hint.addr >= addr && hn->hint.addr < to) {
+				r_list_append (dead, hn);
+			}
+		}
+		RListIter *iter;
+		r_list_foreach (dead, iter, hn) {
+			ut64 key = hn->hint.addr;
+			r_rbtree_delete (&a->hints, &key, hint_cmp, hint_node_free);
+		}
+		r_list_free (dead);
+		range_cut (&a->hint_bits, addr, to);
+		range_cut (&a->hint_arch, addr, to);
+	} else {
+		r_rbtree_delete (&a->hints, &addr, hint_cmp, hint_node_free);
+		r_rbtree_delete (&a->hint_bits, &addr, range_cmp, range_free);
+		r_rbtree_delete (&a->hint_arch, &addr, range_cmp, range_free);
 	}
+	a->bits_hints_changed = true;
+	r_anal_op_cache_invalidate (a, addr, to - addr);
+}
+
+#define SET_HINT(field, value) { \
+	r_anal_op_cache_invalidate (a, addr, 1); \
+	RAnalHint *h = hint_get (a, addr); \
+	if (h) { \
+		h->field = value; \
+	} \
+}
+
+#define SET_HINT_STR(field, value) { \
+	r_anal_op_cache_invalidate (a, addr, 1); \
+	RAnalHint *h = hint_get (a, addr); \
+	if (h) { \
+		hint_set_str (&h->field, value); \
+	} \
+}
+
+#define UNSET_HINT(field, value) { \
+	r_anal_op_cache_invalidate (a, addr, 1); \
+	RAnalHint *h = hint_find (a, addr); \
+	if (h) { \
+		h->field = value; \
+		hint_gc (a, h); \
+	} \
+}
+
+#define UNSET_HINT_STR(field) { \
+	r_anal_op_cache_invalidate (a, addr, 1); \
+	RAnalHint *h = hint_find (a, addr); \
+	if (h) { \
+		R_FREE (h->field); \
+		hint_gc (a, h); \
+	} \
 }
 
 R_API void r_anal_hint_set_offset(RAnal *a, ut64 addr, const char* typeoff) {
-	setHint (a, "Offset:", addr, r_str_trim_ro (typeoff), 0);
+	SET_HINT_STR (offset, r_str_trim_ro (typeoff));
 }
 
 R_API void r_anal_hint_set_jump(RAnal *a, ut64 addr, ut64 ptr) {
-	setHint (a, "jump:", addr, NULL, ptr);
+	SET_HINT (jump, ptr);
 }
 
 R_API void r_anal_hint_set_newbits(RAnal *a, ut64 addr, int bits) {
 	a->bits_hints_changed = true;
-	setHint (a, "Bits:", addr, NULL, bits);
+	SET_HINT (new_bits, bits);
 }
 
 // TOOD: add helpers for newendian and newbank
 
 R_API void r_anal_hint_set_fail(RAnal *a, ut64 addr, ut64 ptr) {
-	setHint (a, "fail:", addr, NULL, ptr);
+	SET_HINT (fail, ptr);
 }
 
 R_API void r_anal_hint_set_high(RAnal *a, ut64 addr) {
-	setHint (a, "high:", addr, NULL, 1);
+	SET_HINT (high, true);
 }
 
 R_API void r_anal_hint_set_immbase(RAnal *a, ut64 addr, int base) {
 	if (base) {
-		setHint (a, "immbase:", addr, NULL, (ut64)base);
+		SET_HINT (immbase, base);
 	} else {
-		unsetHint (a, "immbase:", addr);
+		UNSET_HINT (immbase, 0);
 	}
 }
 
 R_API void r_anal_hint_set_pointer(RAnal *a, ut64 addr, ut64 ptr) {
-	setHint (a, "ptr:", addr, NULL, ptr);
+	SET_HINT (ptr, ptr);
 }
 
 R_API void r_anal_hint_set_ret(RAnal *a, ut64 addr, ut64 val) {
-	setHint (a, "ret:", addr, NULL, val);
+	SET_HINT (ret, val);
 }
 
 R_API void r_anal_hint_set_arch(RAnal *a, ut64 addr, const char *arch) {
-	setHint (a, "arch:", addr, r_str_trim_ro (arch), 0);
+	SET_HINT_STR (arch, r_str_trim_ro (arch));
 }
 
 R_API void r_anal_hint_set_syntax(RAnal *a, ut64 addr, const char *syn) {
-	setHint (a, "Syntax:", addr, syn, 0);
+	SET_HINT_STR (syntax, syn);
 }
 
 R_API void r_anal_hint_set_opcode(RAnal *a, ut64 addr, const char *opcode) {
-	setHint (a, "opcode:", addr, r_str_trim_ro (opcode), 0);
+	SET_HINT_STR (opcode, r_str_trim_ro (opcode));
 }
 
 R_API void r_anal_hint_set_esil(RAnal *a, ut64 addr, const char *esil) {
-	setHint (a, "esil:", addr, r_str_trim_ro (esil), 0);
+	SET_HINT_STR (esil, r_str_trim_ro (esil));
 }
 
 R_API void r_anal_hint_set_bits(RAnal *a, ut64 addr, int bits) {
 	a->bits_hints_changed = true;
-	setHint (a, "bits:", addr, NULL, bits);
+	SET_HINT (bits, bits);
 }
 
 R_API void r_anal_hint_set_size(RAnal *a, ut64 addr, int size) {
-	setHint (a, "size:", addr, NULL, size);
+	SET_HINT (size, size);
+}
+
+// bits for every instruction in [addr, addr + size)
+R_API void r_anal_hint_set_bits_range(RAnal *a, ut64 addr, ut64 size, int bits) {
+	if (size > 0) {
+		range_set (&a->hint_bits, addr, addr + size, bits, NULL);
+		r_anal_op_cache_invalidate (a, addr, size);
+	}
+}
+
+R_API void r_anal_hint_set_arch_range(RAnal *a, ut64 addr, ut64 size, const char *arch) {
+	if (size > 0 && arch) {
+		range_set (&a->hint_arch, addr, addr + size, 0, r_str_trim_ro (arch));
+		r_anal_op_cache_invalidate (a, addr, size);
+	}
 }
 
 R_API void r_anal_hint_unset_size(RAnal *a, ut64 addr) {
-	unsetHint(a, "size:", addr);
+	UNSET_HINT (size, 0);
 }
 
 R_API void r_anal_hint_unset_bits(RAnal *a, ut64 addr) {
 	a->bits_hints_changed = true;
-	unsetHint(a, "bits:", addr);
+	UNSET_HINT (bits, 0);
 }
 
 R_API void r_anal_hint_unset_esil(RAnal *a, ut64 addr) {
-	unsetHint(a, "esil:", addr);
+	UNSET_HINT_STR (esil);
 }
 
 R_API void r_anal_hint_unset_opcode(RAnal *a, ut64 addr) {
-	unsetHint(a, "opcode:", addr);
+	UNSET_HINT_STR (opcode);
 }
 
 R_API void r_anal_hint_unset_high(RAnal *a, ut64 addr) {
-	unsetHint(a, "high:", addr);
+	UNSET_HINT (high, false);
 }
 
 R_API void r_anal_hint_unset_arch(RAnal *a, ut64 addr) {
-	unsetHint(a, "arch:", addr);
+	UNSET_HINT_STR (arch);
 }
 
 R_API void r_anal_hint_unset_syntax(RAnal *a, ut64 addr) {
-	unsetHint(a, "Syntax:", addr);
+	UNSET_HINT_STR (syntax);
 }
 
 R_API void r_anal_hint_unset_pointer(RAnal *a, ut64 addr) {
-	unsetHint(a, "ptr:", addr);
+	UNSET_HINT (ptr, 0);
 }
 
 R_API void r_anal_hint_unset_ret(RAnal *a, ut64 addr) {
-	unsetHint(a, "ret:", addr);
+	UNSET_HINT (ret, UT64_MAX);
 }
 
 R_API void r_anal_hint_unset_offset(RAnal *a, ut64 addr) {
-	unsetHint (a, "Offset:", addr);
+	UNSET_HINT_STR (offset);
 }
 
 R_API void r_anal_hint_unset_jump(RAnal *a, ut64 addr) {
-	unsetHint (a, "jump:", addr);
+	UNSET_HINT (jump, UT64_MAX);
 }
 
 R_API void r_anal_hint_unset_fail(RAnal *a, ut64 addr) {
-	unsetHint (a, "fail:", addr);
+	UNSET_HINT (fail, UT64_MAX);
 }
 
 R_API void r_anal_hint_free(RAnalHint *h) {
 	if (h) {
-		free (h->arch);
-		free (h->esil);
-		free (h->opcode);
-		free (h->syntax);
-		free (h->offset);
+		hint_fini (h);
 		free (h);
 	}
 }
 
-R_API RAnalHint *r_anal_hint_from_string(RAnal *a, ut64 addr, const char *str) {
-	char *r, *nxt, *nxt2;
-	int token = 0;
-	RAnalHint *hint = R_NEW0 (RAnalHint);
-	if (!hint) {
-		return NULL;
+// the bits of the range hint covering addr, 0 if none
+R_API int r_anal_hint_bits_at(RAnal *a, ut64 addr) {
+	RAnalRangeHint *r = range_at (a->hint_bits, addr);
+	return r? r->bits: 0;
+}
+
+R_API const char *r_anal_hint_arch_at(RAnal *a, ut64 addr) {
+	RAnalRangeHint *r = range_at (a->hint_arch, addr);
+	return r? r->arch: NULL;
+}
+
+// Fills hint with what applies to addr: the hints set there, completed with
+// the range hints covering it. The strings belong to the hint database and
+// stay valid until the next change. Returns false if there is nothing.
+R_API bool r_anal_hint_lookup(RAnal *a, ut64 addr, RAnalHint *hint) {
+	RAnalHint *h = hint_find (a, addr);
+	bool found = h;
+	if (h) {
+		*hint = *h;
+	} else {
+		hint_init (hint, addr);
+	}
+	if (!hint->bits && a->hint_bits && (hint->bits = r_anal_hint_bits_at (a, addr))) {
+		found = true;
+	}
+	if (!hint->arch && a->hint_arch && (hint->arch = (char *)r_anal_hint_arch_at (a, addr))) {
+		found = true;
 	}
-	hint->jump = UT64_MAX;
-	hint->fail = UT64_MAX;
-	hint->ret = UT64_MAX;
-	char *s = strdup (str);
-	if (!s) {
-		free (hint);
+	return found;
+}
+
+R_API RAnalHint *r_anal_hint_get(RAnal *a, ut64 addr) {
+	RAnalHint tmp, *hint;
+	if (!r_anal_hint_lookup (a, addr, &tmp) || !(hint = R_NEW (RAnalHint))) {
 		return NULL;
 	}
-	hint->addr = addr;
-	token = *s;
-	for (r = s; ; r = nxt2) {
-		r = sdb_anext (r, &nxt);
-		if (!nxt) {
-			break;
-		}
-		sdb_anext (nxt, &nxt2); // tokenize value
-		if (token) {
-			switch (token) {
-			case 'i': hint->immbase = sdb_atoi (nxt); break;
-			case 'j': hint->jump = sdb_atoi (nxt); break;
-			case 'f': hint->fail = sdb_atoi (nxt); break;
-			case 'p': hint->ptr  = sdb_atoi (nxt); break;
-			case 'r': hint->ret  = sdb_atoi (nxt); break;
-			case 'b': hint->bits = sdb_atoi (nxt); break;
-			case 'B': hint->new_bits = sdb_atoi (nxt); break;
-			case 's': hint->size = sdb_atoi (nxt); break;
-			case 'S': hint->syntax = (char*)sdb_decode (nxt, 0); break;
-			case 'o': hint->opcode = (char*)sdb_decode (nxt, 0); break;
-			case 'O': hint->offset = (char*)sdb_decode (nxt, 0); break;
-			case 'e': hint->esil = (char*)sdb_decode (nxt, 0); break;
-			case 'a': hint->arch = (char*)sdb_decode (nxt, 0); break;
-			case 'h': hint->high = sdb_atoi (nxt); break;
-			}
-		}
-		if (!nxt || !nxt2) {
+	*hint = tmp;
+	hint->arch = tmp.arch? strdup (tmp.arch): NULL;
+	hint->esil = tmp.esil? strdup (tmp.esil): NULL;
+	hint->opcode = tmp.opcode? strdup (tmp.opcode): NULL;
+	hint->syntax = tmp.syntax? strdup (tmp.syntax): NULL;
+	hint->offset = tmp.offset? strdup (tmp.offset): NULL;
+	return hint;
+}
+
+// walks the point hints in address order
+R_API void r_anal_hint_foreach(RAnal *a, RAnalHintCb cb, void *user) {
+	RAnalHintNode *hn;
+	RBIter it;
+	r_rbtree_foreach (a->hints, it, hn, RAnalHintNode, rb) {
+		if (!cb (user, &hn->hint)) {
 			break;
 		}
-		token = *nxt2;
 	}
-	free (s);
-	return hint;
 }
 
-R_API RAnalHint *r_anal_hint_get(RAnal *a, ut64 addr) {
-	char key[64];
-	setf (key, "hint.0x%08"PFMT64x, addr);
-	const char *s = sdb_const_get (DB, key, 0);
-	if (!s) {
-		return NULL;
+// walks the bits ranges and then the arch ones, each in address order
+R_API void r_anal_hint_range_foreach(RAnal *a, RAnalRangeHintCb cb, void *user) {
+	RAnalRangeHint *r;
+	RBIter it;
+	r_rbtree_foreach (a->hint_bits, it, r, RAnalRangeHint, rb) {
+		if (!cb (user, r)) {
+			return;
+		}
+	}
+	r_rbtree_foreach (a->hint_arch, it, r, RAnalRangeHint, rb) {
+		if (!cb (user, r)) {
+			return;
+		}
 	}
-	return r_anal_hint_from_string (a, addr, s);
 }
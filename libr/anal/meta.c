@@ -1,133 +1,150 @@
-/* radare - LGPL - Copyright 2008-2017 - nibble, pancake */
-
-// TODO: rename to r_anal_meta_get() ??
-#if 0
-    TODO
-    ====
-    - handle sync to synchronize all the data on disk.
-    - actually listing only works in memory
-    - array_add doesnt needs index, right?
-    - remove unused arguments from r_meta_find (where ?)
-    - implement r_meta_find
-#endif
-#if 0
-  SDB SPECS
-
-DatabaseName:
-  'anal.meta'
-Keys:
-  'meta.<type>.count=<int>'     number of added metas where 'type' is a single char
-  'meta.<type>.<last>=<array>'  splitted array, each block contains K elements
-  'meta.<type>.<addr>=<string>' string representing extra information of the meta type at given address
-  'range.<baddr>=<array>'       store valid addresses in a base range array
-#endif
+/* radare - LGPL - Copyright 2008-2018 - nibble, pancake */
+
+// Metadata items live in an interval tree ordered by address and type, one
+// item per (type, address) pair, holding their strings already decoded. Each
+// node keeps the highest end address of its subtree, so the items covering an
+// address are found without walking the ones that end before it.
+// Variable comments are keyed by function and index instead of by range and
+// stay in sdb_meta:
+//   'meta.<type>.0x<fcn>.0x<idx>=<size>,<space>,<base64>'
 
 #include <r_anal.h>
 #include <r_core.h>
 #include <r_print.h>
 
-#define META_RANGE_BASE(x) ((x)>>12)
-#define META_RANGE_SIZE 0xfff
 #undef DB
 #define DB a->sdb_meta
 
-static char *meta_inrange_get (RAnal *a, ut64 addr, int size) {
-	ut64 base = META_RANGE_BASE (addr);
-	ut64 base2 = META_RANGE_BASE (addr + size) + 1;
-	char *res = NULL;
-	// return string array of all the offsets where there are stuff
-	for (; base < base2; base += META_RANGE_SIZE) {
-		const char *key = sdb_fmt ("range.0x%"PFMT64x, base);
-		// char *r = sdb_array_get (DB, key, 0, 0);
-		char *r = sdb_get (DB, key, 0);
-		if (r) {
-			if (res) {
-				res = r_str_append (res, ",");
-			}
-			res = r_str_append (res, r);
-			free (r);
-		}
+typedef struct {
+	RBNode rb;
+	ut64 max_to;	// highest mi.to in the subtree
+	RAnalMetaItem mi;
+} RAnalMetaNode;
+
+#define META_NODE(x) container_of ((RBNode *)(x), RAnalMetaNode, rb)
+
+static int meta_cmp(const void *incoming, const RBNode *in_tree) {
+	const RAnalMetaItem *a = incoming;
+	const RAnalMetaItem *b = &META_NODE (in_tree)->mi;
+	if (a->from != b->from) {
+		return a->from < b->from? -1: 1;
 	}
-	return res;
+	return (a->type > b->type) - (a->type < b->type);
 }
 
-static bool meta_inrange_add (RAnal *a, ut64 addr, int size) {
-	bool set = false;
-	char key[64];
-	ut64 base, base2;
-	base = META_RANGE_BASE (addr);
-	base2 = META_RANGE_BASE (addr + size) + 1;
-	for (; base < base2; base += META_RANGE_SIZE) {
-		snprintf (key, sizeof (key)-1, "range.0x%"PFMT64x, base);
-		if (sdb_array_add_num (DB, key, addr, 0)) {
-			set = true;
+static void meta_calc_max(RBNode *node) {
+	RAnalMetaNode *mn = META_NODE (node);
+	int i;
+	mn->max_to = mn->mi.to;
+	for (i = 0; i < 2; i++) {
+		if (node->child[i]) {
+			RAnalMetaNode *child = META_NODE (node->child[i]);
+			if (child->max_to > mn->max_to) {
+				mn->max_to = child->max_to;
+			}
 		}
 	}
-	return set;
 }
 
-static bool meta_inrange_del (RAnal *a, ut64 addr, int size) {
-	bool set = false;
-	char key[64];
-	ut64 base = META_RANGE_BASE (addr);
-	ut64 base2 = META_RANGE_BASE (addr + size) + 1;
-// TODO: optimize this thing?
-	for (; base < base2; base += META_RANGE_SIZE) {
-		snprintf (key, sizeof (key)-1, "range.0x%"PFMT64x, base);
-		if (sdb_array_remove_num (DB, key, addr, 0)) {
-			set = true;
-		}
+static void meta_node_free(RBNode *node) {
+	RAnalMetaNode *mn = META_NODE (node);
+	free (mn->mi.str);
+	free (mn);
+}
+
+// comments, highlights and type notes annotate an address, they do not
+// describe the bytes after it, so lookups of any type skip them
+static bool meta_match(const RAnalMetaItem *mi, int type) {
+	if (type == R_META_TYPE_ANY) {
+		return mi->type != R_META_TYPE_COMMENT && mi->type != R_META_TYPE_HIGHLIGHT
+			&& mi->type != R_META_TYPE_VARTYPE;
 	}
-	//sdb_array_del (DB);
-	return set;
+	return mi->type == type;
 }
 
-// 512 = 1.5s
-// 256 = 1.3s
-// 128 = 1.2s
-// 64 = 1.14
-// 32 = 1.12
-// not storing any = 1
-#define K 256
+static RAnalMetaNode *meta_get(RAnal *a, int type, ut64 addr) {
+	RAnalMetaItem key = { .from = addr, .type = type };
+	RBNode *node = r_rbtree_find (a->meta, &key, meta_cmp);
+	return node? META_NODE (node): NULL;
+}
 
-static int meta_type_add(RAnal *a, char type, ut64 addr) {
-	char key[32];
-	ut32 count, last;
-	snprintf (key, sizeof (key)-1, "meta.%c.count", type);
-	count = (ut32)sdb_num_inc (DB, key, 1, 0);
-	last = count/K;
+// first node at or after (addr, type)
+static RAnalMetaNode *meta_lower_bound(RAnal *a, ut64 addr, int type) {
+	RAnalMetaItem key = { .from = addr, .type = type };
+	RBNode *node = r_rbtree_lower_bound (a->meta, &key, meta_cmp);
+	return node? META_NODE (node): NULL;
+}
 
-	snprintf (key, sizeof (key)-1, "meta.%c.%d", type, last);
-	sdb_array_add_num (DB, key, addr, 0);
-	return count;
+static void meta_remove(RAnal *a, RAnalMetaNode *mn) {
+	RAnalMetaItem key = { .from = mn->mi.from, .type = mn->mi.type };
+	r_rbtree_aug_delete (&a->meta, &key, meta_cmp, meta_node_free, meta_calc_max);
 }
 
-// TODO: Add APIs to resize meta? nope, just del and add
-R_API int r_meta_set_string(RAnal *a, int type, ut64 addr, const char *s) {
-	char key[100], val[2048], *e_str;
-	int ret;
-	ut64 size;
-	int space_idx = a->meta_spaces.space_idx;
-	meta_type_add (a, type, addr);
+// the covering item of the given type with the highest start
+static RAnalMetaNode *meta_stab(RBNode *node, ut64 at, int type) {
+	while (node) {
+		RAnalMetaNode *mn = META_NODE (node);
+		if (mn->max_to <= at) {
+			return NULL;
+		}
+		if (mn->mi.from <= at) {
+			RAnalMetaNode *right = meta_stab (node->child[1], at, type);
+			if (right) {
+				return right;
+			}
+			if (at < mn->mi.to && meta_match (&mn->mi, type)) {
+				return mn;
+			}
+		}
+		node = node->child[0];
+	}
+	return NULL;
+}
 
-	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, type, addr);
-	size = sdb_array_get_num (DB, key, 0, 0);
-	if (!size) {
-		size = strlen (s);
-		meta_inrange_add (a, addr, size);
-		ret = true;
-	} else {
-		ret = false;
+// Stores a copy of str in the item of type at from, replacing the previous one
+static RAnalMetaNode *meta_set(RAnal *a, int type, int subtype, ut64 from, ut64 to, const char *str, int space) {
+	char *dup = str? strdup (str): NULL;
+	RAnalMetaNode *mn = meta_get (a, type, from);
+	if (str && !dup) {
+		return NULL;
+	}
+	if (mn) {
+		free (mn->mi.str);
+		mn->mi.str = dup;
+		mn->mi.subtype = subtype;
+		mn->mi.space = space;
+		if (mn->mi.to != to) {
+			mn->mi.to = to;
+			mn->mi.size = to - from;
+			r_rbtree_aug_update_sum (a->meta, &mn->mi, &mn->rb, meta_cmp, meta_calc_max);
+		}
+		return mn;
 	}
+	if (!(mn = R_NEW0 (RAnalMetaNode))) {
+		free (dup);
+		return NULL;
+	}
+	mn->mi.from = from;
+	mn->mi.to = to;
+	mn->mi.size = to - from;
+	mn->mi.type = type;
+	mn->mi.subtype = subtype;
+	mn->mi.str = dup;
+	mn->mi.space = space;
+	r_rbtree_aug_insert (&a->meta, &mn->mi, &mn->rb, meta_cmp, meta_calc_max);
+	return mn;
+}
+
+// TODO: Add APIs to resize meta? nope, just del and add
+R_API int r_meta_set_string(RAnal *a, int type, ut64 addr, const char *s) {
+	RAnalMetaNode *mn = meta_get (a, type, addr);
+	int ret = !mn;
 	if (a->log) {
 		char *msg = r_str_newf (":C%c %s @ 0x%"PFMT64x, type, s, addr);
 		a->log (a, msg);
 		free (msg);
 	}
-	e_str = sdb_encode ((const void*)s, -1);
-	snprintf (val, sizeof (val)-1, "%d,%d,%s", (int)size, space_idx, e_str);
-	sdb_set (DB, key, val, 0);
-	free ((void*)e_str);
+	meta_set (a, type, 0, addr, mn? mn->mi.to: addr + 1, s, a->meta_spaces.space_idx);
 	return ret;
 }
 
@@ -136,13 +153,11 @@ R_API int r_meta_set_var_comment(RAnal *a, int type, ut64 idx, ut64 addr, const
 	int ret;
 	ut64 size;
 	int space_idx = a->meta_spaces.space_idx;
-	meta_type_add (a, type, addr);
 
 	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x".0x%"PFMT64x, type, addr, idx);
 	size = sdb_array_get_num (DB, key, 0, 0);
 	if (!size) {
 		size = strlen (s);
-		meta_inrange_add (a, addr, size);
 		ret = true;
 	} else {
 		ret = false;
@@ -155,30 +170,8 @@ R_API int r_meta_set_var_comment(RAnal *a, int type, ut64 idx, ut64 addr, const
 }
 
 R_API char *r_meta_get_string(RAnal *a, int type, ut64 addr) {
-	char key[100];
-	const char *k, *p, *p2, *p3;
-	snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, type, addr);
-	k = sdb_const_get (DB, key, NULL);
-	if (!k) {
-		return NULL;
-	}
-	p = strchr (k, SDB_RS);
-	if (!p) {
-		return NULL;
-	}
-	k = p + 1;
-	p2 = strchr (k, SDB_RS);
-	if (!p2) {
-		return (char *)sdb_decode (k, NULL);
-	}
-	k = p2 + 1;
-	if (type == R_META_TYPE_STRING) {
-		p3 = strchr (k, SDB_RS);
-		if (p3) {
-			return (char *)sdb_decode (p3 + 1, NULL);
-		}
-	}
-	return (char *)sdb_decode (k, NULL);
+	RAnalMetaNode *mn = meta_get (a, type, addr);
+	return (mn && mn->mi.str)? strdup (mn->mi.str): NULL;
 }
 
 R_API char *r_meta_get_var_comment (RAnal *a, int type, ut64 idx, ut64 addr) {
@@ -201,84 +194,37 @@ R_API char *r_meta_get_var_comment (RAnal *a, int type, ut64 idx, ut64 addr) {
 	return (char *)sdb_decode (p2+1, NULL);
 }
 
+// Removes the items of type starting in [addr, addr + size), all of them
+// when size is UT64_MAX
 R_API int r_meta_del(RAnal *a, int type, ut64 addr, ut64 size) {
-	char key[100], *dtr, *s, *p, *next;
-	const char *val;
-	int i;
+	RAnalMetaNode *mn;
+	ut64 last;
 	if (size == UT64_MAX) {
-		// FULL CLEANUP
-		// XXX: this thing ignores the type
 		if (type == R_META_TYPE_ANY) {
+			r_meta_free (a);
 			sdb_reset (DB);
-		} else {
-			snprintf (key, sizeof (key)-1, "meta.%c.count", type);
-			int last = (ut64)sdb_num_get (DB, key, NULL)/K;
-			for (i=0; i<last; i++) {
-				snprintf (key, sizeof (key)-1, "meta.%c.%d", type, i);
-				dtr = sdb_get (DB, key, 0);
-				for (p = dtr; p; p = next) {
-					s = sdb_anext (p, &next);
-					snprintf (key, sizeof (key)-1,
-						"meta.%c.0x%"PFMT64x,
-						type, sdb_atoi (s));
-					sdb_unset (DB, key, 0);
-					if (!next) break;
-				}
-				free (dtr);
-			}
-		}
-		return false;
-	}
-	if (type == R_META_TYPE_ANY) {
-		/* special case */
-		r_meta_del (a, R_META_TYPE_COMMENT, addr, size);
-		r_meta_del (a, R_META_TYPE_VARTYPE, addr, size);
-	}
-	if (type == R_META_TYPE_COMMENT || type == R_META_TYPE_VARTYPE) {
-		snprintf (key, sizeof (key)-1, "meta.%c.0x%"PFMT64x, type, addr);
-	} else {
-		snprintf (key, sizeof (key)-1, "meta.0x%"PFMT64x, addr);
-	}
-	meta_inrange_del (a, addr, size);
-	val = sdb_const_get (DB, key, 0);
-	if (val) {
-		if (type == R_META_TYPE_ANY) {
-			char item_key[100];
-			const char *ptr = val;
-			while (*ptr) {
-				snprintf (item_key, sizeof (item_key), "meta.%c.0x%" PFMT64x, *ptr, addr);
-				sdb_unset (DB, item_key, 0);
-				ptr++;
-				if (*ptr) {
-					ptr++;
-				}
-			}
-			sdb_unset (DB, key, 0);
 			return false;
 		}
-		if (strchr (val, ',')) {
-			char type_fld[] = "##";
-			if (val[0] == type) {
-				type_fld[0] = type;
-				type_fld[1] = ',';
-			} else {
-				type_fld[0] = ',';
-				type_fld[1] = type;
-			}
-			sdb_uncat (DB, key, type_fld, 0);
-		} else {
-			sdb_unset (DB, key, 0);
+		addr = 0;
+	}
+	if (!size) {
+		size = 1;
+	}
+	last = (UT64_MAX - addr >= size)? addr + size - 1: UT64_MAX;
+	int from_type = R_META_TYPE_ANY;
+	while ((mn = meta_lower_bound (a, addr, from_type)) && mn->mi.from <= last) {
+		addr = mn->mi.from;
+		from_type = mn->mi.type + 1;
+		if (type == R_META_TYPE_ANY || mn->mi.type == type) {
+			meta_remove (a, mn);
 		}
-		snprintf (key, sizeof (key), "meta.%c.0x%" PFMT64x, type, addr);
-		sdb_unset (DB, key, 0);
 	}
-	sdb_unset (DB, key, 0);
 	return false;
 }
 
 R_API int r_meta_var_comment_del(RAnal *a, int type, ut64 idx, ut64 addr) {
-	char *key;
-	key = r_str_newf ("meta.%c.0x%"PFMT64x"0x%"PFMT64x, type, addr, idx);
+	char key[100];
+	snprintf (key, sizeof (key) - 1, "meta.%c.0x%"PFMT64x".0x%"PFMT64x, type, addr, idx);
 	sdb_unset (DB, key, 0);
 	return 0;
 }
@@ -287,9 +233,17 @@ R_API int r_meta_cleanup(RAnal *a, ut64 from, ut64 to) {
 	return r_meta_del (a, R_META_TYPE_ANY, from, (to-from));
 }
 
+R_API void r_meta_free(RAnal *a) {
+	r_rbtree_free (a->meta, meta_node_free);
+	a->meta = NULL;
+}
+
 R_API void r_meta_item_free(void *_item) {
 	RAnalMetaItem *item = _item;
-	free (item);
+	if (item) {
+		free (item->str);
+		free (item);
+	}
 }
 
 R_API RAnalMetaItem *r_meta_item_new(int type) {
@@ -298,56 +252,7 @@ R_API RAnalMetaItem *r_meta_item_new(int type) {
 	return mi;
 }
 
-static void meta_serialize(RAnalMetaItem *it, char *k, size_t k_size, char *v, size_t v_size) {
-	snprintf (k, k_size, "meta.%c.0x%" PFMT64x, it->type, it->from);
-	if (it->subtype) {
-		snprintf (v, v_size, "%d,%d,%c,%s", (int)it->size, it->space, it->subtype, it->str);
-	} else {
-		snprintf (v, v_size, "%d,%d,%s", (int)it->size, it->space, it->str);
-	}
-}
-
-static bool meta_deserialize(RAnalMetaItem *it, const char *k, const char *v) {
-	if (strlen (k) < 8) {
-		return false;
-	}
-	if (memcmp (k + 6, ".0x", 3)) {
-		return false;
-	}
-	return r_meta_deserialize_val (it, k[5], sdb_atoi (k + 7), v);
-}
-
-R_API bool r_meta_deserialize_val(RAnalMetaItem *it, int type, ut64 from, const char *v) {
-	const char *v2;
-	char *v3;
-	it->type = type;
-	it->subtype = 0;
-	it->size = sdb_atoi (v);
-	it->from = from;
-	it->to = from + it->size;
-	v2 = strchr (v, ',');
-	if (!v2) {
-		return false;
-	}
-	it->space = atoi (v2 + 1);
-	it->str = strchr (v2 + 1, ',');
-	if (it->str) {
-		if (it->type == R_META_TYPE_STRING) {
-			v3 = strchr (it->str + 1, ',');
-			if (v3) {
-				it->subtype = *(it->str + 1);
-				it->str = v3;
-			}
-		}
-		it->str = (char *)sdb_decode ((const char*)it->str + 1, 0);
-	}
-	return true;
-}
-
 static int meta_add(RAnal *a, int type, int subtype, ut64 from, ut64 to, const char *str) {
-	int space_idx = a->meta_spaces.space_idx;
-	char *e_str, key[100], val[2048];
-	int exists;
 	if (from > to) {
 		return false;
 	}
@@ -357,30 +262,7 @@ static int meta_add(RAnal *a, int type, int subtype, ut64 from, ut64 to, const c
 	if (type == 100 && (to - from) < 1) {
 		return false;
 	}
-	/* set entry */
-	e_str = sdb_encode ((const void*)str, -1);
-	RAnalMetaItem mi = {from, to, (int)(to - from), type, subtype, e_str, space_idx};
-	meta_serialize (&mi, key, sizeof (key), val, sizeof (val));
-	exists = sdb_exists (DB, key);
-
-	sdb_set (DB, key, val, 0);
-	free (e_str);
-
-	// XXX: This is totally inefficient, using array_add withuot
-	// checking return value is wrong practice, also it may lead
-	// to inconsistent DB, and pretty bad performance. We should
-	// store this list in a different storage that doesnt have
-	// those limits and it's O(1) instead of O(n)
-	snprintf (key, sizeof (key) - 1, "meta.0x%"PFMT64x, from);
-	if (exists) {
-		const char *value = sdb_const_get (DB, key, 0);
-		int idx = sdb_array_indexof (DB, key, value, 0);
-		sdb_array_delete (DB, key, idx, 0);
-	}
-	snprintf (val, sizeof (val)-1, "%c", type);
-	sdb_array_add (DB, key, val, 0);
-	meta_inrange_add (a, from, to - from);
-	return true;
+	return meta_set (a, type, subtype, from, to, str, a->meta_spaces.space_idx) != NULL;
 }
 
 R_API int r_meta_add(RAnal *a, int type, ut64 from, ut64 to, const char *str) {
@@ -391,62 +273,166 @@ R_API int r_meta_add_with_subtype(RAnal *a, int type, int subtype, ut64 from, ut
 	return meta_add (a, type, subtype, from, to, str);
 }
 
-R_API RAnalMetaItem *r_meta_find(RAnal *a, ut64 at, int type, int where) {
-	const char *infos, *metas;
-	char key[100];
-	Sdb *s = a->sdb_meta;
-	static RAnalMetaItem mi = {0};
-	// XXX: return allocated item? wtf
-	if (where != R_META_WHERE_HERE) {
-		eprintf ("THIS WAS NOT SUPOSED TO HAPPEN\n");
-		return NULL;
+static int meta_item_cmp(const void *a, const void *b) {
+	const RAnalMetaItem *x = *(const RAnalMetaItem **)a;
+	const RAnalMetaItem *y = *(const RAnalMetaItem **)b;
+	if (x->from != y->from) {
+		return x->from < y->from? -1: 1;
 	}
+	return (x->type > y->type) - (x->type < y->type);
+}
 
-	snprintf (key, sizeof (key), "meta.0x%" PFMT64x, at);
-	infos = sdb_const_get (s, key, 0);
-	if (!infos) {
+// duplicates keep their order in the input
+static int meta_item_sort_cmp(const void *a, const void *b) {
+	int ret = meta_item_cmp (a, b);
+	if (!ret) {
+		ret = (*(const RAnalMetaItem **)a > *(const RAnalMetaItem **)b) -
+			(*(const RAnalMetaItem **)a < *(const RAnalMetaItem **)b);
+	}
+	return ret;
+}
+
+// Links the sorted nodes into a balanced tree, nodes on the deepest level,
+// the only incomplete one, are red and all the paths have depth black nodes
+static RBNode *meta_build(RAnalMetaNode **nodes, int lo, int hi, int depth, int red_depth) {
+	if (lo >= hi) {
 		return NULL;
 	}
-	for (; *infos; infos++) {
-		if (*infos == ',') {
-			continue;
+	int mid = lo + (hi - lo) / 2;
+	RBNode *node = &nodes[mid]->rb;
+	node->child[0] = meta_build (nodes, lo, mid, depth + 1, red_depth);
+	node->child[1] = meta_build (nodes, mid + 1, hi, depth + 1, red_depth);
+	node->red = depth && depth == red_depth;
+	meta_calc_max (node);
+	return node;
+}
+
+// Adds count items to the current meta space at once, copying them. Loading
+// a whole set into an empty store builds the tree in one pass instead of
+// rebalancing on every insert. Later items replace earlier ones with the same
+// type and address.
+R_API int r_meta_import(RAnal *a, const RAnalMetaItem *items, int count) {
+	const RAnalMetaItem **sorted;
+	RAnalMetaNode **nodes;
+	int i, n = 0, red_depth = 0;
+	if (count < 1) {
+		return 0;
+	}
+	if (a->meta) {
+		for (i = 0; i < count; i++) {
+			const RAnalMetaItem *it = &items[i];
+			if (meta_add (a, it->type, it->subtype, it->from, it->to, it->str)) {
+				n++;
+			}
 		}
-		if (type != R_META_TYPE_ANY && type != *infos) {
+		return n;
+	}
+	sorted = malloc (sizeof (RAnalMetaItem *) * count);
+	nodes = malloc (sizeof (RAnalMetaNode *) * count);
+	if (!sorted || !nodes) {
+		free (sorted);
+		free (nodes);
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		sorted[i] = &items[i];
+	}
+	qsort (sorted, count, sizeof (RAnalMetaItem *), meta_item_sort_cmp);
+	for (i = 0; i < count; i++) {
+		const RAnalMetaItem *it = sorted[i];
+		ut64 to = it->to > it->from? it->to: it->from + 1;
+		if (it->from > it->to || (i + 1 < count && !meta_item_cmp (&sorted[i], &sorted[i + 1]))) {
 			continue;
 		}
-		snprintf (key, sizeof (key), "meta.%c.0x%" PFMT64x, *infos, at);
-		metas = sdb_const_get (s, key, 0);
-		if (metas) {
-			if (!r_meta_deserialize_val (&mi, *infos, at, metas)) {
-				continue;
-			}
-			return &mi;
+		RAnalMetaNode *mn = R_NEW0 (RAnalMetaNode);
+		if (!mn) {
+			break;
 		}
+		mn->mi = *it;
+		mn->mi.to = to;
+		mn->mi.size = to - it->from;
+		mn->mi.space = a->meta_spaces.space_idx;
+		mn->mi.str = it->str? strdup (it->str): NULL;
+		nodes[n++] = mn;
 	}
-	return NULL;
+	while ((2 << red_depth) <= n) {
+		red_depth++;
+	}
+	a->meta = meta_build (nodes, 0, n, 0, red_depth);
+	free (nodes);
+	free (sorted);
+	return n;
 }
 
-R_API RAnalMetaItem *r_meta_find_in(RAnal *a, ut64 at, int type, int where) {
-	char *res = meta_inrange_get (a, at, 1);
-	if (!res) {
+R_API RAnalMetaItem *r_meta_find(RAnal *a, ut64 at, int type, int where) {
+	RAnalMetaNode *mn;
+	if (where != R_META_WHERE_HERE) {
+		eprintf ("THIS WAS NOT SUPOSED TO HAPPEN\n");
 		return NULL;
 	}
-	RList *list = r_str_split_list (res, ",");
-	RListIter *iter;
-	const char *meta;
-	r_list_foreach (list, iter, meta) {
-		ut64 mia = r_num_math (NULL, meta);
-		RAnalMetaItem *mi = r_meta_find (a, mia, type, where);
-		if (mi && (at >= mi->from && at < mi->to)) {
-			free (res);
-			return mi;
+	if (type != R_META_TYPE_ANY) {
+		mn = meta_get (a, type, at);
+		return mn? &mn->mi: NULL;
+	}
+	for (mn = meta_lower_bound (a, at, type); mn && mn->mi.from == at;
+			mn = meta_lower_bound (a, at, mn->mi.type + 1)) {
+		if (meta_match (&mn->mi, type)) {
+			return &mn->mi;
 		}
 	}
-	r_list_free (list);
-	free (res);
 	return NULL;
 }
 
+// The item covering at, the one starting closest to it when they overlap
+R_API RAnalMetaItem *r_meta_find_in(RAnal *a, ut64 at, int type, int where) {
+	RAnalMetaNode *mn = meta_stab (a->meta, at, type);
+	return mn? &mn->mi: NULL;
+}
+
+// The first item starting after at
+R_API RAnalMetaItem *r_meta_find_next(RAnal *a, ut64 at, int type) {
+	RAnalMetaItem key = { .from = at, .type = ST32_MAX };
+	RAnalMetaNode *mn;
+	RBIter it = r_rbtree_upper_bound_forward (a->meta, &key, meta_cmp);
+	r_rbtree_iter_while (it, mn, RAnalMetaNode, rb) {
+		if (meta_match (&mn->mi, type)) {
+			return &mn->mi;
+		}
+	}
+	return NULL;
+}
+
+// Calls cb with every item of type at at, in type order, until it returns false
+R_API void r_meta_foreach_at(RAnal *a, ut64 at, int type, RAnalMetaItemCb cb, void *user) {
+	RAnalMetaItem key = { .from = at, .type = R_META_TYPE_ANY };
+	RAnalMetaNode *mn;
+	RBIter it = r_rbtree_lower_bound_forward (a->meta, &key, meta_cmp);
+	r_rbtree_iter_while (it, mn, RAnalMetaNode, rb) {
+		if (mn->mi.from != at) {
+			break;
+		}
+		if (meta_match (&mn->mi, type) && !cb (user, &mn->mi)) {
+			break;
+		}
+	}
+}
+
+R_API int r_meta_count(RAnal *a, int type, ut64 from, ut64 to) {
+	RAnalMetaItem key = { .from = from, .type = R_META_TYPE_ANY };
+	RAnalMetaNode *mn;
+	int count = 0;
+	RBIter it = r_rbtree_lower_bound_forward (a->meta, &key, meta_cmp);
+	r_rbtree_iter_while (it, mn, RAnalMetaNode, rb) {
+		if (mn->mi.from >= to) {
+			break;
+		}
+		if (type == R_META_TYPE_ANY || mn->mi.type == type) {
+			count++;
+		}
+	}
+	return count;
+}
+
 R_API const char *r_meta_type_to_string(int type) {
 	// XXX: use type as '%c'
 	switch (type) {
@@ -655,52 +641,40 @@ R_API void r_meta_print(RAnal *a, RAnalMetaItem *d, int rad, bool show_full) {
 	}
 }
 
-static int meta_print_item(void *user, const char *k, const char *v) {
+static int meta_print_item(void *user, RAnalMetaItem *mi) {
 	RAnalMetaUserItem *ui = user;
-	RAnalMetaItem it;
-	if (!meta_deserialize (&it, k, v)) {
-		return 1;
-	}
-	int uirad = ui->rad;
+	RAnalMetaItem it = *mi;
 	if (ui->rad == 'f') {
 		if (!r_anal_fcn_in (ui->fcn, it.from)) {
-			goto beach;
+			return 1;
 		}
-		ui->rad = 0;
 	}
 	if (!it.str) {
-		it.str = strdup (""); // don't break in free
-		if (!it.str) {
-			goto beach;
-		}
+		it.str = ""; // don't break in print
 	}
-	r_meta_print (ui->anal, &it, ui->rad, true);
-beach:
-	free (it.str);
-	ui->rad = uirad;
+	r_meta_print (ui->anal, &it, ui->rad == 'f'? 0: ui->rad, true);
 	return 1;
 }
 
-R_API int r_meta_list_cb(RAnal *a, int type, int rad, SdbForeachCallback cb, void *user, ut64 addr) {
+R_API int r_meta_list_cb(RAnal *a, int type, int rad, RAnalMetaCallback cb, void *user, ut64 addr) {
 	RAnalFunction *fcn = (addr != UT64_MAX) ? r_anal_get_fcn_at (a, addr, 0) : NULL;
 	RAnalMetaUserItem ui = { a, type, rad, cb, user, 0, fcn};
-	SdbList *ls = sdb_foreach_list (DB, true);
-	SdbListIter *lsi;
-	SdbKv *kv;
+	RAnalMetaNode *mn;
+	RBIter it;
 	if (rad == 'j') {
 		a->cb_printf ("[");
 	}
 	isFirst = true; // TODO: kill global
-	ls_foreach (ls, lsi, kv) {
-		if (type == R_META_TYPE_ANY || (strlen (kv->key) > 5 && kv->key[5] == type)) {
+	r_rbtree_foreach (a->meta, it, mn, RAnalMetaNode, rb) {
+		if (type == R_META_TYPE_ANY || mn->mi.type == type) {
+			ui.count++;
 			if (cb) {
-				cb ((void *)&ui, kv->key, kv->value);
+				cb ((void *)&ui, &mn->mi);
 			} else {
-				meta_print_item ((void *)&ui, kv->key, kv->value);
+				meta_print_item ((void *)&ui, &mn->mi);
 			}
 		}
 	}
-	ls_free (ls);
 	if (rad == 'j') {
 		a->cb_printf ("]\n");
 	}
@@ -715,50 +689,39 @@ R_API int r_meta_list_at(RAnal *a, int type, int rad, ut64 addr) {
 	return r_meta_list_cb (a, type, rad, NULL, NULL, addr);
 }
 
-static int meta_enumerate_cb(void *user, const char *k, const char *v) {
+static int meta_enumerate_cb(void *user, RAnalMetaItem *mi) {
 	RAnalMetaUserItem *ui = user;
 	RList *list = ui->user;
-	RAnalMetaItem *it = R_NEW0 (RAnalMetaItem);
-	if (!it) {
-		return 0;
-	}
-	if (!meta_deserialize (it, k, v)) {
-		free (it);
-		goto beach;
+	RAnalMetaItem *it;
+	if (!mi->str || !(it = R_NEW (RAnalMetaItem))) {
+		return 1;
 	}
-	if (!it->str) {
+	*it = *mi;
+	if (!(it->str = strdup (mi->str))) {
 		free (it);
-		goto beach;
+		return 1;
 	}
 	r_list_append (list, it);
-beach:
 	return 1;
 }
 
+// Copies of the items of type with a string, free them with the list
 R_API RList *r_meta_enumerate(RAnal *a, int type) {
-	RList *list = r_list_new ();
+	RList *list = r_list_newf (r_meta_item_free);
 	r_meta_list_cb (a, type, 0, meta_enumerate_cb, list, UT64_MAX);
 	return list;
 }
 
-static int meta_unset_cb(void *user, const char *k, const char *v) {
-	char nk[128], nv[4096];
+static int meta_unset_cb(void *user, RAnalMetaItem *mi) {
 	RAnalMetaUserItem *ui = user;
-	RAnal *a = ui->anal;
-	RAnalMetaItem it = {0};
-	if (!strstr(k, ".0x"))
-		return 1;
-	meta_deserialize (&it, k, v);
-	if (it.space != -1) {
-		it.space = -1;
-		meta_serialize (&it, nk, sizeof (nk), nv, sizeof (nv));
-		sdb_set (DB, nk, nv, 0);
+	if (mi->space == *(int *)ui->user) {
+		mi->space = -1;
 	}
 	return 1;
 }
 
-R_API void r_meta_space_unset_for(RAnal *a, int type) {
-	r_meta_list_cb (a, type, 0, meta_unset_cb, NULL, UT64_MAX);
+R_API void r_meta_space_unset_for(RAnal *a, int space_idx) {
+	r_meta_list_cb (a, R_META_TYPE_ANY, 0, meta_unset_cb, &space_idx, UT64_MAX);
 }
 
 typedef struct {
@@ -767,17 +730,11 @@ typedef struct {
 	int ctx;
 } myMetaUser;
 
-static int meta_count_cb(void *user, const char *k, const char *v) {
+static int meta_count_cb(void *user, RAnalMetaItem *mi) {
 	RAnalMetaUserItem *ui = user;
 	myMetaUser *mu = ui->user;
-	RAnalMetaItem it = {0};
-	if (!strstr(k, ".0x"))
-		return 1;
-	meta_deserialize (&it, k, v);
-	if (mu) {
-		if (it.space == mu->ctx) {
-			mu->count++;
-		}
+	if (mu && mi->space == mu->ctx) {
+		mu->count++;
 	}
 	return 1;
 }
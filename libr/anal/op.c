@@ -4,14 +4,6 @@
 #include <r_util.h>
 #include <r_list.h>
 
-#define SDB_VARUSED_FMT "qzdq"
-struct VarUsedType {
-	ut64 fcn_addr;
-	char *type;
-	ut32 scope;
-	st64 delta;
-};
-
 R_API RAnalOp *r_anal_op_new () {
 	RAnalOp *op = R_NEW0 (RAnalOp);
 	if (op) {
@@ -64,41 +56,21 @@ R_API void r_anal_op_free(void *_op) {
 	free (_op);
 }
 
+// the local var a register arg is stored to at the first instruction reading it
 R_API RAnalVar *get_link_var(RAnal *anal, ut64 faddr, RAnalVar *var) {
-	const char *var_local = sdb_fmt ("var.0x%"PFMT64x".%d.%d.%s",
-			faddr, 1, var->delta, "reads");
-	const char *xss = sdb_const_get (anal->sdb_fcns, var_local, 0);
-	ut64 addr = r_num_math (NULL, xss);
-	char *inst_key = r_str_newf ("inst.0x%"PFMT64x".lvar", addr);
-	char *var_def = sdb_get (anal->sdb_fcns, inst_key, 0);
-
-	if (!var_def) {
-		free (inst_key);
+	RAnalFunction *fcn = r_anal_get_fcn_at (anal, faddr, 0);
+	RAnalFcnVar *v = r_anal_fcn_var_get (fcn, var->kind, var->delta);
+	if (!v || r_vector_empty (&v->reads)) {
 		return NULL;
 	}
-	struct VarUsedType vut;
-	RAnalVar *res = NULL;
-	if (sdb_fmt_tobin (var_def, SDB_VARUSED_FMT, &vut) == 4) {
-		res = r_anal_var_get (anal, vut.fcn_addr, vut.type[0], vut.scope, vut.delta);
-		sdb_fmt_free (&vut, SDB_VARUSED_FMT);
-	}
-	free (inst_key);
-	free (var_def);
-	return res;
+	RAnalVarUse *use = r_anal_fcn_var_use (fcn, *(ut64 *)r_vector_index_ptr (&v->reads, 0));
+	return use? r_anal_fcn_var_dup (fcn, use->link): NULL;
 }
 
 static RAnalVar *get_used_var(RAnal *anal, RAnalOp *op) {
-	char *inst_key = r_str_newf ("inst.0x%"PFMT64x".vars", op->addr);
-	char *var_def = sdb_get (anal->sdb_fcns, inst_key, 0);
-	struct VarUsedType vut;
-	RAnalVar *res = NULL;
-	if (sdb_fmt_tobin (var_def, SDB_VARUSED_FMT, &vut) == 4) {
-		res = r_anal_var_get (anal, vut.fcn_addr, vut.type[0], vut.scope, vut.delta);
-		sdb_fmt_free (&vut, SDB_VARUSED_FMT);
-	}
-	free (inst_key);
-	free (var_def);
-	return res;
+	RAnalFunction *fcn = r_anal_get_fcn_in (anal, op->addr, 0);
+	RAnalVarUse *use = r_anal_fcn_var_use (fcn, op->addr);
+	return use? r_anal_fcn_var_dup (fcn, use->var): NULL;
 }
 
 R_API int r_anal_op(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int len, int mask) {
@@ -125,7 +97,15 @@ R_API int r_anal_op(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int le
 		if (anal && anal->coreb.archbits) {
 			anal->coreb.archbits (anal->coreb.core, addr);
 		}
-		int ret = anal->cur->op (anal, op, addr, data, len);
+		int ret;
+		if (r_anal_op_cache_get (anal, op, addr, data, len, mask, &ret)) {
+			RAnalVar *tmp = get_used_var (anal, op);
+			if (tmp) {
+				op->var = tmp;
+			}
+			return ret;
+		}
+		ret = anal->cur->op (anal, op, addr, data, len);
 		if (ret < 1) {
 			op->type = R_ANAL_OP_TYPE_ILL;
 		}
@@ -134,6 +114,7 @@ R_API int r_anal_op(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int le
 		if (op->nopcode < 1) {
 			op->nopcode = 1;
 		}
+		r_anal_op_cache_set (anal, op, data, len, mask, ret);
 		//free the previous var in op->var
 		RAnalVar *tmp = get_used_var (anal, op);
 		if (tmp) {
@@ -0,0 +1,283 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Optional cache of what the anal plugin decoded (e anal.opcache). The same
+// addresses are decoded again and again by the function analysis, aae, the
+// type matching and the disassembler. r_anal_op looks the address up here
+// before calling anal->cur->op. An entry is only used when the plugin, the
+// bits and the bytes of the instruction are the same, so a stale entry is
+// never returned. Writes and hint changes drop the entries they touch to
+// keep the slots free for live code.
+
+#include <r_anal.h>
+
+#define OPCACHE_MAX_STRINGS (R_ANAL_OPCACHE_SIZE * 4)
+
+static inline ut32 slot_of(ut64 addr) {
+	ut64 h = addr * 0x9e3779b97f4a7c15ULL;
+	return (ut32)(h >> 32) & (R_ANAL_OPCACHE_SIZE - 1);
+}
+
+static void strings_free_kv(HtKv *kv) {
+	free (kv->key);
+	free (kv->value);
+	free (kv);
+}
+
+// the pointer stays valid until the cache is reset
+static const char *intern(RAnalOpCache *oc, const char *s) {
+	char *is;
+	if (!s || !*s) {
+		return NULL;
+	}
+	if ((is = ht_find (oc->strings, s, NULL))) {
+		return is;
+	}
+	if (!(is = strdup (s))) {
+		return NULL;
+	}
+	if (!ht_insert (oc->strings, s, is)) {
+		free (is);
+		return NULL;
+	}
+	oc->nstrings++;
+	return is;
+}
+
+static void opcache_free(RAnalOpCache *oc) {
+	if (oc) {
+		free (oc->slots);
+		ht_free (oc->strings);
+		free (oc);
+	}
+}
+
+R_API void r_anal_op_cache_enable(RAnal *anal, bool enable) {
+	if (!enable) {
+		opcache_free (anal->opcache);
+		anal->opcache = NULL;
+		return;
+	}
+	if (anal->opcache) {
+		return;
+	}
+	RAnalOpCache *oc = R_NEW0 (RAnalOpCache);
+	if (!oc) {
+		return;
+	}
+	oc->slots = calloc (R_ANAL_OPCACHE_SIZE, sizeof (RAnalOpCacheEntry));
+	oc->strings = ht_new (NULL, strings_free_kv, NULL);
+	if (!oc->slots || !oc->strings) {
+		opcache_free (oc);
+		return;
+	}
+	anal->opcache = oc;
+}
+
+// drops the entries, the stats are kept
+R_API void r_anal_op_cache_reset(RAnal *anal) {
+	RAnalOpCache *oc = anal->opcache;
+	if (!oc) {
+		return;
+	}
+	memset (oc->slots, 0, R_ANAL_OPCACHE_SIZE * sizeof (RAnalOpCacheEntry));
+	ht_free (oc->strings);
+	oc->strings = ht_new (NULL, strings_free_kv, NULL);
+	oc->nstrings = 0;
+	if (!oc->strings) {
+		r_anal_op_cache_enable (anal, false);
+	}
+}
+
+// drops the instructions overlapping [addr, addr + size)
+R_API void r_anal_op_cache_invalidate(RAnal *anal, ut64 addr, ut64 size) {
+	RAnalOpCache *oc = anal->opcache;
+	ut64 from, to;
+	ut32 i;
+	if (!oc || !size) {
+		return;
+	}
+	to = (addr + size < addr)? UT64_MAX: addr + size;
+	from = (addr < R_ANAL_OPCACHE_BYTES)? 0: addr - R_ANAL_OPCACHE_BYTES + 1;
+	if (to - from > R_ANAL_OPCACHE_SIZE) {
+		for (i = 0; i < R_ANAL_OPCACHE_SIZE; i++) {
+			RAnalOpCacheEntry *e = &oc->slots[i];
+			if (e->plugin && e->addr < to && e->addr + e->len > addr) {
+				e->plugin = NULL;
+				oc->invalidations++;
+			}
+		}
+		return;
+	}
+	for (; from < to; from++) {
+		RAnalOpCacheEntry *e = &oc->slots[slot_of (from)];
+		if (e->plugin && e->addr == from && e->addr + e->len > addr) {
+			e->plugin = NULL;
+			oc->invalidations++;
+		}
+	}
+}
+
+R_API bool r_anal_op_cache_get(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int len, int mask, int *ret) {
+	RAnalOpCache *oc = anal->opcache;
+	int i;
+	if (!oc) {
+		return false;
+	}
+	RAnalOpCacheEntry *e = &oc->slots[slot_of (addr)];
+	if (!e->plugin || e->addr != addr || e->plugin != anal->cur || e->bits != anal->bits
+			|| (e->mask & mask) != mask || len < e->len || memcmp (e->bytes, data, e->len)) {
+		oc->misses++;
+		return false;
+	}
+	oc->hits++;
+	op->addr = addr;
+	op->mnemonic = e->mnemonic? strdup (e->mnemonic): NULL;
+	op->reg = e->reg;
+	op->ireg = e->ireg;
+	op->type = e->type;
+	op->type2 = e->type2;
+	op->prefix = e->prefix;
+	op->group = e->group;
+	op->stackop = e->stackop;
+	op->cond = e->cond;
+	op->size = e->size;
+	op->nopcode = e->nopcode;
+	op->cycles = e->cycles;
+	op->failcycles = e->failcycles;
+	op->family = e->family;
+	op->id = e->id;
+	op->eob = e->eob;
+	op->sign = e->sign;
+	op->delay = e->delay;
+	op->jump = e->jump;
+	op->fail = e->fail;
+	op->direction = e->direction;
+	op->ptr = e->ptr;
+	op->val = e->val;
+	op->ptrsize = e->ptrsize;
+	op->stackptr = e->stackptr;
+	op->refptr = e->refptr;
+	op->scale = e->scale;
+	op->disp = e->disp;
+	op->hint.new_bits = e->new_bits;
+	if (mask & R_ANAL_OP_MASK_ESIL) {
+		r_strbuf_set (&op->esil, e->esil? e->esil: "");
+	}
+	if (e->opex) {
+		r_strbuf_set (&op->opex, e->opex);
+	}
+	if (mask & R_ANAL_OP_MASK_VAL) {
+		for (i = 0; i < 3; i++) {
+			if (e->vals & (1 << i)) {
+				op->src[i] = r_anal_value_copy (&e->values[i]);
+			}
+		}
+		if (e->vals & (1 << 3)) {
+			op->dst = r_anal_value_copy (&e->values[3]);
+		}
+	}
+	*ret = e->ret;
+	return true;
+}
+
+// op is what anal->cur->op just filled for data
+R_API void r_anal_op_cache_set(RAnal *anal, RAnalOp *op, const ut8 *data, int len, int mask, int ret) {
+	RAnalOpCache *oc = anal->opcache;
+	int i;
+	if (!oc || ret < 1 || op->size < 1 || op->size > R_ANAL_OPCACHE_BYTES || op->size > len
+			|| op->switch_op || op->next) {
+		return;
+	}
+	if (oc->nstrings > OPCACHE_MAX_STRINGS) {
+		r_anal_op_cache_reset (anal);
+		if (!(oc = anal->opcache)) {
+			return;
+		}
+	}
+	RAnalOpCacheEntry *e = &oc->slots[slot_of (op->addr)];
+	if (e->plugin && e->addr != op->addr) {
+		oc->evictions++;
+	}
+	memset (e, 0, sizeof (RAnalOpCacheEntry));
+	e->addr = op->addr;
+	e->bits = anal->bits;
+	e->mask = mask;
+	e->ret = ret;
+	e->len = op->size;
+	memcpy (e->bytes, data, op->size);
+	e->mnemonic = intern (oc, op->mnemonic);
+	e->esil = intern (oc, r_strbuf_get (&op->esil));
+	e->opex = intern (oc, r_strbuf_get (&op->opex));
+	e->reg = op->reg;
+	e->ireg = op->ireg;
+	e->type = op->type;
+	e->type2 = op->type2;
+	e->prefix = op->prefix;
+	e->group = op->group;
+	e->stackop = op->stackop;
+	e->cond = op->cond;
+	e->size = op->size;
+	e->nopcode = op->nopcode;
+	e->cycles = op->cycles;
+	e->failcycles = op->failcycles;
+	e->family = op->family;
+	e->id = op->id;
+	e->eob = op->eob;
+	e->sign = op->sign;
+	e->delay = op->delay;
+	e->jump = op->jump;
+	e->fail = op->fail;
+	e->direction = op->direction;
+	e->ptr = op->ptr;
+	e->val = op->val;
+	e->ptrsize = op->ptrsize;
+	e->stackptr = op->stackptr;
+	e->refptr = op->refptr;
+	e->scale = op->scale;
+	e->disp = op->disp;
+	e->new_bits = op->hint.new_bits;
+	for (i = 0; i < 3; i++) {
+		if (op->src[i]) {
+			e->values[i] = *op->src[i];
+			e->vals |= 1 << i;
+		}
+	}
+	if (op->dst) {
+		e->values[3] = *op->dst;
+		e->vals |= 1 << 3;
+	}
+	// set last, a failed intern leaves a free slot behind
+	e->plugin = anal->cur;
+}
+
+R_API void r_anal_op_cache_stats(RAnal *anal, int mode) {
+	RAnalOpCache *oc = anal->opcache;
+	ut64 hits = oc? oc->hits: 0, misses = oc? oc->misses: 0;
+	ut32 i, used = 0;
+	if (oc) {
+		for (i = 0; i < R_ANAL_OPCACHE_SIZE; i++) {
+			if (oc->slots[i].plugin) {
+				used++;
+			}
+		}
+	}
+	int rate = (hits + misses)? (int)((hits * 100) / (hits + misses)): 0;
+	if (mode == 'j') {
+		anal->cb_printf ("{\"enabled\":%s,\"slots\":%d,\"used\":%d,\"strings\":%d,"
+			"\"hits\":%"PFMT64d",\"misses\":%"PFMT64d",\"rate\":%d,"
+			"\"evictions\":%"PFMT64d",\"invalidations\":%"PFMT64d"}\n",
+			r_str_bool (oc != NULL), R_ANAL_OPCACHE_SIZE, used, oc? oc->nstrings: 0,
+			hits, misses, rate, oc? oc->evictions: 0, oc? oc->invalidations: 0);
+		return;
+	}
+	if (!oc) {
+		anal->cb_printf ("anal.opcache is disabled\n");
+		return;
+	}
+	anal->cb_printf ("slots          %d/%d\n", used, R_ANAL_OPCACHE_SIZE);
+	anal->cb_printf ("strings        %d\n", oc->nstrings);
+	anal->cb_printf ("hits           %"PFMT64d" (%d%%)\n", hits, rate);
+	anal->cb_printf ("misses         %"PFMT64d"\n", misses);
+	anal->cb_printf ("evictions      %"PFMT64d"\n", oc->evictions);
+	anal->cb_printf ("invalidations  %"PFMT64d"\n", oc->invalidations);
+}
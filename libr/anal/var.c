@@ -5,121 +5,254 @@
 #include <r_cons.h>
 #include <r_list.h>
 
-#define DB a->sdb_fcns
+// The variables of a function live in fcn->vars, sorted by (kind, delta) so
+// they are found by binary search, and fcn->var_uses maps the address of an
+// instruction to the variable it accesses. Projects export them as afv
+// commands (see afl*), nothing of it is kept in sdb.
 
-struct VarType {
-	bool isarg;
-	char *type;
-	int size;
-	char *name;
-};
+static int fcn_var_cmp(char kind, int delta, const RAnalFcnVar *v) {
+	if (kind != v->kind) {
+		return kind < v->kind? -1: 1;
+	}
+	return (delta < v->delta)? -1: (delta > v->delta)? 1: 0;
+}
 
-#define SDB_VARTYPE_FMT "bzdz"
+// *idx gets the index of the variable, or the one it would be inserted at
+static RAnalFcnVar *fcn_var_find(RAnalFunction *fcn, char kind, int delta, size_t *idx) {
+	size_t lo = 0, hi = r_pvector_len (&fcn->vars);
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		RAnalFcnVar *v = r_pvector_at (&fcn->vars, mid);
+		int ret = fcn_var_cmp (kind, delta, v);
+		if (!ret) {
+			if (idx) {
+				*idx = mid;
+			}
+			return v;
+		}
+		if (ret < 0) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	if (idx) {
+		*idx = lo;
+	}
+	return NULL;
+}
 
-#define EXISTS(x, ...) snprintf (key, sizeof (key) - 1, x, ## __VA_ARGS__), sdb_exists (DB, key)
-#define SETKEY(x, ...) snprintf (key, sizeof (key) - 1, x, ## __VA_ARGS__);
-#define SETKEY2(x, ...) snprintf (key2, sizeof (key) - 1, x, ## __VA_ARGS__);
-#define SETVAL(x, ...) snprintf (val, sizeof (val) - 1, x, ## __VA_ARGS__);
-R_API bool r_anal_var_display(RAnal *anal, int delta, char kind, const char *type) {
-	char *fmt = r_type_format (anal->sdb_types, type);
-	RRegItem *i;
-	if (!fmt) {
-		eprintf ("type:%s doesn't exist\n", type);
+R_API RAnalFcnVar *r_anal_fcn_var_get(RAnalFunction *fcn, char kind, int delta) {
+	return fcn? fcn_var_find (fcn, kind, delta, NULL): NULL;
+}
+
+R_API RAnalFcnVar *r_anal_fcn_var_get_byname(RAnalFunction *fcn, const char *name) {
+	void **it;
+	if (!fcn || !name) {
+		return NULL;
+	}
+	r_pvector_foreach (&fcn->vars, it) {
+		RAnalFcnVar *v = *it;
+		if (!strcmp (v->name, name)) {
+			return v;
+		}
+	}
+	return NULL;
+}
+
+static void fcn_var_free(RAnalFcnVar *v) {
+	if (v) {
+		free (v->name);
+		free (v->type);
+		r_vector_clear (&v->reads);
+		r_vector_clear (&v->writes);
+		free (v);
+	}
+}
+
+R_API void r_anal_fcn_vars_fini(RAnalFunction *fcn) {
+	void **it;
+	r_pvector_foreach (&fcn->vars, it) {
+		fcn_var_free (*it);
+	}
+	r_pvector_clear (&fcn->vars);
+	r_vector_clear (&fcn->var_uses);
+}
+
+static RAnalFcnVar *fcn_var_set(RAnalFunction *fcn, int delta, char kind, const char *type, int size,
+		bool isarg, const char *name) {
+	size_t idx;
+	char *n = strdup (name? name: "");
+	char *t = strdup (type);
+	if (!n || !t) {
+		free (n);
+		free (t);
+		return NULL;
+	}
+	RAnalFcnVar *v = fcn_var_find (fcn, kind, delta, &idx);
+	if (v) {
+		free (v->name);
+		free (v->type);
+	} else {
+		if (!(v = R_NEW0 (RAnalFcnVar))) {
+			free (n);
+			free (t);
+			return NULL;
+		}
+		v->kind = kind;
+		v->delta = delta;
+		r_vector_init (&v->reads, sizeof (ut64), NULL, NULL);
+		r_vector_init (&v->writes, sizeof (ut64), NULL, NULL);
+		if (!r_pvector_insert (&fcn->vars, idx, v)) {
+			v->name = n;
+			v->type = t;
+			fcn_var_free (v);
+			return NULL;
+		}
+	}
+	v->name = n;
+	v->type = t;
+	v->size = size;
+	v->isarg = isarg;
+	return v;
+}
+
+// the uses pointing to the variable go away with it
+static void fcn_var_remove(RAnalFunction *fcn, size_t idx) {
+	RAnalFcnVar *v = r_pvector_remove_at (&fcn->vars, idx);
+	RAnalVarUse *use = fcn->var_uses.a;
+	size_t i, n = 0;
+	for (i = 0; i < fcn->var_uses.len; i++) {
+		if (use[i].var == v) {
+			use[i].var = NULL;
+		}
+		if (use[i].link == v) {
+			use[i].link = NULL;
+		}
+		if (use[i].var || use[i].link) {
+			use[n++] = use[i];
+		}
+	}
+	fcn->var_uses.len = n;
+	fcn_var_free (v);
+}
+
+static bool fcn_var_del(RAnalFunction *fcn, char kind, int delta) {
+	size_t idx;
+	if (!fcn_var_find (fcn, kind, delta, &idx)) {
 		return false;
 	}
-	bool usePxr = !strcmp (type, "int"); // hacky but useful
-	switch (kind) {
-	case R_ANAL_VAR_KIND_REG:
-		i = r_reg_index_get (anal->reg, delta);
-		if (i) {
-			if (usePxr) {
-				anal->cb_printf ("pxr $w @r:%s\n", i->name);
-			} else {
-				anal->cb_printf ("pf r (%s)\n", i->name);
-			}
-		} else {
-			eprintf ("register not found\n");
+	fcn_var_remove (fcn, idx);
+	return true;
+}
+
+static RAnalVarUse *var_use_at(RAnalFunction *fcn, ut64 addr, bool create) {
+	RAnalVarUse *use = fcn->var_uses.a;
+	size_t lo = 0, hi = fcn->var_uses.len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (use[mid].addr == addr) {
+			return &use[mid];
 		}
-		break;
-	case R_ANAL_VAR_KIND_BPV:
-		if (delta > 0) {
-			if (usePxr) {
-				anal->cb_printf ("pxr $w @%s+0x%x\n", anal->reg->name[R_REG_NAME_BP], delta);
-			} else {
-				anal->cb_printf ("pf %s @%s+0x%x\n", fmt, anal->reg->name[R_REG_NAME_BP], delta);
-			}
+		if (addr < use[mid].addr) {
+			hi = mid;
 		} else {
-			if (usePxr) {
-				anal->cb_printf ("pxr $w @%s-0x%x\n", anal->reg->name[R_REG_NAME_BP], -delta);
-			} else {
-				anal->cb_printf ("pf %s @%s-0x%x\n", fmt, anal->reg->name[R_REG_NAME_BP], -delta);
-			}
+			lo = mid + 1;
 		}
-		break;
-	case R_ANAL_VAR_KIND_SPV:
-		if (usePxr) {
-			anal->cb_printf ("pxr $w @%s+0x%x\n", anal->reg->name[R_REG_NAME_SP], delta);
+	}
+	if (!create) {
+		return NULL;
+	}
+	RAnalVarUse nuse = { addr, NULL, NULL };
+	return r_vector_insert (&fcn->var_uses, lo, &nuse);
+}
+
+// keeps vec sorted and without duplicates
+static bool addr_vector_add(RVector *vec, ut64 addr) {
+	ut64 *a = vec->a;
+	size_t lo = 0, hi = vec->len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (a[mid] == addr) {
+			return true;
+		}
+		if (addr < a[mid]) {
+			hi = mid;
 		} else {
-			anal->cb_printf ("pf %s @ %s+0x%x\n", fmt, anal->reg->name[R_REG_NAME_SP], delta);
+			lo = mid + 1;
 		}
-		break;
 	}
-	free (fmt);
-	return true;
+	return r_vector_insert (vec, lo, &addr) != NULL;
 }
 
-R_API bool r_anal_var_add(RAnal *a, ut64 addr, int scope, int delta, char kind, const char *type, int size,
-		bool isarg, const char *name) {
-	if (!a) {
-		return false;
+static bool var_kind_valid(char kind) {
+	switch (kind) {
+	case R_ANAL_VAR_KIND_BPV: // base pointer var/args
+	case R_ANAL_VAR_KIND_SPV: // stack pointer var/args
+	case R_ANAL_VAR_KIND_REG: // registers args
+		return true;
+	}
+	eprintf ("Invalid var kind '%c'\n", kind);
+	return false;
+}
+
+// the function starting at addr, or else the one containing it
+static RAnalFunction *var_fcn(RAnal *a, ut64 addr) {
+	RAnalFunction *fcn = r_anal_get_fcn_at (a, addr, 0);
+	return fcn? fcn: r_anal_get_fcn_in (a, addr, 0);
+}
+
+static RAnalVar *var_dup(RAnalFunction *fcn, RAnalFcnVar *v, int scope) {
+	RAnalVar *av = R_NEW0 (RAnalVar);
+	if (!av) {
+		return NULL;
 	}
+	av->addr = fcn->addr;
+	av->scope = scope;
+	av->delta = v->delta;
+	av->isarg = v->isarg;
+	av->name = strdup (v->name);
+	av->size = v->size;
+	av->type = strdup (v->type);
+	av->kind = v->kind;
+	return av;
+}
+
+R_API RAnalVarUse *r_anal_fcn_var_use(RAnalFunction *fcn, ut64 addr) {
+	return fcn? var_use_at (fcn, addr, false): NULL;
+}
+
+R_API RAnalVar *r_anal_fcn_var_dup(RAnalFunction *fcn, RAnalFcnVar *v) {
+	return (fcn && v)? var_dup (fcn, v, 1): NULL;
+}
+
+static bool var_add(RAnalFunction *fcn, int delta, char kind, const char *type, int size, bool isarg,
+		const char *name) {
 	if (!kind) {
 		kind = R_ANAL_VAR_KIND_BPV;
 	}
 	if (!type) {
 		type = "int";
 	}
-	switch (kind) {
-	case R_ANAL_VAR_KIND_BPV: // base pointer var/args
-	case R_ANAL_VAR_KIND_SPV: // stack pointer var/args
-	case R_ANAL_VAR_KIND_REG: // registers args
-		break;
-	default:
-		eprintf ("Invalid var kind '%c'\n", kind);
+	if (!var_kind_valid (kind)) {
 		return false;
 	}
-	const char *var_def = sdb_fmt ("%d,%s,%d,%s", isarg, type, size, name);
-	if (scope > 0) {
-		const char *sign = "";
-		if (delta < 0) {
-			delta = -delta;
-			sign = "_";
-		}
-		/* local variable */
-		const char *fcn_key = sdb_fmt ("fcn.0x%"PFMT64x ".%c", addr, kind);
-		const char *var_key = sdb_fmt ("var.0x%"PFMT64x ".%c.%d.%s%d", addr, kind, scope, sign, delta);
-		const char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", addr, scope, name);
-		const char *shortvar = sdb_fmt ("%d.%s%d", scope, sign, delta);
-		sdb_array_add (DB, fcn_key, shortvar, 0);
-		sdb_set (DB, var_key, var_def, 0);
-		if (*sign) {
-			delta = -delta;
-		}
-		char *name_val = r_str_newf ("%c,%d", kind, delta);
-		sdb_set (DB, name_key, name_val, 0);
-		free (name_val);
-	} else {
-		/* global variable */
-		const char *var_global = sdb_fmt ("var.0x%"PFMT64x, addr);
-		const char *var_def = sdb_fmt ("%c.%s,%d,%s", kind, type, size, name);
-		sdb_array_add (DB, var_global, var_def, 0);
+	return fcn_var_set (fcn, delta, kind, type, size, isarg, name) != NULL;
+}
+
+R_API bool r_anal_var_add(RAnal *a, ut64 addr, int scope, int delta, char kind, const char *type, int size,
+		bool isarg, const char *name) {
+	if (!a || scope < 1) {
+		// only function locals and arguments are stored
+		return false;
 	}
-	return true;
+	RAnalFunction *fcn = var_fcn (a, addr);
+	return fcn? var_add (fcn, delta, kind, type, size, isarg, name): false;
 }
 
-R_API int r_anal_var_retype(RAnal *a, ut64 addr, int scope, int delta, char kind, const char *type, int size, 
+R_API int r_anal_var_retype(RAnal *a, ut64 addr, int scope, int delta, char kind, const char *type, int size,
 		bool isarg, const char *name) {
-	if (!a) {
+	if (!a || scope < 1) {
 		return false;
 	}
 	if (kind < 1) {
@@ -128,231 +261,137 @@ R_API int r_anal_var_retype(RAnal *a, ut64 addr, int scope, int delta, char kind
 	if (!type) {
 		type = "int";
 	}
-	RAnalFunction *fcn = r_anal_get_fcn_in (a, addr, 0);
+	RAnalFunction *fcn = var_fcn (a, addr);
 	if (!fcn) {
 		return false;
 	}
 	if ((size == -1) && (delta == -1) ) {
-		RList *list = r_anal_var_list (a, fcn, kind);
-		RListIter *iter;
-		RAnalVar *var;
-		r_list_foreach (list, iter, var) {
-			if (!strcmp (var->name, name)) {
-				delta = var->delta;
-				size = var->size;
-				break;
-			}
+		RAnalFcnVar *v = r_anal_fcn_var_get_byname (fcn, name);
+		if (v && v->kind == kind) {
+			delta = v->delta;
+			size = v->size;
 		}
-		r_list_free (list);
 	}
-	switch (kind) {
-	case R_ANAL_VAR_KIND_REG:
-	case R_ANAL_VAR_KIND_BPV:
-	case R_ANAL_VAR_KIND_SPV:
-		break;
-	default:
-		eprintf ("Invalid var kind '%c'\n", kind);
+	if (!var_kind_valid (kind) || !fcn_var_set (fcn, delta, kind, type, size, isarg, name)) {
 		return false;
 	}
-	const char *var_def = sdb_fmt ("%d,%s,%d,%s", isarg, type, size, name);
-	if (scope > 0) {
-		char *sign = delta >= 0 ? "": "_";
-		/* local variable */
-		const char *fcn_key = sdb_fmt ("fcn.0x%"PFMT64x ".%c", fcn->addr, kind);
-		const char *var_key = sdb_fmt ("var.0x%"PFMT64x ".%c.%d.%s%d", fcn->addr, kind, scope, sign, R_ABS(delta));
-		const char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", fcn->addr, scope, name);
-		const char *shortvar = sdb_fmt ("%d.%s%d", scope, sign, R_ABS(delta));
-		const char *name_val = sdb_fmt ("%c,%d", kind, delta);
-		sdb_array_add (DB, fcn_key, shortvar, 0);
-		sdb_set (DB, var_key, var_def, 0);
-		sdb_set (DB, name_key, name_val, 0);
-		Sdb *TDB = a->sdb_types;
-		const char *type_kind = sdb_const_get (TDB, type, 0);
-		if (type_kind && r_str_startswith (type_kind, "struct")) {
-			char *field;
-			int field_n;
-			char *type_key = r_str_newf ("%s.%s", type_kind, type);
-			for (field_n = 0; (field = sdb_array_get (TDB, type_key, field_n, NULL)); field_n++) {
-				char *field_key = r_str_newf ("%s.%s", type_key, field);
-				char *field_type = sdb_array_get (TDB, field_key, 0, NULL);
-				ut64 field_offset = sdb_array_get_num (TDB, field_key, 1, NULL);
-				if (field_offset != 0) { // delete variables which are overlayed by structure
-					r_anal_var_delete (a, addr, kind, scope, delta + field_offset);
-				}
-				free (field_type);
-				free (field_key);
-				free (field);
+	Sdb *TDB = a->sdb_types;
+	const char *type_kind = sdb_const_get (TDB, type, 0);
+	if (type_kind && r_str_startswith (type_kind, "struct")) {
+		char *field;
+		int field_n;
+		char *type_key = r_str_newf ("%s.%s", type_kind, type);
+		for (field_n = 0; (field = sdb_array_get (TDB, type_key, field_n, NULL)); field_n++) {
+			char *field_key = r_str_newf ("%s.%s", type_key, field);
+			ut64 field_offset = sdb_array_get_num (TDB, field_key, 1, NULL);
+			if (field_offset != 0) { // delete variables which are overlayed by structure
+				fcn_var_del (fcn, kind, delta + field_offset);
 			}
-			free (type_key);
+			free (field_key);
+			free (field);
 		}
-	} else {
-		/* global variable */
-		const char *var_global = sdb_fmt ("var.0x%"PFMT64x, fcn->addr);
-		sdb_array_add (DB, var_global, var_def, 0);
+		free (type_key);
 	}
 	return true;
 }
 
 R_API int r_anal_var_delete_all(RAnal *a, ut64 addr, const char kind) {
-	RAnalFunction *fcn = r_anal_get_fcn_in (a, addr, 0);
+	RAnalFunction *fcn = var_fcn (a, addr);
 	if (fcn) {
-		RAnalVar *v;
-		RListIter *iter;
-		RList *list = r_anal_var_list (a, fcn, kind);
-		r_list_foreach (list, iter, v) {
-			// r_anal_var_delete (a, addr, kind, v->scope, v->delta);
-			r_anal_var_delete (a, addr, kind, 1, v->delta);
+		size_t i = r_pvector_len (&fcn->vars);
+		while (i-- > 0) {
+			RAnalFcnVar *v = r_pvector_at (&fcn->vars, i);
+			if (v->kind == kind) {
+				fcn_var_remove (fcn, i);
+			}
 		}
-		// XXX: i dont think we want to alocate and free by hand. r_anal_var_delete should be the list->free already
-		r_list_free (list);
 	}
 	return 0;
 }
 
 R_API int r_anal_var_delete(RAnal *a, ut64 addr, const char kind, int scope, int delta) {
-	RAnalVar *av = r_anal_var_get (a, addr, kind, scope, delta);
-	if (!av) {
+	RAnalFunction *fcn = var_fcn (a, addr);
+	if (!fcn || scope < 1) {
 		return false;
 	}
-	if (scope > 0) {
-		char *sign = "";
-		if (delta < 0) {
-			delta = -delta;
-			sign = "_";
-		}
-		char *fcn_key = sdb_fmt ("fcn.0x%"PFMT64x ".%c", addr, kind);
-		char *var_key = sdb_fmt ("var.0x%"PFMT64x ".%c.%d.%s%d", addr, kind, scope, sign, delta);
-		char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", addr, scope, av->name);
-		char *shortvar = sdb_fmt ("%d.%s%d", scope, sign, delta);
-		sdb_array_remove (DB, fcn_key, shortvar, 0);
-		sdb_unset (DB, var_key, 0);
-		sdb_unset (DB, name_key, 0);
-		if (*sign) {
-			delta = -delta;
-		}
-	} else {
-		char *var_global = sdb_fmt ("var.0x%"PFMT64x, addr);
-		char *var_def = sdb_fmt ("%c.%s,%d,%s", kind, av->type, av->size, av->name);
-		sdb_array_remove (DB, var_global, var_def, 0);
-	}
-	r_anal_var_free (av);
-	r_anal_var_access_clear (a, addr, scope, delta);
-	return true;
+	return fcn_var_del (fcn, kind, delta);
 }
 
 R_API bool r_anal_var_delete_byname(RAnal *a, RAnalFunction *fcn, int kind, const char *name) {
-	char *varlist;
 	if (!a || !fcn) {
 		return false;
 	}
-	varlist = sdb_get (DB, sdb_fmt ("fcn.0x%"PFMT64x ".%c",
-			fcn->addr, kind), 0);
-	if (varlist) {
-		char *next, *ptr = varlist;
-		if (varlist && *varlist) {
-			do {
-				char *word = sdb_anext (ptr, &next);
-				char *sign = strstr (word, "_");
-				const char *vardef = sdb_const_get (DB, sdb_fmt (
-						"var.0x%"PFMT64x ".%c.%s",
-						fcn->addr, kind, word), 0);
-				if (sign) {
-					*sign = '-';
-				}
-				int delta = strlen (word) < 3? -1: atoi (word + 2);
-				if (vardef) {
-					const char *p = strchr (vardef, ',');
-					if (p) {
-						p = strchr (p + 1, ',');
-						if (p) {
-							p = strchr (p + 1, ',');
-							if (p) {
-								if (!strcmp (p + 1, name)) {
-									return r_anal_var_delete (a, fcn->addr,
-										kind, 1, delta);
-								}
-							}
-						}
-					}
-				} else {
-					eprintf ("Inconsistent Sdb storage, Cannot find '%s'\n", word);
-				}
-				ptr = next;
-			} while (next);
-		}
+	RAnalFcnVar *v = r_anal_fcn_var_get_byname (fcn, name);
+	if (!v || v->kind != kind) {
+		return false;
 	}
-	free (varlist);
-	return false;
+	return fcn_var_del (fcn, v->kind, v->delta);
 }
 
 R_API RAnalVar *r_anal_var_get_byname(RAnal *a, ut64 addr, const char *name) {
 	if (!a || !name) {
-		// eprintf ("No something\n");
-		return NULL;
-	}
-	char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", addr, 1, name);
-	char *name_value = sdb_get (DB, name_key, 0);
-	if (!name_value) {
-		// eprintf ("Cant find key for %s\n", name_key);
 		return NULL;
 	}
-	const char *comma = strchr (name_value, ',');
-	if (comma && *comma) {
-		int delta = r_num_math (NULL, comma + 1);
-		RAnalVar *res = r_anal_var_get (a, addr, *name_value, 1, delta);
-		free (name_value);
-		return res;
-	}
-	free (name_value);
-	return NULL;
+	RAnalFunction *fcn = var_fcn (a, addr);
+	RAnalFcnVar *v = r_anal_fcn_var_get_byname (fcn, name);
+	return v? var_dup (fcn, v, 1): NULL;
 }
 
 R_API RAnalVar *r_anal_var_get(RAnal *a, ut64 addr, char kind, int scope, int delta) {
-	RAnalVar *av;
-	struct VarType vt = {
-		0
-	};
-	char *sign = "";
-	RAnalFunction *fcn = r_anal_get_fcn_in (a, addr, 0);
+	RAnalFunction *fcn = var_fcn (a, addr);
 	if (!fcn) {
 		return NULL;
 	}
-	if (delta < 0) {
-		delta = -delta;
-		sign = "_";
-	}
-	const char *varkey = sdb_fmt ("var.0x%"PFMT64x ".%c.%d.%s%d",
-			fcn->addr, kind, scope, sign, delta);
-	char *vardef = sdb_get (DB, varkey, 0);
-	if (!vardef) {
-		return NULL;
-	}
-	if (*sign) {
-		delta = -delta;
-	}
-	sdb_fmt_init (&vt, SDB_VARTYPE_FMT);
-	sdb_fmt_tobin (vardef, SDB_VARTYPE_FMT, &vt);
-	free (vardef);
+	RAnalFcnVar *v = fcn_var_find (fcn, kind, delta, NULL);
+	return v? var_dup (fcn, v, scope): NULL;
+}
 
-	av = R_NEW0 (RAnalVar);
-	if (!av) {
-		sdb_fmt_free (&vt, SDB_VARTYPE_FMT);
-		return NULL;
+R_API bool r_anal_var_display(RAnal *anal, int delta, char kind, const char *type) {
+	char *fmt = r_type_format (anal->sdb_types, type);
+	RRegItem *i;
+	if (!fmt) {
+		eprintf ("type:%s doesn't exist\n", type);
+		return false;
 	}
-	av->addr = fcn->addr;
-	av->scope = scope;
-	av->delta = delta;
-	av->isarg = vt.isarg;
-	av->name = vt.name? strdup (vt.name): strdup ("unkown_var");
-	av->size = vt.size;
-	av->type = vt.type? strdup (vt.type): strdup ("unkown_type");
-	av->kind = kind;
-	sdb_fmt_free (&vt, SDB_VARTYPE_FMT);
-	// TODO:
-	// get name from sdb
-	// get size from sdb
-	// get type from sdb
-	return av;
+	bool usePxr = !strcmp (type, "int"); // hacky but useful
+	switch (kind) {
+	case R_ANAL_VAR_KIND_REG:
+		i = r_reg_index_get (anal->reg, delta);
+		if (i) {
+			if (usePxr) {
+				anal->cb_printf ("pxr $w @r:%s\n", i->name);
+			} else {
+				anal->cb_printf ("pf r (%s)\n", i->name);
+			}
+		} else {
+			eprintf ("register not found\n");
+		}
+		break;
+	case R_ANAL_VAR_KIND_BPV:
+		if (delta > 0) {
+			if (usePxr) {
+				anal->cb_printf ("pxr $w @%s+0x%x\n", anal->reg->name[R_REG_NAME_BP], delta);
+			} else {
+				anal->cb_printf ("pf %s @%s+0x%x\n", fmt, anal->reg->name[R_REG_NAME_BP], delta);
+			}
+		} else {
+			if (usePxr) {
+				anal->cb_printf ("pxr $w @%s-0x%x\n", anal->reg->name[R_REG_NAME_BP], -delta);
+			} else {
+				anal->cb_printf ("pf %s @%s-0x%x\n", fmt, anal->reg->name[R_REG_NAME_BP], -delta);
+			}
+		}
+		break;
+	case R_ANAL_VAR_KIND_SPV:
+		if (usePxr) {
+			anal->cb_printf ("pxr $w @%s+0x%x\n", anal->reg->name[R_REG_NAME_SP], delta);
+		} else {
+			anal->cb_printf ("pf %s @ %s+0x%x\n", fmt, anal->reg->name[R_REG_NAME_SP], delta);
+		}
+		break;
+	}
+	free (fmt);
+	return true;
 }
 
 R_API void r_anal_var_free(RAnalVar *av) {
@@ -382,12 +421,6 @@ R_API ut64 r_anal_var_addr(RAnal *a, RAnalFunction *fcn, const char *name) {
 	return ret;
 }
 
-/* (columns) elements in the array value */
-#define R_ANAL_VAR_SDB_KIND 0 /* char */
-#define R_ANAL_VAR_SDB_TYPE 1 /* string */
-#define R_ANAL_VAR_SDB_SIZE 2 /* number */
-#define R_ANAL_VAR_SDB_NAME 3 /* string */
-
 #define IS_NUMBER(x) ((x) >= '0' && (x) <= '9')
 
 R_API bool r_anal_var_check_name(const char *name) {
@@ -396,133 +429,96 @@ R_API bool r_anal_var_check_name(const char *name) {
 
 // afvn local_48 counter
 R_API int r_anal_var_rename(RAnal *a, ut64 addr, int scope, char kind, const char *old_name, const char *new_name, bool verbose) {
-	char key[128], *stored_name;
-	int delta;
-
 	if (!r_anal_var_check_name (new_name)) {
 		return 0;
 	}
-	RAnalVar *v1 = r_anal_var_get_byname (a, addr, new_name);
-	if (v1) {
-		r_anal_var_free (v1);
+	RAnalFunction *fcn = var_fcn (a, addr);
+	if (r_anal_fcn_var_get_byname (fcn, new_name)) {
 		if (verbose) {
 			eprintf ("variable or arg with name `%s` already exist\n", new_name);
 		}
 		return false;
 	}
-	// XXX: This is hardcoded because ->kind seems to be 0
-	scope = 1;
-	// XXX. this is pretty weak, because oldname may not exist  too and error returned.
-	if (scope > 0) { // local
-		const char *sign = "";
-		SETKEY ("var.0x%"PFMT64x ".%d.%s", addr, scope, old_name);
-		char *name_val = sdb_get (DB, key, 0);
-		if (!name_val) {
-			return 0;
-		}
-		char *comma = strchr (name_val, ',');
-		if (comma) {
-			delta = r_num_math (NULL, comma + 1);
-			sdb_unset (DB, key, 0);
-			SETKEY ("var.0x%"PFMT64x ".%d.%s", addr, scope, new_name);
-			sdb_set (DB, key, name_val, 0);
-			free (name_val);
-			if (delta < 0) {
-				delta = -delta;
-				sign = "_";
-			}
-			SETKEY ("var.0x%"PFMT64x ".%c.%d.%s%d", addr, kind, scope, sign, delta);
-			sdb_array_set (DB, key, R_ANAL_VAR_SDB_NAME, new_name, 0);
-		}
-	} else { // global
-		SETKEY ("var.0x%"PFMT64x, addr);
-		stored_name = sdb_array_get (DB, key, R_ANAL_VAR_SDB_NAME, 0);
-		if (!stored_name) {
-			return 0;
-		}
-		if (!old_name) {
-			old_name = stored_name;
-		} else if (strcmp (stored_name, old_name)) {
-			return 0;
-		}
-		sdb_unset (DB, key, 0);
-		SETKEY ("var.0x%"PFMT64x, addr);
-		sdb_array_set (DB, key, R_ANAL_VAR_SDB_NAME, new_name, 0);
+	RAnalFcnVar *v = r_anal_fcn_var_get_byname (fcn, old_name);
+	if (!v) {
+		return 0;
+	}
+	char *name = strdup (new_name);
+	if (!name) {
+		return 0;
 	}
+	free (v->name);
+	v->name = name;
 	return 1;
 }
 
 // Used for linking reg based arg and local-var like "mov [local_8h], rsi"
-static void r_anal_var_link (RAnal *a, ut64 addr, RAnalVar *var) {
-	const char *inst_key = sdb_fmt ("inst.0x%"PFMT64x ".lvar", addr);
-	const char *var_def = sdb_fmt ("0x%"PFMT64x ",%c,0x%x,0x%x", var->addr,
-			var->kind, var->scope, var->delta);
-	sdb_set (DB, inst_key, var_def, 0);
+static void r_anal_var_link (RAnalFunction *fcn, ut64 addr, RAnalVar *var) {
+	RAnalFcnVar *v = fcn_var_find (fcn, var->kind, var->delta, NULL);
+	RAnalVarUse *use;
+	if (v && (use = var_use_at (fcn, addr, true))) {
+		use->link = v;
+	}
+}
+
+static int var_access(RAnalFunction *fcn, char kind, int delta, int xs_type, ut64 xs_addr) {
+	RAnalFcnVar *v = fcn_var_find (fcn, kind, delta, NULL);
+	RAnalVarUse *use;
+	if (!v || !(use = var_use_at (fcn, xs_addr, true))) {
+		return false;
+	}
+	use->var = v;
+	return addr_vector_add (xs_type? &v->writes: &v->reads, xs_addr);
 }
 
 // avr
 R_API int r_anal_var_access(RAnal *a, ut64 var_addr, char kind, int scope, int delta, int xs_type, ut64 xs_addr) {
-	const char *var_global;
-	const char *xs_type_str = xs_type? "writes": "reads";
-	// TODO: kind is not used
-	if (scope > 0) { // local
-		const char *var_local = sdb_fmt ("var.0x%"PFMT64x ".%d.%d.%s",
-			var_addr, scope, delta, xs_type_str);
-		const char *inst_key = sdb_fmt ("inst.0x%"PFMT64x ".vars", xs_addr);
-		const char *var_def = sdb_fmt ("0x%"PFMT64x ",%c,0x%x,0x%x", var_addr,
-			kind, scope, delta);
-		sdb_set (DB, inst_key, var_def, 0);
-		return sdb_array_add_num (DB, var_local, xs_addr, 0);
-	}
-	// global
-	sdb_add (DB, sdb_fmt ("var.0x%"PFMT64x, var_addr), "a,", 0);
-	var_global = sdb_fmt ("var.0x%"PFMT64x ".%s", var_addr, xs_type_str);
-	return sdb_array_add_num (DB, var_global, xs_addr, 0);
+	RAnalFunction *fcn = var_fcn (a, var_addr);
+	if (!fcn || scope < 1) {
+		return false;
+	}
+	return var_access (fcn, kind, delta, xs_type, xs_addr);
 }
 
 R_API void r_anal_var_access_clear(RAnal *a, ut64 var_addr, int scope, int delta) {
-	char key[128], key2[128];
-	if (scope > 0) { // local arg or var
-		SETKEY ("var.0x%"PFMT64x ".%d.%d.%s", var_addr, scope, delta, "writes");
-		SETKEY2 ("var.0x%"PFMT64x ".%d.%d.%s", var_addr, scope, delta, "reads");
-	} else { // global
-		SETKEY ("var.0x%"PFMT64x ".%s", var_addr, "writes");
-		SETKEY2 ("var.0x%"PFMT64x ".%s", var_addr, "reads");
+	RAnalFunction *fcn = var_fcn (a, var_addr);
+	void **it;
+	if (!fcn || scope < 1) {
+		return;
+	}
+	r_pvector_foreach (&fcn->vars, it) {
+		RAnalFcnVar *v = *it;
+		if (v->delta == delta) {
+			r_vector_clear (&v->reads);
+			r_vector_clear (&v->writes);
+		}
 	}
-	sdb_unset (DB, key, 0);
-	sdb_unset (DB, key2, 0);
 }
 
 R_API int r_anal_fcn_var_del_bydelta(RAnal *a, ut64 fna, const char kind, int scope, ut32 delta) {
-	int idx;
-	char key[128], val[128], *v;
-	SETKEY ("fcn.0x%08"PFMT64x ".%c", fna, kind);
-	v = sdb_itoa (delta, val, 10);
-	idx = sdb_array_indexof (DB, key, v, 0);
-	if (idx != -1) {
-		sdb_array_delete (DB, key, idx, 0);
-		SETKEY ("fcn.0x%08"PFMT64x ".%c.%d", fna, kind, delta);
-		sdb_unset (DB, key, 0);
-	}
-	return false;
+	return r_anal_var_delete (a, fna, kind, scope, (int)delta);
 }
 
 R_API int r_anal_var_count(RAnal *a, RAnalFunction *fcn, int kind, int type) {
 	// type { local: 0, arg: 1 };
-	RList *list = r_anal_var_list (a, fcn, kind);
-	RAnalVar *var;
-	RListIter *iter;
 	int count[2] = {
 		0
 	};
-	r_list_foreach (list, iter, var) {
+	void **it;
+	if (!fcn) {
+		return 0;
+	}
+	r_pvector_foreach (&fcn->vars, it) {
+		RAnalFcnVar *v = *it;
+		if (v->kind != kind) {
+			continue;
+		}
 		if (kind == R_ANAL_VAR_KIND_REG) {
 			count[1]++;
 			continue;
 		}
-		count[var->isarg]++;
+		count[v->isarg]++;
 	}
-	r_list_free (list);
 	return count[type];
 }
 
@@ -573,25 +569,12 @@ static void var_add_structure_fields_to_list(RAnal *a, RAnalVar *av, const char
 static char *get_varname(RAnal *a, RAnalFunction *fcn, char type, const char *pfx, int idx) {
 	char *varname = r_str_newf ("%s_%xh", pfx, idx);
 	int i = 2;
-	char v_kind;
-	int v_delta = 0;
-	while (1) {
-		char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", fcn->addr, 1, varname);
-		char *name_value = sdb_get (a->sdb_fcns, name_key, 0);
-		if (!name_value) {
-			break;
-		}
-		const char *comma = strchr (name_value, ',');
-		if (comma && *comma) {
-			v_delta = r_num_math (NULL, comma + 1);
-			v_kind = *name_value;
-		}
-		if (v_kind == type && R_ABS (v_delta) == idx) {
-			free (name_value);
+	RAnalFcnVar *v;
+	while ((v = r_anal_fcn_var_get_byname (fcn, varname))) {
+		if (v->kind == type && R_ABS (v->delta) == idx) {
 			return varname;
 		}
 		free (varname);
-		free (name_value);
 		varname = r_str_newf ("%s_%xh_%d", pfx, idx, i);
 		i++;
 	}
@@ -654,13 +637,13 @@ static void extract_arg(RAnal *anal, RAnalFunction *fcn, RAnalOp *op, const char
 		const char *pfx = ((ptr < fcn->maxstack) && (type == 's')) ? VARPREFIX : ARGPREFIX;
 		bool isarg = strcmp(pfx , ARGPREFIX) ? false : true;
 		char *varname = get_varname (anal, fcn, type, pfx, R_ABS (ptr));
-		r_anal_var_add (anal, fcn->addr, 1, ptr, type, NULL, anal->bits / 8, isarg, varname);
-		r_anal_var_access (anal, fcn->addr, type, 1, ptr, rw, op->addr);
+		var_add (fcn, ptr, type, NULL, anal->bits / 8, isarg, varname);
+		var_access (fcn, type, ptr, rw, op->addr);
 		free (varname);
 	} else {
 		char *varname = get_varname (anal, fcn, type, VARPREFIX, R_ABS (ptr));
-		r_anal_var_add (anal, fcn->addr, 1, -ptr, type, NULL, anal->bits / 8, 0, varname);
-		r_anal_var_access (anal, fcn->addr, type, 1, -ptr, rw, op->addr);
+		var_add (fcn, -ptr, type, NULL, anal->bits / 8, 0, varname);
+		var_access (fcn, type, -ptr, rw, op->addr);
 		free (varname);
 	}
 beach:
@@ -717,12 +700,11 @@ R_API void extract_rarg(RAnal *anal, RAnalOp *op, RAnalFunction *fcn, int *reg_s
 					name = r_str_newf ("%s%d", "arg", i + 1);
 					vname = name;
 				}
-				r_anal_var_add (anal, fcn->addr, 1, delta, R_ANAL_VAR_KIND_REG, type, anal->bits / 8,
-						1, vname);
+				var_add (fcn, delta, R_ANAL_VAR_KIND_REG, type, anal->bits / 8, 1, vname);
 				if (op->var && op->var->kind != R_ANAL_VAR_KIND_REG) {
-					r_anal_var_link (anal, op->addr, op->var);
+					r_anal_var_link (fcn, op->addr, op->var);
 				}
-				r_anal_var_access (anal, fcn->addr, R_ANAL_VAR_KIND_REG, 1, delta, 0, op->addr);
+				var_access (fcn, R_ANAL_VAR_KIND_REG, delta, 0, op->addr);
 				r_meta_set_string (anal, R_META_TYPE_VARTYPE, op->addr, vname);
 				free (name);
 			}
@@ -753,56 +735,24 @@ static RList *var_generate_list(RAnal *a, RAnalFunction *fcn, int kind, bool dyn
 	if (kind < 1) {
 		kind = R_ANAL_VAR_KIND_BPV; // by default show vars
 	}
-	char *varlist = sdb_get (DB, sdb_fmt ("fcn.0x%"PFMT64x ".%c", fcn->addr, kind), 0);
-	if (varlist && *varlist) {
-		char *next, *ptr = varlist;
-		do {
-			char *word = sdb_anext (ptr, &next);
-			if (r_str_nlen (word, 3) < 3) {
-				return NULL;
-			}
-			const char *vardef = sdb_const_get (DB, sdb_fmt (
-				"var.0x%"PFMT64x ".%c.%s",
-				fcn->addr, kind, word), 0);
-			if (word[2] == '_') {
-				word[2] = '-';
-			}
-			int delta = atoi (word + 2);
-			if (vardef) {
-				struct VarType vt = { 0 };
-				sdb_fmt_init (&vt, SDB_VARTYPE_FMT);
-				sdb_fmt_tobin (vardef, SDB_VARTYPE_FMT, &vt);
-				RAnalVar *av = R_NEW0 (RAnalVar);
-				if (!av) {
-					free (varlist);
-					r_list_free (list);
-					return NULL;
-				}
-				if (!vt.name || !vt.type) {
-					// This should be properly fixed
-					eprintf ("Warning null var in fcn.0x%"PFMT64x ".%c.%s\n",
-						fcn->addr, kind, word);
-					free (av);
-					continue;
-				}
-				av->delta = delta;
-				av->kind = kind;
-				av->name = strdup (vt.name);
-				av->isarg = vt.isarg;
-				av->size = vt.size;
-				av->type = strdup (vt.type);
-				r_list_append (list, av);
-				if (dynamicVars) { // make dynamic variables like structure fields
-					var_add_structure_fields_to_list (a, av, vt.name, delta, list);
-				}
-				sdb_fmt_free (&vt, SDB_VARTYPE_FMT);
-			} else {
-				eprintf ("Cannot find var definition for '%s'\n", word);
-			}
-			ptr = next;
-		} while (next);
+	size_t i;
+	// the vars of a kind are contiguous, starting at its lowest delta
+	fcn_var_find (fcn, kind, ST32_MIN, &i);
+	for (; i < r_pvector_len (&fcn->vars); i++) {
+		RAnalFcnVar *v = r_pvector_at (&fcn->vars, i);
+		if (v->kind != kind) {
+			break;
+		}
+		RAnalVar *av = var_dup (fcn, v, 1);
+		if (!av) {
+			r_list_free (list);
+			return NULL;
+		}
+		r_list_append (list, av);
+		if (dynamicVars) { // make dynamic variables like structure fields
+			var_add_structure_fields_to_list (a, av, v->name, v->delta, list);
+		}
 	}
-	free (varlist);
 	return list;
 }
 
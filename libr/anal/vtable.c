@@ -70,21 +70,37 @@ R_API RList *r_anal_vtable_get_methods(RVTableContext *context, RVTableInfo *tab
 		return NULL;
 	}
 
-	int curMethod = 0;
+	int curMethod;
 	int totalMethods = table->method_count;
-	ut64 startAddress = table->saddr;
-	while (curMethod < totalMethods) {
-		ut64 curAddressValue;
+	int word = context->word_size;
+	// fetch all the slots in a single batch instead of a read per method
+	RIOReadVec *vec = calloc (R_MAX (totalMethods, 1), sizeof (RIOReadVec));
+	ut8 *slots = calloc (R_MAX (totalMethods, 1), word);
+	if (!vec || !slots) {
+		free (vec);
+		free (slots);
+		r_list_free (vtableMethods);
+		return NULL;
+	}
+	for (curMethod = 0; curMethod < totalMethods; curMethod++) {
+		vec[curMethod].addr = table->saddr + curMethod * word;
+		vec[curMethod].buf = slots + curMethod * word;
+		vec[curMethod].len = word;
+	}
+	if (totalMethods > 0) {
+		(void)anal->iob.read_batch (anal->iob.io, vec, totalMethods);
+	}
+	for (curMethod = 0; curMethod < totalMethods; curMethod++) {
 		RVTableMethodInfo *methodInfo;
-		if (context->read_addr (context->anal, startAddress, &curAddressValue)
+		if (vec[curMethod].ret == word
 			&& (methodInfo = (RVTableMethodInfo *)malloc (sizeof (RVTableMethodInfo)))) {
-			methodInfo->addr = curAddressValue;
-			methodInfo->vtable_offset = startAddress - table->saddr;
+			methodInfo->addr = r_read_ble (vec[curMethod].buf, anal->big_endian, word * 8);
+			methodInfo->vtable_offset = vec[curMethod].addr - table->saddr;
 			r_list_append (vtableMethods, methodInfo);
 		}
-		startAddress += context->word_size;
-		curMethod++;
 	}
+	free (vec);
+	free (slots);
 
 	table->methods = vtableMethods;
 	return vtableMethods;
@@ -127,27 +143,46 @@ static int vtable_is_addr_vtable_start(RVTableContext *context, ut64 curAddress)
 	// total xref's to curAddress
 	RList *xrefs = r_anal_xrefs_get (context->anal, curAddress);
 	if (r_list_empty (xrefs)) {
+		r_list_free (xrefs);
+		return false;
+	}
+	// read the code at every xref from .text in one batch
+	int n = 0, count = r_list_length (xrefs);
+	RIOReadVec *vec = calloc (count, sizeof (RIOReadVec));
+	ut8 *bufs = calloc (count, VTABLE_BUFF_SIZE);
+	if (!vec || !bufs) {
+		free (vec);
+		free (bufs);
+		r_list_free (xrefs);
 		return false;
 	}
 	r_list_foreach (xrefs, xrefIter, xref) {
 		// section in which currenct xref lies
 		if (vtable_addr_in_text_section (context, xref->addr)) {
-			ut8 buf[VTABLE_BUFF_SIZE];
-			context->anal->iob.read_at (context->anal->iob.io, xref->addr, buf, sizeof(buf));
-
-			RAnalOp analop = { 0 };
-			r_anal_op (context->anal, &analop, xref->addr, buf, sizeof(buf), R_ANAL_OP_MASK_BASIC);
-
-			if (analop.type == R_ANAL_OP_TYPE_MOV
-				|| analop.type == R_ANAL_OP_TYPE_LEA) {
-				return true;
-			}
-
-			r_anal_op_fini (&analop);
+			vec[n].addr = xref->addr;
+			vec[n].buf = bufs + n * VTABLE_BUFF_SIZE;
+			vec[n].len = VTABLE_BUFF_SIZE;
+			n++;
 		}
 	}
 	r_list_free (xrefs);
-	return false;
+	if (n > 0) {
+		(void)context->anal->iob.read_batch (context->anal->iob.io, vec, n);
+	}
+	bool ret = false;
+	int i;
+	for (i = 0; i < n && !ret; i++) {
+		RAnalOp analop = { 0 };
+		r_anal_op (context->anal, &analop, vec[i].addr, vec[i].buf, VTABLE_BUFF_SIZE, R_ANAL_OP_MASK_BASIC);
+		if (analop.type == R_ANAL_OP_TYPE_MOV
+			|| analop.type == R_ANAL_OP_TYPE_LEA) {
+			ret = true;
+		}
+		r_anal_op_fini (&analop);
+	}
+	free (vec);
+	free (bufs);
+	return ret;
 }
 
 R_API RList *r_anal_vtable_search(RVTableContext *context) {
@@ -24,12 +24,186 @@ xrefs
 // XXX: is it possible to have multiple type for the same (from, to) pair?
 //      if it is, things need to be adjusted
 
-#define u64_to_key(x) (sdb_fmt ("%"PFMT64x, (x)))
+// Both directions live in a RAnalRefTable: an open addressing hash of
+// addresses to the sorted edges leaving them. Nothing is formatted nor
+// duplicated per lookup, and a node costs 24 bytes plus its edges.
+
+#define REF_TABLE_MIN 64
+#define REF_EDGES_MIN 2
+
+static inline ut32 ref_hash(ut64 k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	return (ut32)k;
+}
+
+static RAnalRefTable *ref_table_new(void) {
+	return R_NEW0 (RAnalRefTable);
+}
+
+static void ref_table_free(RAnalRefTable *t) {
+	ut32 i;
+	if (!t) {
+		return;
+	}
+	for (i = 0; i < t->size; i++) {
+		free (t->nodes[i].edges);
+	}
+	free (t->nodes);
+	free (t);
+}
 
-#define ht_find_u64(_ht,_key,_found) (ht_find ((_ht), u64_to_key (_key), (_found)))
-#define ht_insert_u64(_ht,_key,_value) (ht_insert ((_ht), u64_to_key (_key), _value))
-#define ht_update_u64(_ht,_key,_value) (ht_update ((_ht), u64_to_key (_key), _value))
-#define ht_delete_u64(_ht,_key) (ht_delete ((_ht), u64_to_key (_key)))
+static RAnalRefNode *ref_table_find(RAnalRefTable *t, ut64 key) {
+	if (!t || !t->size) {
+		return NULL;
+	}
+	ut32 mask = t->size - 1;
+	ut32 i = ref_hash (key) & mask;
+	while (t->nodes[i].edges) {
+		if (t->nodes[i].key == key) {
+			return &t->nodes[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+// makes room for n more keys keeping the load under one half
+static bool ref_table_reserve(RAnalRefTable *t, ut32 n) {
+	ut64 need = ((ut64)t->count + n) * 2;
+	ut32 i, size = t->size? t->size: REF_TABLE_MIN;
+	if (need <= t->size) {
+		return true;
+	}
+	while (size < need) {
+		if (size >= (1U << 31)) {
+			return false;
+		}
+		size <<= 1;
+	}
+	RAnalRefNode *nodes = calloc (size, sizeof (RAnalRefNode));
+	if (!nodes) {
+		return false;
+	}
+	for (i = 0; i < t->size; i++) {
+		RAnalRefNode *n = &t->nodes[i];
+		if (n->edges) {
+			ut32 j = ref_hash (n->key) & (size - 1);
+			while (nodes[j].edges) {
+				j = (j + 1) & (size - 1);
+			}
+			nodes[j] = *n;
+		}
+	}
+	free (t->nodes);
+	t->nodes = nodes;
+	t->size = size;
+	return true;
+}
+
+static RAnalRefNode *ref_table_get(RAnalRefTable *t, ut64 key) {
+	RAnalRefNode *n = ref_table_find (t, key);
+	if (n) {
+		return n;
+	}
+	if (!ref_table_reserve (t, 1)) {
+		return NULL;
+	}
+	ut32 mask = t->size - 1;
+	ut32 i = ref_hash (key) & mask;
+	while (t->nodes[i].edges) {
+		i = (i + 1) & mask;
+	}
+	n = &t->nodes[i];
+	if (!(n->edges = malloc (REF_EDGES_MIN * sizeof (RAnalRefEdge)))) {
+		return NULL;
+	}
+	n->key = key;
+	n->count = 0;
+	n->size = REF_EDGES_MIN;
+	t->count++;
+	return n;
+}
+
+// frees the slot and shifts back the entries of its probe sequence, so
+// lookups never need tombstones
+static void ref_table_remove(RAnalRefTable *t, RAnalRefNode *n) {
+	ut32 mask = t->size - 1;
+	ut32 i = (ut32)(n - t->nodes), j = i;
+	free (n->edges);
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!t->nodes[j].edges) {
+			break;
+		}
+		ut32 k = ref_hash (t->nodes[j].key) & mask;
+		if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+			t->nodes[i] = t->nodes[j];
+			i = j;
+		}
+	}
+	memset (&t->nodes[i], 0, sizeof (RAnalRefNode));
+	t->count--;
+}
+
+// index of the first edge going to addr or above
+static ut32 ref_edge_lower(RAnalRefNode *n, ut64 addr) {
+	ut32 lo = 0, hi = n->count;
+	while (lo < hi) {
+		ut32 mid = lo + (hi - lo) / 2;
+		if (n->edges[mid].addr < addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static bool ref_edge_set(RAnalRefTable *t, ut64 key, ut64 addr, int type) {
+	RAnalRefNode *n = ref_table_get (t, key);
+	if (!n) {
+		return false;
+	}
+	ut32 i = ref_edge_lower (n, addr);
+	if (i < n->count && n->edges[i].addr == addr) {
+		n->edges[i].type = type;
+		return true;
+	}
+	if (n->count == n->size) {
+		RAnalRefEdge *edges = realloc (n->edges, n->size * 2 * sizeof (RAnalRefEdge));
+		if (!edges) {
+			return false;
+		}
+		n->edges = edges;
+		n->size *= 2;
+	}
+	memmove (n->edges + i + 1, n->edges + i, (n->count - i) * sizeof (RAnalRefEdge));
+	n->edges[i].addr = addr;
+	n->edges[i].type = type;
+	n->count++;
+	t->edges++;
+	return true;
+}
+
+static bool ref_edge_del(RAnalRefTable *t, ut64 key, ut64 addr) {
+	RAnalRefNode *n = ref_table_find (t, key);
+	if (!n) {
+		return false;
+	}
+	ut32 i = ref_edge_lower (n, addr);
+	if (i == n->count || n->edges[i].addr != addr) {
+		return false;
+	}
+	n->count--;
+	memmove (n->edges + i, n->edges + i + 1, (n->count - i) * sizeof (RAnalRefEdge));
+	t->edges--;
+	if (!n->count) {
+		ref_table_remove (t, n);
+	}
+	return true;
+}
 
 R_API RAnalRef *r_anal_ref_new() {
 	RAnalRef *ref = R_NEW0 (RAnalRef);
@@ -48,33 +222,19 @@ R_API RList *r_anal_ref_list_new() {
 R_API void r_anal_ref_free(void *ref) {
 	free (ref);
 }
-void xrefs_ht_free(HtKv *kv) {
-	free (kv->key);
-	ht_free (kv->value);
-	free (kv);
-}
-
-void xrefs_ref_free(HtKv *kv) {
-	free (kv->key);
-	r_anal_ref_free (kv->value);
-	free (kv);
-}
 
-static bool appendRef(RList *list, const char *k, RAnalRef *ref) {
-	RAnalRef *cloned = r_anal_ref_new ();
-	if (!cloned) {
-		return false;
+static void appendRefs(RList *list, RAnalRefNode *n) {
+	ut32 i;
+	for (i = 0; i < n->count; i++) {
+		RAnalRef *ref = r_anal_ref_new ();
+		if (!ref) {
+			return;
+		}
+		ref->at = n->key;
+		ref->addr = n->edges[i].addr;
+		ref->type = n->edges[i].type;
+		r_list_append (list, ref);
 	}
-	cloned->addr = ref->addr;
-	cloned->at = ref->at;
-	cloned->type = ref->type;
-	r_list_append (list, cloned);
-	return true;
-}
-
-static bool mylistrefs_cb(RList *list, const char *k, SdbHash *ht) {
-	ht_foreach (ht, (HtForeachCallback)appendRef, list);
-	return true;
 }
 
 static int ref_cmp(const RAnalRef *a, const RAnalRef *b) {
@@ -93,65 +253,110 @@ static int ref_cmp(const RAnalRef *a, const RAnalRef *b) {
 	return 0;
 }
 
-static void listxrefs(SdbHash *m, ut64 addr, RList *list) {
+// the refs of one address come out sorted, all of them need a sort
+static void listxrefs(RAnalRefTable *t, ut64 addr, RList *list) {
 	if (addr == UT64_MAX) {
-		ht_foreach (m, (HtForeachCallback)mylistrefs_cb, list);
+		ut32 i;
+		for (i = 0; t && i < t->size; i++) {
+			if (t->nodes[i].edges) {
+				appendRefs (list, &t->nodes[i]);
+			}
+		}
+		r_list_sort (list, (RListComparator)ref_cmp);
 	} else {
-		bool found;
-		SdbHash *d = ht_find_u64 (m, addr, &found);
-		if (!found) {
-			return;
+		RAnalRefNode *n = ref_table_find (t, addr);
+		if (n) {
+			appendRefs (list, n);
 		}
-
-		ht_foreach (d, (HtForeachCallback)appendRef, list);
 	}
-	r_list_sort (list, (RListComparator)ref_cmp);
 }
 
-static void setxref(SdbHash *m, ut64 from, ut64 to, int type) {
-	bool found;
-	SdbHash *ht = ht_find_u64 (m, from, &found);
-
-	if (!found) {
-		ht = ht_new (NULL, xrefs_ref_free, NULL);
-		if (!ht) {
-			return;
-		}
-
-		ht_insert_u64 (m, from, ht);
-	}
-
-	RAnalRef *ref = r_anal_ref_new ();
-	ref->at = from;
-	ref->addr = to;
-	ref->type = type;
-
-	ht_update_u64 (ht, to, ref);
+static bool xrefs_valid(RAnal *anal, ut64 from, ut64 to) {
+	return anal->iob.is_valid_offset (anal->iob.io, from, 0)
+		&& anal->iob.is_valid_offset (anal->iob.io, to, 0);
 }
 
 // set a reference from FROM to TO and a cross-reference(xref) from TO to FROM.
 R_API int r_anal_xrefs_set(RAnal *anal, ut64 from, ut64 to, const RAnalRefType type) {
-	if (!anal) {
+	if (!anal || !xrefs_valid (anal, from, to)) {
 		return false;
 	}
-	if (!anal->iob.is_valid_offset (anal->iob.io, from, 0)) {
-		return false;
+	ref_edge_set (anal->dict_xrefs, to, from, type);
+	ref_edge_set (anal->dict_refs, from, to, type);
+	return true;
+}
+
+// sets count refs going from ref->at to ref->addr, growing the tables once,
+// returns how many were valid
+R_API int r_anal_xrefs_set_bulk(RAnal *anal, const RAnalRef *refs, int count) {
+	int i, n = 0;
+	if (!anal || !refs || count < 1) {
+		return 0;
 	}
-	if (!anal->iob.is_valid_offset (anal->iob.io, to, 0)) {
-		return false;
+	(void)ref_table_reserve (anal->dict_refs, count);
+	(void)ref_table_reserve (anal->dict_xrefs, count);
+	for (i = 0; i < count; i++) {
+		const RAnalRef *ref = &refs[i];
+		if (xrefs_valid (anal, ref->at, ref->addr)) {
+			ref_edge_set (anal->dict_xrefs, ref->addr, ref->at, ref->type);
+			ref_edge_set (anal->dict_refs, ref->at, ref->addr, ref->type);
+			n++;
+		}
 	}
-	setxref (anal->dict_xrefs, to, from, type);
-	setxref (anal->dict_refs, from, to, type);
-	return true;
+	return n;
 }
 
 R_API int r_anal_xrefs_deln(RAnal *anal, ut64 from, ut64 to, const RAnalRefType type) {
 	if (!anal) {
 		return false;
 	}
-	ht_delete_u64 (anal->dict_refs, from);
-	ht_delete_u64 (anal->dict_xrefs, to);
-	return true;
+	bool res = ref_edge_del (anal->dict_refs, from, to);
+	res |= ref_edge_del (anal->dict_xrefs, to, from);
+	return res;
+}
+
+// removes the refs going out of [from, to) and their xrefs, returns how
+// many were removed
+R_API int r_anal_xrefs_del_range(RAnal *anal, ut64 from, ut64 to) {
+	RAnalRefTable *t = anal? anal->dict_refs: NULL;
+	ut64 *keys, nkeys = 0, addr;
+	ut32 i;
+	int n = 0;
+	if (!t || from >= to || !t->count) {
+		return 0;
+	}
+	if (to - from <= t->count) {
+		// small ranges are cheaper to probe than to scan
+		if (!(keys = malloc ((to - from) * sizeof (ut64)))) {
+			return 0;
+		}
+		for (addr = from; addr < to; addr++) {
+			if (ref_table_find (t, addr)) {
+				keys[nkeys++] = addr;
+			}
+		}
+	} else {
+		if (!(keys = malloc ((ut64)t->count * sizeof (ut64)))) {
+			return 0;
+		}
+		for (i = 0; i < t->size; i++) {
+			RAnalRefNode *node = &t->nodes[i];
+			if (node->edges && node->key >= from && node->key < to) {
+				keys[nkeys++] = node->key;
+			}
+		}
+	}
+	while (nkeys--) {
+		RAnalRefNode *node = ref_table_find (t, keys[nkeys]);
+		for (i = 0; i < node->count; i++) {
+			ref_edge_del (anal->dict_xrefs, node->edges[i].addr, node->key);
+		}
+		n += node->count;
+		t->edges -= node->count;
+		ref_table_remove (t, node);
+	}
+	free (keys);
+	return n;
 }
 
 R_API int r_anal_xref_del(RAnal *anal, ut64 from, ut64 to) {
@@ -294,34 +499,28 @@ R_API RAnalRefType r_anal_xrefs_type(char ch) {
 }
 
 R_API bool r_anal_xrefs_init(RAnal *anal) {
-	SdbHash *tmp;
-
-	ht_free (anal->dict_refs);
-	anal->dict_refs = NULL;
-	ht_free (anal->dict_xrefs);
-	anal->dict_xrefs = NULL;
-
-	tmp = ht_new (NULL, xrefs_ht_free, NULL);
-	if (!tmp) {
-		return false;
-	}
-	anal->dict_refs = tmp;
-
-	tmp = ht_new (NULL, xrefs_ht_free, NULL);
-	if (!tmp) {
-		ht_free (anal->dict_refs);
-		anal->dict_refs = NULL;
+	r_anal_xrefs_fini (anal);
+	anal->dict_refs = ref_table_new ();
+	anal->dict_xrefs = ref_table_new ();
+	if (!anal->dict_refs || !anal->dict_xrefs) {
+		r_anal_xrefs_fini (anal);
 		return false;
 	}
-	anal->dict_xrefs = tmp;
 	return true;
 }
 
+R_API void r_anal_xrefs_fini(RAnal *anal) {
+	ref_table_free (anal->dict_refs);
+	anal->dict_refs = NULL;
+	ref_table_free (anal->dict_xrefs);
+	anal->dict_xrefs = NULL;
+}
+
 R_API int r_anal_xrefs_count(RAnal *anal) {
-	return anal->dict_xrefs->count;
+	return anal->dict_xrefs? (int)anal->dict_xrefs->edges: 0;
 }
 
-static RList *fcn_get_refs(RAnalFunction *fcn, SdbHash *ht) {
+static RList *fcn_get_refs(RAnalFunction *fcn, RAnalRefTable *ht) {
 	RListIter *iter;
 	RAnalBlock *bb;
 	RList *list = r_anal_ref_list_new ();
@@ -337,6 +536,7 @@ static RList *fcn_get_refs(RAnalFunction *fcn, SdbHash *ht) {
 			listxrefs (ht, at, list);
 		}
 	}
+	r_list_sort (list, (RListComparator)ref_cmp);
 	return list;
 }
 
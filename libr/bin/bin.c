@@ -439,15 +439,22 @@ R_API bool r_bin_load_io2(RBin *bin, int fd, ut64 baseaddr, ut64 loadaddr, int x
 			return false;
 		}
 		const int asz = sz? sz: 1;
-		buf_bytes = calloc (1, asz);
+		ut64 seekaddr = is_debugger? baseaddr: loadaddr;
+		ut64 vsz = asz;
+		// the plugins keep and may patch their buffer, so copy the view
+		// once instead of zeroing a buffer and reading through io
+		const ut8 *view = iob->fd_view? iob->fd_view (io, fd, seekaddr, &vsz): NULL;
+		if (view && vsz == asz) {
+			buf_bytes = r_mem_dup ((void *)view, asz);
+		} else if ((buf_bytes = calloc (1, asz))) {
+			if (!iob->fd_read_at (io, fd, seekaddr, buf_bytes, asz)) {
+				sz = 0LL;
+			}
+		}
 		if (!buf_bytes) {
 			eprintf ("Cannot allocate %d bytes.\n", asz);
 			return false;
 		}
-		ut64 seekaddr = is_debugger? baseaddr: loadaddr;
-		if (!iob->fd_read_at (io, fd, seekaddr, buf_bytes, asz)) {
-			sz = 0LL;
-		}
 	}
 	if (bin->use_xtr && !name && (st64)sz > 0) {
 		// XXX - for the time being this is fine, but we may want to
@@ -37,20 +37,62 @@ static void r_anal_emul_restore(RCore *core, RConfigHold *hc) {
 	r_config_hold_free (hc);
 }
 
-#define SDB_CONTAINS(i,s) sdb_array_contains (trace, sdb_fmt ("%d.reg.write", i), s, 0)
+#define TRACE_WRITES(i,s) r_anal_esil_trace_reg (anal->esil, i, R_ANAL_ESIL_TRACE_REG_WRITE, s, NULL)
 
-static bool type_pos_hit(RAnal *anal, Sdb *trace, bool in_stack, int idx, int size, const char *place) {
+static bool type_pos_hit(RAnal *anal, bool in_stack, int idx, int size, const char *place) {
 	if (in_stack) {
 		const char *sp_name = r_reg_get_name (anal->reg, R_REG_NAME_SP);
 		ut64 sp = r_reg_getv (anal->reg, sp_name);
-		ut64 write_addr = sdb_num_get (trace, sdb_fmt ("%d.mem.write", idx), 0);
+		ut64 write_addr = 0;
+		r_anal_esil_trace_mem (anal->esil, idx, R_ANAL_ESIL_TRACE_MEM_WRITE, &write_addr);
 		return (write_addr == sp + size);
 	} else {
-		return SDB_CONTAINS (idx, place);
+		return TRACE_WRITES (idx, place);
 	}
 }
 
-static void var_rename(RAnal *anal, RAnalVar *v, const char *name, ut64 addr) {
+typedef struct {
+	RAnalEsil *esil;
+	char *buf;
+	int len;
+	int nregs;
+	ut16 regs[32];
+} TraceRegs;
+
+static bool trace_regs_cb(void *user, RAnalEsilTraceEvent *ev) {
+	TraceRegs *tr = user;
+	int i;
+	if (ev->kind != R_ANAL_ESIL_TRACE_REG_WRITE) {
+		return true;
+	}
+	// once each, in the order they were written
+	for (i = 0; i < tr->nregs; i++) {
+		if (tr->regs[i] == ev->reg) {
+			return true;
+		}
+	}
+	const char *name = r_anal_esil_trace_reg_name (tr->esil, ev->reg);
+	int len = strlen (tr->buf);
+	if (tr->nregs >= R_ARRAY_SIZE (tr->regs) || len + strlen (name) + 2 > tr->len) {
+		return false;
+	}
+	tr->regs[tr->nregs++] = ev->reg;
+	snprintf (tr->buf + len, tr->len - len, "%s%s", len? ",": "", name);
+	return true;
+}
+
+// comma separated names of the registers written at idx, NULL if none
+static const char *trace_reg_writes(RAnal *anal, int idx, char *buf, int len) {
+	TraceRegs tr = { anal->esil, buf, len, 0 };
+	*buf = 0;
+	r_anal_esil_trace_foreach (anal->esil, idx, trace_regs_cb, &tr);
+	return *buf? buf: NULL;
+}
+
+// a worker of r_core_anal_type_match_parallel also logs the changes
+// it makes to the variables for type_match_replay
+
+static void var_rename(RAnal *anal, RAnalVar *v, const char *name, ut64 addr, RStrBuf *log) {
 	if (!name || !v) {
 		return;
 	}
@@ -70,10 +112,13 @@ static void var_rename(RAnal *anal, RAnalVar *v, const char *name, ut64 addr) {
 	if (!fcn) {
 		return;
 	}
+	if (log) {
+		r_strbuf_appendf (log, "n 0x%"PFMT64x" %c %s %s\n", fcn->addr, v->kind, v->name, name);
+	}
 	r_anal_var_rename (anal, fcn->addr, 1, v->kind, v->name, name, false);
 }
 
-static void var_retype(RAnal *anal, RAnalVar *var, const char *vname, char *type, ut64 addr, bool ref, bool pfx) {
+static void var_retype(RAnal *anal, RAnalVar *var, const char *vname, char *type, ut64 addr, bool ref, bool pfx, RStrBuf *log) {
 	if (!type || !var) {
 		return;
 	}
@@ -117,9 +162,67 @@ static void var_retype(RAnal *anal, RAnalVar *var, const char *vname, char *type
 		// char * => char **
 		strncat (ntype, "*", len);
 	}
+	if (log) {
+		r_strbuf_appendf (log, "t 0x%"PFMT64x" %d %c %d %d %s %s\n", addr, var->delta,
+			var->kind, var->size, var->isarg, var->name, ntype);
+	}
 	r_anal_var_retype (anal, addr, 1, var->delta, var->kind, ntype, var->size, var->isarg, var->name);
 }
 
+// sets the type of an argument of the function called, see key in type_match
+static void fcn_arg_set(RAnal *anal, const char *key, const char *type, RStrBuf *log) {
+	if (log) {
+		r_strbuf_appendf (log, "a %s %s\n", key, type);
+	}
+	sdb_set (anal->sdb_fcns, key, type, 0);
+}
+
+static void vartype_set(RAnal *anal, ut64 addr, const char *str, RStrBuf *log) {
+	if (log) {
+		r_strbuf_appendf (log, "v 0x%"PFMT64x" %s\n", addr, str);
+	}
+	r_meta_set_string (anal, R_META_TYPE_VARTYPE, addr, str);
+}
+
+// the functions emulated to the end go in done
+static void type_match_replay(RAnal *anal, char *log, RVector *done) {
+	char *p, *nl, kind, name[256], type[256];
+	int delta, size, isarg, n;
+	ut64 addr;
+	for (p = log; p && *p; p = nl) {
+		if ((nl = strchr (p, '\n'))) {
+			*nl++ = 0;
+		}
+		switch (*p) {
+		case 't':
+			if (sscanf (p + 1, " 0x%"PFMT64x" %d %c %d %d %255s %n", &addr, &delta, &kind, &size, &isarg, name, &n) == 6) {
+				r_anal_var_retype (anal, addr, 1, delta, kind, p + 1 + n, size, isarg, name);
+			}
+			break;
+		case 'n':
+			if (sscanf (p + 1, " 0x%"PFMT64x" %c %255s %255s", &addr, &kind, name, type) == 4) {
+				r_anal_var_rename (anal, addr, 1, kind, name, type, false);
+			}
+			break;
+		case 'a':
+			if (sscanf (p + 1, " %255s %n", name, &n) == 1) {
+				sdb_set (anal->sdb_fcns, name, p + 1 + n, 0);
+			}
+			break;
+		case 'v':
+			if (sscanf (p + 1, " 0x%"PFMT64x" %n", &addr, &n) == 1) {
+				r_meta_set_string (anal, R_META_TYPE_VARTYPE, addr, p + 1 + n);
+			}
+			break;
+		case 'd':
+			if (sscanf (p + 1, " 0x%"PFMT64x, &addr) == 1) {
+				r_vector_push (done, &addr);
+			}
+			break;
+		}
+	}
+}
+
 static void get_src_regname(RCore *core, ut64 addr, char *regname, int size) {
 	RAnal *anal = core->anal;
 	RAnalOp *op = r_core_anal_op (core, addr, R_ANAL_OP_MASK_ESIL);
@@ -147,12 +250,15 @@ static void get_src_regname(RCore *core, ut64 addr, char *regname, int size) {
 	r_anal_op_free (op);
 }
 
-static ut64 get_addr(Sdb *trace, const char *regname, int idx) {
+static ut64 get_addr(RAnal *anal, const char *regname, int idx) {
+	ut64 val;
 	if (!regname || !*regname) {
 		return UT64_MAX;
 	}
-	const char *query = sdb_fmt ("%d.reg.read.%s", idx, regname);
-	return r_num_math (NULL, sdb_const_get (trace, query, 0));
+	if (!r_anal_esil_trace_reg (anal->esil, idx, R_ANAL_ESIL_TRACE_REG_READ, regname, &val)) {
+		return 0;
+	}
+	return val;
 }
 
 static RList *parse_format(RCore *core, char *fmt) {
@@ -184,12 +290,11 @@ static RList *parse_format(RCore *core, char *fmt) {
 #define REG_SZ 10
 
 static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const char* cc,
-		int prev_idx, bool userfnc, ut64 caddr) {
-	Sdb *trace = core->anal->esil->db_trace;
+		int prev_idx, bool userfnc, ut64 caddr, RStrBuf *log) {
 	Sdb *TDB = core->anal->sdb_types;
 	RAnal *anal = core->anal;
 	RList *types = NULL;
-	int idx = sdb_num_get (trace, "idx", 0);
+	int idx = anal->esil->trace_idx - 1;
 	bool verbose = r_config_get_i (core->config, "anal.types.verbose");
 	bool stack_rev = false, in_stack = false, format = false;
 
@@ -243,8 +348,8 @@ static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const
 		bool res = false;
 		// Backtrace instruction from source sink to prev source sink
 		for (j = idx; j >= prev_idx; j--) {
-			ut64 instr_addr = sdb_num_get (trace, sdb_fmt ("%d.addr", j), 0);
-			if (instr_addr < baddr) {
+			ut64 instr_addr = r_anal_esil_trace_addr (anal->esil, j);
+			if (instr_addr == UT64_MAX || instr_addr < baddr) {
 				break;
 			}
 			RAnalOp *op = r_core_anal_op (core, instr_addr, R_ANAL_OP_MASK_BASIC);
@@ -266,15 +371,14 @@ static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const
 			} else {
 				key = sdb_fmt ("fcn.0x%08"PFMT64x".arg.%d", caddr, size);
 			}
-			const char *query = sdb_fmt ("%d.mem.read", j);
-			if (op->type == R_ANAL_OP_TYPE_MOV && sdb_const_get (trace, query, 0)) {
+			if (op->type == R_ANAL_OP_TYPE_MOV && r_anal_esil_trace_mem (anal->esil, j, R_ANAL_ESIL_TRACE_MEM_READ, NULL)) {
 				memref = (!memref && var && (var->kind != R_ANAL_VAR_KIND_REG))? false: true;
 			}
 			// Match type from function param to instr
-			if (type_pos_hit (anal, trace, in_stack, j, size, place)) {
+			if (type_pos_hit (anal, in_stack, j, size, place)) {
 				if (!cmt_set && type && name) {
-					r_meta_set_string (anal, R_META_TYPE_VARTYPE, instr_addr,
-							sdb_fmt ("%s%s%s", type, r_str_endswith (type, "*") ? "" : " ", name));
+					vartype_set (anal, instr_addr,
+							sdb_fmt ("%s%s%s", type, r_str_endswith (type, "*") ? "" : " ", name), log);
 					cmt_set = true;
 					if ((op->ptr && op->ptr != UT64_MAX) && !strcmp (name, "format")) {
 						RFlagItem *f = r_flag_get_i (core->flags, op->ptr);
@@ -287,26 +391,26 @@ static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const
 				}
 				if (var) {
 					if (!userfnc) {
-						var_retype (anal, var, name, type, addr, memref, false);
-						var_rename (anal, var, name, addr);
+						var_retype (anal, var, name, type, addr, memref, false, log);
+						var_rename (anal, var, name, addr, log);
 					} else {
 						// Set callee argument info
-						sdb_set (anal->sdb_fcns, key, var->type, 0);
+						fcn_arg_set (anal, key, var->type, log);
 					}
 					res = true;
 				} else {
 					get_src_regname (core, instr_addr, regname, sizeof (regname));
-					xaddr = get_addr (trace, regname, j);
+					xaddr = get_addr (anal, regname, j);
 				}
 			}
 			// Type propagate by following source reg
-			if (!res && *regname && SDB_CONTAINS (j, regname)) {
+			if (!res && *regname && TRACE_WRITES (j, regname)) {
 				if (var) {
 					if (!userfnc) {
-						var_retype (anal, var, name, type, addr, memref, false);
-						var_rename (anal, var, name, addr);
+						var_retype (anal, var, name, type, addr, memref, false, log);
+						var_rename (anal, var, name, addr, log);
 					} else {
-						sdb_set (anal->sdb_fcns, key, var->type, 0);
+						fcn_arg_set (anal, key, var->type, log);
 					}
 					res = true;
 				} else {
@@ -325,9 +429,9 @@ static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const
 			} else if (var && res && xaddr && (xaddr != UT64_MAX)) { // Type progation using value
 				char tmp[REG_SZ] = {0};
 				get_src_regname (core, instr_addr, tmp, sizeof (tmp));
-				ut64 ptr = get_addr (trace, tmp, j);
+				ut64 ptr = get_addr (anal, tmp, j);
 				if (ptr == xaddr) {
-					var_retype (anal, var, name, type, addr, memref, false);
+					var_retype (anal, var, name, type, addr, memref, false, log);
 				}
 			}
 			r_anal_op_free (op);
@@ -340,19 +444,22 @@ static void type_match(RCore *core, ut64 addr, char *fcn_name, ut64 baddr, const
 	r_cons_break_pop ();
 }
 
-R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
+// emulates fcn to match the types of the calls and the instructions in it,
+// false when it couldn't get to the end
+static bool type_match_fcn(RCore *core, RAnalFunction *fcn, RStrBuf *log) {
 	RAnalBlock *bb;
 	RListIter *it;
 	RAnalOp aop = {0};
 	RAnal *anal = core->anal;
 	Sdb *TDB = anal->sdb_types;
 	bool resolved = false;
+	bool done = true;
 
 	if (!core|| !fcn) {
-		return;
+		return false;
 	}
 	if (!core->anal->esil) {
-		return;
+		return false;
 	}
 	int ret, bsize = R_MAX (64, core->blocksize);
 	const int mininstrsz = r_anal_archinfo (anal, R_ANAL_ARCHINFO_MIN_OP_SIZE);
@@ -360,17 +467,17 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 	int cur_idx , prev_idx = anal->esil->trace_idx;
 	RConfigHold *hc = r_config_hold_new (core->config);
 	if (!hc) {
-		return;
+		return false;
 	}
 	if (!r_anal_emul_init (core, hc) || !fcn) {
 		r_anal_emul_restore (core, hc);
-		return;
+		return false;
 	}
 	ut8 *buf = malloc (bsize);
 	if (!buf) {
 		free (buf);
 		r_anal_emul_restore (core, hc);
-		return;
+		return false;
 	}
 	char *fcn_name = NULL;
 	char *ret_type = NULL;
@@ -378,10 +485,12 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 	bool prop = false;
 	bool prev_var = false;
 	char prev_type[256] = {0};
+	char prev_buf[256], cur_buf[256], ret_buf[256];
 	const char *prev_dest = NULL;
 	const char *ret_reg = NULL;
 	const char *pc = r_reg_get_name (core->dbg->reg, R_REG_NAME_PC);
 	RRegItem *r = r_reg_get (core->dbg->reg, pc, -1);
+	Sdb *counts = sdb_new0 ();
 	r_cons_break_push (NULL, NULL);
 	r_list_foreach (fcn->bbs, it, bb) {
 		ut64 addr = bb->addr;
@@ -389,6 +498,7 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 		r_reg_set_value (core->dbg->reg, r, addr);
 		while (1) {
 			if (r_cons_is_breaked ()) {
+				done = false;
 				goto out_function;
 			}
 			if (i >= (bsize - 32)) {
@@ -408,20 +518,19 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 				r_anal_op_fini (&aop);
 				continue;
 			}
-			int loop_count = sdb_num_get (anal->esil->db_trace, sdb_fmt ("0x%"PFMT64x".count", addr), 0);
+			int loop_count = sdb_num_get (counts, sdb_fmt ("0x%"PFMT64x, addr), 0);
 			if (loop_count > LOOP_MAX || aop.type == R_ANAL_OP_TYPE_RET) {
 				r_anal_op_fini (&aop);
 				break;
 			}
-			sdb_num_set (anal->esil->db_trace, sdb_fmt ("0x%"PFMT64x".count", addr), loop_count + 1, 0);
+			sdb_num_set (counts, sdb_fmt ("0x%"PFMT64x, addr), loop_count + 1, 0);
 			if (r_anal_op_nonlinear (aop.type)) {   // skip the instr
 				r_reg_set_value (core->dbg->reg, r, addr + ret);
 			} else {
 				r_core_esil_step (core, UT64_MAX, NULL, NULL);
 			}
 			bool userfnc = false;
-			Sdb *trace = anal->esil->db_trace;
-			cur_idx = sdb_num_get (trace, "idx", 0);
+			cur_idx = anal->esil->trace_idx - 1;
 			RAnalVar *var = aop.var;
 			RAnalOp *next_op = r_core_anal_op (core, addr + ret, R_ANAL_OP_MASK_BASIC);
 			ut32 type = aop.type & R_ANAL_OP_TYPE_MASK;
@@ -440,20 +549,19 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 					const char* cc = r_anal_cc_func (anal, fcn_name);
 					if (cc && r_anal_cc_exist (anal, cc)) {
 						type_match (core, addr, fcn_name, bb->addr, cc, prev_idx,
-								userfnc, fcn_call->addr);
+								userfnc, fcn_call->addr, log);
 						prev_idx = cur_idx;
 						ret_type = (char *) r_type_func_ret (TDB, fcn_name);
 						ret_reg = r_anal_cc_ret (anal, cc);
 						resolved = false;
 					}
 					if (!strcmp (fcn_name, "__stack_chk_fail")) {
-						const char *query = sdb_fmt ("%d.addr", cur_idx - 1);
-						ut64 mov_addr = sdb_num_get (trace, query, 0);
+						ut64 mov_addr = r_anal_esil_trace_addr (anal->esil, cur_idx - 1);
 						RAnalOp *mop = r_core_anal_op (core, mov_addr, R_ANAL_OP_MASK_BASIC);
 						if (mop && mop->var) {
 							ut32 type = mop->type & R_ANAL_OP_TYPE_MASK;
 							if (type == R_ANAL_OP_TYPE_MOV) {
-								var_rename (anal, mop->var, "canary", addr);
+								var_rename (anal, mop->var, "canary", addr, log);
 							}
 						}
 						r_anal_op_free (mop);
@@ -463,15 +571,14 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 			} else if (!resolved && ret_type && ret_reg) {
 				// Forward propgation of function return type
 				char src[REG_SZ] = {0};
-				const char *query = sdb_fmt ("%d.reg.write", cur_idx);
-				const char *cur_dest = sdb_const_get (trace, query, 0);
+				const char *cur_dest = trace_reg_writes (anal, cur_idx, cur_buf, sizeof (cur_buf));
 				get_src_regname (core, aop.addr, src, sizeof (src));
 				if (ret_reg && *src && strstr (ret_reg, src)) {
 					if (var && aop.direction == R_ANAL_OP_DIR_WRITE) {
-						var_retype (anal, var, NULL, ret_type, addr, false, false);
+						var_retype (anal, var, NULL, ret_type, addr, false, false, log);
 						resolved = true;
 					} else if (type == R_ANAL_OP_TYPE_MOV) {
-						ret_reg = cur_dest;
+						ret_reg = cur_dest? strcpy (ret_buf, cur_dest): NULL;
 					}
 				} else if (cur_dest) {
 					char *foo = r_str_new (cur_dest);
@@ -493,12 +600,12 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 						sign = true;
 					} else {
 						// cmp [local_ch], rax ; jb
-						var_retype (anal, var, NULL, "unsigned", addr, false, true);
+						var_retype (anal, var, NULL, "unsigned", addr, false, true, log);
 					}
 				}
 				// cmp [local_ch], rax ; jge
 				if (sign || aop.sign) {
-					var_retype (anal, var, NULL, "signed", addr, false, true);
+					var_retype (anal, var, NULL, "signed", addr, false, true, log);
 				}
 				// lea rax , str.hello  ; mov [local_ch], rax;
 				// mov rdx , [local_4h] ; mov [local_8h], rdx;
@@ -507,10 +614,10 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 					get_src_regname (core, addr, reg, sizeof (reg));
 					bool match = strstr (prev_dest, reg)? true: false;
 					if (str_flag && match) {
-						var_retype (anal, var, NULL, "const char *", addr, false, false);
+						var_retype (anal, var, NULL, "const char *", addr, false, false, log);
 					}
 					if (prop && match && prev_var) {
-						var_retype (anal, var, NULL, prev_type, addr, false, false);
+						var_retype (anal, var, NULL, prev_type, addr, false, false, log);
 					}
 				}
 			}
@@ -537,8 +644,7 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 						str_flag = true;
 					}
 				}
-				const char *query = sdb_fmt ("%d.reg.write", cur_idx);
-				prev_dest = sdb_const_get (trace, query, 0);
+				prev_dest = trace_reg_writes (anal, cur_idx, prev_buf, sizeof (prev_buf));
 				if (var) {
 					strncpy (prev_type, var->type, sizeof (prev_type) - 1);
 					prop = true;
@@ -551,6 +657,18 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 
 		}
 	}
+out_function:
+	free (buf);
+	r_cons_break_pop();
+	r_anal_emul_restore (core, hc);
+	sdb_free (counts);
+	r_anal_esil_trace_reset (anal->esil);
+	return done;
+}
+
+// propagates the types of the arguments set by the calls to fcn
+static void type_match_args(RCore *core, RAnalFunction *fcn) {
+	RAnal *anal = core->anal;
 	const char *place = r_anal_cc_arg (anal, fcn->cc, 1);
 	// Type propgation for register based args
 	RList *list = r_anal_var_list (anal, fcn, R_ANAL_VAR_KIND_REG);
@@ -571,9 +689,9 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 		}
 		if (lvar) {
 			// Propagate local var type = to => register-based var
-			var_retype (anal, rvar, NULL, lvar->type, fcn->addr, false, false);
+			var_retype (anal, rvar, NULL, lvar->type, fcn->addr, false, false, NULL);
 			// Propagate local var type <= from = register-based var
-			var_retype (anal, lvar, NULL, rvar->type, fcn->addr, false, false);
+			var_retype (anal, lvar, NULL, rvar->type, fcn->addr, false, false, NULL);
 			if (!strstr (lvar->type, "int")) {
 				res = false;
 			}
@@ -581,9 +699,9 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 		if (type && res) {
 			// Propgate type to local var and register based var passed
 			// from caller function
-			var_retype (anal, rvar, NULL, type, fcn->addr, false, false);
+			var_retype (anal, rvar, NULL, type, fcn->addr, false, false, NULL);
 			if (lvar) {
-				var_retype (anal, lvar, NULL, type, fcn->addr, false, false);
+				var_retype (anal, lvar, NULL, type, fcn->addr, false, false, NULL);
 			}
 		}
 		free (type);
@@ -597,16 +715,85 @@ R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
 				const char *query = sdb_fmt ("fcn.0x%08"PFMT64x".arg.%d", fcn->addr, (bp_var->delta - 8));
 				char *type = (char *) sdb_const_get (anal->sdb_fcns, query, NULL);
 				if (type) {
-					var_retype (anal, bp_var, NULL, type, fcn->addr, false, false);
+					var_retype (anal, bp_var, NULL, type, fcn->addr, false, false, NULL);
 				}
 			}
 		}
 		r_list_free (list2);
 	}
 	r_list_free (list);
-out_function:
-	free (buf);
-	r_cons_break_pop();
-	r_anal_emul_restore (core, hc);
-	sdb_reset (anal->esil->db_trace);
+}
+
+R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn) {
+	if (type_match_fcn (core, fcn, NULL)) {
+		type_match_args (core, fcn);
+	}
+}
+
+// With anal.threads > 1 the functions are split round robin between
+// workers (see r_core_anal_workers), walking them in the order of aaft.
+// The argument types set by the calls are propagated once all the
+// functions were emulated, so a function gets those of all its callers and
+// not only of the ones emulated before it. As in the serial path, only the
+// functions emulated to the end get them, the workers log those with 'd'.
+
+static int type_match_addr_cmp(const void *a, const void *b) {
+	ut64 x = *(const ut64 *)a, y = *(const ut64 *)b;
+	return (x < y)? -1: (x > y)? 1: 0;
+}
+
+// user is the RVector of the functions done, filled here when there's no log
+static void type_match_worker(RCore *core, void *user, int worker, int nworkers, RStrBuf *log) {
+	RAnalFunction *fcn;
+	RListIter *it;
+	int i = 0;
+	r_list_foreach_prev (core->anal->fcns, it, fcn) {
+		if (i++ % nworkers != worker || !r_core_seek (core, fcn->addr, true)) {
+			continue;
+		}
+		r_anal_esil_set_pc (core->anal->esil, fcn->addr);
+		if (type_match_fcn (core, fcn, log)) {
+			if (log) {
+				r_strbuf_appendf (log, "d 0x%"PFMT64x"\n", fcn->addr);
+			} else {
+				r_vector_push (user, &fcn->addr);
+			}
+		}
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+	}
+}
+
+static void type_match_merge(RCore *core, void *user, int worker, int nworkers, char *log) {
+	if (log) {
+		type_match_replay (core->anal, log, user);
+	} else {
+		type_match_worker (core, user, worker, nworkers, NULL);
+	}
+}
+
+// false when no worker could be started, the caller matches serially then
+R_API bool r_core_anal_type_match_parallel(RCore *core, int nworkers) {
+	RAnalFunction *fcn;
+	RListIter *it;
+	RVector done;
+	r_vector_init (&done, sizeof (ut64), NULL, NULL);
+	if (!r_core_anal_workers (core, nworkers, type_match_worker, type_match_merge, &done)) {
+		r_vector_clear (&done);
+		return false;
+	}
+	if (done.len) {
+		qsort (done.a, done.len, sizeof (ut64), type_match_addr_cmp);
+	}
+	r_list_foreach_prev (core->anal->fcns, it, fcn) {
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+		if (done.len && bsearch (&fcn->addr, done.a, done.len, sizeof (ut64), type_match_addr_cmp)) {
+			type_match_args (core, fcn);
+		}
+	}
+	r_vector_clear (&done);
+	return true;
 }
@@ -53,8 +53,6 @@ static char *getFunctionName(RCore *core, ut64 addr) {
 	return NULL;
 }
 
-static RCore *mycore = NULL;
-
 // XXX: copypaste from anal/data.c
 #define MINLEN 1
 static int is_string (const ut8 *buf, int size, int *len) {
@@ -878,13 +876,9 @@ static void print_hint_h_format(RAnalHint* hint) {
 	r_cons_newline ();
 }
 
-static int cb(void *p, const char *k, const char *v) {
+static bool hint_list_cb(void *p, const RAnalHint *hint) {
 	HintListState *hls = p;
-	RAnalHint *hint = r_anal_hint_from_string (hls->a, sdb_atoi (k + 5), v);
 	switch (hls->mode) {
-	case 's':
-		r_cons_printf ("%s=%s\n", k, v);
-		break;
 	case '*':
 		HINTCMD_ADDR (hint, arch, "aha %s");
 		HINTCMD_ADDR (hint, bits, "ahb %d");
@@ -914,16 +908,49 @@ static int cb(void *p, const char *k, const char *v) {
 		r_cons_print ("}");
 		break;
 	default:
-		print_hint_h_format (hint);
+		print_hint_h_format ((RAnalHint *)hint);
 		break;
 	}
-	free (hint);
-	return 1;
+	hls->count++;
+	return true;
+}
+
+static bool hint_range_list_cb(void *p, const RAnalRangeHint *r) {
+	HintListState *hls = p;
+	switch (hls->mode) {
+	case '*':
+		if (r->arch) {
+			r_cons_printf ("aha %s %"PFMT64d" @ 0x%"PFMT64x"\n", r->arch, r->to - r->from, r->from);
+		} else {
+			r_cons_printf ("ahb %d %"PFMT64d" @ 0x%"PFMT64x"\n", r->bits, r->to - r->from, r->from);
+		}
+		break;
+	case 'j':
+		r_cons_printf ("%s{\"from\":%"PFMT64d",\"to\":%"PFMT64d",\"range\":true",
+			hls->count>0?",":"", r->from, r->to);
+		if (r->arch) {
+			r_cons_printf (",\"arch\":\"%s\"", r->arch);
+		} else {
+			r_cons_printf (",\"bits\":%d", r->bits);
+		}
+		r_cons_print ("}");
+		break;
+	default:
+		r_cons_printf (" 0x%08"PFMT64x" - 0x%08"PFMT64x" => range", r->from, r->to);
+		if (r->arch) {
+			r_cons_printf (" arch='%s'\n", r->arch);
+		} else {
+			r_cons_printf (" bits=%d\n", r->bits);
+		}
+		break;
+	}
+	hls->count++;
+	return true;
 }
 
 R_API void r_core_anal_hint_print(RAnal* a, ut64 addr, int mode) {
-	RAnalHint *hint = r_anal_hint_get (a, addr);
-	if (!hint) {
+	RAnalHint h, *hint = &h;
+	if (!r_anal_hint_lookup (a, addr, hint)) {
 		return;
 	}
 	if (mode == '*') {
@@ -937,7 +964,6 @@ R_API void r_core_anal_hint_print(RAnal* a, ut64 addr, int mode) {
 	} else {
 		print_hint_h_format (hint);
 	}
-	free (hint);
 }
 
 R_API void r_core_anal_hint_list(RAnal *a, int mode) {
@@ -952,17 +978,8 @@ R_API void r_core_anal_hint_list(RAnal *a, int mode) {
 	if (mode == 'j') {
 		r_cons_strcat ("[");
 	}
-#if 0
-	sdb_foreach (a->sdb_hints, cb, &hls);
-#else
-	SdbList *ls = sdb_foreach_list (a->sdb_hints, true);
-	SdbListIter *lsi;
-	SdbKv *kv;
-	ls_foreach (ls, lsi, kv) {
-		cb (&hls, kv->key, kv->value);
-	}
-	ls_free (ls);
-#endif
+	r_anal_hint_foreach (a, hint_list_cb, &hls);
+	r_anal_hint_range_foreach (a, hint_range_list_cb, &hls);
 	if (mode == 'j') {
 		r_cons_strcat ("]\n");
 	}
@@ -1418,17 +1435,8 @@ fin:
 /* returns the address of the basic block that contains addr or UT64_MAX if
  * there is no such basic block */
 R_API ut64 r_core_anal_get_bbaddr(RCore *core, ut64 addr) {
-	RAnalBlock *bbi;
-	RAnalFunction *fcni;
-	RListIter *iter, *iter2;
-	r_list_foreach (core->anal->fcns, iter, fcni) {
-		r_list_foreach (fcni->bbs, iter2, bbi) {
-			if (addr >= bbi->addr && addr < bbi->addr + bbi->size) {
-				return bbi->addr;
-			}
-		}
-	}
-	return UT64_MAX;
+	RAnalBlock *bb = r_anal_bb_from_offset (core->anal, addr);
+	return bb? bb->addr: UT64_MAX;
 }
 
 /* seek basic block that contains address addr or just addr if there's no such
@@ -2986,7 +2994,8 @@ R_API int r_core_anal_search(RCore *core, ut64 from, ut64 to, ut64 ref, int mode
 	return count;
 }
 
-static void found_xref(RCore *core, ut64 at, ut64 xref_to, RAnalRefType type, int count, int rad, int cfg_debug, bool cfg_anal_strings) {
+// the refs to add go in refs, r_core_anal_search_xrefs sets them at once
+static void found_xref(RCore *core, RVector *refs, ut64 at, ut64 xref_to, RAnalRefType type, int count, int rad, int cfg_debug, bool cfg_anal_strings) {
 	// Validate the reference. If virtual addressing is enabled, we
 	// allow only references to virtual addresses in order to reduce
 	// the number of false positives. In debugger mode, the reference
@@ -3020,10 +3029,10 @@ static void found_xref(RCore *core, ut64 at, ut64 xref_to, RAnalRefType type, in
 			}
 			free (str_string);
 		}
-		// Add to SDB
 		if (xref_to) {
-			r_anal_xrefs_set (core->anal, at, xref_to, type);
-		}	
+			RAnalRef ref = { type, xref_to, at };
+			r_vector_push (refs, &ref);
+		}
 	} else if (rad == 'j') {
 		// Output JSON
 		if (count > 0) {
@@ -3058,12 +3067,14 @@ static void found_xref(RCore *core, ut64 at, ut64 xref_to, RAnalRefType type, in
 R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 	int cfg_debug = r_config_get_i (core->config, "cfg.debug");
 	bool cfg_anal_strings = r_config_get_i (core->config, "anal.strings");
-	ut8 *buf;
+	const ut8 *buf;
+	ut8 *scratch;
 	ut64 at;
 	ut8 *block;
 	int count = 0;
 	const int bsz = core->blocksize;
 	RAnalOp op = { 0 };
+	RVector refs;
 
 	if (from == to) {
 		return -1;
@@ -3078,20 +3089,21 @@ R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 		eprintf ("Error: block size too small\n");
 		return -1;
 	}
-	buf = malloc (bsz);
-	if (!buf) {
+	scratch = malloc (bsz);
+	if (!scratch) {
 		eprintf ("Error: cannot allocate a block\n");
 		return -1;
 	}
 	block = malloc (bsz);
 	if (!block) {
 		eprintf ("Error: cannot allocate a temp block\n");
-		free (buf);
+		free (scratch);
 		return -1;
-	}	
+	}
 	if (rad == 'j') {
 		r_cons_printf ("{");
 	}
+	r_vector_init (&refs, sizeof (RAnalRef), NULL, NULL);
 	r_cons_break_push (NULL, NULL);
 	at = from;
 	while (at < to && !r_cons_is_breaked ()) {
@@ -3099,7 +3111,9 @@ R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 		if (!r_io_is_valid_offset (core->io, at, R_IO_EXEC)) {
 			break;
 		}
-		(void)r_io_read_at (core->io, at, buf, bsz);
+		// analyze the mapped file in place when possible, nothing in
+		// this loop writes to io so the view stays valid
+		buf = r_io_view_at (core->io, at, scratch, bsz);
 		memset (block, -1, bsz);
 		if (!memcmp (buf, block, bsz)) {
 		//	eprintf ("Error: skipping uninitialized block \n");
@@ -3124,16 +3138,16 @@ R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 			}
 			// find references
 			if (op.ptr && op.ptr != UT64_MAX && op.ptr != UT32_MAX) {
-				found_xref (core, op.addr, op.ptr, R_ANAL_REF_TYPE_DATA, count, rad, cfg_debug, cfg_anal_strings);
+				found_xref (core, &refs, op.addr, op.ptr, R_ANAL_REF_TYPE_DATA, count, rad, cfg_debug, cfg_anal_strings);
 			}
 			switch (op.type) {
 			case R_ANAL_OP_TYPE_JMP:
 			case R_ANAL_OP_TYPE_CJMP:
-				found_xref(core, op.addr, op.jump, R_ANAL_REF_TYPE_CODE, count, rad, cfg_debug, cfg_anal_strings);
+				found_xref (core, &refs, op.addr, op.jump, R_ANAL_REF_TYPE_CODE, count, rad, cfg_debug, cfg_anal_strings);
 				break;
 			case R_ANAL_OP_TYPE_CALL:
 			case R_ANAL_OP_TYPE_CCALL:
-				found_xref(core, op.addr, op.jump, R_ANAL_REF_TYPE_CALL, count, rad, cfg_debug, cfg_anal_strings);
+				found_xref (core, &refs, op.addr, op.jump, R_ANAL_REF_TYPE_CALL, count, rad, cfg_debug, cfg_anal_strings);
 				break;
 			case R_ANAL_OP_TYPE_UJMP:
 			case R_ANAL_OP_TYPE_IJMP:
@@ -3141,14 +3155,14 @@ R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 			case R_ANAL_OP_TYPE_IRJMP:
 			case R_ANAL_OP_TYPE_MJMP:
 			case R_ANAL_OP_TYPE_UCJMP:
-				found_xref(core, op.addr, op.ptr, R_ANAL_REF_TYPE_CODE, count, rad, cfg_debug, cfg_anal_strings);
+				found_xref (core, &refs, op.addr, op.ptr, R_ANAL_REF_TYPE_CODE, count, rad, cfg_debug, cfg_anal_strings);
 				break;
 			case R_ANAL_OP_TYPE_UCALL:
 			case R_ANAL_OP_TYPE_ICALL:
 			case R_ANAL_OP_TYPE_RCALL:
 			case R_ANAL_OP_TYPE_IRCALL:
 			case R_ANAL_OP_TYPE_UCCALL:
-				found_xref(core, op.addr, op.ptr, R_ANAL_REF_TYPE_CALL, count, rad, cfg_debug, cfg_anal_strings);
+				found_xref (core, &refs, op.addr, op.ptr, R_ANAL_REF_TYPE_CALL, count, rad, cfg_debug, cfg_anal_strings);
 				break;
 			default:
 				break;
@@ -3160,7 +3174,9 @@ R_API int r_core_anal_search_xrefs(RCore *core, ut64 from, ut64 to, int rad) {
 		}
 	}
 	r_cons_break_pop ();
-	free (buf);
+	r_anal_xrefs_set_bulk (core->anal, refs.a, refs.len);
+	r_vector_clear (&refs);
+	free (scratch);
 	free (block);
 	if (rad == 'j') {
 		r_cons_printf ("}\n");
@@ -3181,6 +3197,228 @@ static bool isValidSymbol(RBinSymbol *symbol) {
 	return false;
 }
 
+#if __UNIX__ && HAVE_FORK
+static bool write_all(int fd, const char *buf, int len) {
+	while (len > 0) {
+		int n = write (fd, buf, len);
+		if (n < 1) {
+			return false;
+		}
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+#endif
+
+// Runs work in nworkers forked processes: the anal plugins keep their
+// decoder state in globals, so threads can't share them. Each worker appends
+// what it found to its log and merge replays the logs in the parent in
+// worker order, so the result doesn't depend on which one finishes first.
+// merge gets a NULL log when its worker couldn't be started and does that
+// share itself then. False when no worker could be started.
+R_API bool r_core_anal_workers(RCore *core, int nworkers, RCoreAnalWorkCb work, RCoreAnalMergeCb merge, void *user) {
+#if __UNIX__ && HAVE_FORK
+	char buf[4096];
+	int i, started = 0;
+	if (nworkers < 2) {
+		return false;
+	}
+	int *fds = calloc (nworkers, sizeof (int));
+	int *pids = calloc (nworkers, sizeof (int));
+	if (!fds || !pids) {
+		free (fds);
+		free (pids);
+		return false;
+	}
+	r_cons_flush ();
+	for (i = 0; i < nworkers; i++) {
+		int p[2];
+		pids[i] = -1;
+		if (pipe (p) == -1) {
+			continue;
+		}
+		pids[i] = r_sys_fork ();
+		if (!pids[i]) {
+			RStrBuf *log = r_strbuf_new ("");
+			close (p[0]);
+			if (log) {
+				work (core, user, i, nworkers, log);
+				const char *s = r_strbuf_get (log);
+				write_all (p[1], s, strlen (s));
+			}
+			close (p[1]);
+			_exit (0);
+		}
+		close (p[1]);
+		if (pids[i] == -1) {
+			close (p[0]);
+			continue;
+		}
+		fds[i] = p[0];
+		started++;
+	}
+	if (!started) {
+		free (fds);
+		free (pids);
+		return false;
+	}
+	for (i = 0; i < nworkers; i++) {
+		if (pids[i] == -1) {
+			merge (core, user, i, nworkers, NULL);
+			continue;
+		}
+		RStrBuf *sb = r_strbuf_new ("");
+		int n;
+		while ((n = read (fds[i], buf, sizeof (buf))) > 0) {
+			r_strbuf_append_n (sb, buf, n);
+		}
+		close (fds[i]);
+		waitpid (pids[i], NULL, 0);
+		merge (core, user, i, nworkers, r_strbuf_get (sb));
+		r_strbuf_free (sb);
+	}
+	free (fds);
+	free (pids);
+	return true;
+#else
+	return false;
+#endif
+}
+
+// With anal.threads > 1 the addresses are split round robin between the
+// workers, which send back the functions they found in the afl* format.
+// When two workers find the same function the one of the first worker is
+// kept. The xrefs, meta and hints that a worker adds outside of its
+// functions come last, in a record for address UT64_MAX.
+
+typedef struct {
+	RVector *addrs;
+	RVector old; // sorted addresses of the functions known before the fork
+	int depth;
+} AnalFcnWork;
+
+static int addr_cmp(const void *a, const void *b) {
+	ut64 x = *(const ut64 *)a, y = *(const ut64 *)b;
+	return (x < y)? -1: (x > y)? 1: 0;
+}
+
+// the xrefs, meta and hints as r2 commands, one per line
+static char *anal_state_cmds(RCore *core) {
+	r_cons_push ();
+	r_anal_xrefs_list (core->anal, '*');
+	r_meta_list (core->anal, R_META_TYPE_ANY, '*');
+	r_core_anal_hint_list (core->anal, '*');
+	const char *cmds = r_cons_get_buffer ();
+	char *ret = strdup (cmds? cmds: "");
+	r_cons_pop ();
+	return ret;
+}
+
+static void anal_fcn_worker(RCore *core, void *user, int worker, int nworkers, RStrBuf *log) {
+	AnalFcnWork *w = user;
+	RAnalFunction *fcn;
+	RListIter *iter;
+	RStrBuf *delta;
+	char *line, *nl;
+	size_t i;
+	SdbHash *known = ht_new (NULL, NULL, NULL);
+	char *cmds = anal_state_cmds (core);
+	for (line = cmds; line && *line; line = nl + 1) {
+		if (!(nl = strchr (line, '\n'))) {
+			break;
+		}
+		*nl = 0;
+		ht_insert (known, line, NULL);
+	}
+	free (cmds);
+	for (i = worker; i < w->addrs->len; i += nworkers) {
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+		r_core_anal_fcn (core, *(ut64 *)r_vector_index_ptr (w->addrs, i), -1, R_ANAL_REF_TYPE_NULL, w->depth);
+	}
+	r_list_foreach (core->anal->fcns, iter, fcn) {
+		if (w->old.len && bsearch (&fcn->addr, w->old.a, w->old.len, sizeof (ut64), addr_cmp)) {
+			continue;
+		}
+		r_cons_push ();
+		fcn_print_detail (core, fcn);
+		const char *cmds = r_cons_get_buffer ();
+		r_strbuf_appendf (log, "0x%"PFMT64x" %d\n%s", fcn->addr, cmds? (int)strlen (cmds): 0, cmds? cmds: "");
+		r_cons_pop ();
+	}
+	delta = r_strbuf_new ("");
+	cmds = anal_state_cmds (core);
+	for (line = cmds; line && *line; line = nl + 1) {
+		if (!(nl = strchr (line, '\n'))) {
+			break;
+		}
+		*nl = 0;
+		if (!ht_find (known, line, NULL)) {
+			r_strbuf_appendf (delta, "%s\n", line);
+		}
+	}
+	free (cmds);
+	ht_free (known);
+	r_strbuf_appendf (log, "0x%"PFMT64x" %d\n%s", UT64_MAX, delta->len, r_strbuf_get (delta));
+	r_strbuf_free (delta);
+}
+
+static void anal_fcn_merge(RCore *core, void *user, int worker, int nworkers, char *buf) {
+	AnalFcnWork *w = user;
+	char *p = buf;
+	const char *eob = buf? buf + strlen (buf): NULL;
+	r_flag_space_push (core->flags, "functions");
+	if (!buf) {
+		// no worker for this share, analyze it here
+		size_t j;
+		for (j = worker; j < w->addrs->len; j += nworkers) {
+			r_core_anal_fcn (core, *(ut64 *)r_vector_index_ptr (w->addrs, j), -1, R_ANAL_REF_TYPE_NULL, w->depth);
+		}
+	}
+	while (p && *p) {
+		char *nl = strchr (p, '\n');
+		char *end = NULL;
+		if (!nl) {
+			break;
+		}
+		ut64 addr = strtoull (p, &end, 16);
+		int len = atoi (end);
+		p = nl + 1;
+		if (len < 0 || len > eob - p) {
+			break;
+		}
+		char *cmds = r_str_ndup (p, len);
+		p += len;
+		if (cmds && (addr == UT64_MAX || !r_anal_get_fcn_at (core->anal, addr, 0))) {
+			r_cons_push ();
+			r_core_cmd_lines (core, cmds);
+			r_cons_pop ();
+		}
+		free (cmds);
+	}
+	r_flag_space_pop (core->flags);
+}
+
+// false when no worker could be started, the caller analyzes serially then
+static bool anal_fcn_parallel(RCore *core, RVector *addrs, int nworkers, int depth) {
+	RAnalFunction *fcn;
+	RListIter *iter;
+	AnalFcnWork w = { addrs };
+	w.depth = depth;
+	r_vector_init (&w.old, sizeof (ut64), NULL, NULL);
+	r_list_foreach (core->anal->fcns, iter, fcn) {
+		r_vector_push (&w.old, &fcn->addr);
+	}
+	if (w.old.len) {
+		qsort (w.old.a, w.old.len, sizeof (ut64), addr_cmp);
+	}
+	bool ret = r_core_anal_workers (core, nworkers, anal_fcn_worker, anal_fcn_merge, &w);
+	r_vector_clear (&w.old);
+	return ret;
+}
+
 R_API int r_core_anal_all(RCore *core) {
 	RList *list;
 	RListIter *iter;
@@ -3189,6 +3427,8 @@ R_API int r_core_anal_all(RCore *core) {
 	RBinAddr *binmain;
 	RBinAddr *entry;
 	RBinSymbol *symbol;
+	RVector addrs;
+	size_t i;
 	int depth = core->anal->opt.depth;
 	bool anal_vars = r_config_get_i (core->config, "anal.vars");
 
@@ -3203,34 +3443,44 @@ R_API int r_core_anal_all(RCore *core) {
 	}
 
 	r_cons_break_push (NULL, NULL);
+	r_vector_init (&addrs, sizeof (ut64), NULL, NULL);
 	/* Symbols (Imports are already analyzed by rabin2 on init) */
 	if ((list = r_bin_get_symbols (core->bin)) != NULL) {
 		r_list_foreach (list, iter, symbol) {
-			if (r_cons_is_breaked ()) {
-				break;
-			}
 			if (strstr (symbol->name, ".dll_")) { // Stop analyzing PE imports further
 				continue;
 			}
 			if (isValidSymbol (symbol)) {
 				ut64 addr = r_bin_get_vaddr (core->bin, symbol->paddr,
 					symbol->vaddr);
-				r_core_anal_fcn (core, addr, -1,
-					R_ANAL_REF_TYPE_NULL, depth);
+				r_vector_push (&addrs, &addr);
 			}
 		}
 	}
 	/* Main */
 	if ((binmain = r_bin_get_sym (core->bin, R_BIN_SYM_MAIN)) != NULL) {
 		ut64 addr = r_bin_get_vaddr (core->bin, binmain->paddr, binmain->vaddr);
-		r_core_anal_fcn (core, addr, -1, R_ANAL_REF_TYPE_NULL, depth);
+		r_vector_push (&addrs, &addr);
 	}
 	if ((list = r_bin_get_entries (core->bin)) != NULL) {
 		r_list_foreach (list, iter, entry) {
 			ut64 addr = r_bin_get_vaddr (core->bin, entry->paddr, entry->vaddr);
-			r_core_anal_fcn (core, addr, -1, R_ANAL_REF_TYPE_NULL, depth);
+			r_vector_push (&addrs, &addr);
+		}
+	}
+	int threads = r_config_get_i (core->config, "anal.threads");
+	if (threads > 1 && addrs.len > 1) {
+		if (anal_fcn_parallel (core, &addrs, R_MIN (threads, addrs.len), depth)) {
+			r_vector_clear (&addrs);
 		}
 	}
+	for (i = 0; i < addrs.len; i++) {
+		if (r_cons_is_breaked ()) {
+			break;
+		}
+		r_core_anal_fcn (core, *(ut64 *)r_vector_index_ptr (&addrs, i), -1, R_ANAL_REF_TYPE_NULL, depth);
+	}
+	r_vector_clear (&addrs);
 	if (anal_vars) {
 		/* Set fcn type to R_ANAL_FCN_TYPE_SYM for symbols */
 		r_list_foreach (core->anal->fcns, iter, fcni) {
@@ -3247,68 +3497,286 @@ R_API int r_core_anal_all(RCore *core) {
 	return true;
 }
 
-R_API int r_core_anal_data (RCore *core, ut64 addr, int count, int depth, int wordsize) {
+// Called after every write, remembers the functions whose blocks cover the
+// patched bytes so r_core_anal_reanal only redoes those. Only the w
+// commands and aaw redo them, the functions patched by other writes (esil,
+// the debugger, io plugins) wait until then.
+R_API void r_core_anal_dirty(RCore *core, ut64 addr, int len) {
+	RListIter *iter;
+	RAnalBlock *bb;
+	if (!core->anal->bb_tree || len < 1) {
+		return;
+	}
+	RList *bbs = r_anal_bb_index_intersect (core->anal, addr, addr + len);
+	r_list_foreach (bbs, iter, bb) {
+		if (!bb->fcn) {
+			continue;
+		}
+		ut64 *a = core->anal_dirty.a;
+		size_t lo = 0, hi = core->anal_dirty.len;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (a[mid] < bb->fcn->addr) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo == core->anal_dirty.len || a[lo] != bb->fcn->addr) {
+			r_vector_insert (&core->anal_dirty, lo, &bb->fcn->addr);
+		}
+	}
+	r_list_free (bbs);
+}
+
+static void fcn_restore_name(RCore *core, RAnalFunction *fcn, const char *name) {
+	if (!strcmp (fcn->name, name)) {
+		return;
+	}
+	RFlagItem *fi = r_flag_get (core->flags, fcn->name);
+	if (fi) {
+		r_flag_rename (core->flags, fi, name);
+	}
+	free (fcn->name);
+	fcn->name = strdup (name);
+	if (core->anal->cb.on_fcn_rename) {
+		core->anal->cb.on_fcn_rename (core->anal, core->anal->user, fcn, fcn->name);
+	}
+}
+
+// the attributes and variables the user may have set on a function
+typedef struct {
+	char *name;
+	int type;
+	int bits;
+	ut64 size;
+	const char *cc;
+	char *rets; // not owned by the function, r_anal_fcn_free keeps it
+	char *attr;
+	RList *vars;
+} ReanalFcn;
+
+static void reanal_save(RCore *core, RAnalFunction *fcn, ReanalFcn *rf) {
+	rf->name = strdup (fcn->name);
+	rf->type = fcn->type;
+	rf->bits = fcn->bits;
+	rf->size = r_anal_fcn_size (fcn);
+	rf->cc = fcn->cc;
+	rf->rets = fcn->rets;
+	rf->attr = fcn->attr? strdup (fcn->attr): NULL;
+	rf->vars = r_anal_var_all_list (core->anal, fcn);
+}
+
+// the recovered variables at the same place keep their new accesses
+static void reanal_restore(RCore *core, RAnalFunction *fcn, ReanalFcn *rf) {
+	RListIter *iter;
+	RAnalVar *var;
+	fcn_restore_name (core, fcn, rf->name);
+	fcn->type = rf->type;
+	fcn->bits = rf->bits;
+	fcn->cc = rf->cc;
+	fcn->rets = rf->rets;
+	free (fcn->attr);
+	fcn->attr = rf->attr;
+	rf->attr = NULL;
+	r_list_foreach (rf->vars, iter, var) {
+		r_anal_var_add (core->anal, fcn->addr, 1, var->delta, var->kind,
+			var->type, var->size, var->isarg, var->name);
+	}
+}
+
+// the function at addr again, for when the new code doesn't analyze as one
+static RAnalFunction *reanal_define(RCore *core, ut64 addr, ReanalFcn *rf) {
+	RAnalFunction *fcn = r_anal_fcn_new ();
+	if (!fcn) {
+		return NULL;
+	}
+	fcn->addr = addr;
+	fcn->name = strdup (rf->name);
+	fcn->type = rf->type;
+	r_anal_fcn_set_size (NULL, fcn, rf->size);
+	if (!r_anal_fcn_insert (core->anal, fcn)) {
+		r_anal_fcn_free (fcn);
+		return NULL;
+	}
+	return fcn;
+}
+
+static void reanal_fini(ReanalFcn *rf) {
+	free (rf->name);
+	free (rf->attr);
+	r_list_free (rf->vars);
+}
+
+// Analyzes again the functions patched since the last call. Their refs are
+// dropped and rebuilt from the new code, the calls to new targets get
+// analyzed by r_core_anal_fcn. The name, type, bits, cc, rets, attr and
+// the variables of the function are kept. When the new code doesn't make a
+// function anymore, it is defined again with its old size, as af+ does.
+// Returns the amount of functions redone.
+R_API int r_core_anal_reanal(RCore *core) {
+	RListIter *iter;
+	RAnalBlock *bb;
+	RVector dirty = core->anal_dirty;
+	int depth = core->anal->opt.depth;
+	bool anal_vars = r_config_get_i (core->config, "anal.vars");
+	int count = 0;
+	size_t i;
+	r_vector_init (&core->anal_dirty, sizeof (ut64), NULL, NULL);
+	r_flag_space_push (core->flags, "functions");
+	for (i = 0; i < dirty.len; i++) {
+		ut64 addr = ((ut64 *)dirty.a)[i];
+		RAnalFunction *fcn = r_anal_get_fcn_at (core->anal, addr, 0);
+		if (!fcn) {
+			continue;
+		}
+		ReanalFcn rf;
+		reanal_save (core, fcn, &rf);
+		r_list_foreach (fcn->bbs, iter, bb) {
+			r_anal_xrefs_del_range (core->anal, bb->addr, bb->addr + bb->size);
+		}
+		r_anal_fcn_del (core->anal, addr);
+		r_core_anal_fcn (core, addr, UT64_MAX, R_ANAL_REF_TYPE_NULL, depth);
+		fcn = r_anal_get_fcn_at (core->anal, addr, 0);
+		if (fcn && rf.name) {
+			if (anal_vars) {
+				r_core_recover_vars (core, fcn, true);
+			}
+			reanal_restore (core, fcn, &rf);
+			count++;
+		} else if (!fcn && rf.name && (fcn = reanal_define (core, addr, &rf))) {
+			reanal_restore (core, fcn, &rf);
+		}
+		reanal_fini (&rf);
+	}
+	r_flag_space_pop (core->flags);
+	r_vector_clear (&dirty);
+	return count;
+}
+
+// upper bound of the memory used to prefetch the blocks pointed from a block
+#define ANAL_DATA_PREFETCH_MAX (1024 * 1024)
+
+typedef struct {
+	RAnalData *d;
+	ut64 dst;
+	ut8 *block;
+} AnalDataItem;
+
+// block, when given, holds the blocksize bytes at addr already
+static int core_anal_data(RCore *core, ut64 addr, int count, int depth, int wordsize, const ut8 *block) {
 	RAnalData *d;
-	ut64 dstaddr = 0LL;
-	ut8 *buf = core->block;
 	int len = core->blocksize;
 	int word = wordsize ? wordsize: core->assembler->bits / 8;
 	char *str;
-	int i, j;
+	int i, j, k, n;
 
 	count = R_MIN (count, len);
-	buf = malloc (len + 1);
-	if (!buf) {
+	ut8 *buf = malloc (len + 1);
+	AnalDataItem *items = R_NEWS0 (AnalDataItem, R_MAX (count, 1));
+	RIOReadVec *vec = R_NEWS0 (RIOReadVec, R_MAX (count, 1));
+	if (!buf || !items || !vec) {
+		free (buf);
+		free (items);
+		free (vec);
 		return false;
 	}
-	memset (buf, 0xff, len);
-	r_io_read_at (core->io, addr, buf, len);
+	if (block) {
+		memcpy (buf, block, len);
+	} else {
+		memset (buf, 0xff, len);
+		r_io_read_at (core->io, addr, buf, len);
+	}
 	buf[len - 1] = 0;
 
 	RConsPrintablePalette *pal = r_config_get_i (core->config, "scr.color")? &r_cons_singleton ()->pal: NULL;
-	for (i = j = 0; j < count; j++) {
+	for (i = j = 0; j < count;) {
 		if (i >= len) {
 			r_io_read_at (core->io, addr + i, buf, len);
 			buf[len] = 0;
 			addr += i;
 			i = 0;
+			j++;
 			continue;
 		}
-		/* r_anal_data requires null-terminated buffer according to coverity */
-		/* but it should not.. so this must be fixed in anal/data.c instead of */
-		/* null terminating here */
-		d = r_anal_data (core->anal, addr + i, buf + i, len - i, wordsize);
-		str = r_anal_data_to_string (d, pal);
-		r_cons_println (str);
-
-		if (d) {
-			switch (d->type) {
-			case R_ANAL_DATA_TYPE_POINTER:
+		// walk the items of this block first, so the blocks behind its
+		// pointers can be read with a single batch before recursing
+		for (n = 0; j + n < count && i < len; n++) {
+			/* r_anal_data requires null-terminated buffer according to coverity */
+			/* but it should not.. so this must be fixed in anal/data.c instead of */
+			/* null terminating here */
+			d = r_anal_data (core->anal, addr + i, buf + i, len - i, wordsize);
+			items[n].d = d;
+			items[n].block = NULL;
+			if (d) {
+				switch (d->type) {
+				case R_ANAL_DATA_TYPE_POINTER:
+					items[n].dst = r_mem_get_num (buf + i, word);
+					i += word;
+					break;
+				case R_ANAL_DATA_TYPE_STRING:
+					buf[len-1] = 0;
+					i += strlen ((const char*)buf + i) + 1;
+					break;
+				default:
+					i += (d->len > 3)? d->len: word;
+					break;
+				}
+			} else {
+				i += word;
+			}
+		}
+		ut8 *blocks = NULL;
+		if (depth > 0) {
+			int nvec = 0;
+			for (k = 0; k < n; k++) {
+				if (items[k].d && items[k].d->type == R_ANAL_DATA_TYPE_POINTER
+						&& (nvec + 1) * (st64)len <= ANAL_DATA_PREFETCH_MAX) {
+					vec[nvec].addr = items[k].dst;
+					vec[nvec].len = len;
+					nvec++;
+				}
+			}
+			if (nvec > 0 && (blocks = malloc ((size_t)nvec * len))) {
+				memset (blocks, 0xff, (size_t)nvec * len);
+				for (k = 0; k < nvec; k++) {
+					vec[k].buf = blocks + (size_t)k * len;
+				}
+				(void)r_io_read_batch (core->io, vec, nvec);
+				for (k = 0, nvec = 0; k < n; k++) {
+					if (items[k].d && items[k].d->type == R_ANAL_DATA_TYPE_POINTER
+							&& (nvec + 1) * (st64)len <= ANAL_DATA_PREFETCH_MAX) {
+						items[k].block = vec[nvec++].buf;
+					}
+				}
+			}
+		}
+		for (k = 0; k < n; k++) {
+			d = items[k].d;
+			str = r_anal_data_to_string (d, pal);
+			r_cons_println (str);
+			if (d && d->type == R_ANAL_DATA_TYPE_POINTER) {
 				r_cons_printf ("`- ");
-				dstaddr = r_mem_get_num (buf + i, word);
 				if (depth > 0) {
-					r_core_anal_data (core, dstaddr, 1, depth - 1, wordsize);
+					core_anal_data (core, items[k].dst, 1, depth - 1, wordsize, items[k].block);
 				}
-				i += word;
-				break;
-			case R_ANAL_DATA_TYPE_STRING:
-				buf[len-1] = 0;
-				i += strlen ((const char*)buf + i) + 1;
-				break;
-			default:
-				i += (d->len > 3)? d->len: word;
-				break;
 			}
-		} else {
-			i += word;
+			free (str);
+			r_anal_data_free (d);
 		}
-		free (str);
-		r_anal_data_free (d);
+		free (blocks);
+		j += n;
 	}
+	free (items);
+	free (vec);
 	free (buf);
 	return true;
 }
 
+R_API int r_core_anal_data (RCore *core, ut64 addr, int count, int depth, int wordsize) {
+	return core_anal_data (core, addr, count, depth, wordsize, NULL);
+}
+
 /* core analysis stats */
 /* stats --- colorful bar */
 R_API RCoreAnalStats* r_core_anal_get_stats(RCore *core, ut64 from, ut64 to, ut64 step) {
@@ -3390,6 +3858,7 @@ R_API RCoreAnalStats* r_core_anal_get_stats(RCore *core, ut64 from, ut64 to, ut6
 			break;
 		}
 	}
+	r_list_free (metas);
 	// iter all comments
 	// iter all strings
 	return as;
@@ -3675,70 +4144,184 @@ static bool myvalid(RIO *io, ut64 addr) {
 	return true;
 }
 
+// state of an aae run, in esil->user while its hooks are set
+typedef struct {
+	RCore *core;
+	RAnalOp *op; // being emulated, the reg_write hook reads its id
+	ut64 last_read;
+	ut64 last_data;
+	ut64 ntarget; // UT64_MAX when looking for any ref
+	ut64 refptr;
+	bool target;
+	bool strings;
+	bool stop;
+	int arch;
+	int opalign;
+	int in;
+	const char *sn;
+	const char *pcname;
+	RStrBuf *log; // in a worker, what it finds for esilbreak_replay
+} EsilBreak;
+
+// the results go through these, a worker also logs them for the parent
+
+static void esilbreak_ref(EsilBreak *eb, ut64 from, ut64 to, RAnalRefType type) {
+	r_anal_xrefs_set (eb->core->anal, from, to, type);
+	if (eb->log) {
+		r_strbuf_appendf (eb->log, "x 0x%"PFMT64x" 0x%"PFMT64x" %c\n", from, to, type);
+	}
+}
+
+static void esilbreak_string(EsilBreak *eb, ut64 addr) {
+	add_string_ref (eb->core, addr);
+	if (eb->log) {
+		r_strbuf_appendf (eb->log, "s 0x%"PFMT64x"\n", addr);
+	}
+}
+
+static void esilbreak_bits(EsilBreak *eb, ut64 addr, int bits) {
+	r_anal_hint_set_bits (eb->core->anal, addr, bits);
+	if (eb->log) {
+		r_strbuf_appendf (eb->log, "b 0x%"PFMT64x" %d\n", addr, bits);
+	}
+}
+
+static void esilbreak_syscall(EsilBreak *eb, ut64 addr, int snv) {
+	RCore *core = eb->core;
+	RSyscallItem *si = r_syscall_get (core->anal->syscall, snv, eb->in);
+	r_flag_space_set (core->flags, "syscalls");
+	if (si) {
+	//	eprintf ("0x%08"PFMT64x" SYSCALL %-4d %s\n", addr, snv, si->name);
+		r_flag_set_next (core->flags, sdb_fmt ("syscall.%s", si->name), addr, 1);
+	} else {
+	//	eprintf ("0x%08"PFMT64x" SYSCALL %d\n", addr, snv);
+		r_flag_set_next (core->flags, sdb_fmt ("syscall.%d", snv), addr, 1);
+	}
+	r_flag_space_set (core->flags, NULL);
+	if (eb->log) {
+		r_strbuf_appendf (eb->log, "y 0x%"PFMT64x" %d\n", addr, snv);
+	}
+}
+
+static void esilbreak_comment(EsilBreak *eb, ut64 addr, ut64 dst) {
+	RCore *core = eb->core;
+	RFlagItem *f;
+	char *str;
+	if ((f = r_flag_get_i2 (core->flags, dst))) {
+		r_meta_set_string (core->anal, R_META_TYPE_COMMENT, addr, f->name);
+	} else if ((str = is_string_at (core, dst, NULL))) {
+		char *str2 = sdb_fmt ("esilref: '%s'", str);
+		// HACK avoid format string inside string used later as format
+		// string crashes disasm inside agf under some conditions.
+		// https://github.com/radare/radare2/issues/6937
+		r_str_replace_char (str2, '%', '&');
+		r_meta_set_string (core->anal, R_META_TYPE_COMMENT, addr, str2);
+		free (str);
+	}
+	if (eb->log) {
+		r_strbuf_appendf (eb->log, "c 0x%"PFMT64x" 0x%"PFMT64x"\n", addr, dst);
+	}
+}
+
+static void esilbreak_replay(EsilBreak *eb, char *log) {
+	char *p, *nl;
+	for (p = log; p && *p; p = nl) {
+		ut64 a, b;
+		char type;
+		int n;
+		if ((nl = strchr (p, '\n'))) {
+			*nl++ = 0;
+		}
+		switch (*p) {
+		case 'x':
+			if (sscanf (p + 1, " 0x%"PFMT64x" 0x%"PFMT64x" %c", &a, &b, &type) == 3) {
+				esilbreak_ref (eb, a, b, type);
+			}
+			break;
+		case 's':
+			if (sscanf (p + 1, " 0x%"PFMT64x, &a) == 1) {
+				esilbreak_string (eb, a);
+			}
+			break;
+		case 'b':
+			if (sscanf (p + 1, " 0x%"PFMT64x" %d", &a, &n) == 2) {
+				esilbreak_bits (eb, a, n);
+			}
+			break;
+		case 'y':
+			if (sscanf (p + 1, " 0x%"PFMT64x" %d", &a, &n) == 2) {
+				esilbreak_syscall (eb, a, n);
+			}
+			break;
+		case 'c':
+			if (sscanf (p + 1, " 0x%"PFMT64x" 0x%"PFMT64x, &a, &b) == 2) {
+				esilbreak_comment (eb, a, b);
+			}
+			break;
+		}
+	}
+}
+
 static int esilbreak_mem_write(RAnalEsil *esil, ut64 addr, const ut8 *buf, int len) {
 	/* do nothing */
 	return 1;
 }
 
-/* TODO: move into RCore? */
-static ut64 esilbreak_last_read = UT64_MAX;
-static ut64 esilbreak_last_data = UT64_MAX;
-
-static ut64 ntarget = UT64_MAX;
-
 // TODO differentiate endian-aware mem_read with other reads; move ntarget handling to another function
 static int esilbreak_mem_read(RAnalEsil *esil, ut64 addr, ut8 *buf, int len) {
+	EsilBreak *eb = esil->user;
+	RCore *core = eb->core;
 	ut8 str[128];
 	if (addr != UT64_MAX) {
-		esilbreak_last_read = addr;
+		eb->last_read = addr;
 	}
-	if (myvalid (mycore->io, addr) && r_io_read_at (mycore->io, addr, (ut8*)buf, len)) {
+	if (myvalid (core->io, addr) && r_io_read_at (core->io, addr, (ut8*)buf, len)) {
 		ut64 refptr;
 		bool trace = true;
 		switch (len) {
 		case 2:
-			esilbreak_last_data = refptr = (ut64)r_read_ble16 (buf, esil->anal->big_endian);
+			eb->last_data = refptr = (ut64)r_read_ble16 (buf, esil->anal->big_endian);
 			break;
 		case 4:
-			esilbreak_last_data = refptr = (ut64)r_read_ble32 (buf, esil->anal->big_endian);
+			eb->last_data = refptr = (ut64)r_read_ble32 (buf, esil->anal->big_endian);
 			break;
 		case 8:
-			esilbreak_last_data = refptr = r_read_ble64 (buf, esil->anal->big_endian);
+			eb->last_data = refptr = r_read_ble64 (buf, esil->anal->big_endian);
 			break;
 		default:
 			trace = false;
-			r_io_read_at (mycore->io, addr, (ut8*)buf, len);
+			r_io_read_at (core->io, addr, (ut8*)buf, len);
 			break;
 		}
 
 		// TODO incorrect
 		bool validRef = false;
-		if (trace && myvalid (mycore->io, refptr)) {
-			if (ntarget == UT64_MAX || ntarget == refptr) {
-				r_anal_xrefs_set (mycore->anal, esil->address, refptr, R_ANAL_REF_TYPE_DATA);
+		if (trace && myvalid (core->io, refptr)) {
+			if (eb->ntarget == UT64_MAX || eb->ntarget == refptr) {
+				esilbreak_ref (eb, esil->address, refptr, R_ANAL_REF_TYPE_DATA);
 				str[0] = 0;
-				if (r_io_read_at (mycore->io, refptr, str, sizeof (str)) < 1) {
+				if (r_io_read_at (core->io, refptr, str, sizeof (str)) < 1) {
 					eprintf ("Invalid read\n");
 					str[0] = 0;
 				}
 				str[sizeof (str) - 1] = 0;
-				add_string_ref (mycore, refptr);
-				esilbreak_last_data = UT64_MAX;
+				esilbreak_string (eb, refptr);
+				eb->last_data = UT64_MAX;
 				validRef = true;
 			}
 		}
 
 		/** resolve ptr */
-		if (ntarget == UT64_MAX || ntarget == addr || (ntarget == UT64_MAX && !validRef)) {
-			r_anal_xrefs_set (mycore->anal, esil->address, addr, R_ANAL_REF_TYPE_DATA);
+		if (eb->ntarget == UT64_MAX || eb->ntarget == addr || (eb->ntarget == UT64_MAX && !validRef)) {
+			esilbreak_ref (eb, esil->address, addr, R_ANAL_REF_TYPE_DATA);
 		}
 	}
 	return 0; // fallback
 }
 
-static bool esil_anal_stop = false;
 static void cccb(void *u) {
-	esil_anal_stop = true;
+	EsilBreak *eb = u;
+	eb->stop = true;
 	eprintf ("^C\n");
 }
 
@@ -3767,8 +4350,9 @@ static int esilbreak_reg_write(RAnalEsil *esil, const char *name, ut64 *val) {
 	if (!esil) {
 		return 0;
 	}
+	EsilBreak *eb = esil->user;
 	anal = esil->anal;
-	op = esil->user;
+	op = eb->op;
 	//specific case to handle blx/bx cases in arm through emulation
 	// XXX this thing creates a lot of false positives
 	if (anal && anal->opt.armthumb) {
@@ -3781,12 +4365,12 @@ static int esilbreak_reg_write(RAnalEsil *esil, const char *name, ut64 *val) {
 			case 14: //ARM_INS_BLX
 			case 15: //ARM_INS_BX
 				if (!(*val & 1)) {
-					r_anal_hint_set_bits (anal, *val, 32);
+					esilbreak_bits (eb, *val, 32);
 				} else {
 					ut64 snv = r_reg_getv (anal->reg, "pc");
 					if (snv != UT32_MAX && snv != UT64_MAX) {
 						if (r_io_is_valid_offset (anal->iob.io, *val, 1)) {
-							r_anal_hint_set_bits (anal, *val - 1, 16);
+							esilbreak_bits (eb, *val - 1, 16);
 						}
 					}
 				}
@@ -3897,127 +4481,37 @@ static void getpcfromstack(RCore *core, RAnalEsil *esil) {
 	memcpy (esil, &esil_cpy, sizeof (esil_cpy));
 
  err_anal_op:
+	if (esil_cpy.progs != esil->progs) {
+		// the copy allocated its own program cache, dropped with it
+		r_anal_esil_prog_reset (&esil_cpy);
+		R_FREE (esil_cpy.progs);
+	}
 	r_anal_op_fini (&op);
 	free (buf);
 }
 
-R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
-	bool cfg_anal_strings = r_config_get_i (core->config, "anal.strings");
+#define CHECKREF(x) ((eb->refptr && x == eb->refptr) || !eb->refptr)
+
+// sweeps buf[from, to), the instructions can go up to buf[len]
+static void esilbreak_range(EsilBreak *eb, ut64 addr, const ut8 *buf, int from, int to, int len) {
+	RCore *core = eb->core;
 	RAnalEsil *ESIL = core->anal->esil;
-	ut64 refptr = 0LL;
-	const char *pcname;
-#if 0
-	RAsmOp asmop;
-#endif
 	RAnalOp op = R_EMPTY;
-	ut8 *buf = NULL;
-	bool end_address_set = false;
-	int i, iend;
-	int minopsize = 4; // XXX this depends on asm->mininstrsize
-	ut64 addr = core->offset;
-	ut64 end = 0LL;
+	int i, minopsize = 4; // XXX this depends on asm->mininstrsize
 	ut64 cur;
-
-	mycore = core;
-	if (!strcmp (str, "?")) {
-		eprintf ("Usage: aae[f] [len] [addr] - analyze refs in function, section or len bytes with esil\n");
-		eprintf ("  aae $SS @ $S             - analyze the whole section\n");
-		eprintf ("  aae $SS str.Hello @ $S   - find references for str.Hellow\n");
-		return;
-	}
-#define CHECKREF(x) ((refptr && x == refptr) || !refptr)
-	if (target) {
-		const char *expr = r_str_trim_ro (target);
-		if (*expr) {
-			refptr = ntarget = r_num_math (core->num, expr);
-			if (!refptr) {
-				ntarget = refptr = addr;
-			}
-		} else {
-			ntarget = UT64_MAX;
-			refptr = 0LL;
-		}
-	} else {
-		ntarget = UT64_MAX;
-		refptr = 0LL;
-	}
-	if (!strcmp (str, "f")) {
-		RAnalFunction *fcn = r_anal_get_fcn_in (core->anal, core->offset, 0);
-		if (fcn) {
-			addr = fcn->addr;
-			end = fcn->addr + r_anal_fcn_size (fcn);
-			end_address_set = true;
-		}
-	}
-
-	if (!end_address_set) {
-		if (str[0] == ' ') {
-			end = addr + r_num_math (core->num, str + 1);
-		} else {
-			RIOSection *sect = r_io_section_vget (core->io, addr);
-			if (sect) {
-				end = sect->vaddr + sect->size;
-			} else {
-				end = addr + core->blocksize;
-			}
-		}
-	}
-
-	iend = end - addr;
-	if (iend < 0) {
-		return;
-	}
-	buf = malloc (iend + 2);
-	if (!buf) {
-		perror ("malloc");
-		return;
-	}
-	esilbreak_last_read = UT64_MAX;
-	r_io_read_at (core->io, addr, buf, iend + 1);
-	if (!ESIL) {
-		r_core_cmd0 (core, "aei");
-		ESIL = core->anal->esil;
-		if (!ESIL) {
-			eprintf ("ESIL not initialized\n");
-			return;
-		}
-	}
-	ESIL->cb.hook_reg_write = &esilbreak_reg_write;
-	//this is necessary for the hook to read the id of analop
-	ESIL->user = &op;
-	ESIL->cb.hook_mem_read = &esilbreak_mem_read;
-	ESIL->cb.hook_mem_write = &esilbreak_mem_write;
-	//eprintf ("Analyzing ESIL refs from 0x%"PFMT64x" - 0x%"PFMT64x"\n", addr, end);
-	// TODO: backup/restore register state before/after analysis
-	pcname = r_reg_get_name (core->anal->reg, R_REG_NAME_PC);
-	if (!pcname || !*pcname) {
-		eprintf ("Cannot find program counter register in the current profile.\n");
-		return;
-	}
-	esil_anal_stop = false;
-	r_cons_break_push (cccb, core);
-
-	int arch = -1;
-	if (core->anal->bits == 64 && !strcmp (core->anal->cur->arch, "arm")) {
-		arch = R2_ARCH_ARM64;
-	}
-
-	int opalign = r_anal_archinfo (core->anal, R_ANAL_ARCHINFO_ALIGN);
-	int in = r_syscall_get_swi (core->anal->syscall);
-	const char *sn = r_reg_get_name (core->anal->reg, R_REG_NAME_SN);
-	r_reg_arena_push (core->anal->reg);
-	for (i = 0; i < iend; i++) {
-		if (esil_anal_stop || r_cons_is_breaked ()) {
+	eb->op = &op;
+	for (i = from; i < to; i++) {
+		if (eb->stop || r_cons_is_breaked ()) {
 			break;
 		}
 		cur = addr + i;
 		/* realign address if needed */
-		if (opalign > 0) {
-			cur -= (cur % opalign);
+		if (eb->opalign > 0) {
+			cur -= (cur % eb->opalign);
 		}
 		r_anal_op_fini (&op);
 		r_asm_set_pc (core->assembler, cur);
-		if (!r_anal_op (core->anal, &op, cur, buf + i, iend - i, R_ANAL_OP_MASK_ALL)) {
+		if (!r_anal_op (core->anal, &op, cur, buf + i, len - i, R_ANAL_OP_MASK_ALL)) {
 			i += minopsize - 1;
 		}
 		// if (op.type & 0x80000000 || op.type == 0) {
@@ -4027,7 +4521,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 		}
 		//we need to check again i because buf+i may goes beyond its boundaries
 		//because of i+= minopsize - 1
-		if (i > iend) {
+		if (i > len) {
 			break;
 		}
 		if (op.size < 1) {
@@ -4036,19 +4530,10 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 		}
 		switch (op.type) {
 		case R_ANAL_OP_TYPE_SWI:
-			if (!refptr && (in == -1 || op.val == in)) {
-				r_flag_space_set (core->flags, "syscalls");
-				int snv = (int)r_reg_getv (core->anal->reg, sn);
+			if (!eb->refptr && (eb->in == -1 || op.val == eb->in)) {
+				int snv = (int)r_reg_getv (core->anal->reg, eb->sn);
 				if (snv > 0) {
-					RSyscallItem *si = r_syscall_get (core->anal->syscall, snv, in);
-					if (si) {
-					//	eprintf ("0x%08"PFMT64x" SYSCALL %-4d %s\n", cur, snv, si->name);
-						r_flag_set_next (core->flags, sdb_fmt ("syscall.%s", si->name), cur, 1);
-					} else {
-					//	eprintf ("0x%08"PFMT64x" SYSCALL %d\n", cur, snv);
-						r_flag_set_next (core->flags, sdb_fmt ("syscall.%d", snv), cur, 1);
-					}
-					r_flag_space_set (core->flags, NULL);
+					esilbreak_syscall (eb, cur, snv);
 				}
 			}
 			break;
@@ -4067,22 +4552,22 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 			switch (op.type) {
 			case R_ANAL_OP_TYPE_LEA:
 				// arm64
-				if (core->anal->cur && arch == R2_ARCH_ARM64) {
+				if (core->anal->cur && eb->arch == R2_ARCH_ARM64) {
 					if (CHECKREF (ESIL->cur)) {
-						r_anal_xrefs_set (core->anal, cur, ESIL->cur, R_ANAL_REF_TYPE_STRING);
+						esilbreak_ref (eb, cur, ESIL->cur, R_ANAL_REF_TYPE_STRING);
 					}
-				} else if ((target && op.ptr == ntarget) || !target) {
+				} else if ((eb->target && op.ptr == eb->ntarget) || !eb->target) {
 			//		if (core->anal->cur && strcmp (core->anal->cur->arch, "arm")) {
 					if (CHECKREF (ESIL->cur)) {
 						if (op.ptr && r_io_is_valid_offset (core->io, op.ptr, !core->anal->opt.noncode)) {
-							r_anal_xrefs_set (core->anal, cur, op.ptr, R_ANAL_REF_TYPE_STRING);
+							esilbreak_ref (eb, cur, op.ptr, R_ANAL_REF_TYPE_STRING);
 						} else {
-							r_anal_xrefs_set (core->anal, cur, ESIL->cur, R_ANAL_REF_TYPE_STRING);
+							esilbreak_ref (eb, cur, ESIL->cur, R_ANAL_REF_TYPE_STRING);
 						}
 					}
 				}
-				if (cfg_anal_strings) {
-					add_string_ref (core, op.ptr);
+				if (eb->strings) {
+					esilbreak_string (eb, op.ptr);
 				}
 				break;
 			case R_ANAL_OP_TYPE_ADD:
@@ -4090,13 +4575,13 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 				if (core->anal->cur && !strcmp (core->anal->cur->arch, "arm")) {
 					/* This code is known to work on Thumb, ARM and ARM64 */
 					ut64 dst = ESIL->cur;
-					if ((target && dst == ntarget) || !target) {
+					if ((eb->target && dst == eb->ntarget) || !eb->target) {
 						if (CHECKREF (dst)) {
-							r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_DATA);
+							esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_DATA);
 						}
 					}
-				//	if (cfg_anal_strings) {
-						add_string_ref (core, dst);
+				//	if (eb->strings) {
+						esilbreak_string (eb, dst);
 				//	}
 				} else if ((core->anal->bits == 32 && core->anal->cur && !strcmp (core->anal->cur->arch, "mips"))) {
 					ut64 dst = ESIL->cur;
@@ -4109,26 +4594,14 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					if (!strcmp (op.src[0]->reg->name, "zero")) {
 						break;
 					}
-					if ((target && dst == ntarget) || !target) {
-						if (dst > 0xffff && op.src[1] && (dst & 0xffff) == (op.src[1]->imm & 0xffff) && myvalid (mycore->io, dst)) {
-							RFlagItem *f;
-							char *str;
+					if ((eb->target && dst == eb->ntarget) || !eb->target) {
+						if (dst > 0xffff && op.src[1] && (dst & 0xffff) == (op.src[1]->imm & 0xffff) && myvalid (core->io, dst)) {
 							if (CHECKREF (dst) || CHECKREF (cur)) {
-								r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_DATA);
-								if (cfg_anal_strings) {
-									add_string_ref (core, dst);
-								}
-								if ((f = r_flag_get_i2 (core->flags, dst))) {
-									r_meta_set_string (core->anal, R_META_TYPE_COMMENT, cur, f->name);
-								} else if ((str = is_string_at (mycore, dst, NULL))) {
-									char *str2 = sdb_fmt ("esilref: '%s'", str);
-									// HACK avoid format string inside string used later as format
-									// string crashes disasm inside agf under some conditions.
-									// https://github.com/radare/radare2/issues/6937
-									r_str_replace_char (str2, '%', '&');
-									r_meta_set_string (core->anal, R_META_TYPE_COMMENT, cur, str2);
-									free (str);
+								esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_DATA);
+								if (eb->strings) {
+									esilbreak_string (eb, dst);
 								}
+								esilbreak_comment (eb, cur, dst);
 							}
 						}
 					}
@@ -4136,21 +4609,21 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 				break;
 			case R_ANAL_OP_TYPE_LOAD:
 				{
-					ut64 dst = esilbreak_last_read;
+					ut64 dst = eb->last_read;
 					if (dst != UT64_MAX && CHECKREF (dst)) {
-						if (myvalid (mycore->io, dst)) {
-							r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_DATA);
-							if (cfg_anal_strings) {
-								add_string_ref (core, dst);
+						if (myvalid (core->io, dst)) {
+							esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_DATA);
+							if (eb->strings) {
+								esilbreak_string (eb, dst);
 							}
 						}
 					}
-					dst = esilbreak_last_data;
+					dst = eb->last_data;
 					if (dst != UT64_MAX && CHECKREF (dst)) {
-						if (myvalid (mycore->io, dst)) {
-							r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_DATA);
-							if (cfg_anal_strings) {
-								add_string_ref (core, dst);
+						if (myvalid (core->io, dst)) {
+							esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_DATA);
+							if (eb->strings) {
+								esilbreak_string (eb, dst);
 							}
 						}
 					}
@@ -4161,7 +4634,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					ut64 dst = op.jump;
 					if (CHECKREF (dst)) {
 						if (myvalid (core->io, dst)) {
-							r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_CODE);
+							esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_CODE);
 						}
 					}
 				}
@@ -4171,7 +4644,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 					ut64 dst = op.jump;
 					if (CHECKREF (dst)) {
 						if (myvalid (core->io, dst)) {
-							r_anal_xrefs_set (core->anal, cur, dst, R_ANAL_REF_TYPE_CALL);
+							esilbreak_ref (eb, cur, dst, R_ANAL_REF_TYPE_CALL);
 						}
 						ESIL->old = cur + op.size;
 						getpcfromstack (core, ESIL);
@@ -4185,9 +4658,9 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 			case R_ANAL_OP_TYPE_IRCALL:
 			case R_ANAL_OP_TYPE_MJMP:
 				{
-					ut64 dst = core->anal->esil->jump_target;
+					ut64 dst = ESIL->jump_target;
 					if (dst == UT64_MAX) {
-						dst = r_reg_getv (core->anal->reg, pcname);
+						dst = r_reg_getv (core->anal->reg, eb->pcname);
 					}
 					if (CHECKREF (dst)) {
 						if (myvalid (core->io, dst)) {
@@ -4195,7 +4668,7 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 								(op.type & R_ANAL_OP_TYPE_MASK) == R_ANAL_OP_TYPE_UCALL
 								? R_ANAL_REF_TYPE_CALL
 								: R_ANAL_REF_TYPE_CODE;
-							r_anal_xrefs_set (core->anal, cur, dst, ref);
+							esilbreak_ref (eb, cur, dst, ref);
 						}
 					}
 				}
@@ -4204,12 +4677,180 @@ R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
 			r_anal_esil_stack_free (ESIL);
 		}
 	}
-	free (buf);
 	r_anal_op_fini (&op);
+	eb->op = NULL;
+}
+
+// With anal.threads > 1 the range is split at function starts between the
+// workers. Each one sweeps its part from the registers the range starts
+// with, so a part doesn't see the values left by the code before it.
+typedef struct {
+	EsilBreak *eb;
+	ut64 addr;
+	const ut8 *buf;
+	int len;
+	int *bounds; // nworkers + 1 offsets in buf
+} EsilBreakWork;
+
+static void esilbreak_worker(RCore *core, void *user, int worker, int nworkers, RStrBuf *log) {
+	EsilBreakWork *w = user;
+	w->eb->log = log;
+	esilbreak_range (w->eb, w->addr, w->buf, w->bounds[worker], w->bounds[worker + 1], w->len);
+}
+
+static void esilbreak_merge(RCore *core, void *user, int worker, int nworkers, char *log) {
+	EsilBreakWork *w = user;
+	if (log) {
+		esilbreak_replay (w->eb, log);
+	} else {
+		esilbreak_range (w->eb, w->addr, w->buf, w->bounds[worker], w->bounds[worker + 1], w->len);
+	}
+}
+
+static bool esilbreak_parallel(EsilBreak *eb, ut64 addr, const ut8 *buf, int len, int nworkers) {
+	RAnalFunction *fcn;
+	RListIter *iter;
+	RVector starts;
+	int i, n = 0;
+	bool ret = false;
+	r_vector_init (&starts, sizeof (ut64), NULL, NULL);
+	r_list_foreach (eb->core->anal->fcns, iter, fcn) {
+		if (fcn->addr > addr && fcn->addr < addr + len) {
+			r_vector_push (&starts, &fcn->addr);
+		}
+	}
+	int *bounds = calloc (nworkers + 1, sizeof (int));
+	if (!bounds || !starts.len) {
+		goto beach;
+	}
+	qsort (starts.a, starts.len, sizeof (ut64), addr_cmp);
+	// a part ends at the first function after its share of the bytes
+	size_t j = 0;
+	for (i = 1; i < nworkers && j < starts.len; i++) {
+		ut64 at = addr + (ut64)len * i / nworkers;
+		while (j < starts.len && *(ut64 *)r_vector_index_ptr (&starts, j) < at) {
+			j++;
+		}
+		if (j < starts.len) {
+			bounds[++n] = (int)(*(ut64 *)r_vector_index_ptr (&starts, j++) - addr);
+		}
+	}
+	bounds[++n] = len;
+	if (n > 1) {
+		EsilBreakWork w = { eb, addr, buf, len, bounds };
+		ret = r_core_anal_workers (eb->core, n, esilbreak_worker, esilbreak_merge, &w);
+	}
+beach:
+	free (bounds);
+	r_vector_clear (&starts);
+	return ret;
+}
+
+R_API void r_core_anal_esil(RCore *core, const char *str, const char *target) {
+	RAnalEsil *ESIL = core->anal->esil;
+	EsilBreak eb = { core };
+	ut8 *buf = NULL;
+	bool end_address_set = false;
+	int iend;
+	ut64 addr = core->offset;
+	ut64 end = 0LL;
+
+	if (!strcmp (str, "?")) {
+		eprintf ("Usage: aae[f] [len] [addr] - analyze refs in function, section or len bytes with esil\n");
+		eprintf ("  aae $SS @ $S             - analyze the whole section\n");
+		eprintf ("  aae $SS str.Hello @ $S   - find references for str.Hellow\n");
+		return;
+	}
+	eb.strings = r_config_get_i (core->config, "anal.strings");
+	eb.target = target != NULL;
+	eb.ntarget = UT64_MAX;
+	if (target) {
+		const char *expr = r_str_trim_ro (target);
+		if (*expr) {
+			eb.refptr = eb.ntarget = r_num_math (core->num, expr);
+			if (!eb.refptr) {
+				eb.ntarget = eb.refptr = addr;
+			}
+		}
+	}
+	if (!strcmp (str, "f")) {
+		RAnalFunction *fcn = r_anal_get_fcn_in (core->anal, core->offset, 0);
+		if (fcn) {
+			addr = fcn->addr;
+			end = fcn->addr + r_anal_fcn_size (fcn);
+			end_address_set = true;
+		}
+	}
+
+	if (!end_address_set) {
+		if (str[0] == ' ') {
+			end = addr + r_num_math (core->num, str + 1);
+		} else {
+			RIOSection *sect = r_io_section_vget (core->io, addr);
+			if (sect) {
+				end = sect->vaddr + sect->size;
+			} else {
+				end = addr + core->blocksize;
+			}
+		}
+	}
+
+	iend = end - addr;
+	if (iend < 0) {
+		return;
+	}
+	if (!ESIL) {
+		r_core_cmd0 (core, "aei");
+		ESIL = core->anal->esil;
+		if (!ESIL) {
+			eprintf ("ESIL not initialized\n");
+			return;
+		}
+	}
+	//eprintf ("Analyzing ESIL refs from 0x%"PFMT64x" - 0x%"PFMT64x"\n", addr, end);
+	// TODO: backup/restore register state before/after analysis
+	eb.pcname = r_reg_get_name (core->anal->reg, R_REG_NAME_PC);
+	if (!eb.pcname || !*eb.pcname) {
+		eprintf ("Cannot find program counter register in the current profile.\n");
+		return;
+	}
+	buf = malloc (iend + 2);
+	if (!buf) {
+		perror ("malloc");
+		return;
+	}
+	eb.last_read = UT64_MAX;
+	eb.last_data = UT64_MAX;
+	r_io_read_at (core->io, addr, buf, iend + 1);
+	// the hooks only live for this run
+	RAnalEsilCallbacks cb = ESIL->cb;
+	void *user = ESIL->user;
+	ESIL->cb.hook_reg_write = &esilbreak_reg_write;
+	ESIL->cb.hook_mem_read = &esilbreak_mem_read;
+	ESIL->cb.hook_mem_write = &esilbreak_mem_write;
+	ESIL->user = &eb;
+	r_cons_break_push (cccb, &eb);
+
+	eb.arch = -1;
+	if (core->anal->bits == 64 && !strcmp (core->anal->cur->arch, "arm")) {
+		eb.arch = R2_ARCH_ARM64;
+	}
+	eb.opalign = r_anal_archinfo (core->anal, R_ANAL_ARCHINFO_ALIGN);
+	eb.in = r_syscall_get_swi (core->anal->syscall);
+	eb.sn = r_reg_get_name (core->anal->reg, R_REG_NAME_SN);
+	r_reg_arena_push (core->anal->reg);
+	int threads = r_config_get_i (core->config, "anal.threads");
+	if (threads < 2 || !esilbreak_parallel (&eb, addr, buf, iend, threads)) {
+		esilbreak_range (&eb, addr, buf, 0, iend, iend);
+	}
+	free (buf);
 	r_cons_break_pop ();
+	ESIL->cb = cb;
+	ESIL->user = user;
 	// restore register
 	r_reg_arena_pop (core->anal->reg);
 }
+#undef CHECKREF
 
 typedef struct {
 	dict visited;
@@ -155,6 +155,10 @@ R_API RBinFile * r_core_bin_cur(RCore *core) {
 	return binfile;
 }
 
+static void meta_str_free(void *e, void *user) {
+	free (((RAnalMetaItem *)e)->str);
+}
+
 static void _print_strings(RCore *r, RList *list, int mode, int va) {
 	bool b64str = r_config_get_i (r->config, "bin.b64str");
 	int minstr = r_config_get_i (r->config, "bin.minstr");
@@ -165,8 +169,10 @@ static void _print_strings(RCore *r, RList *list, int mode, int va) {
 	RListIter *last_processed = NULL;
 	RBinString *string;
 	RBinSection *section;
+	RVector metas;
 	char *q;
 
+	r_vector_init (&metas, sizeof (RAnalMetaItem), meta_str_free, NULL);
 	bin->minstrlen = minstr;
 	bin->maxstrlen = maxstr;
 	if (IS_MODE_JSON (mode)) {
@@ -215,7 +221,10 @@ static void _print_strings(RCore *r, RList *list, int mode, int va) {
 			if (r_cons_is_breaked ()) {
 				break;
 			}
-			r_meta_add (r->anal, R_META_TYPE_STRING, addr, addr + string->size, string->string);
+			// added at once after the loop
+			RAnalMetaItem mi = { addr, addr + string->size, string->size,
+				R_META_TYPE_STRING, 0, strdup (string->string) };
+			r_vector_push (&metas, &mi);
 			f_name = strdup (string->string);
 			r_name_filter (f_name, -1);
 			if (r->bin->prefix) {
@@ -365,8 +374,10 @@ static void _print_strings(RCore *r, RList *list, int mode, int va) {
 		r_cons_printf ("]");
 	}
 	if (IS_MODE_SET (mode)) {
+		r_meta_import (r->anal, metas.a, metas.len);
 		r_cons_break_pop ();
 	}
+	r_vector_clear (&metas);
 }
 
 static bool bin_raw_strings(RCore *r, int mode, int va) {
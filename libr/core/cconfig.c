@@ -218,6 +218,13 @@ static int cb_analvars(void *user, void *data) {
         return true;
 }
 
+static int cb_analopcache(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	r_anal_op_cache_enable (core->anal, node->i_value);
+	return true;
+}
+
 static int cb_analstrings(void *user, void *data) {
 	RCore *core = (RCore*) user;
 	RConfigNode *node = (RConfigNode*) data;
@@ -1253,6 +1260,24 @@ static int cb_esilverbose (void *user, void *data) {
 	return true;
 }
 
+static int cb_esiljit(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode*) data;
+	if (core->anal->esil) {
+		core->anal->esil->jit = node->i_value;
+	}
+	return true;
+}
+
+static int cb_esiltracespill(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode*) data;
+	if (core->anal->esil) {
+		return r_anal_esil_trace_spill (core->anal->esil, node->value);
+	}
+	return true;
+}
+
 static int cb_esilstackdepth (void *user, void *data) {
 	RConfigNode *node = (RConfigNode*) data;
 	if (node->i_value < 3) {
@@ -1596,6 +1621,57 @@ static int cb_ioff(void *user, void *data) {
 	return true;
 }
 
+static int cb_iozindex(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	core->io->zindex = node->i_value;
+	return true;
+}
+
+static int cb_ioprof(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	r_io_prof_enable (core->io, node->i_value);
+	return true;
+}
+
+static int cb_ioundowrite(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	core->io->undo.w_enable = node->i_value;
+	return true;
+}
+
+static int cb_ioundosize(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	r_io_wundo_set_limit (core->io, node->i_value);
+	return true;
+}
+
+static int cb_iorcache(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	r_io_rcache_enable (core->io, node->i_value);
+	return true;
+}
+
+static int cb_iorcache_bsize(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	if (!r_io_rcache_setup (core->io, (ut32)node->i_value, core->io->rcache.pages)) {
+		eprintf ("io.rcache.bsize must be a power of two\n");
+		return false;
+	}
+	return true;
+}
+
+static int cb_iorcache_pages(void *user, void *data) {
+	RCore *core = (RCore *) user;
+	RConfigNode *node = (RConfigNode *) data;
+	return r_io_rcache_setup (core->io, core->io->rcache.bsize, (ut32)node->i_value);
+}
+
 static int cb_io_oxff(void *user, void *data) {
 	RCore *core = (RCore *) user;
 	RConfigNode *node = (RConfigNode *) data;
@@ -2326,6 +2402,9 @@ R_API int r_core_config_init(RCore *core) {
 			"dbg.maps", "dbg.maps.exec", "dbg.maps.write", "dbg.maps.readonly",
 			"anal.fcn", "anal.bb", NULL);
 	SETI ("anal.timeout", 0, "Stop analyzing after a couple of seconds");
+	SETCB ("anal.opcache", "false", &cb_analopcache, "Cache the decoded instructions (see aoc)");
+	SETPREF ("anal.reanal", "true", "Analyze again the functions patched after each w command, other writes wait for the next one or aaw");
+	SETI ("anal.threads", 1, "Number of workers used by aa, aae and aaft");
 
 	SETCB ("anal.armthumb", "false", &cb_analarmthumb, "aae computes arm/thumb changes (lot of false positives ahead)");
 	SETCB ("anal.eobjmp", "false", &cb_analeobjmp, "jmp is end of block mode (option)");
@@ -2389,6 +2468,8 @@ R_API int r_core_config_init(RCore *core) {
 	SETI ("esil.stack.addr", 0x100000, "Number of elements that can be pushed on the esilstack");
 	SETPREF ("esil.stack.pattern", "0", "Specify fill pattern to initialize the stack (0, w, d, i)");
 	SETI ("esil.addr.size", 64, "Maximum address size in accessed by the ESIL VM");
+	SETCB ("esil.jit", "false", &cb_esiljit, "Translate the esil of the instructions run often to avoid the stack and the register lookups");
+	SETCB ("esil.trace.spill", "", &cb_esiltracespill, "File where the oldest esil trace events are lz4 compressed instead of dropped");
 	SETPREF ("esil.breakoninvalid", "false", "Break esil execution when instruction is invalid");
 
 	/* asm */
@@ -2933,6 +3014,13 @@ R_API int r_core_config_init(RCore *core) {
 	SETCB ("io.pcache", "false", &cb_iopcache, "io.cache for p-level");
 	SETCB ("io.pcache.write", "false", &cb_iopcachewrite, "Enable write-cache");
 	SETCB ("io.pcache.read", "false", &cb_iopcacheread, "Enable read-cache");
+	SETCB ("io.prof", "false", &cb_ioprof, "Time and count the reads and writes of the io backends (see oP)");
+	SETCB ("io.rcache", "false", &cb_iorcache, "Cache backend reads in pages (for slow remote and debugger io plugins)");
+	SETICB ("io.rcache.bsize", 0x1000, &cb_iorcache_bsize, "Page size of the io.rcache (power of two)");
+	SETICB ("io.rcache.pages", 256, &cb_iorcache_pages, "Maximum number of pages kept in the io.rcache");
+	SETCB ("io.undo.write", "false", &cb_ioundowrite, "Journal the writes so they can be undone (see uW)");
+	SETICB ("io.undo.size", 64 * 1024 * 1024, &cb_ioundosize, "Memory cap of the write journal, oldest writes are forgotten first (0 for none)");
+	SETCB ("io.zindex", "false", &cb_iozindex, "Save and reuse the random access index of gzip/zip files in a .zidx file beside them");
 	SETCB ("io.ff", "true", &cb_ioff, "Fill invalid buffers with 0xff instead of returning error");
 	SETPREF("io.exec", "true", "See !!r2 -h~-x");
 	SETICB ("io.0xff", 0xff, &cb_io_oxff, "Use this value instead of 0xff to fill unallocated areas");
@@ -258,6 +258,9 @@ beach:
 static void choose_bits_anal_hints(RCore *core, ut64 addr, int *bits) {
 	RAnalRange *range;
 	RListIter *iter;
+	if ((*bits = r_anal_hint_bits_at (core->anal, addr))) {
+		return;
+	}
 	r_list_foreach (core->anal->bits_ranges, iter, range) {
 		if (addr >= range->from && addr < range->to) {
 			*bits = range->bits;
@@ -234,6 +234,11 @@ static const char *help_msg_u[] = {
 	"uw", "", "alias for wc (requires: e io.cache=true)",
 	"us", "", "alias for s- (seek history)",
 	"uc", "", "undo core commands (uc?, ucl, uc*, ..)",
+	"uW", "", "list the write journal (requires: e io.undo.write=true)",
+	"uW.", "", "list the journaled writes touching the current block",
+	"uW-", "", "undo the last write",
+	"uW+", "", "redo the last undone write",
+	"uW!", "", "forget all the journaled writes",
 	NULL
 };
 
@@ -346,6 +351,56 @@ R_API RAsmOp *r_core_disassemble (RCore *core, ut64 addr) {
 	return op;
 }
 
+static void cmd_uname_wundo(RCore *core, const char *input) {
+	RListIter *iter;
+	RIOUndoWrite *u, *found = NULL;
+	RList *list;
+	switch (*input) {
+	case '.': // "uW."
+		list = r_io_wundo_at (core->io, core->offset, core->blocksize);
+		r_list_foreach (list, iter, u) {
+			r_cons_printf ("%c %d 0x%08"PFMT64x"\n", u->set? '+': '-', u->len, u->off);
+		}
+		r_list_free (list);
+		break;
+	case '-': // "uW-"
+		r_list_foreach_prev (core->io->undo.w_list, iter, u) {
+			if (u->set) {
+				found = u;
+				break;
+			}
+		}
+		if (found) {
+			r_io_wundo_apply (core->io, found, false);
+		} else {
+			eprintf ("Nothing to undo\n");
+		}
+		break;
+	case '+': // "uW+"
+		r_list_foreach (core->io->undo.w_list, iter, u) {
+			if (!u->set) {
+				found = u;
+				break;
+			}
+		}
+		if (found) {
+			r_io_wundo_apply (core->io, found, true);
+		} else {
+			eprintf ("Nothing to redo\n");
+		}
+		break;
+	case '!': // "uW!"
+		r_io_wundo_clear (core->io);
+		break;
+	case '?':
+		r_core_cmd_help (core, help_msg_u);
+		break;
+	default:
+		r_io_wundo_list (core->io);
+		break;
+	}
+}
+
 static int cmd_uname(void *data, const char *input) {
 	RCore *core = data;
 	switch (input[0]) {
@@ -399,6 +454,10 @@ static int cmd_uname(void *data, const char *input) {
 	case 'w': // "uw"
 		r_core_cmdf (data, "wc%s", input + 1);
 		return 1;
+	case 'W': // "uW"
+		cmd_uname_wundo (core, input + 1);
+		r_core_block_read (core);
+		return 1;
 	}
 #if __UNIX__
 	struct utsname un;
@@ -1925,7 +1984,11 @@ static int r_core_cmd_subst(RCore *core, char *cmd) {
 		}
 		char *cr = strdup (cmdrep);
 		core->break_loop = false;
+		// io.prof accounts the backend accesses to the innermost command
+		const char *ocmd = core->io->prof.cmd;
+		core->io->prof.cmd = cmd;
 		ret = r_core_cmd_subst_i (core, cmd, colon, (rep == orep - 1) ? &tmpseek : NULL);
+		core->io->prof.cmd = ocmd;
 		if (ret && *cmd == 'q') {
 			free (cr);
 			goto beach;
@@ -2919,18 +2982,9 @@ fail:
 	goto beach;
 }
 
-static int foreach_comment(void *user, const char *k, const char *v) {
+static int foreach_comment(void *user, RAnalMetaItem *mi) {
 	RAnalMetaUserItem *ui = user;
-	RCore *core = ui->anal->user;
-	const char *cmd = ui->user;
-	if (!strncmp (k, "meta.C.", 7)) {
-		char *cmt = (char *)sdb_decode (v, 0);
-		if (!cmt) cmt = strdup ("");
-		//eprintf ("--> %s = %s\n", k + 7, cmt);
-		r_core_cmdf (core, "s %s", k + 7);
-		r_core_cmd0 (core, cmd);
-		free (cmt);
-	}
+	r_list_append (ui->user, r_str_newf ("0x%"PFMT64x, mi->from));
 	return 1;
 }
 
@@ -2968,7 +3022,17 @@ R_API int r_core_cmd_foreach3(RCore *core, const char *cmd, char *each) { // "@@
 		case 'a': // call
 			break;
 		default:
-			r_meta_list_cb (core->anal, R_META_TYPE_COMMENT, 0, foreach_comment, (void*)cmd, UT64_MAX);
+			{
+			// the command may edit the comments, so walk a copy of their addresses
+			char *addr;
+			list = r_list_newf (free);
+			r_meta_list_cb (core->anal, R_META_TYPE_COMMENT, 0, foreach_comment, list, UT64_MAX);
+			r_list_foreach (list, iter, addr) {
+				r_core_cmdf (core, "s %s", addr);
+				r_core_cmd0 (core, cmd);
+			}
+			r_list_free (list);
+			}
 			break;
 		}
 		break;
@@ -52,6 +52,7 @@ static const char *help_msg_aa[] = {
 	"aaT", " [len]", "analyze code after trap-sleds",
 	"aau", " [len]", "list mem areas (larger than len bytes) not covered by functions",
 	"aav", " [sat]", "find values referencing a specific section or map",
+	"aaw", "", "analyze again the functions patched since the last aaw (see anal.reanal)",
 	NULL
 };
 
@@ -446,6 +447,7 @@ static const char *help_msg_ah[] = {
 	"ah*", " offset", "list hints in radare commands format",
 	"aha", " ppc 51", "set arch for a range of N bytes",
 	"ahb", " 16 @ $$", "force 16bit for current instruction",
+	"ahb", " 16 0x100", "force 16bit for a range of N bytes",
 	"ahc", " 0x804804", "override call/jump address",
 	"ahe", " 3,eax,+=", "set vm analysis string",
 	"ahf", " 0x804840", "override fallback address for call",
@@ -483,6 +485,7 @@ static const char *help_msg_ao[] = {
 	"aom", " [id]", "list current or all mnemonics for current arch",
 	"aod", " [mnemonic]", "describe opcode for asm.arch",
 	"aoda", "", "show all mnemonic descriptions",
+	"aoc", "[j-]", "show the anal.opcache stats (aoc- drops the cached opcodes)",
 	"ao", " 5", "display opcode analysis of 5 opcodes",
 	"ao*", "", "display opcode in r commands",
 	NULL
@@ -675,16 +678,19 @@ static bool type_cmd_afta (RCore *core, RAnalFunction *fcn) {
 	r_core_cmd0 (core, "aei");
 	r_core_cmd0 (core, "aeim");
 	r_reg_arena_push (core->anal->reg);
-	// Iterating Reverse so that we get function in top-bottom call order
-	r_list_foreach_prev (core->anal->fcns, it, fcn) {
-		int ret = r_core_seek (core, fcn->addr, true);
-		if (!ret) {
-			continue;
-		}
-		r_anal_esil_set_pc (core->anal->esil, fcn->addr);
-		r_core_anal_type_match (core, fcn);
-		if (r_cons_is_breaked ()) {
-			break;
+	int threads = r_config_get_i (core->config, "anal.threads");
+	if (threads < 2 || !r_core_anal_type_match_parallel (core, threads)) {
+		// Iterating Reverse so that we get function in top-bottom call order
+		r_list_foreach_prev (core->anal->fcns, it, fcn) {
+			int ret = r_core_seek (core, fcn->addr, true);
+			if (!ret) {
+				continue;
+			}
+			r_anal_esil_set_pc (core->anal->esil, fcn->addr);
+			r_core_anal_type_match (core, fcn);
+			if (r_cons_is_breaked ()) {
+				break;
+			}
 		}
 	}
 	r_core_cmd0 (core, "aeim-");
@@ -777,15 +783,16 @@ static void var_help(RCore *core, char ch) {
 	}
 }
 
-static void var_accesses_list(RAnal *a, RAnalFunction *fcn, int delta, const char *typestr) {
-	const char *var_local = sdb_fmt ("var.0x%"PFMT64x".%d.%d.%s",
-			fcn->addr, 1, delta, typestr);
-	const char *xss = sdb_const_get (a->sdb_fcns, var_local, 0);
-	if (xss && *xss) {
-		r_cons_printf ("%s\n", xss);
-	} else {
-		r_cons_newline ();
+static void var_accesses_list(RAnalFunction *fcn, RAnalVar *var, bool writes) {
+	RAnalFcnVar *v = r_anal_fcn_var_get (fcn, var->kind, var->delta);
+	if (v) {
+		RVector *xs = writes? &v->writes: &v->reads;
+		size_t i;
+		for (i = 0; i < xs->len; i++) {
+			r_cons_printf ("%s0x%"PFMT64x, i? ",": "", *(ut64 *)r_vector_index_ptr (xs, i));
+		}
 	}
+	r_cons_newline ();
 }
 
 static void list_vars(RCore *core, RAnalFunction *fcn, int type, const char *name) {
@@ -799,24 +806,27 @@ static void list_vars(RCore *core, RAnalFunction *fcn, int type, const char *nam
 			r_cons_printf ("f fcnvar.%s @ %s%s%d\n", var->name, bp,
 				var->delta>=0? "+":"", var->delta);
 		}
+		r_list_free (list);
 		return;
 	}
 	if (type != 'W' && type != 'R') {
+		r_list_free (list);
 		return;
 	}
-	const char *typestr = type == 'R'?"reads":"writes";
 	if (name && *name) {
 		var = r_anal_var_get_byname (core->anal, fcn->addr, name);
 		if (var) {
 			r_cons_printf ("%10s  ", var->name);
-			var_accesses_list (core->anal, fcn, var->delta, typestr);
+			var_accesses_list (fcn, var, type == 'W');
+			r_anal_var_free (var);
 		}
 	} else {
 		r_list_foreach (list, iter, var) {
 			r_cons_printf ("%10s  ", var->name);
-			var_accesses_list (core->anal, fcn, var->delta, typestr);
+			var_accesses_list (fcn, var, type == 'W');
 		}
 	}
+	r_list_free (list);
 }
 
 static int cmd_an(RCore *core, bool use_json, const char *name)
@@ -3302,6 +3312,7 @@ R_API int r_core_esil_step(RCore *core, ut64 until_addr, const char *until_expr,
 		r_anal_esil_setup (esil, core->anal, romem, stats, noNULL); // setup io
 		core->anal->esil = esil;
 		esil->verbose = verbose;
+		esil->jit = r_config_get_i (core->config, "esil.jit");
 		{
 			const char *s = r_config_get (core->config, "cmd.esil.intr");
 			if (s) {
@@ -3640,6 +3651,7 @@ static void cmd_esil_mem(RCore *core, const char *input) {
 		r_anal_esil_setup (esil, core->anal, romem, stats, noNULL); // setup io
 		core->anal->esil = esil;
 		esil->verbose = verbose;
+		esil->jit = r_config_get_i (core->config, "esil.jit");
 		{
 			const char *s = r_config_get (core->config, "cmd.esil.intr");
 			if (s) {
@@ -4241,7 +4253,9 @@ static void cmd_anal_esil(RCore *core, const char *input) {
 		}
 		r_anal_esil_setup (esil, core->anal, romem, stats, noNULL); // setup io
 		r_anal_esil_set_pc (esil, core->offset);
+		esil->progs_by_expr = true;
 		r_anal_esil_parse (esil, input + 1);
+		esil->progs_by_expr = false;
 		r_anal_esil_dumpstack (esil);
 		r_anal_esil_stack_free (esil);
 		break;
@@ -4424,6 +4438,10 @@ static void cmd_anal_esil(RCore *core, const char *input) {
 			}
 			r_anal_esil_setup (esil, core->anal, romem, stats, noNULL); // setup io
 			esil->verbose = (int)r_config_get_i (core->config, "esil.verbose");
+			esil->jit = r_config_get_i (core->config, "esil.jit");
+			if (*r_config_get (core->config, "esil.trace.spill")) {
+				r_anal_esil_trace_spill (esil, r_config_get (core->config, "esil.trace.spill"));
+			}
 			/* restore user settings for interrupt handling */
 			{
 				const char *s = r_config_get (core->config, "cmd.esil.intr");
@@ -4731,6 +4749,13 @@ static void cmd_anal_opcode(RCore *core, const char *input) {
                         eprintf ("Use: aod[?a] ([opcode])    describe current, [given] or all mnemonics\n");
                 }
                 break;
+	case 'c': // "aoc"
+		if (input[1] == '-') {
+			r_anal_op_cache_reset (core->anal);
+		} else {
+			r_anal_op_cache_stats (core->anal, input[1]);
+		}
+		break;
 	case '*':
 		r_core_anal_hint_list (core->anal, input[0]);
 		break;
@@ -5617,34 +5642,36 @@ static void cmd_anal_hint(RCore *core, const char *input) {
 		r_core_anal_hint_print (core->anal, core->offset, 0);
 		break;
 	case 'a': // "aha" set arch
-		if (input[1]) {
-			int i;
+		if (input[1] == '-') {
+			r_anal_hint_unset_arch (core->anal, core->offset);
+		} else if (input[1]) {
 			char *ptr = strdup (input + 2);
-			i = r_str_word_set0 (ptr);
+			int i = r_str_word_set0 (ptr);
 			if (i == 2) {
-				r_num_math (core->num, r_str_word_get0 (ptr, 1));
+				ut64 size = r_num_math (core->num, r_str_word_get0 (ptr, 1));
+				r_anal_hint_set_arch_range (core->anal, core->offset, size, r_str_word_get0 (ptr, 0));
+			} else {
+				r_anal_hint_set_arch (core->anal, core->offset, r_str_word_get0 (ptr, 0));
 			}
-			r_anal_hint_set_arch (core->anal, core->offset, r_str_word_get0 (ptr, 0));
 			free (ptr);
-		} else if (input[1] == '-') {
-			r_anal_hint_unset_arch (core->anal, core->offset);
 		} else {
 			eprintf ("Missing argument\n");
 		}
 		break;
 	case 'b': // "ahb" set bits
-		if (input[1]) {
+		if (input[1] == '-') {
+			r_anal_hint_unset_bits (core->anal, core->offset);
+		} else if (input[1]) {
 			char *ptr = strdup (input + 2);
-			int bits;
 			int i = r_str_word_set0 (ptr);
+			int bits = r_num_math (core->num, r_str_word_get0 (ptr, 0));
 			if (i == 2) {
-				r_num_math (core->num, r_str_word_get0 (ptr, 1));
+				ut64 size = r_num_math (core->num, r_str_word_get0 (ptr, 1));
+				r_anal_hint_set_bits_range (core->anal, core->offset, size, bits);
+			} else {
+				r_anal_hint_set_bits (core->anal, core->offset, bits);
 			}
-			bits = r_num_math (core->num, r_str_word_get0 (ptr, 0));
-			r_anal_hint_set_bits (core->anal, core->offset, bits);
 			free (ptr);
-		}  else if (input[1] == '-') {
-			r_anal_hint_unset_bits (core->anal, core->offset);
 		} else {
 			eprintf ("Missing argument\n");
 		}
@@ -5756,6 +5783,7 @@ static void cmd_anal_hint(RCore *core, const char *input) {
 		} else if (input[1] == '-') { // "ahr-"
 			r_anal_hint_unset_ret (core->anal, core->offset);
 		}
+		break;
 	case '*': // "ah*"
 		if (input[1] == ' ') {
 			char *ptr = strdup (r_str_trim_ro (input + 2));
@@ -6877,6 +6905,9 @@ static int cmd_anal_all(RCore *core, const char *input) {
 	case 'n': // "aan"
 		r_core_anal_autoname_all_fcns (core);
 		break; //aan
+	case 'w': // "aaw"
+		r_core_anal_reanal (core);
+		break;
 	case 'p': // "aap"
 		if (*input == '?') {
 			// TODO: accept parameters for ranges
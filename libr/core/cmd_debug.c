@@ -437,8 +437,9 @@ static const char *help_msg_dte[] = {
 	"dte", "", "Esil trace log for a single instruction",
 	"dte", " [idx]", "Show commands for that index log",
 	"dte", "-*", "Delete all esil traces",
+	"dtea", " [addr]", "List the esil trace steps at addr",
 	"dtei", "", "Esil trace log single instruction",
-	"dtek", " [sdb query]", "Esil trace log single instruction from sdb",
+	"dteq", "", "List the esil trace steps without their accesses",
 	NULL
 };
 
@@ -4453,8 +4454,16 @@ static int cmd_debug(void *data, const char *input) {
 			}
 			switch (input[2]) {
 			case 0: // "dte"
-				r_anal_esil_trace_list (core->anal->esil);
+			case 'q': // "dteq"
+				r_anal_esil_trace_list (core->anal->esil, input[2]);
 				break;
+			case 'a': { // "dtea"
+				ut64 addr = input[3]? r_num_math (core->num, input + 3): core->offset;
+				int idx = core->anal->esil->trace_idx;
+				while ((idx = r_anal_esil_trace_prev_at (core->anal->esil, addr, idx)) != -1) {
+					r_cons_printf ("[%d] 0x%08"PFMT64x"\n", idx, addr);
+				}
+			} break;
 			case 'i': { // "dtei"
 				RAnalOp *op;
 				ut64 addr = r_num_math (core->num, input + 3);
@@ -4469,10 +4478,7 @@ static int cmd_debug(void *data, const char *input) {
 			} break;
 			case '-': // "dte-"
 				if (!strcmp (input + 3, "*")) {
-					if (core->anal->esil) {
-						sdb_free (core->anal->esil->db_trace);
-						core->anal->esil->db_trace = sdb_new0 ();
-					}
+					r_anal_esil_trace_reset (core->anal->esil);
 				} else {
 					eprintf ("TODO: dte- cannot delete specific logs. Use dte-*\n");
 				}
@@ -4482,16 +4488,6 @@ static int cmd_debug(void *data, const char *input) {
 				r_anal_esil_trace_show (
 					core->anal->esil, idx);
 			} break;
-			case 'k': // "dtek"
-				if (input[3] == ' ') {
-					char *s = sdb_querys (core->anal->esil->db_trace,
-							NULL, 0, input + 4);
-					r_cons_println (s);
-					free (s);
-				} else {
-					eprintf ("Usage: dtek [query]\n");
-				}
-				break;
 			default:
 				r_core_cmd_help (core, help_msg_dte);
 			}
@@ -605,32 +605,21 @@ static int cmd_meta_others(RCore *core, const char *input) {
 			}
 			break;
 		}
-		char key[100];
-		const char *val;
-		RAnalMetaItem mi;
-		Sdb *s = core->anal->sdb_meta;
+		RAnalMetaItem *mi = r_meta_find (core->anal, addr, type, R_META_WHERE_HERE);
 		bool esc_bslash = core->print->esc_bslash;
-		snprintf (key, sizeof (key), "meta.%c.0x%" PFMT64x, type, addr);
-		val = sdb_const_get (s, key, 0);
-		if (!val) {
-			break;
-		}
-		if (!r_meta_deserialize_val (&mi, type, addr, val)) {
-			break;
-		}
-		if (!mi.str) {
+		if (!mi || (!mi->str && type != 'd')) {
 			break;
 		}
 		if (type == 's') {
 			char *esc_str;
-			switch (mi.subtype) {
+			switch (mi->subtype) {
 			case R_STRING_ENC_UTF8:
-				esc_str = r_str_escape_utf8 (mi.str, false, esc_bslash);
+				esc_str = r_str_escape_utf8 (mi->str, false, esc_bslash);
 				break;
 			case 0:  /* temporary legacy workaround */
 				esc_bslash = false;
 			default:
-				esc_str = r_str_escape_latin1 (mi.str, false, esc_bslash, false);
+				esc_str = r_str_escape_latin1 (mi->str, false, esc_bslash, false);
 			}
 			if (esc_str) {
 				r_cons_printf ("\"%s\"\n", esc_str);
@@ -639,11 +628,10 @@ static int cmd_meta_others(RCore *core, const char *input) {
 				r_cons_println ("<oom>");
 			}
 		} else if (type == 'd') {
-			r_cons_printf ("%"PFMT64u"\n", mi.size);
+			r_cons_printf ("%"PFMT64u"\n", mi->size);
 		} else {
-			r_cons_println (mi.str);
+			r_cons_println (mi->str);
 		}
-		free (mi.str);
 		break;
 	case ' ':
 	case '\0':
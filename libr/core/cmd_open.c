@@ -23,10 +23,12 @@ static const char *help_msg_o[] = {
 	"o=","","list opened files (ascii-art bars)",
 	"ob","[?] [lbdos] [...]","list opened binary files backed by fd",
 	"oc"," [file]","open core file, like relaunching r2",
+	"oC","[?]","show and manage the io.rcache read page cache",
 	"of"," [file]","open file and map it at addr 0 as read-only",
 	"oi","[-|idx]","alias for o, but using index instead of fd",
 	"oj","[?]	","list opened files in JSON format",
 	"oL","","list all IO plugins registered",
+	"oP","[?]","show the io.prof backend access profile",
 	"om","[?]","create, list, remove IO maps",
 	"on"," [file] 0x4000","map raw file at 0x4000 (no r_bin involved)",
 	"oo","[?]","reopen current file (kill+fork in debugger)",
@@ -151,6 +153,25 @@ static const char *help_msg_oonn[] = {
 	NULL
 };
 
+static const char *help_msg_oC[] = {
+	"Usage:", "oC[j-+!] [fd]", " # io.rcache read page cache",
+	"oC", "", "show page cache usage and hit/miss counters",
+	"oCj", "", "show page cache stats in JSON",
+	"oC-", " [fd]", "drop all cached pages (or only those of fd)",
+	"oC+", " fd", "cache reads of the given fd (default)",
+	"oC!", " fd", "bypass the cache for the given fd",
+	"oCr", "", "reset the hit/miss counters",
+	NULL
+};
+
+static const char *help_msg_oP[] = {
+	"Usage:", "oP[j-]", " # io.prof backend access profile",
+	"oP", "", "show calls, bytes and latency per plugin, map and command",
+	"oPj", "", "show the profile in JSON, with latency histograms",
+	"oP-", "", "reset the profile",
+	NULL
+};
+
 static inline ut32 find_binfile_id_by_fd (RBin *bin, ut32 fd) {
 	RListIter *it;
 	RBinFile *bf;
@@ -185,6 +206,7 @@ static void cmd_open_init(RCore *core) {
 	DEFINE_CMD_DESCRIPTOR (core, om);
 	DEFINE_CMD_DESCRIPTOR (core, oo);
 	DEFINE_CMD_DESCRIPTOR_SPECIAL (core, oo+, oo_plus);
+	DEFINE_CMD_DESCRIPTOR (core, oC);
 	DEFINE_CMD_DESCRIPTOR (core, oob);
 	DEFINE_CMD_DESCRIPTOR (core, ood);
 	DEFINE_CMD_DESCRIPTOR (core, oon);
@@ -806,6 +828,58 @@ static void cmd_open_map(RCore *core, const char *input) {
 	r_core_block_read (core);
 }
 
+static void cmd_open_rcache(RCore *core, const char *input) {
+	RIODesc *desc;
+	switch (*input) {
+	case '\0': // "oC"
+	case 'j': // "oCj"
+		r_io_rcache_stats (core->io, *input);
+		break;
+	case '-': // "oC-"
+		if (input[1] == ' ') {
+			r_io_rcache_flush_fd (core->io, (int)r_num_math (core->num, input + 2));
+		} else {
+			r_io_rcache_flush (core->io);
+		}
+		break;
+	case '+': // "oC+"
+	case '!': // "oC!"
+		desc = input[1]? r_io_desc_get (core->io, (int)r_num_math (core->num, input + 1)): core->io->desc;
+		if (!desc) {
+			eprintf ("Invalid fd\n");
+			break;
+		}
+		desc->nocache = (*input == '!');
+		if (desc->nocache) {
+			r_io_rcache_flush_fd (core->io, desc->fd);
+		}
+		break;
+	case 'r': // "oCr"
+		r_io_rcache_reset_stats (core->io);
+		break;
+	case '?':
+	default:
+		r_core_cmd_help (core, help_msg_oC);
+		break;
+	}
+}
+
+static void cmd_open_prof(RCore *core, const char *input) {
+	switch (*input) {
+	case '\0': // "oP"
+	case 'j': // "oPj"
+		r_io_prof_dump (core->io, *input);
+		break;
+	case '-': // "oP-"
+		r_io_prof_reset (core->io);
+		break;
+	case '?':
+	default:
+		r_core_cmd_help (core, help_msg_oP);
+		break;
+	}
+}
+
 static bool reopen_in_malloc_cb(void *user, void *data, ut32 id) {
 	RIO *io = (RIO *)user;
 	RIODesc *desc = (RIODesc *)data;
@@ -1346,6 +1420,12 @@ static int cmd_open(void *data, const char *input) {
 	case 'b': // "ob"
 		cmd_open_bin (core, input);
 		break;
+	case 'C': // "oC"
+		cmd_open_rcache (core, input + 1);
+		break;
+	case 'P': // "oP"
+		cmd_open_prof (core, input + 1);
+		break;
 	case '-': // "o-"
 		switch (input[1]) {
 		case '!': // "o-!"
@@ -303,8 +303,9 @@ R_API int r_core_search_prelude(RCore *core, ut64 from, ut64 to, const ut8 *buf,
 		if (!r_io_is_valid_offset (core->io, at, 0)) {
 			break;
 		}
-		(void)r_io_read_at (core->io, at, b, core->blocksize);
-		if (r_search_update (core->search, at, b, core->blocksize) == -1) {
+		// function analysis on hits only reads io, so the view stays valid
+		const ut8 *data = r_io_view_at (core->io, at, b, core->blocksize);
+		if (r_search_update (core->search, at, data, core->blocksize) == -1) {
 			eprintf ("search: update read error at 0x%08"PFMT64x "\n", at);
 			break;
 		}
@@ -630,7 +631,7 @@ R_API RList *r_core_get_boundaries_prot(RCore *core, int protection, const char
 			append_bound (list, core->io, search_itv, m->itv.addr, m->itv.size);
 		}
 	} else if (!strcmp (mode, "io.maps")) { // Non-overlapping RIOMap parts not overriden by others (skyline)
-		const RPVector *skyline = &core->io->map_skyline;
+		const RPVector *skyline = r_io_map_get_skyline (core->io);
 		ut64 begin = UT64_MAX;
 		ut64 end = UT64_MAX;
 		size_t i;
@@ -1593,6 +1594,7 @@ static void do_esil_search(RCore *core, struct search_parameters *param, const c
 		r_anal_esil_setup (core->anal->esil, core->anal, 1, 0, nonull);
 		r_anal_esil_stack_free (core->anal->esil);
 		core->anal->esil->verbose = 0;
+		core->anal->esil->progs_by_expr = true;
 
 		r_cons_break_push (NULL, NULL);
 		for (addr = from; addr < to; addr++) {
@@ -1660,6 +1662,7 @@ static void do_esil_search(RCore *core, struct search_parameters *param, const c
 				hit_combo = 0;
 			}
 		}
+		core->anal->esil->progs_by_expr = false;
 		r_config_set_i (core->config, "search.kwidx", search->n_kws); // TODO remove
 		r_cons_break_pop ();
 	}
@@ -2162,6 +2165,7 @@ static void do_asm_search(RCore *core, struct search_parameters *param, const ch
 static void do_string_search(RCore *core, RInterval search_itv, struct search_parameters *param) {
 	ut64 at;
 	ut8 *buf;
+	const ut8 *data;
 	RSearch *search = core->search;
 
 	if (json) {
@@ -2190,6 +2194,9 @@ static void do_string_search(RCore *core, RInterval search_itv, struct search_pa
 		// REMOVE OLD FLAGS r_core_cmdf (core, "f-%s*", r_config_get (core->config, "search.prefix"));
 		r_search_set_callback (core->search, &_cb_hit, param);
 		cmdhit = r_config_get (core->config, "cmd.hit");
+		// cmd.hit may write to io, which would invalidate the blocks read ahead
+		const bool readahead = !cmdhit || !*cmdhit;
+		RIOReadAhead *ra = NULL;
 		if (!(buf = malloc (core->blocksize))) {
 			return;
 		}
@@ -2223,6 +2230,9 @@ static void do_string_search(RCore *core, RInterval search_itv, struct search_pa
 					from1 = search->bckwrds ? to : from,
 					to1 = search->bckwrds ? from : to;
 			ut64 len;
+			if (readahead && !search->bckwrds) {
+				ra = r_io_ra_new (core->io, from, to, core->blocksize, 0);
+			}
 			for (at = from1; at != to1; at = search->bckwrds ? at - len : at + len) {
 				print_search_progress (at, to1, search->nhits);
 				if (r_cons_is_breaked ()) {
@@ -2236,20 +2246,27 @@ static void do_string_search(RCore *core, RInterval search_itv, struct search_pa
 						break;
 					}
 					(void)r_io_read_at (core->io, at - len, buf, len);
+					data = buf;
 				} else {
 					len = R_MIN (core->blocksize, to - at);
 					if (!r_io_is_valid_offset (core->io, at, 0)) {
 						break;
 					}
-					(void)r_io_read_at (core->io, at, buf, len);
+					if (ra) {
+						// blocks come in the same order and sizes as this loop
+						data = r_io_ra_next (ra, NULL, NULL);
+					} else {
+						(void)r_io_read_at (core->io, at, buf, len);
+						data = buf;
+					}
 				}
 				if (param->crypto_search) {
 					// TODO support backward search
 					int delta = 0;
 					if (param->aes_search) {
-						delta = r_search_aes_update (core->search, at, buf, len);
+						delta = r_search_aes_update (core->search, at, data, len);
 					} else if (param->rsa_search) {
-						delta = r_search_rsa_update (core->search, at, buf, len);
+						delta = r_search_rsa_update (core->search, at, data, len);
 					}
 					if (delta != -1) {
 						int t = r_search_hit_new (core->search, &aeskw, at + delta);
@@ -2258,12 +2275,14 @@ static void do_string_search(RCore *core, RInterval search_itv, struct search_pa
 						}
 					}
 				} else {
-					(void)r_search_update (core->search, at, buf, len);
+					(void)r_search_update (core->search, at, data, len);
 					if (core->search->maxhits > 0 && core->search->nhits >= core->search->maxhits) {
 						goto done;
 					}
 				}
 			}
+			r_io_ra_free (ra);
+			ra = NULL;
 			print_search_progress (at, to1, search->nhits);
 			r_cons_clear_line (1);
 			core->num->value = search->nhits;
@@ -2272,6 +2291,7 @@ static void do_string_search(RCore *core, RInterval search_itv, struct search_pa
 			}
 		}
 done:
+		r_io_ra_free (ra);
 		r_cons_break_pop ();
 		free (buf);
 	} else {
@@ -706,7 +706,7 @@ static void cmd_write_pcache(RCore *core, const char *input) {
 }
 
 /* TODO: simplify using r_write */
-static int cmd_write(void *data, const char *input) {
+static int cmd_write_bytes(void *data, const char *input) {
 	int wseek, i, size, len;
 	RCore *core = (RCore *)data;
 	char *tmp, *str, *ostr;
@@ -1563,3 +1563,12 @@ static int cmd_write(void *data, const char *input) {
 	R_FREE (ostr);
 	return 0;
 }
+
+static int cmd_write(void *data, const char *input) {
+	RCore *core = (RCore *)data;
+	int ret = cmd_write_bytes (data, input);
+	if (core->anal_dirty.len && r_config_get_i (core->config, "anal.reanal")) {
+		r_core_anal_reanal (core);
+	}
+	return ret;
+}
@@ -311,6 +311,12 @@ static void core_post_write_callback(void *user, ut64 maddr, ut8 *bytes, int cnt
 	free (comment);
 }
 
+static void core_write_callback(void *user, ut64 addr, int len) {
+	RCore *core = (RCore *)user;
+	r_anal_op_cache_invalidate (core->anal, addr, len);
+	r_core_anal_dirty (core, addr, len);
+}
+
 static int core_cmd_callback (void *user, const char *cmd) {
     RCore *core = (RCore *)user;
     return r_core_cmd0 (core, cmd);
@@ -1879,11 +1885,9 @@ static int mywrite(const ut8 *buf, int len) {
 }
 
 static bool exists_var(RPrint *print, ut64 func_addr, char *str) {
-	char *name_key = sdb_fmt ("var.0x%"PFMT64x ".%d.%s", func_addr, 1, str);
-	if (sdb_const_get_len (((RCore*)(print->user))->anal->sdb_fcns, name_key, NULL, 0)) {
-		return true;
-	}
-	return false;
+	RAnal *anal = ((RCore*)(print->user))->anal;
+	RAnalFunction *fcn = r_anal_get_fcn_at (anal, func_addr, 0);
+	return r_anal_fcn_var_get_byname (fcn, str) != NULL;
 }
 
 static bool r_core_anal_log(struct r_anal_t *anal, const char *msg) {
@@ -2089,6 +2093,7 @@ R_API bool r_core_init(RCore *core) {
 	r_egg_setup (core->egg, R_SYS_ARCH, R_SYS_BITS, 0, R_SYS_OS);
 
 	core->undos = r_list_newf ((RListFree)r_core_undo_free);
+	r_vector_init (&core->anal_dirty, sizeof (ut64), NULL, NULL);
 	core->fixedarch = false;
 	core->fixedbits = false;
 
@@ -2147,6 +2152,7 @@ R_API bool r_core_init(RCore *core) {
 	core->io->cb_core_cmd = core_cmd_callback;
 	core->io->cb_core_cmdstr = core_cmdstr_callback;
 	core->io->cb_core_post_write = core_post_write_callback;
+	core->io->cb_core_write = core_write_callback;
 	core->search = r_search_new (R_SEARCH_KEYWORD);
 	r_io_undo_enable (core->io, 1, 0); // TODO: configurable via eval
 	core->fs = r_fs_new ();
@@ -2259,6 +2265,7 @@ R_API RCore *r_core_fini(RCore *c) {
 	r_core_autocomplete_free (c->autocomplete);
 
 	r_list_free (c->undos);
+	r_vector_clear (&c->anal_dirty);
 	r_num_free (c->num);
 	// TODO: sync or not? sdb_sync (c->sdb);
 	// TODO: sync all dbs?
@@ -216,7 +216,8 @@ typedef struct {
 	const char *color_func_var_addr;
 
 	RFlagItem *lastflag;
-	RAnalHint *hint;
+	RAnalHint *hint; // NULL or &hint_at
+	RAnalHint hint_at;
 	RPrint *print;
 
 	ut64 esil_old_pc;
@@ -829,7 +830,6 @@ static void ds_free(RDisasmState *ds) {
 		}
 	}
 	r_anal_op_fini (&ds->analop);
-	r_anal_hint_free (ds->hint);
 	ds_print_esil_anal_fini (ds);
 	ds_reflines_fini (ds);
 	ds_print_esil_anal_fini (ds);
@@ -1017,39 +1017,40 @@ static void ds_build_op_str(RDisasmState *ds, bool print_color) {
 	free (asm_str);
 }
 
+// sets key to the value of a hint, saving the previous value to restore it
+// at the first instruction without one. Unchanged values are not set again,
+// switching asm.arch reloads the plugins.
+static void hint_config(RCore *core, const char *key, const char *val, char **saved) {
+	const char *cur = r_config_get (core->config, key);
+	if (val) {
+		if (!*saved) {
+			*saved = strdup (cur? cur: "");
+		}
+		if (!cur || strcmp (cur, val)) {
+			r_config_set (core->config, key, val);
+		}
+	} else if (*saved) {
+		if (!cur || strcmp (cur, *saved)) {
+			r_config_set (core->config, key, *saved);
+		}
+		R_FREE (*saved);
+	}
+}
+
 //removed hints bits from since r_anal_build_range_on_hints along with
 //r_core_seek_archbits will be used instead. The ranges are built from hints
+// hint is filled in place and its strings are borrowed from the hint store,
+// returns NULL when there's no hint at that address
 R_API RAnalHint *r_core_hint_begin(RCore *core, RAnalHint* hint, ut64 at) {
 	static char *hint_arch = NULL;
 	static char *hint_syntax = NULL;
-	r_anal_hint_free (hint);
-	hint = r_anal_hint_get (core->anal, at);
-	if (hint_arch) {
-		r_config_set (core->config, "asm.arch", hint_arch);
-		hint_arch = NULL;
-	}
-	if (hint_syntax) {
-		r_config_set (core->config, "asm.syntax", hint_syntax);
-		hint_syntax = NULL;
+	if (!r_anal_hint_lookup (core->anal, at, hint)) {
+		hint = NULL;
 	}
-	if (hint) {
-		/* arch */
-		if (hint->arch && !core->fixedarch) {
-			if (!hint_arch) {
-				hint_arch = strdup (r_config_get (core->config, "asm.arch"));
-			}
-			r_config_set (core->config, "asm.arch", hint->arch);
-		}
-		/* syntax */
-		if (hint->syntax) {
-			if (!hint_syntax) {
-				hint_syntax = strdup (r_config_get (core->config, "asm.syntax"));
-			}
-			r_config_set (core->config, "asm.syntax", hint->syntax);
-		}
-		if (hint->high) {
-			/* TODO: do something here */
-		}
+	hint_config (core, "asm.arch", (hint && !core->fixedarch)? hint->arch: NULL, &hint_arch);
+	hint_config (core, "asm.syntax", hint? hint->syntax: NULL, &hint_syntax);
+	if (hint && hint->high) {
+		/* TODO: do something here */
 	}
 	return hint;
 }
@@ -2052,34 +2053,26 @@ static void ds_update_ref_lines(RDisasmState *ds) {
 	}
 }
 
+static bool ds_meta_size_cb(void *user, RAnalMetaItem *mi) {
+	switch (mi->type) {
+	case R_META_TYPE_DATA:
+	case R_META_TYPE_STRING:
+	case R_META_TYPE_FORMAT:
+	case R_META_TYPE_MAGIC:
+	case R_META_TYPE_HIDE:
+		*(ut64 *)user = mi->size;
+		break;
+	}
+	return true;
+}
+
 static int ds_disassemble(RDisasmState *ds, ut8 *buf, int len) {
 	RCore *core = ds->core;
 	int ret;
-	const char *info;
-	Sdb *s = core->anal->sdb_meta;
-	char key[100];
 	ut64 mt_sz = UT64_MAX;
 
 	//handle meta info to fix ds->oplen
-	snprintf (key, sizeof (key) - 1, "meta.0x%"PFMT64x, ds->at);
-	info = sdb_const_get (s, key, 0);
-	if (info) {
-		for (;*info; info++) {
-			switch (*info) {
-			case R_META_TYPE_DATA:
-			case R_META_TYPE_STRING:
-			case R_META_TYPE_FORMAT:
-			case R_META_TYPE_MAGIC:
-			case R_META_TYPE_HIDE:
-				snprintf (key, sizeof (key) - 1,
-						"meta.%c.0x%"PFMT64x, *info, ds->at);
-				sdb_const_get (s, key, 0);
-				mt_sz = sdb_array_get_num (s, key, 0, 0);
-				//if (mt_sz) { break; }
-				break;
-			}
-		}
-	}
+	r_meta_foreach_at (core->anal, ds->at, R_META_TYPE_ANY, ds_meta_size_cb, &mt_sz);
 
 	if (ds->hint && ds->hint->size) {
 		ds->oplen = ds->hint->size;
@@ -2210,7 +2203,7 @@ static int ds_disassemble(RDisasmState *ds, ut8 *buf, int len) {
 	} else if (ds->capitalize) {
 		ds->asmop.buf_asm[0] = toupper (ds->asmop.buf_asm[0]);
 	}
-	if (info && mt_sz != UT64_MAX) {
+	if (mt_sz != UT64_MAX) {
 		ds->oplen = mt_sz;
 	}
 	return ret;
@@ -2614,34 +2607,32 @@ static bool ds_print_data_type(RDisasmState *ds, const ut8 *buf, int ib, int siz
 	return true;
 }
 
+typedef struct {
+	RAnalMetaItem items[8];
+	int count;
+} DsMetaAt;
+
+static bool ds_meta_at_cb(void *user, RAnalMetaItem *mi) {
+	DsMetaAt *at = user;
+	at->items[at->count++] = *mi;
+	return at->count < R_ARRAY_SIZE (at->items);
+}
+
 static int ds_print_meta_infos(RDisasmState *ds, ut8* buf, int len, int idx) {
-	int ret = 0;
-	const char *infos, *metas;
-	char key[100];
-	RAnalMetaItem MI, *mi = &MI;
+	int i, ret = 0;
+	DsMetaAt at = {{{0}}};
+	RAnalMetaItem *mi;
 	RCore *core = ds->core;
-	Sdb *s = core->anal->sdb_meta;
 	if (!ds->asm_meta) {
 		return 0;
 	}
 
-	snprintf (key, sizeof (key), "meta.0x%" PFMT64x, ds->at);
-	infos = sdb_const_get (s, key, 0);
+	r_meta_foreach_at (core->anal, ds->at, R_META_TYPE_ANY, ds_meta_at_cb, &at);
 
 	ds->mi_found = false;
-	if (infos) {
-		for (; *infos; infos++) {
-			if (*infos == ',') {
-				continue;
-			}
-			snprintf (key, sizeof (key), "meta.%c.0x%" PFMT64x, *infos, ds->at);
-			metas = sdb_const_get (s, key, 0);
-			if (!metas) {
-				continue;
-			}
-			if (!r_meta_deserialize_val (mi, *infos, ds->at, metas)) {
-				continue;
-			}
+	if (at.count) {
+		for (i = 0; i < at.count; i++) {
+			mi = &at.items[i];
 			// TODO: implement ranged meta find (if not at the begging of function..
 			char *out = NULL;
 			int hexlen;
@@ -2697,12 +2688,19 @@ static int ds_print_meta_infos(RDisasmState *ds, ut8* buf, int len, int idx) {
 					ds->oplen = mi->size;
 					ds->mi_found = true;
 					break;
-				case R_META_TYPE_RUN:
-					r_core_cmdf (core, "%s @ 0x%"PFMT64x, mi->str, ds->at);
+				case R_META_TYPE_RUN: {
+					// the command may change the metadata and the copied items
+					char *cmd = mi->str? strdup (mi->str): NULL;
 					ds->asmop.size = mi->size;
 					ds->oplen = mi->size;
 					ds->mi_found = true;
+					if (cmd) {
+						r_core_cmdf (core, "%s @ 0x%"PFMT64x, cmd, ds->at);
+						free (cmd);
+					}
+					i = at.count;
 					break;
+				}
 				case R_META_TYPE_DATA:
 					hexlen = len - idx;
 					delta = ds->at - mi->from;
@@ -2735,10 +2733,6 @@ static int ds_print_meta_infos(RDisasmState *ds, ut8* buf, int len, int idx) {
 					break;
 				}
 			}
-			if (MI.str) {
-				free (MI.str);
-				MI.str = NULL;
-			}
 		}
 	}
 	return ret;
@@ -4079,22 +4073,13 @@ static void delete_last_comment(RDisasmState *ds) {
 }
 
 static bool can_emulate_metadata(RCore * core, ut64 at) {
-	const char *infos;
 	const char *emuskipmeta = r_config_get (core->config, "emu.skip");
-	char key[32];
-	Sdb *s = core->anal->sdb_meta;
-	snprintf (key, sizeof (key)-1, "meta.0x%"PFMT64x, at);
-	infos = sdb_const_get (s, key, 0);
-	if (!infos) {
-		/* no metadata: let's emulate this */
-		return true;
-	}
-	for (; *infos; infos++) {
+	for (; emuskipmeta && *emuskipmeta; emuskipmeta++) {
 		/*
 		 * don't emulate if at least one metadata type
 		 * can't be emulated
 		 */
-		if (*infos != ',' && strchr(emuskipmeta, *infos)) {
+		if (r_meta_find (core->anal, at, *emuskipmeta, R_META_WHERE_HERE)) {
 			return false;
 		}
 	}
@@ -4624,7 +4609,7 @@ toro:
 		}
 		r_core_seek_archbits (core, ds->at); // slow but safe
 		ds->has_description = false;
-		ds->hint = r_core_hint_begin (core, ds->hint, ds->at);
+		ds->hint = r_core_hint_begin (core, &ds->hint_at, ds->at);
 		ds->printed_str_addr = UT64_MAX;
 		ds->printed_flag_addr = UT64_MAX;
 		// XXX. this must be done in ds_update_pc()
@@ -5041,7 +5026,7 @@ R_API int r_core_print_disasm_instructions(RCore *core, int nb_bytes, int nb_opc
 		if (r_cons_is_breaked ()) {
 			break;
 		}
-		ds->hint = r_core_hint_begin (core, ds->hint, ds->at);
+		ds->hint = r_core_hint_begin (core, &ds->hint_at, ds->at);
 		ds->has_description = false;
 		r_asm_set_pc (core->assembler, ds->at);
 		// XXX copypasta from main disassembler function
@@ -5145,10 +5130,7 @@ R_API int r_core_print_disasm_instructions(RCore *core, int nb_bytes, int nb_opc
 			}
 			R_FREE (ds->opstr);
 		}
-		if (ds->hint) {
-			r_anal_hint_free (ds->hint);
-			ds->hint = NULL;
-		}
+		ds->hint = NULL;
 	}
 	r_cons_break_pop ();
 	ds_free (ds);
@@ -5252,7 +5234,7 @@ R_API int r_core_print_disasm_json(RCore *core, ut64 addr, ut8 *buf, int nb_byte
 		bool end_nbopcodes, end_nbbytes;
 
 		at = addr + k;
-		ds->hint = r_core_hint_begin (core, ds->hint, ds->at);
+		ds->hint = r_core_hint_begin (core, &ds->hint_at, ds->at);
 		r_asm_set_pc (core->assembler, at);
 		// 32 is the biggest opcode length in intel
 		// Make sure we have room for it
@@ -5977,9 +5959,11 @@ toro:
 					r_parse_immtrim (asm_str);
 				}
 				if (filter) {
-					core->parser->hint = r_anal_hint_get (core->anal, at);
+					RAnalHint hint;
+					core->parser->hint = r_anal_hint_lookup (core->anal, at, &hint)? &hint: NULL;
 					r_parse_filter (core->parser, core->flags,
 						asm_str, opstr, sizeof (opstr) - 1, core->print->big_endian);
+					core->parser->hint = NULL;
 					asm_str = (char *)&opstr;
 				}
 				if (show_color) {
@@ -921,14 +921,59 @@ static void GH(print_heap_graph)(RCore *core, MallocState *main_arena, GHT *init
 
 
 #if __GLIBC_MINOR__ > 25
+static void GH(tcache_chains_free)(GHT **chains) {
+	int i;
+	if (chains) {
+		for (i = 0; i < TCACHE_MAX_BINS; i++) {
+			free (chains[i]);
+		}
+		free (chains);
+	}
+}
+
+// Follows the fd pointers of all the tcache bins in lockstep, so every hop
+// costs one batched read for all the bins. chains[i] holds the counts[i]
+// entries of bin i.
+static GHT **GH(tcache_chains)(RCore *core, GH(RHeapTcache) *tcache) {
+	RIOReadVec vec[TCACHE_MAX_BINS];
+	GHT **chains = R_NEWS0 (GHT *, TCACHE_MAX_BINS);
+	int i, n, depth = 0;
+	if (!chains) {
+		return NULL;
+	}
+	for (i = 0; i < TCACHE_MAX_BINS; i++) {
+		if (tcache->counts[i] > 0) {
+			if (!(chains[i] = R_NEWS0 (GHT, tcache->counts[i]))) {
+				GH(tcache_chains_free) (chains);
+				return NULL;
+			}
+			chains[i][0] = (GHT)(size_t)tcache->entries[i];
+			depth = R_MAX (depth, tcache->counts[i]);
+		}
+	}
+	for (n = 1; n < depth; n++) {
+		int count = 0;
+		for (i = 0; i < TCACHE_MAX_BINS; i++) {
+			if (tcache->counts[i] > n) {
+				chains[i][n] = GHT_MAX;
+				vec[count].addr = chains[i][n - 1];
+				vec[count].buf = (ut8 *)&chains[i][n];
+				vec[count].len = sizeof (GHT);
+				count++;
+			}
+		}
+		(void)r_io_read_batch (core->io, vec, count);
+	}
+	return chains;
+}
+
 static void GH(print_tcache_instance)(RCore *core, MallocState *main_arena, GHT *initial_brk) {
         if (!core || !core->dbg || !core->dbg->maps) {
                 return;
         }
 
-	GHT brk_start = GHT_MAX, brk_end = GHT_MAX, tcache_fd = GHT_MAX;
+	GHT brk_start = GHT_MAX, brk_end = GHT_MAX;
 	GH(get_brks) (core, &brk_start, &brk_end);
-	GHT tcache_tmp = GHT_MAX;
 
 	*initial_brk = ( (brk_start >> 12) << 12 ) + sizeof(GH(RHeapTcache)) + MALLOC_ALIGNMENT;
 
@@ -938,8 +983,12 @@ static void GH(print_tcache_instance)(RCore *core, MallocState *main_arena, GHT
 	}
 
 	GH(RHeapTcache) *tcache = R_NEW0 (GH(RHeapTcache));
+	if (!tcache) {
+		return;
+	}
 
 	(void)r_io_read_at (core->io, brk_start + MALLOC_ALIGNMENT, (ut8 *)tcache, sizeof ( GH(RHeapTcache) ));
+	GHT **chains = GH(tcache_chains) (core, tcache);
 
 	PRINT_GA("Thread cache @\n");
 	for (int i = 0; i < TCACHE_MAX_BINS; i++) {
@@ -950,17 +999,16 @@ static void GH(print_tcache_instance)(RCore *core, MallocState *main_arena, GHT
 			PRINTF_BA("%2d",tcache->counts[i]);
 			PRINT_GA(", fd :");
 			PRINTF_BA("0x%"PFMT64x,(ut64)tcache->entries[i]-MALLOC_ALIGNMENT);
-			if (tcache->counts[i] > 1) {
-				tcache_fd = (ut64)tcache->entries[i];
+			if (tcache->counts[i] > 1 && chains) {
 				for(int n=1; n < tcache->counts[i]; n++) {
-					(void)r_io_read_at (core->io, tcache_fd, &tcache_tmp, sizeof ( GHT ) );
-					PRINTF_BA("->0x%"PFMT64x, tcache_tmp - MALLOC_ALIGNMENT);
-					tcache_fd = tcache_tmp;
+					PRINTF_BA("->0x%"PFMT64x, (ut64)(chains[i][n] - MALLOC_ALIGNMENT));
 				}
 			}
 			PRINT_BA("\n");
 		}
 	}
+	GH(tcache_chains_free) (chains);
+	free (tcache);
 }
 #endif
 
@@ -974,7 +1022,6 @@ static void GH(print_heap_segment)(RCore *core, MallocState *main_arena, GHT *in
 	GH(get_brks) (core, &brk_start, &brk_end);
 
 #if __GLIBC_MINOR__ > 25
-	GHT tcache_fd = GHT_MAX, tcache_tmp = GHT_MAX;
 #if HEAP32
 	*initial_brk = ( (brk_start >> 12) << 12 ) + sizeof (GH(RHeapTcache)) + MALLOC_ALIGNMENT + 0x418;
 #else
@@ -997,6 +1044,16 @@ static void GH(print_heap_segment)(RCore *core, MallocState *main_arena, GHT *in
 		return;
 	}
 
+#if __GLIBC_MINOR__ > 25
+	// the tcache does not change while walking the heap, fetch it once
+	GH(RHeapTcache) *tcache = R_NEW0 (GH(RHeapTcache));
+	GHT **chains = NULL;
+	if (tcache) {
+		(void)r_io_read_at (core->io, brk_start + MALLOC_ALIGNMENT, (ut8 *)tcache, sizeof ( GH(RHeapTcache) ));
+		chains = GH(tcache_chains) (core, tcache);
+	}
+#endif
+
 	(void)r_io_read_at (core->io, next_chunk, (ut8 *)cnk, sizeof (GH(RHeapChunk)));
 	size_tmp = (cnk->size >> 3) << 3;
 
@@ -1059,25 +1116,12 @@ static void GH(print_heap_segment)(RCore *core, MallocState *main_arena, GHT *in
 		}
 
 #if __GLIBC_MINOR__ > 25
-		GH(RHeapTcache) *tcache = R_NEW0 (GH(RHeapTcache));
-		(void)r_io_read_at (core->io, brk_start + MALLOC_ALIGNMENT, (ut8 *)tcache, sizeof ( GH(RHeapTcache) ));
-		for (int i=0; i < TCACHE_MAX_BINS; i++){
-			if( tcache->counts[i] > 0 ) {
-				if ( (ut64)tcache->entries[i] - SZ * 2 == (ut64)prev_chunk ){
+		for (int i = 0; chains && !is_free && i < TCACHE_MAX_BINS; i++) {
+			for (int n = 0; n < tcache->counts[i]; n++) {
+				if ((ut64)chains[i][n] - SZ * 2 == (ut64)prev_chunk) {
 					is_free = true;
 					break;
 				}
-				if( tcache->counts[i] > 1 ) {
-					tcache_fd = (ut64)tcache->entries[i];
-					for (int n = 1; n < tcache->counts[i]; n++) {
-						(void)r_io_read_at (core->io, tcache_fd, (ut8*)&tcache_tmp, sizeof ( GHT ) );
-						if ( (ut64)tcache_tmp - SZ * 2 == (ut64)prev_chunk ) {
-							is_free = true;
-							break;
-						}
-						tcache_fd = (ut64)tcache_tmp;
-					}
-				}
 			}
 		}
 #endif
@@ -1120,6 +1164,10 @@ static void GH(print_heap_segment)(RCore *core, MallocState *main_arena, GHT *in
 	r_cons_printf ("\n");
 	free (cnk);
 	free (cnk_next);
+#if __GLIBC_MINOR__ > 25
+	GH(tcache_chains_free) (chains);
+	free (tcache);
+#endif
 }
 
 static void GH(print_heap_segment_json)(RCore *core, MallocState *main_arena, GHT *initial_brk, GHT global_max_fast) {
@@ -781,20 +781,13 @@ R_API int r_core_visual_types(RCore *core) {
 	return true;
 }
 
-static int cmtcb(void *usr, const char *k, const char *v) {
-	if (!strncmp (k, "meta.C.", 7)) {
-		RList *list = (RList*)usr;
-		char *msg, *comma = strchr (v, ',');
-		if (comma) {
-			comma = strchr (comma + 1, ',');
-			if (comma) {
-				msg = (char *)sdb_decode (comma + 1, NULL);
-				if (msg) {
-					msg = r_str_replace (msg, "\n", "", true);
-					r_list_append (list, r_str_newf ("%s  %s", k+7, msg));
-					free (msg);
-				}
-			}
+static int cmtcb(void *user, RAnalMetaItem *mi) {
+	RAnalMetaUserItem *ui = user;
+	if (mi->str) {
+		char *msg = r_str_replace (strdup (mi->str), "\n", "", true);
+		if (msg) {
+			r_list_append (ui->user, r_str_newf ("0x%"PFMT64x"  %s", mi->from, msg));
+			free (msg);
 		}
 	}
 	return 1;
@@ -852,7 +845,7 @@ R_API bool r_core_visual_hudstuff(RCore *core) {
 		r_list_append (list, r_str_newf ("0x%08"PFMT64x"  %s",
 			flag->offset, flag->name));
 	}
-	sdb_foreach (core->anal->sdb_meta, cmtcb, list);
+	r_meta_list_cb (core->anal, R_META_TYPE_COMMENT, 0, cmtcb, list, UT64_MAX);
 	res = r_cons_hud (list, NULL);
 	if (res) {
 		char *p = strchr (res, ' ');
@@ -1471,36 +1464,6 @@ R_API int r_core_visual_trackflags(RCore *core) {
 	}
 	return true;
 }
-static bool meta_deserialize(RAnalMetaItem *it, const char *k, const char *v) {
-	if (strlen (k) < 8) {
-		return false;
-	}
-	if (memcmp (k + 6, ".0x", 3)) {
-		return false;
-	}
-	return r_meta_deserialize_val (it, k[5], sdb_atoi (k + 7), v);
-}
-
-static int meta_enumerate_cb(void *user, const char *k, const char *v) {
-	RAnalMetaUserItem *ui = user;
-	RList *list = ui->user;
-	RAnalMetaItem *it = R_NEW0 (RAnalMetaItem);
-	if (!it) {
-		return 0;
-	}
-	if (!meta_deserialize (it, k, v)) {
-		free (it);
-		goto beach;
-	}
-	if (!it->str) {
-		free (it);
-		goto beach;
-	}
-	r_list_append (list, it);
-beach:
-	return 1;
-}
-
 R_API int r_core_visual_comments (RCore *core) {
 	char *str;
 	char cmd[512], *p = NULL;
@@ -1512,10 +1475,9 @@ R_API int r_core_visual_comments (RCore *core) {
 		r_cons_clear00 ();
 		r_cons_strcat ("Comments:\n");
 		found = 0;
-		RList *items = r_list_newf (free);
+		RList *items = r_meta_enumerate (core->anal, R_META_TYPE_COMMENT);
 		RAnalMetaItem *item;
 		RListIter *iter;
-		r_meta_list_cb (core->anal, R_META_TYPE_COMMENT, 0, meta_enumerate_cb, items, UT64_MAX);
 		int i = 0;
 		r_list_foreach (items, iter, item) {
 			str = item->str;
@@ -1525,15 +1487,15 @@ R_API int r_core_visual_comments (RCore *core) {
 				from = addr;
 				size = 1; // XXX: remove this thing size for comments is useless d->size;
 				free (p);
-				p = str;
+				p = strdup (str);
 				r_cons_printf ("  >  %s\n", str);
 			} else {
 				r_cons_printf ("     %s\n", str);
-				free (str);
 			}
 			i ++;
 			found = true;
 		}
+		r_list_free (items);
 		if (!found) {
 			if (--option < 0) {
 				r_cons_any_key ("No comments");
@@ -659,6 +659,10 @@ R_API RDebugReasonType r_debug_wait(RDebug *dbg, RBreakpointItem **bp) {
 	/* if our debugger plugin has wait */
 	if (dbg->h && dbg->h->wait) {
 		reason = dbg->h->wait (dbg, dbg->pid);
+		/* the target ran, cached pages of its memory are stale now */
+		if (dbg->iob.io) {
+			r_io_rcache_flush (dbg->iob.io);
+		}
 		if (reason == R_DEBUG_REASON_DEAD) {
 			eprintf ("\n==> Process finished\n\n");
 			// XXX(jjd): TODO: handle fallback or something else
@@ -52,11 +52,16 @@ typedef struct r_anal_meta_item_t {
 	int space;
 } RAnalMetaItem;
 
+// cb gets the RAnalMetaUserItem of the listing as user
+typedef int (*RAnalMetaCallback)(void *user, RAnalMetaItem *mi);
+// returning false stops the iteration
+typedef bool (*RAnalMetaItemCb)(void *user, RAnalMetaItem *mi);
+
 typedef struct {
 	struct r_anal_t *anal;
 	int type;
 	int rad;
-	SdbForeachCallback cb;
+	RAnalMetaCallback cb;
 	void *user;
 	int count;
 	struct r_anal_type_function_t *fcn;
@@ -267,6 +272,25 @@ typedef struct r_anal_fcn_meta_t {
 	int sgec;           // edge cardinality of the functions callgraph
 } RAnalFcnMeta;
 
+// variable or argument of a function, kept in RAnalFunction.vars
+typedef struct r_anal_fcn_var_t {
+	char kind;	// R_ANAL_VAR_KIND_*
+	bool isarg;
+	int delta;	// stack offset, or register index for REG
+	int size;
+	char *name;
+	char *type;
+	RVector reads;	// ut64, sorted addresses of the instructions reading it
+	RVector writes;	// ut64, same for the writes
+} RAnalFcnVar;
+
+// variable accessed by the instruction at addr, the one RAnalOp.var gets
+typedef struct r_anal_var_use_t {
+	ut64 addr;
+	RAnalFcnVar *var;
+	RAnalFcnVar *link;	// local a register argument is stored to there
+} RAnalVarUse;
+
 /* Store various function information,
  * variables, arguments, refs and even
  * description */
@@ -299,6 +323,8 @@ typedef struct r_anal_type_function_t {
 	RAnalFcnMeta meta;
 	RRangeTiny bbr;
 	RBNode rb;
+	RPVector vars; // RAnalFcnVar, sorted by kind and delta
+	RVector var_uses; // RAnalVarUse, sorted by addr
 } RAnalFunction;
 
 typedef struct r_anal_func_arg_t {
@@ -616,6 +642,35 @@ typedef enum {
 	R_ANAL_CPP_ABI_MSVC
 } RAnalCPPABI;
 
+/* hint applying to every address of [from, to) */
+typedef struct r_anal_range_hint_t {
+	RBNode rb;
+	ut64 from;
+	ut64 to;
+	int bits;
+	char *arch;
+} RAnalRangeHint;
+
+/* one direction of the cross references, keyed by address */
+typedef struct r_anal_ref_edge_t {
+	ut64 addr;	// the other end of the reference
+	int type;	// RAnalRefType
+} RAnalRefEdge;
+
+typedef struct r_anal_ref_node_t {
+	ut64 key;
+	RAnalRefEdge *edges;	// sorted by addr, NULL for a free slot
+	ut32 count;
+	ut32 size;
+} RAnalRefNode;
+
+typedef struct r_anal_ref_table_t {
+	RAnalRefNode *nodes;	// open addressing, linear probing
+	ut32 size;	// power of two
+	ut32 count;	// used slots
+	ut64 edges;
+} RAnalRefTable;
+
 typedef struct r_anal_t {
 	char *cpu;
 	char *os;
@@ -628,6 +683,8 @@ typedef struct r_anal_t {
 	ut64 gp; // global pointer. used for mips. but can be used by other arches too in the future
 	RList *fcns;
 	RBNode *fcn_tree;
+	RBNode *bb_tree; // RAnalBlock of the functions in fcns, by addr
+	struct r_anal_op_cache_t *opcache; // decoded ops, NULL unless anal.opcache is set
 	RListRange *fcnstore;
 	RList *refs;
 	RList *vartypes;
@@ -655,12 +712,13 @@ typedef struct r_anal_t {
 	RList *plugins;
 	Sdb *sdb_types;
 	Sdb *sdb_fmts;
-	Sdb *sdb_meta; // TODO: Future r_meta api
+	Sdb *sdb_meta; // variable comments
+	RBNode *meta; // RAnalMetaItem by address, an interval tree
 	Sdb *sdb_zigns;
 
 #if USE_DICT
-	SdbHash *dict_refs;
-	SdbHash *dict_xrefs;
+	RAnalRefTable *dict_refs;
+	RAnalRefTable *dict_xrefs;
 #endif
 	bool recursive_noreturn;
 	RSpaces meta_spaces;
@@ -677,7 +735,9 @@ typedef struct r_anal_t {
 	Sdb *sdb_args;  //
 	Sdb *sdb_vars; // globals?
 #endif
-	Sdb *sdb_hints; // OK
+	RBNode *hints;	// point hints by address
+	RBNode *hint_bits;	// RAnalRangeHint, never overlapping
+	RBNode *hint_arch;	// RAnalRangeHint, never overlapping
 	bool bits_hints_changed;
 	Sdb *sdb_fcnsign; // OK
 	Sdb *sdb_cc; // calling conventions
@@ -726,6 +786,9 @@ typedef struct r_anal_hint_t {
 	bool high; // highlight hint
 } RAnalHint;
 
+typedef bool (*RAnalHintCb)(void *user, const RAnalHint *hint);
+typedef bool (*RAnalRangeHintCb)(void *user, const RAnalRangeHint *range);
+
 typedef struct r_anal_var_access_t {
 	ut64 addr;
 	int set;
@@ -814,6 +877,63 @@ typedef struct r_anal_op_t {
 	RAnalHint hint;
 } RAnalOp;
 
+#define R_ANAL_OPCACHE_SIZE 4096	// slots, power of two
+#define R_ANAL_OPCACHE_BYTES 16	// longer instructions are not cached
+
+// what anal->cur->op filled for an instruction, without the heap parts
+typedef struct r_anal_op_cache_entry_t {
+	ut64 addr;
+	const struct r_anal_plugin_t *plugin;	// NULL for a free slot
+	int bits;
+	int mask;	// R_ANAL_OP_MASK_* it was decoded with
+	int ret;
+	ut8 len;	// size of the instruction, the bytes kept
+	ut8 vals;	// bit n set when values[n] holds src[n], bit 3 for dst
+	ut8 bytes[R_ANAL_OPCACHE_BYTES];
+	const char *mnemonic;	// interned in RAnalOpCache.strings
+	const char *esil;
+	const char *opex;
+	const char *reg;
+	const char *ireg;
+	ut32 type;
+	ut32 type2;
+	ut64 prefix;
+	int group;
+	int stackop;
+	int cond;
+	int size;
+	int nopcode;
+	int cycles;
+	int failcycles;
+	int family;
+	int id;
+	bool eob;
+	bool sign;
+	int delay;
+	ut64 jump;
+	ut64 fail;
+	int direction;
+	st64 ptr;
+	ut64 val;
+	int ptrsize;
+	st64 stackptr;
+	int refptr;
+	int scale;
+	ut64 disp;
+	int new_bits;
+	RAnalValue values[4];
+} RAnalOpCacheEntry;
+
+typedef struct r_anal_op_cache_t {
+	RAnalOpCacheEntry *slots;	// direct mapped by address
+	SdbHash *strings;
+	ut32 nstrings;
+	ut64 hits;
+	ut64 misses;
+	ut64 evictions;
+	ut64 invalidations;
+} RAnalOpCache;
+
 #define R_ANAL_COND_SINGLE(x) (!x->arg[1] || x->arg[0]==x->arg[1])
 
 typedef struct r_anal_cond_t {
@@ -858,6 +978,10 @@ typedef struct r_anal_bb_t {
 	ut8 *parent_reg_arena;
 	int stackptr;
 	int parent_stackptr;
+	RAnalFunction *fcn; // the one whose bbs list holds it
+	RAnal *anal; // set while it is in anal->bb_tree
+	RBNode rb;
+	ut64 rb_max_addr; // maximum of addr + size in the subtree, for interval tree
 #undef RAnalBlock
 } RAnalBlock;
 
@@ -1052,9 +1176,77 @@ typedef struct r_anal_esil_callbacks_t {
 	int (*reg_write)(ESIL *esil, const char *name, ut64 val);
 } RAnalEsilCallbacks;
 
+enum {
+	R_ANAL_ESIL_VAL_STR, // resolved by name when used, like "$z" or a flag
+	R_ANAL_ESIL_VAL_NUM,
+	R_ANAL_ESIL_VAL_REG,
+};
+
+#define R_ANAL_ESIL_VAL_SIZE 64
+
+// an entry of the esil stack, no allocations are done to push or pop it
+typedef struct r_anal_esil_value_t {
+	int type;
+	ut64 num; // R_ANAL_ESIL_VAL_NUM
+	int reg; // R_ANAL_ESIL_VAL_REG, index of the register str was compiled to
+	char str[R_ANAL_ESIL_VAL_SIZE]; // the pushed word, empty for r_anal_esil_pushnum
+} RAnalEsilValue;
+
+enum {
+	R_ANAL_ESIL_TRACE_STEP, // starts the events of an instruction
+	R_ANAL_ESIL_TRACE_REG_READ,
+	R_ANAL_ESIL_TRACE_REG_WRITE,
+	R_ANAL_ESIL_TRACE_MEM_READ,
+	R_ANAL_ESIL_TRACE_MEM_WRITE,
+};
+
+#define R_ANAL_ESIL_TRACE_CHUNK 4096 // events per chunk
+#define R_ANAL_ESIL_TRACE_CHUNKS 256 // chunks kept in memory
+
+typedef struct r_anal_esil_trace_event_t {
+	ut8 kind;
+	ut8 size; // bytes in value for memory events
+	ut16 reg; // register events, index in RAnalEsilTrace.regs
+	ut32 step;
+	ut64 addr; // address of the instruction or of the memory access
+	ut64 value; // register value, or the bytes of the memory access
+} RAnalEsilTraceEvent;
+
+typedef struct r_anal_esil_trace_step_t {
+	ut64 seq; // of its R_ANAL_ESIL_TRACE_STEP event
+	ut64 addr;
+	int prev; // previous step at the same address or -1
+} RAnalEsilTraceStep;
+
+typedef struct r_anal_esil_trace_t {
+	RAnalEsilTraceEvent **chunks; // ring of R_ANAL_ESIL_TRACE_CHUNKS
+	ut64 nevents; // sequence number of the next event
+	ut64 first; // oldest chunk in memory
+	RVector steps; // RAnalEsilTraceStep, steps[0] is step number steps_base
+	int steps_base;
+	int steps_first; // oldest step whose events are still there
+	int *addrs; // open addressing, last step at each address
+	int saddrs;
+	int naddrs;
+	char **regs; // register names by index
+	int nregs;
+	ut16 *regids; // open addressing, index + 1 of each name
+	int sregids;
+	FILE *spill; // lz4 compressed chunks dropped from the ring
+	char *spill_path;
+	RVector spilled; // offset and size of each spilled chunk
+	ut64 spill_first; // chunk number of spilled[0]
+	RAnalEsilTraceEvent *cache; // last chunk read back from spill
+	ut64 cache_chunk;
+	bool busy;
+	RAnalEsilCallbacks ocbs; // restored once the instruction is traced
+} RAnalEsilTrace;
+
+typedef bool (*RAnalEsilTraceCB)(void *user, RAnalEsilTraceEvent *ev);
+
 typedef struct r_anal_esil_t {
 	RAnal *anal;
-	char **stack;
+	RAnalEsilValue *stack;
 	ut64 addrmask;
 	int stacksize;
 	int stackptr;
@@ -1081,12 +1273,15 @@ typedef struct r_anal_esil_t {
 	ut64 cur;	//used for carry-flagging and borrow-flagging
 	ut8 lastsz;	//in bits //used for signature-flag
 	/* native ops and custom ops */
-	Sdb *ops;
-	Sdb *interrupts;
+	struct r_anal_esil_ops_t *ops; // the builtin ops, overridable with r_anal_esil_set_op
+	struct r_anal_esil_opslot_t *userops; // the other ops of r_anal_esil_set_op
+	int nuserops;
+	int (**interrupts)(ESIL *esil, int interrupt); // handlers indexed by number
+	int ninterrupts;
 	/* deep esil parsing fills this */
 	Sdb *stats;
-	Sdb *db_trace;
-	int trace_idx;
+	RAnalEsilTrace *trace; // r_anal_esil_trace records here
+	int trace_idx; // next step number
 	RAnalEsilCallbacks cb;
 	RAnalReil *Reil;
 	char *cmd_intr; // r2 (external) command to run when an interrupt occurs
@@ -1099,12 +1294,65 @@ typedef struct r_anal_esil_t {
 	void *user;
 	int stack_fd;
 	RList *sessions; // <RAnalEsilSession*>
+	struct r_anal_esil_prog_t **progs; // compiled expressions, direct mapped by address
+	bool progs_by_expr; // map progs by expression instead, for one expression run at many addresses
+	bool jit; // run the hot programs translated, see esil_jit.c
 } RAnalEsil;
 
 #undef ESIL
 
 typedef int (*RAnalEsilOp)(RAnalEsil *esil);
 
+#define R_ANAL_ESIL_OPS_BITS 8
+#define R_ANAL_ESIL_OPS_SLOTS (1 << R_ANAL_ESIL_OPS_BITS)
+#define R_ANAL_ESIL_OPS_BUCKETS 64
+#define R_ANAL_ESIL_INTERRUPTS_MAX 0x10000
+
+typedef struct r_anal_esil_opslot_t {
+	ut32 hash;
+	const char *name;
+	RAnalEsilOp op;
+} RAnalEsilOpSlot;
+
+// perfect hash of the builtin op names: the displacement of the bucket of
+// a name picks its slot, no two names share one
+typedef struct r_anal_esil_ops_t {
+	ut8 disp[R_ANAL_ESIL_OPS_BUCKETS];
+	RAnalEsilOpSlot slots[R_ANAL_ESIL_OPS_SLOTS];
+} RAnalEsilOps;
+
+#define R_ANAL_ESIL_PROGS 1024 // slots of RAnalEsil.progs, power of two
+
+enum {
+	R_ANAL_ESIL_INSN_NOP, // empty word, only keeps the GOTO numbering
+	R_ANAL_ESIL_INSN_PUSH,
+	R_ANAL_ESIL_INSN_OP,
+	R_ANAL_ESIL_INSN_ELSE, // "}{"
+	R_ANAL_ESIL_INSN_ENDIF, // "}"
+};
+
+typedef struct r_anal_esil_insn_t {
+	int kind;
+	RAnalEsilOp op; // resolved handler of R_ANAL_ESIL_INSN_OP
+	const char *word; // in RAnalEsilProg.words
+	RAnalEsilValue val; // what R_ANAL_ESIL_INSN_PUSH pushes
+} RAnalEsilInsn;
+
+// an esil expression compiled to one instruction per word
+typedef struct r_anal_esil_prog_t {
+	ut64 addr;
+	char *expr; // what it was compiled from
+	char *words; // expr with the commas replaced by zeros
+	RAnalEsilInsn *insns;
+	int ninsns;
+	int refs;
+	int runs;
+	struct r_anal_esil_jit_t *jit; // the translation once it runs R_ANAL_ESIL_JIT_HOT times
+	bool nojit; // it can't be translated
+} RAnalEsilProg;
+
+#define R_ANAL_ESIL_JIT_HOT 2
+
 typedef int (*RAnalCmdExt)(/* Rcore */RAnal *anal, const char* input);
 typedef int (*RAnalAnalyzeFunctions)(RAnal *a, ut64 at, ut64 from, int reftype, int depth);
 typedef int (*RAnalExCallback)(RAnal *a, struct r_anal_state_type_t *state, ut64 addr);
@@ -1279,6 +1527,13 @@ R_API RList *r_anal_bb_list_new(void);
 R_API void r_anal_bb_free(RAnalBlock *bb);
 R_API int r_anal_bb(RAnal *anal, RAnalBlock *bb, ut64 addr, ut8 *buf, ut64 len, int head);
 R_API RAnalBlock *r_anal_bb_from_offset(RAnal *anal, ut64 off);
+R_API void r_anal_bb_index_add(RAnal *anal, RAnalBlock *bb);
+R_API void r_anal_bb_index_del(RAnalBlock *bb);
+R_API void r_anal_bb_index_update(RAnalBlock *bb);
+R_API void r_anal_bb_index_reset(RAnal *anal);
+R_API RAnalBlock *r_anal_bb_index_in(RAnal *anal, ut64 addr, RAnalFunction *fcn);
+R_API RList *r_anal_bb_index_intersect(RAnal *anal, ut64 from, ut64 to);
+R_API RAnalBlock *r_anal_bb_index_at(RAnal *anal, ut64 addr, RAnalFunction *fcn);
 R_API int r_anal_bb_is_in_offset(RAnalBlock *bb, ut64 addr);
 R_API bool r_anal_bb_set_offset(RAnalBlock *bb, int i, ut16 v);
 R_API ut16 r_anal_bb_offset_inst(RAnalBlock *bb, int i);
@@ -1300,10 +1555,29 @@ R_API RAnalOp *r_anal_op_hexstr(RAnal *anal, ut64 addr,
 		const char *hexstr);
 R_API char *r_anal_op_to_string(RAnal *anal, RAnalOp *op);
 
+/* esil_trace.c */
+R_API void r_anal_esil_trace_free(RAnalEsilTrace *trace);
+R_API void r_anal_esil_trace_reset(RAnalEsil *esil);
+R_API bool r_anal_esil_trace_spill(RAnalEsil *esil, const char *path);
+R_API void r_anal_esil_trace(RAnalEsil *esil, RAnalOp *op);
+R_API ut64 r_anal_esil_trace_addr(RAnalEsil *esil, int step);
+R_API bool r_anal_esil_trace_foreach(RAnalEsil *esil, int step, RAnalEsilTraceCB cb, void *user);
+R_API bool r_anal_esil_trace_reg(RAnalEsil *esil, int step, int kind, const char *name, ut64 *val);
+R_API bool r_anal_esil_trace_mem(RAnalEsil *esil, int step, int kind, ut64 *addr);
+R_API int r_anal_esil_trace_prev_at(RAnalEsil *esil, ut64 addr, int step);
+R_API const char *r_anal_esil_trace_reg_name(RAnalEsil *esil, int reg);
+R_API void r_anal_esil_trace_list(RAnalEsil *esil, int mode);
+R_API void r_anal_esil_trace_show(RAnalEsil *esil, int idx);
+
+/* opcache.c */
+R_API void r_anal_op_cache_enable(RAnal *anal, bool enable);
+R_API void r_anal_op_cache_reset(RAnal *anal);
+R_API void r_anal_op_cache_invalidate(RAnal *anal, ut64 addr, ut64 size);
+R_API bool r_anal_op_cache_get(RAnal *anal, RAnalOp *op, ut64 addr, const ut8 *data, int len, int mask, int *ret);
+R_API void r_anal_op_cache_set(RAnal *anal, RAnalOp *op, const ut8 *data, int len, int mask, int ret);
+R_API void r_anal_op_cache_stats(RAnal *anal, int mode);
+
 R_API RAnalEsil *r_anal_esil_new (int stacksize, int iotrap, unsigned int addrsize);
-R_API void r_anal_esil_trace (RAnalEsil *esil, RAnalOp *op);
-R_API void r_anal_esil_trace_list (RAnalEsil *esil);
-R_API void r_anal_esil_trace_show (RAnalEsil *esil, int idx);
 R_API bool r_anal_esil_set_pc (RAnalEsil *esil, ut64 addr);
 R_API int r_anal_esil_setup (RAnalEsil *esil, RAnal *anal, int romem, int stats, int nonull);
 R_API void r_anal_esil_free (RAnalEsil *esil);
@@ -1314,17 +1588,37 @@ R_API int r_anal_esil_mem_read (RAnalEsil *esil, ut64 addr, ut8 *buf, int len);
 R_API int r_anal_esil_mem_write (RAnalEsil *esil, ut64 addr, const ut8 *buf, int len);
 R_API int r_anal_esil_reg_read (RAnalEsil *esil, const char *regname, ut64 *num, int *size);
 R_API int r_anal_esil_reg_write (RAnalEsil *esil, const char *dst, ut64 num);
+R_API bool r_anal_esil_reg_cb_internal(RAnalEsil *esil, bool *nonull);
 R_API int r_anal_esil_pushnum (RAnalEsil *esil, ut64 num);
 R_API bool r_anal_esil_push (RAnalEsil *esil, const char *str);
 R_API char *r_anal_esil_pop (RAnalEsil *esil);
+R_API bool r_anal_esil_value_set (RAnalEsil *esil, RAnalEsilValue *v, const char *str);
+R_API const char *r_anal_esil_value_str (RAnalEsilValue *v);
+R_API bool r_anal_esil_value_num (RAnalEsil *esil, RAnalEsilValue *v, ut64 *num, int *size);
+R_API bool r_anal_esil_push_value (RAnalEsil *esil, const RAnalEsilValue *v);
+R_API bool r_anal_esil_pop_value (RAnalEsil *esil, RAnalEsilValue *v);
 R_API int r_anal_esil_set_op (RAnalEsil *esil, const char *op, RAnalEsilOp code);
+R_API RAnalEsilOp r_anal_esil_get_op (RAnalEsil *esil, const char *op);
+R_API RAnalEsilOp r_anal_esil_builtin_op(const char *name);
 R_API void r_anal_esil_stack_free (RAnalEsil *esil);
 R_API int r_anal_esil_get_parm_type (RAnalEsil *esil, const char *str);
 R_API int r_anal_esil_get_parm (RAnalEsil *esil, const char *str, ut64 *num);
+R_API int r_anal_esil_get_parm_size (RAnalEsil *esil, const char *str, ut64 *num, int *size);
 R_API int r_anal_esil_condition (RAnalEsil *esil, const char *str);
 R_API int r_anal_esil_set_interrupt (RAnalEsil *esil, int interrupt, RAnalEsilInterruptCB interruptcb);
 R_API int r_anal_esil_fire_interrupt (RAnalEsil *esil, int interrupt);
 
+/* esil_compile.c */
+R_API RAnalEsilProg *r_anal_esil_compile(RAnalEsil *esil, const char *expr);
+R_API void r_anal_esil_prog_unref(RAnalEsilProg *prog);
+R_API int r_anal_esil_prog_run(RAnalEsil *esil, RAnalEsilProg *prog);
+R_API RAnalEsilProg *r_anal_esil_prog_get(RAnalEsil *esil, ut64 addr, const char *expr);
+R_API void r_anal_esil_prog_reset(RAnalEsil *esil);
+
+/* esil_jit.c */
+R_API bool r_anal_esil_jit_run(RAnalEsil *esil, RAnalEsilProg *prog, int *ret);
+R_API void r_anal_esil_jit_free(struct r_anal_esil_jit_t *jit);
+
 R_API void r_anal_esil_mem_ro(RAnalEsil *esil, int mem_readonly);
 R_API void r_anal_esil_stats(RAnalEsil *esil, int enable);
 
@@ -1430,6 +1724,8 @@ R_API RList *r_anal_fcn_get_xrefs(RAnal *anal, RAnalFunction *fcn);
 R_API int r_anal_xrefs_from(RAnal *anal, RList *list, const char *kind, const RAnalRefType type, ut64 addr);
 R_API int r_anal_xrefs_set(RAnal *anal, ut64 from, ut64 to, const RAnalRefType type);
 R_API int r_anal_xrefs_deln(RAnal *anal, ut64 from, ut64 to, const RAnalRefType type);
+R_API int r_anal_xrefs_set_bulk(RAnal *anal, const RAnalRef *refs, int count);
+R_API int r_anal_xrefs_del_range(RAnal *anal, ut64 from, ut64 to);
 R_API int r_anal_xref_del(RAnal *anal, ut64 at, ut64 addr);
 
 R_API RList* r_anal_fcn_get_vars (RAnalFunction *anal);
@@ -1464,9 +1760,15 @@ R_API void extract_vars(RAnal *anal, RAnalFunction *fcn, RAnalOp *op);
 R_API void extract_rarg(RAnal *anal, RAnalOp *op, RAnalFunction *fcn, int *reg_set, int *count);
 R_API RAnalVarAccess *r_anal_var_access_get(RAnal *anal, RAnalVar *var, ut64 from);
 R_API RAnalVar *r_anal_var_get_byname (RAnal *anal, ut64 addr, const char* name);
+R_API RAnalFcnVar *r_anal_fcn_var_get(RAnalFunction *fcn, char kind, int delta);
+R_API RAnalFcnVar *r_anal_fcn_var_get_byname(RAnalFunction *fcn, const char *name);
+R_API RAnalVarUse *r_anal_fcn_var_use(RAnalFunction *fcn, ut64 addr);
+R_API RAnalVar *r_anal_fcn_var_dup(RAnalFunction *fcn, RAnalFcnVar *v);
+R_API void r_anal_fcn_vars_fini(RAnalFunction *fcn);
 
 /* project */
 R_API bool r_anal_xrefs_init (RAnal *anal);
+R_API void r_anal_xrefs_fini (RAnal *anal);
 
 #define R_ANAL_THRESHOLDFCN 0.7F
 #define R_ANAL_THRESHOLDBB 0.7F
@@ -1542,7 +1844,7 @@ R_API void r_anal_data_free (RAnalData *d);
 R_API char *r_anal_data_to_string(RAnalData *d, RConsPrintablePalette *pal);
 
 R_API void r_meta_free(RAnal *m);
-R_API void r_meta_space_unset_for(RAnal *a, int type);
+R_API void r_meta_space_unset_for(RAnal *a, int space_idx);
 R_API int r_meta_space_count_for(RAnal *a, int space_idx);
 R_API RList *r_meta_enumerate(RAnal *a, int type);
 R_API int r_meta_count(RAnal *m, int type, ut64 from, ut64 to);
@@ -1556,28 +1858,36 @@ R_API int r_meta_add(RAnal *m, int type, ut64 from, ut64 size, const char *str);
 R_API int r_meta_add_with_subtype(RAnal *m, int type, int subtype, ut64 from, ut64 size, const char *str);
 R_API RAnalMetaItem *r_meta_find(RAnal *m, ut64 off, int type, int where);
 R_API RAnalMetaItem *r_meta_find_in(RAnal *m, ut64 off, int type, int where);
+R_API RAnalMetaItem *r_meta_find_next(RAnal *m, ut64 off, int type);
+R_API void r_meta_foreach_at(RAnal *m, ut64 off, int type, RAnalMetaItemCb cb, void *user);
+R_API int r_meta_import(RAnal *m, const RAnalMetaItem *items, int count);
 R_API int r_meta_cleanup(RAnal *m, ut64 from, ut64 to);
 R_API const char *r_meta_type_to_string(int type);
 R_API RList *r_meta_enumerate(RAnal *a, int type);
 R_API int r_meta_list(RAnal *m, int type, int rad);
 R_API int r_meta_list_at(RAnal *m, int type, int rad, ut64 addr);
-R_API int r_meta_list_cb(RAnal *m, int type, int rad, SdbForeachCallback cb, void *user, ut64 addr);
+R_API int r_meta_list_cb(RAnal *m, int type, int rad, RAnalMetaCallback cb, void *user, ut64 addr);
 R_API void r_meta_item_free(void *_item);
 R_API RAnalMetaItem *r_meta_item_new(int type);
-R_API bool r_meta_deserialize_val(RAnalMetaItem *it, int type, ut64 from, const char *v);
 R_API void r_meta_print(RAnal *a, RAnalMetaItem *d, int rad, bool show_full);
 
 /* hints */
 
 R_API void r_anal_build_range_on_hints (RAnal *a);
 //R_API void r_anal_hint_list (RAnal *anal, int mode);
-R_API RAnalHint *r_anal_hint_from_string(RAnal *a, ut64 addr, const char *str);
 R_API void r_anal_hint_del (RAnal *anal, ut64 addr, int size);
 R_API void r_anal_hint_clear (RAnal *a);
 R_API RAnalHint *r_anal_hint_at (RAnal *a, ut64 from);
 R_API RAnalHint *r_anal_hint_add (RAnal *a, ut64 from, int size);
 R_API void r_anal_hint_free (RAnalHint *h);
 R_API RAnalHint *r_anal_hint_get(RAnal *anal, ut64 addr);
+R_API bool r_anal_hint_lookup(RAnal *a, ut64 addr, RAnalHint *hint);
+R_API int r_anal_hint_bits_at(RAnal *a, ut64 addr);
+R_API const char *r_anal_hint_arch_at(RAnal *a, ut64 addr);
+R_API void r_anal_hint_foreach(RAnal *a, RAnalHintCb cb, void *user);
+R_API void r_anal_hint_range_foreach(RAnal *a, RAnalRangeHintCb cb, void *user);
+R_API void r_anal_hint_set_bits_range(RAnal *a, ut64 addr, ut64 size, int bits);
+R_API void r_anal_hint_set_arch_range(RAnal *a, ut64 addr, ut64 size, const char *arch);
 R_API void r_anal_hint_set_syntax (RAnal *a, ut64 addr, const char *syn);
 R_API void r_anal_hint_set_jump (RAnal *a, ut64 addr, ut64 ptr);
 R_API void r_anal_hint_set_offset (RAnal *a, ut64 addr, const char *typeoff);
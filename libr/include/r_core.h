@@ -253,6 +253,7 @@ typedef struct r_core_t {
 	bool pava;
 	struct r_core_t *c2;
 	RCoreAutocomplete *autocomplete;
+	RVector anal_dirty; // ut64 addresses of the functions patched since the last reanalysis
 } RCore;
 
 R_API int r_core_bind(RCore *core, RCoreBind *bnd);
@@ -490,10 +491,16 @@ R_API int r_core_anal_graph_fcn(RCore *core, char *input, int opts);
 R_API RList* r_core_anal_graph_to(RCore *core, ut64 addr, int n);
 R_API int r_core_anal_ref_list(RCore *core, int rad);
 R_API int r_core_anal_all(RCore *core);
+R_API void r_core_anal_dirty(RCore *core, ut64 addr, int len);
+typedef void (*RCoreAnalWorkCb)(RCore *core, void *user, int worker, int nworkers, RStrBuf *log);
+typedef void (*RCoreAnalMergeCb)(RCore *core, void *user, int worker, int nworkers, char *log);
+R_API bool r_core_anal_workers(RCore *core, int nworkers, RCoreAnalWorkCb work, RCoreAnalMergeCb merge, void *user);
+R_API int r_core_anal_reanal(RCore *core);
 R_API RList* r_core_anal_cycles (RCore *core, int ccl);
 
 /*tp.c*/
 R_API void r_core_anal_type_match(RCore *core, RAnalFunction *fcn);
+R_API bool r_core_anal_type_match_parallel(RCore *core, int nworkers);
 
 /* asm.c */
 typedef struct r_core_asm_hit {
@@ -41,7 +41,10 @@ typedef struct r_io_undo_t {
 	int s_enable;
 	int w_enable;
 	/* write stuff */
-	RList *w_list;
+	RList *w_list;	// RIOUndoWrite in write order
+	RBNode *w_tree;	// the same entries by offset
+	ut64 w_size;	// memory taken by the entries
+	ut64 w_limit;	// w_size cap, 0 for none
 	int w_init;
 	/* seek stuff */
 	int idx;
@@ -57,8 +60,55 @@ typedef struct r_io_undo_w_t {
 	ut8 *o;   /* old data */
 	ut8 *n;   /* new data */
 	int len;  /* length */
+	int olen; /* stored size of o, less than len when lz4 compressed */
+	int nlen; /* stored size of n */
+	RBNode rb;
+	ut64 rb_max_addr;
 } RIOUndoWrite;
 
+typedef struct r_io_rcache_page_t {
+	int fd;
+	int len;	// valid bytes, short at the end of the backend
+	ut64 addr;	// page aligned paddr
+	ut8 *buf;
+	struct r_io_rcache_page_t *hnext;	// hash bucket chain
+	struct r_io_rcache_page_t *prev;	// lru list, most recently used first
+	struct r_io_rcache_page_t *next;
+} RIORCachePage;
+
+typedef struct r_io_rcache_t {
+	bool enabled;
+	ut32 bsize;	// page size, power of two
+	ut32 pages;	// max amount of cached pages
+	ut32 count;
+	ut32 nbuckets;
+	RIORCachePage **buckets;
+	RIORCachePage *head;
+	RIORCachePage *tail;
+	ut64 hits;
+	ut64 misses;
+	ut64 evictions;
+	ut64 invalidations;
+} RIORCache;
+
+#define R_IO_PROF_HIST 16
+
+typedef struct r_io_prof_stat_t {
+	ut64 calls;
+	ut64 bytes;
+	ut64 usec;	// time spent in the calls
+	ut64 max;	// slowest call
+	ut64 hist[R_IO_PROF_HIST];	// calls under 2^i usecs, the last one takes the rest
+} RIOProfStat;
+
+typedef struct r_io_prof_t {
+	bool enabled;
+	const char *cmd;	// command being run, set by the core for attribution
+	RIOProfStat read;	// every backend read
+	RIOProfStat write;
+	SdbHash *ht;	// "plugin:name", "map:id" and "cmd:name" breakdowns
+} RIOProf;
+
 typedef struct r_io_t {
 	struct r_io_desc_t *desc;
 	ut64 off;
@@ -73,12 +123,17 @@ typedef struct r_io_t {
 	bool cachemode; // write in cache all the read operations (EXPERIMENTAL)
 	int p_cache;
 	int buffer_enabled;
+	bool zindex; // keep the gzip/zip random access indexes beside the files
 	int debug;
 //#warning remove debug from RIO
 	RIDPool *sec_ids;
 	RIDPool *map_ids;
 	SdbList *maps; //from tail backwards maps with higher priority are found
 	RPVector map_skyline; // map parts that are not covered by others
+	RPVector map_pskyline; // same for the physical ranges, built on demand
+	bool skyline_dirty;
+	bool pskyline_dirty;
+	int map_batch;
 	SdbList *sections;
 	RIDStorage *files;
 	RCache *buffer;
@@ -87,6 +142,8 @@ typedef struct r_io_t {
 	ut8 *write_mask;
 	int write_mask_len;
 	RIOUndo undo;
+	RIORCache rcache;
+	RIOProf prof;
 	SdbList *plugins;
 	char *runprofile;
 	char *args;
@@ -95,6 +152,7 @@ typedef struct r_io_t {
 	int (*cb_core_cmd)(void *user, const char *str);
 	char* (*cb_core_cmdstr)(void *user, const char *str);
 	void (*cb_core_post_write)(void *user, ut64 maddr, ut8 *orig_bytes, int orig_len);
+	void (*cb_core_write)(void *user, ut64 addr, int len);	// after every r_io_write_at that succeeded
 } RIO;
 
 typedef struct r_io_desc_t {
@@ -104,7 +162,8 @@ typedef struct r_io_desc_t {
 	char *uri;
 	char *name;
 	char *referer;
-	Sdb *cache;
+	struct r_io_desc_cache_table_t *cache;
+	bool nocache;	// bypass the io.rcache page cache
 	void *data;
 	struct r_io_plugin_t *plugin;
 	RIO *io;
@@ -134,6 +193,14 @@ typedef struct {
 #define RMT_CMD    0x07
 #define RMT_REPLY  0x80
 
+// one element of a scatter-gather read
+typedef struct r_io_read_vec_t {
+	ut64 addr;
+	ut8 *buf;
+	int len;
+	int ret; // bytes read, < 0 on error
+} RIOReadVec;
+
 typedef struct r_io_plugin_t {
 	char *name;
 	char *desc;
@@ -150,6 +217,13 @@ typedef struct r_io_plugin_t {
 	RIODesc* (*open)(RIO *io, const char *, int rw, int mode);
 	RList* /*RIODesc* */ (*open_many)(RIO *io, const char *, int rw, int mode);
 	int (*read)(RIO *io, RIODesc *fd, ut8 *buf, int count);
+	// optional, vec is sorted by addr. Fills every ret or returns false to
+	// let RIO read the elements one by one
+	bool (*read_vec)(RIO *io, RIODesc *fd, RIOReadVec *vec, int count);
+	// optional, returns the backing bytes at addr without copying them and
+	// clamps *len to what is available there. Valid until the next write,
+	// resize or close of fd
+	const ut8 *(*view)(RIO *io, RIODesc *fd, ut64 addr, ut64 *len);
 	ut64 (*lseek)(RIO *io, RIODesc *fd, ut64 offset, int whence);
 	int (*write)(RIO *io, RIODesc *fd, const ut8 *buf, int count);
 	int (*close)(RIODesc *desc);
@@ -178,6 +252,8 @@ typedef struct r_io_map_skyline_t {
 	RInterval itv;
 } RIOMapSkyline;
 
+typedef struct r_io_read_ahead_t RIOReadAhead;
+
 typedef struct r_io_section_t {
 	char *name;
 	ut64 paddr;
@@ -207,12 +283,26 @@ typedef struct r_io_cache_t {
 	int written;
 } RIOCache;
 
-#define R_IO_DESC_CACHE_SIZE (sizeof(ut64) * 8)
+#define R_IO_DESC_CACHE_SHIFT 6
+#define R_IO_DESC_CACHE_SIZE (1 << R_IO_DESC_CACHE_SHIFT)
 typedef struct r_io_desc_cache_t {
-	ut64 cached;
+	ut64 cached;	// bitmap of the written bytes in cdata
 	ut8 cdata[R_IO_DESC_CACHE_SIZE];
 } RIODescCache;
 
+#define R_IO_DESC_CACHE_FANOUT 64
+typedef struct r_io_desc_cache_node_t {
+	void *slot[R_IO_DESC_CACHE_FANOUT];	// child nodes, or RIODescCache pages at the last level
+	int used;
+} RIODescCacheNode;
+
+// radix page table indexed by paddr >> R_IO_DESC_CACHE_SHIFT
+typedef struct r_io_desc_cache_table_t {
+	RIODescCacheNode *root;
+	int height;
+	ut64 pages;
+} RIODescCacheTable;
+
 typedef struct r_io_access_log_element_t {
 	ut64 vaddr;
 	ut64 paddr;
@@ -239,6 +329,7 @@ typedef RIODesc *(*RIOOpen) (RIO *io, const char *uri, int flags, int mode);
 typedef RIODesc *(*RIOOpenAt) (RIO *io, const  char *uri, int flags, int mode, ut64 at);
 typedef bool (*RIOClose) (RIO *io, int fd);
 typedef bool (*RIOReadAt) (RIO *io, ut64 addr, ut8 *buf, int len);
+typedef bool (*RIOReadBatch) (RIO *io, RIOReadVec *vec, int count);
 typedef RIOAccessLog *(*RIOAlReadAt) (RIO *io, ut64 addr, ut8 *buf, int len);
 typedef bool (*RIOWriteAt) (RIO *io, ut64 addr, const ut8 *buf, int len);
 typedef char *(*RIOSystem) (RIO *io, const char* cmd);
@@ -249,6 +340,7 @@ typedef ut64 (*RIOFdSize) (RIO *io, int fd);
 typedef int (*RIOFdRead) (RIO *io, int fd, ut8 *buf, int len);
 typedef int (*RIOFdWrite) (RIO *io, int fd, const ut8 *buf, int len);
 typedef int (*RIOFdReadAt) (RIO *io, int fd, ut64 addr, ut8 *buf, int len);
+typedef const ut8 *(*RIOFdView) (RIO *io, int fd, ut64 addr, ut64 *len);
 typedef int (*RIOFdWriteAt) (RIO *io, int fd, ut64 addr, const ut8 *buf, int len);
 typedef bool (*RIOFdIsDbg) (RIO *io, int fd);
 typedef const char *(*RIOFdGetName) (RIO *io, int fd);
@@ -273,6 +365,7 @@ typedef struct r_io_bind_t {
 	RIOOpenAt open_at;
 	RIOClose close;
 	RIOReadAt read_at;
+	RIOReadBatch read_batch;
 	RIOAlReadAt al_read_at;	//needed for esil
 	RIOWriteAt write_at;
 	RIOSystem system;
@@ -283,6 +376,7 @@ typedef struct r_io_bind_t {
 	RIOFdRead fd_read;	//needed for esil
 	RIOFdWrite fd_write;	//needed for esil
 	RIOFdReadAt fd_read_at;
+	RIOFdView fd_view;
 	RIOFdWriteAt fd_write_at;
 	RIOFdIsDbg fd_is_dbg;
 	RIOFdGetName fd_get_name;
@@ -323,6 +417,9 @@ R_API void r_io_map_set_name (RIOMap *map, const char *name);
 R_API void r_io_map_del_name (RIOMap *map);
 R_API RIOMap *r_io_map_add_next_available(RIO *io, int fd, int flags, ut64 delta, ut64 addr, ut64 size, ut64 load_align);
 R_API void r_io_map_calculate_skyline(RIO *io);
+R_API const RPVector *r_io_map_get_skyline(RIO *io);
+R_API void r_io_map_batch_begin(RIO *io);
+R_API void r_io_map_batch_end(RIO *io);
 R_API RList* r_io_map_get_for_fd(RIO *io, int fd);
 R_API bool r_io_map_resize(RIO *io, ut32 id, ut64 newsize);
 
@@ -345,6 +442,13 @@ R_API RIOAccessLog *r_io_al_vwrite_at (RIO *io, ut64 vaddr, const ut8 *buf, int
 R_API bool r_io_read_at (RIO *io, ut64 addr, ut8 *buf, int len);
 R_API bool r_io_read_at_mapped(RIO *io, ut64 addr, ut8 *buf, int len);
 R_API int r_io_nread_at (RIO *io, ut64 addr, ut8 *buf, int len);
+R_API bool r_io_read_batch(RIO *io, RIOReadVec *vec, int count);
+R_API const ut8 *r_io_view(RIO *io, ut64 addr, ut64 *len);
+R_API const ut8 *r_io_view_at(RIO *io, ut64 addr, ut8 *buf, int len);
+R_API RIOReadAhead *r_io_ra_new(RIO *io, ut64 from, ut64 to, int bsize, int depth);
+R_API const ut8 *r_io_ra_next(RIOReadAhead *ra, ut64 *addr, int *len);
+R_API bool r_io_ra_failed(RIOReadAhead *ra);
+R_API void r_io_ra_free(RIOReadAhead *ra);
 R_API RIOAccessLog *r_io_al_read_at (RIO *io, ut64 addr, ut8 *buf, int len);
 R_API void r_io_alprint(RList *ls);
 R_API bool r_io_write_at (RIO *io, ut64 addr, const ut8 *buf, int len);
@@ -395,6 +499,8 @@ R_API void r_io_wundo_apply_all(RIO *io, int set);
 R_API int r_io_wundo_apply(RIO *io, struct r_io_undo_w_t *u, int set);
 R_API void r_io_wundo_clear(RIO *io);
 R_API int r_io_wundo_size(RIO *io);
+R_API void r_io_wundo_set_limit(RIO *io, ut64 limit);
+R_API RList *r_io_wundo_at(RIO *io, ut64 addr, int len);
 R_API void r_io_wundo_list(RIO *io);
 R_API int r_io_wundo_set_t(RIO *io, RIOUndoWrite *u, int set) ;
 R_API void r_io_wundo_set_all(RIO *io, int set);
@@ -421,6 +527,8 @@ R_API int r_io_desc_get_pid (RIODesc *desc);
 R_API int r_io_desc_get_tid (RIODesc *desc);
 R_API bool r_io_desc_get_base (RIODesc *desc, ut64 *base);
 R_API int r_io_desc_read_at (RIODesc *desc, ut64 addr, ut8 *buf, int len);
+R_API bool r_io_desc_read_vec(RIODesc *desc, RIOReadVec *vec, int count);
+R_API const ut8 *r_io_desc_view(RIODesc *desc, ut64 paddr, ut64 *len);
 R_API int r_io_desc_write_at (RIODesc *desc, ut64 addr, const ut8 *buf, int len);
 R_API bool r_io_desc_fini (RIO *io);
 
@@ -435,6 +543,29 @@ R_API void r_io_cache_reset(RIO *io, int set);
 R_API bool r_io_cache_write(RIO *io, ut64 addr, const ut8 *buf, int len);
 R_API bool r_io_cache_read(RIO *io, ut64 addr, ut8 *buf, int len);
 
+/* io/rcache.c */
+R_API void r_io_rcache_init(RIO *io);
+R_API void r_io_rcache_fini(RIO *io);
+R_API bool r_io_rcache_setup(RIO *io, ut32 bsize, ut32 pages);
+R_API void r_io_rcache_enable(RIO *io, bool enable);
+R_API bool r_io_rcache_active(RIODesc *desc);
+R_API int r_io_rcache_read(RIODesc *desc, ut64 paddr, ut8 *buf, int len);
+R_API void r_io_rcache_invalidate(RIO *io, int fd, ut64 paddr, ut64 size);
+R_API void r_io_rcache_flush_fd(RIO *io, int fd);
+R_API void r_io_rcache_flush(RIO *io);
+R_API void r_io_rcache_reset_stats(RIO *io);
+R_API void r_io_rcache_stats(RIO *io, int mode);
+
+/* io/prof.c */
+R_API void r_io_prof_init(RIO *io);
+R_API void r_io_prof_fini(RIO *io);
+R_API void r_io_prof_enable(RIO *io, bool enable);
+R_API void r_io_prof_reset(RIO *io);
+R_API ut64 r_io_prof_now(void);
+R_API void r_io_prof_backend(RIODesc *desc, bool write, int len, ut64 usec);
+R_API void r_io_prof_map(RIO *io, RIOMap *map, bool write, int len, ut64 usec);
+R_API void r_io_prof_dump(RIO *io, int mode);
+
 /* io/section.c */
 R_API void r_io_section_init (RIO *io);
 R_API void r_io_section_fini (RIO *io);
@@ -466,6 +597,7 @@ R_API ut64 r_io_section_get_vaddr_at(RIO *io, ut64 addr);
 R_API bool r_io_desc_cache_init (RIODesc *desc);
 R_API int r_io_desc_cache_write (RIODesc *desc, ut64 paddr, const ut8 *buf, int len);
 R_API int r_io_desc_cache_read (RIODesc *desc, ut64 paddr, ut8 *buf, int len);
+R_API bool r_io_desc_cache_overlaps(RIODesc *desc, ut64 paddr, ut64 len);
 R_API bool r_io_desc_cache_commit (RIODesc *desc);
 R_API void r_io_desc_cache_cleanup (RIODesc *desc);
 R_API void r_io_desc_cache_fini (RIODesc *desc);
@@ -488,6 +620,7 @@ R_API ut64 r_io_fd_size (RIO *io, int fd);
 R_API bool r_io_fd_resize (RIO *io, int fd, ut64 newsize);
 R_API bool r_io_fd_is_blockdevice (RIO *io, int fd);
 R_API int r_io_fd_read_at (RIO *io, int fd, ut64 addr, ut8 *buf, int len);
+R_API const ut8 *r_io_fd_view(RIO *io, int fd, ut64 addr, ut64 *len);
 R_API int r_io_fd_write_at (RIO *io, int fd, ut64 addr, const ut8 *buf, int len);
 R_API bool r_io_fd_is_dbg (RIO *io, int fd);
 R_API int r_io_fd_get_pid (RIO *io, int fd);
@@ -91,7 +91,7 @@ typedef struct r_reg_item_t {
 	int packed_size; /* 0 means no packed register, 1byte pack, 2b pack... */
 	bool is_float;
 	char *flags;
-	int index;
+	int index; /* stable id in the profile, see r_reg_index_get */
 	int arena; /* in which arena is this reg living */
 } RRegItem;
 
@@ -115,12 +115,16 @@ typedef struct r_reg_t {
 	char *name[R_REG_NAME_LAST]; // aliases
 	RRegSet regset[R_REG_TYPE_LAST];
 	RList *allregs;
+	RRegItem **items; /* allregs by index */
+	int nitems;
+	SdbHash *ht; /* name -> RRegItem, built by r_reg_reindex */
 	int iters;
 	int arch;
 	int bits;
 	int size;
 	bool is_thumb;
 	bool big_endian;
+	ut32 profile_gen; // changes every time the registers are freed
 } RReg;
 
 typedef struct r_reg_flags_t {
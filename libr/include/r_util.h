@@ -70,6 +70,7 @@ int gettimeofday (struct timeval* p, void* tz);
 #include "r_util/r_json.h"
 #include "r_util/r_x509.h"
 #include "r_util/r_pkcs7.h"
+#include "r_util/r_zran.h"
 
 #ifdef __cplusplus
 extern "C" {
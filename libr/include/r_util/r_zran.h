@@ -0,0 +1,54 @@
+#ifndef R_ZRAN_H
+#define R_ZRAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define R_ZRAN_WINSIZE 32768
+#define R_ZRAN_SPAN (1024 * 1024)
+
+// reads len bytes of the compressed data at off, returns the amount read
+typedef int (*RZranRead)(void *user, ut64 off, ut8 *buf, int len);
+
+typedef enum {
+	R_ZRAN_AUTO,	// gzip or zlib streams, members may be concatenated
+	R_ZRAN_RAW,	// bare deflate, as stored in zip archives
+} RZranFormat;
+
+// restart point of the inflater
+typedef struct r_zran_point_t {
+	ut64 out;	// uncompressed offset
+	ut64 in;	// offset of the first compressed byte past it
+	int bits;	// bits of the byte before in that belong to it
+	ut8 *window;	// the R_ZRAN_WINSIZE bytes of output before out
+} RZranPoint;
+
+typedef struct r_zran_t {
+	RZranRead read;
+	void *user;
+	ut64 in_size;
+	ut64 span;
+	RZranFormat format;
+	int trailer;	// bytes after each member, 8 for gzip and 4 for zlib
+	RZranPoint *points;
+	int npoints;
+	int points_size;
+	bool complete;	// the whole stream was inflated once
+	ut64 size;	// uncompressed bytes seen so far, the total once complete
+	void *build;	// inflater extending the index
+	void *cursor;	// inflater of the last random read
+} RZran;
+
+R_API RZran *r_zran_new(RZranRead read, void *user, ut64 in_size, RZranFormat format, ut64 span);
+R_API void r_zran_free(RZran *z);
+R_API int r_zran_read(RZran *z, ut64 off, ut8 *buf, int len);
+R_API ut64 r_zran_size(RZran *z);
+R_API bool r_zran_save(RZran *z, const char *file);
+R_API bool r_zran_load(RZran *z, const char *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
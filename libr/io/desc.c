@@ -77,6 +77,7 @@ R_API bool r_io_desc_del(RIO* io, int fd) {		//can we pass this a riodesc and ch
 	if (!io || !io->files || !(desc = r_id_storage_get (io->files, fd))) {
 		return false;
 	}
+	r_io_rcache_flush_fd (io, fd);
 	r_io_desc_free (desc);
 	if (desc == io->desc) {
 		io->desc = NULL;
@@ -148,6 +149,10 @@ R_API int r_io_desc_write(RIODesc *desc, const ut8* buf, int len) {
 		return r_io_desc_cache_write (desc,
 				r_io_desc_seek (desc, 0LL, R_IO_SEEK_CUR), buf, len);
 	}
+	if (desc->io && desc->io->rcache.count) {
+		r_io_rcache_invalidate (desc->io, desc->fd,
+				r_io_desc_seek (desc, 0LL, R_IO_SEEK_CUR), len);
+	}
 	return r_io_plugin_write (desc, buf, len);
 }
 
@@ -194,6 +199,9 @@ R_API ut64 r_io_desc_size(RIODesc* desc) {
 R_API bool r_io_desc_resize(RIODesc *desc, ut64 newsize) {
 	if (desc && desc->plugin && desc->plugin->resize) {
 		bool ret = desc->plugin->resize (desc->io, desc, newsize);
+		if (desc->io) {
+			r_io_rcache_flush_fd (desc->io, desc->fd);
+		}
 		if (desc->io && desc->io->p_cache) {
 			r_io_desc_cache_cleanup (desc);
 		}
@@ -216,12 +224,14 @@ R_API bool r_io_desc_exchange(RIO* io, int fd, int fdx) {
 	if (!(desc = r_io_desc_get (io, fd)) || !(descx = r_io_desc_get (io, fdx))) {
 		return false;
 	}
+	r_io_rcache_flush_fd (io, fd);
+	r_io_rcache_flush_fd (io, fdx);
 	desc->fd = fdx;
 	descx->fd = fd;
 	r_id_storage_set (io->files, desc,  fdx);
 	r_id_storage_set (io->files, descx, fd);
 	if (io->p_cache) {
-		Sdb* cache = desc->cache;
+		RIODescCacheTable *cache = desc->cache;
 		desc->cache = descx->cache;
 		descx->cache = cache;
 		r_io_desc_cache_cleanup (desc);
@@ -288,12 +298,86 @@ R_API bool r_io_desc_get_base (RIODesc *desc, ut64 *base) {
 }
 
 R_API int r_io_desc_read_at(RIODesc *desc, ut64 addr, ut8 *buf, int len) {
+	if (desc && buf && len > 0 && desc->plugin && r_io_rcache_active (desc)) {
+		int ret = r_io_rcache_read (desc, addr, buf, len);
+		if (ret > 0 && (desc->io->p_cache & 1)) {
+			ret = r_io_desc_cache_read (desc, addr, buf, ret);
+		}
+		return ret;
+	}
 	if (desc && buf && (r_io_desc_seek (desc, addr, R_IO_SEEK_SET) == addr)) {
 		return r_io_desc_read (desc, buf, len);
 	}
 	return 0;
 }
 
+static bool desc_read_vec(RIODesc *desc, RIOReadVec *vec, int count) {
+	RIO *io = desc->io;
+	if (io->prof.enabled) {
+		int i, len = 0;
+		ut64 t = r_io_prof_now ();
+		bool ret = desc->plugin->read_vec (io, desc, vec, count);
+		for (i = 0; ret && i < count; i++) {
+			len += R_MAX (vec[i].ret, 0);
+		}
+		// an unhandled vector is read again one element at a time
+		r_io_prof_backend (desc, false, len, r_io_prof_now () - t);
+		return ret;
+	}
+	return desc->plugin->read_vec (io, desc, vec, count);
+}
+
+// reads every element of vec from desc, using the plugin's read_vec when it
+// has one. Returns true iff all the elements were read completely.
+R_API bool r_io_desc_read_vec(RIODesc *desc, RIOReadVec *vec, int count) {
+	int i;
+	bool ret = true;
+	if (!desc || !desc->plugin || !vec || count < 1 || !(desc->flags & R_IO_READ)) {
+		return false;
+	}
+	RIO *io = desc->io;
+	// cachemode and the page cache need to see every read
+	if (desc->plugin->read_vec && !io->cachemode && !r_io_rcache_active (desc)
+			&& desc_read_vec (desc, vec, count)) {
+		for (i = 0; i < count; i++) {
+			if (vec[i].ret > 0 && (io->p_cache & 1)) {
+				vec[i].ret = r_io_desc_cache_read (desc, vec[i].addr, vec[i].buf, vec[i].ret);
+			}
+			if (vec[i].ret != vec[i].len) {
+				ret = false;
+			}
+		}
+		return ret;
+	}
+	for (i = 0; i < count; i++) {
+		vec[i].ret = r_io_desc_read_at (desc, vec[i].addr, vec[i].buf, vec[i].len);
+		if (vec[i].ret != vec[i].len) {
+			ret = false;
+		}
+	}
+	return ret;
+}
+
+// returns the plugin's own bytes at paddr without copying them, *len is
+// clamped to the bytes available there. NULL when the plugin has no view
+// or a cache would make them differ from what r_io_desc_read_at returns
+R_API const ut8 *r_io_desc_view(RIODesc *desc, ut64 paddr, ut64 *len) {
+	if (!desc || !desc->plugin || !desc->plugin->view || !len || !*len
+			|| !(desc->flags & R_IO_READ) || !desc->io || desc->io->cachemode) {
+		return NULL;
+	}
+	ut64 n = *len;
+	const ut8 *ret = desc->plugin->view (desc->io, desc, paddr, &n);
+	if (!ret || !n) {
+		return NULL;
+	}
+	if ((desc->io->p_cache & 1) && r_io_desc_cache_overlaps (desc, paddr, n)) {
+		return NULL;
+	}
+	*len = n;
+	return ret;
+}
+
 R_API int r_io_desc_write_at(RIODesc *desc, ut64 addr, const ut8 *buf, int len) {
 	if (desc && buf && (r_io_desc_seek (desc, addr, R_IO_SEEK_SET) == addr)) {
 		return r_io_desc_write (desc, buf, len);
@@ -57,6 +57,14 @@ R_API int r_io_fd_read_at(RIO *io, int fd, ut64 addr, ut8 *buf, int len) {
 	return r_io_desc_read_at (desc, addr, buf, len);
 }
 
+R_API const ut8 *r_io_fd_view(RIO *io, int fd, ut64 addr, ut64 *len) {
+	RIODesc *desc;
+	if (!io || !(desc = r_io_desc_get (io, fd))) {
+		return NULL;
+	}
+	return r_io_desc_view (desc, addr, len);
+}
+
 //returns length of written bytes
 R_API int r_io_fd_write_at(RIO *io, int fd, ut64 addr, const ut8 *buf, int len) {
 	RIODesc *desc;
@@ -7,10 +7,22 @@
 R_LIB_VERSION (r_io);
 
 static int fd_read_at_wrap (RIO *io, int fd, ut64 addr, ut8 *buf, int len, RIOMap *map, void *user) {
+	if (io->prof.enabled && map) {
+		ut64 t = r_io_prof_now ();
+		int ret = r_io_fd_read_at (io, fd, addr, buf, len);
+		r_io_prof_map (io, map, false, ret, r_io_prof_now () - t);
+		return ret;
+	}
 	return r_io_fd_read_at (io, fd, addr, buf, len);
 }
 
 static int fd_write_at_wrap (RIO *io, int fd, ut64 addr, ut8 *buf, int len, RIOMap *map, void *user) {
+	if (io->prof.enabled && map) {
+		ut64 t = r_io_prof_now ();
+		int ret = r_io_fd_write_at (io, fd, addr, buf, len);
+		r_io_prof_map (io, map, true, ret, r_io_prof_now () - t);
+		return ret;
+	}
 	return r_io_fd_write_at (io, fd, addr, buf, len);
 }
 
@@ -59,7 +71,7 @@ typedef int (*cbOnIterMap)(RIO *io, int fd, ut64 addr, ut8 *buf, int len, RIOMap
 // If prefix_mode is true, returns the number of bytes of operated prefix; returns < 0 on error.
 // If prefix_mode is false, operates in non-stop mode and returns true iff all IO operations on overlapped maps are complete.
 static st64 on_map_skyline(RIO *io, ut64 vaddr, ut8 *buf, int len, int match_flg, cbOnIterMap op, bool prefix_mode) {
-	const RPVector *skyline = &io->map_skyline;
+	const RPVector *skyline = r_io_map_get_skyline (io);
 	ut64 addr = vaddr;
 	size_t i;
 	bool ret = true, wrap = !prefix_mode && vaddr + len < vaddr;
@@ -209,9 +221,12 @@ R_API RIO* r_io_init(RIO* io) {
 	io->addrbytes = 1;
 	r_io_desc_init (io);
 	r_pvector_init (&io->map_skyline, free);
+	r_pvector_init (&io->map_pskyline, free);
 	r_io_map_init (io);
 	r_io_section_init (io);
 	r_io_cache_init (io);
+	r_io_rcache_init (io);
+	r_io_prof_init (io);
 	r_io_plugin_init (io);
 	r_io_undo_init (io);
 	return io;
@@ -367,6 +382,7 @@ R_API int r_io_close_all(RIO* io) { // what about undo?
 	if (!io) {
 		return false;
 	}
+	r_io_rcache_flush (io);
 	r_io_desc_fini (io);
 	r_io_map_fini (io);
 	r_io_section_fini (io);
@@ -529,6 +545,294 @@ R_API int r_io_nread_at(RIO *io, ut64 addr, ut8 *buf, int len) {
 	return ret;
 }
 
+// part of a batch run that lives in one map
+typedef struct {
+	int fd;
+	int run;
+	ut64 paddr;
+	ut64 vaddr;
+	ut8 *buf;
+	int len;
+	int ret;
+} BatchSeg;
+
+// requests that are adjacent or overlap are read as a single run
+typedef struct {
+	ut64 addr;
+	ut8 *buf;
+	int len;
+	int first;
+	int count;
+	bool failed;
+} BatchRun;
+
+static int batch_cmp_addr(const void *a, const void *b) {
+	const RIOReadVec *va = *(const RIOReadVec **)a, *vb = *(const RIOReadVec **)b;
+	return (va->addr > vb->addr) - (va->addr < vb->addr);
+}
+
+static int batch_cmp_seg(const void *a, const void *b) {
+	const BatchSeg *sa = a, *sb = b;
+	if (sa->fd != sb->fd) {
+		return sa->fd - sb->fd;
+	}
+	return (sa->paddr > sb->paddr) - (sa->paddr < sb->paddr);
+}
+
+// splits the run at [addr, addr + len) in the parts of the skyline
+static bool batch_split_run(RIO *io, RVector *segs, BatchRun *run, int idx) {
+	const RPVector *skyline = r_io_map_get_skyline (io);
+	ut64 addr = run->addr, end = run->addr + run->len;
+	size_t i;
+#define CMP(addr, part) (addr < r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? -1 : \
+			addr > r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? 1 : 0)
+	r_pvector_lower_bound (skyline, addr, i, CMP);
+#undef CMP
+	for (; i < r_pvector_len (skyline) && addr < end; i++) {
+		const RIOMapSkyline *part = r_pvector_at (skyline, i);
+		if (part->itv.addr >= end) {
+			break;
+		}
+		if (addr < part->itv.addr) {
+			addr = part->itv.addr;
+		}
+		ut64 last = R_MIN (end - 1, r_itv_end (part->itv) - 1);
+		BatchSeg seg = {
+			.fd = part->map->fd,
+			.run = idx,
+			.paddr = part->map->delta + addr - part->map->itv.addr,
+			.vaddr = addr,
+			.buf = run->buf + (addr - run->addr),
+			.len = (int)(last - addr + 1),
+		};
+		seg.ret = seg.len;
+		if (!(part->map->flags & R_IO_READ) && !io->p_cache) {
+			// not readable, keep it around to fail the requests on it
+			seg.fd = -1;
+			seg.ret = -1;
+		}
+		if (!r_vector_push (segs, &seg)) {
+			return false;
+		}
+		if (last == UT64_MAX) {
+			break;
+		}
+		addr = last + 1;
+	}
+	return true;
+}
+
+// Reads many small ranges at once. Requests are sorted and the ones that touch
+// are merged, then every run is split along the skyline and the pieces are
+// handed to each desc in one go, so plugins with read_vec (ptrace, gdb..) get
+// a single roundtrip. Each vec[i].ret is set to len if that range was read
+// completely, or to 0, like the bool returned by r_io_read_at.
+R_API bool r_io_read_batch(RIO *io, RIOReadVec *vec, int count) {
+	RIOReadVec **order = NULL;
+	BatchRun *runs = NULL;
+	RVector segs;
+	int i, j, nruns = 0;
+	bool ret = true;
+	if (!io || !vec || count < 1) {
+		return false;
+	}
+	if (!io->va || io->buffer_enabled) {
+		for (i = 0; i < count; i++) {
+			bool ok = vec[i].len > 0 && r_io_read_at (io, vec[i].addr, vec[i].buf, vec[i].len);
+			vec[i].ret = ok? vec[i].len: 0;
+			ret &= ok;
+		}
+		return ret;
+	}
+	r_vector_init (&segs, sizeof (BatchSeg), NULL, NULL);
+	order = calloc (count, sizeof (RIOReadVec *));
+	runs = calloc (count, sizeof (BatchRun));
+	if (!order || !runs) {
+		ret = false;
+		goto beach;
+	}
+	for (i = j = 0; i < count; i++) {
+		vec[i].ret = 0;
+		if (vec[i].len > 0 && vec[i].buf) {
+			order[j++] = &vec[i];
+		} else {
+			ret = false;
+		}
+	}
+	qsort (order, j, sizeof (RIOReadVec *), batch_cmp_addr);
+	for (i = 0; i < j; i++) {
+		RIOReadVec *v = order[i];
+		ut64 end = v->addr + v->len;
+		if (end < v->addr) {
+			// the address space wraps here, leave it to the slow path
+			bool ok = r_io_read_at (io, v->addr, v->buf, v->len);
+			v->ret = ok? v->len: 0;
+			ret &= ok;
+			continue;
+		}
+		BatchRun *run = nruns? &runs[nruns - 1]: NULL;
+		if (run && v->addr <= run->addr + run->len && end - run->addr <= ST32_MAX) {
+			if (end > run->addr + run->len) {
+				run->len = (int)(end - run->addr);
+			}
+			order[run->first + run->count++] = v;
+		} else {
+			run = &runs[nruns++];
+			run->addr = v->addr;
+			run->len = v->len;
+			run->first = i;
+			run->count = 1;
+			order[i] = v;
+		}
+	}
+	for (i = 0; i < nruns; i++) {
+		BatchRun *run = &runs[i];
+		if (run->count == 1) {
+			run->buf = order[run->first]->buf;
+		} else if (!(run->buf = malloc (run->len))) {
+			run->failed = true;
+			continue;
+		}
+		if (io->ff) {
+			memset (run->buf, io->Oxff, run->len);
+		}
+		if (!batch_split_run (io, &segs, run, i)) {
+			run->failed = true;
+		}
+	}
+	// group the pieces by desc, in physical address order
+	BatchSeg *seg = segs.a;
+	if (segs.len > 1) {
+		qsort (seg, segs.len, sizeof (BatchSeg), batch_cmp_seg);
+	}
+	RIOReadVec *pvec = calloc (R_MAX (segs.len, 1), sizeof (RIOReadVec));
+	if (!pvec) {
+		ret = false;
+		goto beach;
+	}
+	for (i = 0; i < segs.len; i = j) {
+		for (j = i; j < segs.len && seg[j].fd == seg[i].fd; j++) {
+			pvec[j - i] = (RIOReadVec){ seg[j].paddr, seg[j].buf, seg[j].len, 0 };
+		}
+		RIODesc *desc = seg[i].fd < 0? NULL: r_io_desc_get (io, seg[i].fd);
+		if (!desc || !r_io_desc_read_vec (desc, pvec, j - i)) {
+			int k;
+			for (k = i; k < j; k++) {
+				seg[k].ret = desc? pvec[k - i].ret: -1;
+			}
+		}
+	}
+	free (pvec);
+	// a short read only fails the requests that overlap it
+	for (i = 0; i < segs.len; i++) {
+		if (seg[i].ret != seg[i].len) {
+			BatchRun *run = &runs[seg[i].run];
+			for (j = 0; j < run->count; j++) {
+				RIOReadVec *v = order[run->first + j];
+				if (v->addr < seg[i].vaddr + seg[i].len && seg[i].vaddr < v->addr + v->len) {
+					v->ret = -1;
+				}
+			}
+		}
+	}
+	for (i = 0; i < nruns; i++) {
+		BatchRun *run = &runs[i];
+		if (run->buf && (io->cached & R_IO_READ)) {
+			(void)r_io_cache_read (io, run->addr, run->buf, run->len);
+		}
+		for (j = 0; j < run->count; j++) {
+			RIOReadVec *v = order[run->first + j];
+			if (run->buf && run->count > 1) {
+				memcpy (v->buf, run->buf + (v->addr - run->addr), v->len);
+			}
+			v->ret = (run->failed || v->ret < 0)? 0: v->len;
+			if (!v->ret) {
+				ret = false;
+			}
+		}
+	}
+beach:
+	if (runs) {
+		for (i = 0; i < nruns; i++) {
+			if (runs[i].count > 1) {
+				free (runs[i].buf);
+			}
+		}
+	}
+	free (runs);
+	free (order);
+	r_vector_clear (&segs);
+	return ret;
+}
+
+static bool cache_overlaps(RIO *io, ut64 addr, ut64 len) {
+	RIOCache *c;
+	RListIter *iter;
+	r_list_foreach (io->cache, iter, c) {
+		if (r_itv_overlap2 (c->itv, addr, len)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns the bytes at addr straight from the backing plugin (the mmap of
+// io_default and io_mmap) without copying them, *len is clamped to the
+// contiguous bytes available there. Returns NULL when the range can not be
+// viewed as is: no plugin support, an io.cache, p_cache or io.buffer overlay,
+// or a non readable map. The view is only valid until the next write, resize
+// or close of the desc behind it.
+R_API const ut8 *r_io_view(RIO *io, ut64 addr, ut64 *len) {
+	const ut8 *ret;
+	ut64 n;
+	if (!io || !len || !*len || io->buffer_enabled) {
+		return NULL;
+	}
+	n = *len;
+	if (io->va) {
+		const RPVector *skyline = r_io_map_get_skyline (io);
+		const RIOMapSkyline *part;
+		size_t i;
+#define CMP(addr, part) (addr < r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? -1 : \
+			addr > r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? 1 : 0)
+		r_pvector_lower_bound (skyline, addr, i, CMP);
+#undef CMP
+		if (i == r_pvector_len (skyline)) {
+			return NULL;
+		}
+		part = r_pvector_at (skyline, i);
+		if (addr < part->itv.addr || !((part->map->flags & R_IO_READ) || io->p_cache)) {
+			return NULL;
+		}
+		// r_itv_end is 0 for a part ending at 2^64, the subtraction still holds
+		n = R_MIN (n, r_itv_end (part->itv) - addr);
+		ret = r_io_fd_view (io, part->map->fd, part->map->delta + addr - part->map->itv.addr, &n);
+	} else {
+		ret = r_io_desc_view (io->desc, addr, &n);
+	}
+	if (!ret || ((io->cached & R_IO_READ) && cache_overlaps (io, addr, n))) {
+		return NULL;
+	}
+	*len = n;
+	return ret;
+}
+
+// Returns a pointer to len bytes at addr: a view of the backing store when
+// the whole range is viewable, otherwise buf filled by r_io_read_at.
+R_API const ut8 *r_io_view_at(RIO *io, ut64 addr, ut8 *buf, int len) {
+	ut64 n = len;
+	const ut8 *view;
+	if (!io || !buf || len < 1) {
+		return NULL;
+	}
+	view = r_io_view (io, addr, &n);
+	if (view && n == len) {
+		return view;
+	}
+	(void)r_io_read_at (io, addr, buf, len);
+	return buf;
+}
+
 R_API RIOAccessLog *r_io_al_read_at(RIO* io, ut64 addr, ut8* buf, int len) {
 	RIOAccessLog *log;
 	RIOAccessLogElement *ale = NULL;
@@ -577,6 +881,10 @@ R_API bool r_io_write_at(RIO* io, ut64 addr, const ut8* buf, int len) {
 			mybuf[i] &= io->write_mask[i % io->write_mask_len];
 		}
 	}
+	if (!(io->cached & R_IO_WRITE)) {
+		// io.cache writes are undone with wc-
+		r_io_wundo_new (io, addr, mybuf, len);
+	}
 	if (io->cached & R_IO_WRITE) {
 		ret = r_io_cache_write (io, addr, mybuf, len);
 	} else if (io->va) {
@@ -584,6 +892,9 @@ R_API bool r_io_write_at(RIO* io, ut64 addr, const ut8* buf, int len) {
 	} else {
 		ret = r_io_pwrite_at (io, addr, mybuf, len) > 0;
 	}
+	if (ret && io->cb_core_write) {
+		io->cb_core_write (io->user, addr, len);
+	}
 	if (buf != mybuf) {
 		free (mybuf);
 	}
@@ -722,6 +1033,7 @@ R_API int r_io_bind(RIO* io, RIOBind* bnd) {
 	bnd->open_at = r_io_open_at;
 	bnd->close = r_io_fd_close;
 	bnd->read_at = r_io_read_at;
+	bnd->read_batch = r_io_read_batch;
 	bnd->al_read_at = r_io_al_read_at;
 	bnd->write_at = r_io_write_at;
 	bnd->system = r_io_system;
@@ -732,6 +1044,7 @@ R_API int r_io_bind(RIO* io, RIOBind* bnd) {
 	bnd->fd_read = r_io_fd_read;
 	bnd->fd_write = r_io_fd_write;
 	bnd->fd_read_at = r_io_fd_read_at;
+	bnd->fd_view = r_io_fd_view;
 	bnd->fd_write_at = r_io_fd_write_at;
 	bnd->fd_is_dbg = r_io_fd_is_dbg;
 	bnd->fd_get_name = r_io_fd_get_name;
@@ -823,6 +1136,8 @@ R_API int r_io_fini(RIO* io) {
 		return false;
 	}
 	r_io_desc_cache_fini_all (io);
+	r_io_rcache_fini (io);
+	r_io_prof_fini (io);
 	r_io_desc_fini (io);
 	r_io_map_fini (io);
 	r_io_section_fini (io);
@@ -28,9 +28,10 @@ static int _cmp_map_event(const void *a_, const void *b_) {
 	return a->is_to - b->is_to;
 }
 
+// the event with the highest priority is on the top of the heap
 static int _cmp_map_event_by_id(const void *a_, const void *b_) {
 	struct map_event_t *a = (void *)a_, *b = (void *)b_;
-	return a->id - b->id;
+	return b->id - a->id;
 }
 
 // Precondition: from == 0 && to == 0 (full address) or from < to
@@ -60,15 +61,31 @@ static bool _map_skyline_push(RPVector *map_skyline, ut64 from, ut64 to, RIOMap
 	return true;
 }
 
-// Store map parts that are not covered by others into io->map_skyline
-R_API void r_io_map_calculate_skyline(RIO *io) {
+// The range covered by map in the virtual or in the physical address space,
+// as an inclusive [from, last] pair so the end of the address space fits
+static inline void _map_range(RIOMap *map, bool paddr, ut64 *from, ut64 *last) {
+	if (paddr) {
+		ut64 size = map->delta? R_MIN (map->itv.size, -map->delta): map->itv.size;
+		*from = map->delta;
+		*last = map->delta + size - 1;
+	} else {
+		*from = map->itv.addr;
+		*last = r_itv_end (map->itv) - 1;
+	}
+}
+
+// Store map parts that are not covered by others into skyline
+static void _calculate_skyline(RIO *io, RPVector *skyline, bool paddr) {
 	SdbListIter *iter;
 	RIOMap *map;
 	RPVector events;
 	RBinHeap heap;
 	struct map_event_t *ev;
 	bool *deleted = NULL;
-	r_pvector_clear (&io->map_skyline);
+	r_pvector_clear (skyline);
+	if (!io->maps) {
+		return;
+	}
 	r_pvector_init (&events, free);
 	if (!r_pvector_reserve (&events, ls_length (io->maps) * 2) ||
 			!(deleted = calloc (ls_length (io->maps), 1))) {
@@ -77,11 +94,13 @@ R_API void r_io_map_calculate_skyline(RIO *io) {
 
 	int i = 0;
 	ls_foreach (io->maps, iter, map) {
+		ut64 from, last;
+		_map_range (map, paddr, &from, &last);
 		if (!(ev = R_NEW (struct map_event_t))) {
 			goto out;
 		}
 		ev->map = map;
-		ev->addr = map->itv.addr;
+		ev->addr = from;
 		ev->is_to = false;
 		ev->id = i;
 		r_pvector_push (&events, ev);
@@ -89,7 +108,7 @@ R_API void r_io_map_calculate_skyline(RIO *io) {
 			goto out;
 		}
 		ev->map = map;
-		ev->addr = r_itv_end (map->itv);
+		ev->addr = last + 1;
 		ev->is_to = true;
 		ev->id = i;
 		r_pvector_push (&events, ev);
@@ -115,22 +134,22 @@ R_API void r_io_map_calculate_skyline(RIO *io) {
 		if (!i) {
 			last = to;
 			last_map = map;
-		} else if (last != to || (!to && ev->is_to)) {
+		} else if (!to && ev->is_to) {
+			// This is a to == 2**64 event. There are no more skyline parts.
+			if (last_map) {
+				(void)_map_skyline_push (skyline, last, to, last_map);
+			}
+			break;
+		} else if (last != to) {
 			if (last_map != map) {
-				if (last_map && !_map_skyline_push (&io->map_skyline, last, to, last_map)) {
+				if (last_map && !_map_skyline_push (skyline, last, to, last_map)) {
 					break;
 				}
 				last = to;
 				last_map = map;
 			}
-			if (!to && ev->is_to) {
-				if (map) {
-					(void)_map_skyline_push (&io->map_skyline, last, to, map);
-				}
-				// This is a to == 2**64 event. There are no more skyline parts.
-				break;
-			}
-		} else if (map && (!last_map || map->id > last_map->id)) {
+		} else {
+			// several events at the same address, the heap top wins
 			last_map = map;
 		}
 	}
@@ -141,6 +160,193 @@ out:
 	free (deleted);
 }
 
+R_API void r_io_map_calculate_skyline(RIO *io) {
+	_calculate_skyline (io, &io->map_skyline, false);
+	io->skyline_dirty = false;
+	io->pskyline_dirty = true;
+}
+
+// index of the first skyline part whose last address is >= addr
+static size_t _skyline_lower_bound(const RPVector *skyline, ut64 addr) {
+	size_t i;
+#define CMP(addr, part) (addr < r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? -1 : \
+			addr > r_itv_end (((RIOMapSkyline *)part)->itv) - 1 ? 1 : 0)
+	r_pvector_lower_bound (skyline, addr, i, CMP);
+#undef CMP
+	return i;
+}
+
+static RIOMap *_skyline_find(const RPVector *skyline, ut64 addr) {
+	size_t i = _skyline_lower_bound (skyline, addr);
+	if (i < r_pvector_len (skyline)) {
+		const RIOMapSkyline *part = r_pvector_at (skyline, i);
+		if (part->itv.addr <= addr) {
+			return part->map;
+		}
+	}
+	return NULL;
+}
+
+// Removes [from, last] from the skyline, splitting the parts on its borders.
+// Returns the index where a part starting at from has to be inserted.
+static size_t _skyline_cut(RPVector *skyline, ut64 from, ut64 last, bool *ok) {
+	size_t i = _skyline_lower_bound (skyline, from), j;
+	RIOMapSkyline *part;
+	if (i < r_pvector_len (skyline)) {
+		part = r_pvector_at (skyline, i);
+		ut64 plast = r_itv_end (part->itv) - 1;
+		if (part->itv.addr < from) {
+			part->itv.size = from - part->itv.addr;
+			i++;
+			if (plast > last) {
+				// [from, last] punches a hole in the middle of this part
+				RIOMapSkyline *tail = R_NEW (RIOMapSkyline);
+				if (!tail) {
+					*ok = false;
+					return i;
+				}
+				tail->map = part->map;
+				tail->itv = (RInterval){ last + 1, plast - last };
+				if (!r_pvector_insert (skyline, i, tail)) {
+					free (tail);
+					*ok = false;
+				}
+				return i;
+			}
+		}
+	}
+	// drop every part fully covered by [from, last] with a single memmove
+	for (j = i; j < r_pvector_len (skyline); j++) {
+		part = r_pvector_at (skyline, j);
+		if (part->itv.addr > last || r_itv_end (part->itv) - 1 > last) {
+			break;
+		}
+		free (part);
+	}
+	if (j > i) {
+		void **a = (void **)skyline->v.a;
+		memmove (a + i, a + j, (r_pvector_len (skyline) - j) * sizeof (void *));
+		skyline->v.len -= j - i;
+	}
+	if (i < r_pvector_len (skyline)) {
+		part = r_pvector_at (skyline, i);
+		if (part->itv.addr <= last) {
+			ut64 plast = r_itv_end (part->itv) - 1;
+			part->itv = (RInterval){ last + 1, plast - last };
+		}
+	}
+	return i;
+}
+
+// Puts [from, last] of map on top of the skyline, merging it with the
+// neighbour parts of the same map
+static bool _skyline_cover(RPVector *skyline, ut64 from, ut64 last, RIOMap *map) {
+	bool ok = true;
+	size_t i = _skyline_cut (skyline, from, last, &ok);
+	if (!ok) {
+		return false;
+	}
+	RIOMapSkyline *prev = i? r_pvector_at (skyline, i - 1): NULL;
+	RIOMapSkyline *next = (i < r_pvector_len (skyline))? r_pvector_at (skyline, i): NULL;
+	bool join_prev = prev && prev->map == map && r_itv_end (prev->itv) == from;
+	bool join_next = next && next->map == map && last != UT64_MAX && next->itv.addr == last + 1;
+	if (join_prev && join_next) {
+		prev->itv.size = r_itv_end (next->itv) - prev->itv.addr;
+		free (r_pvector_remove_at (skyline, i));
+	} else if (join_prev) {
+		prev->itv.size = last - prev->itv.addr + 1;
+	} else if (join_next) {
+		next->itv.size = r_itv_end (next->itv) - from;
+		next->itv.addr = from;
+	} else {
+		RIOMapSkyline *part = R_NEW (RIOMapSkyline);
+		if (!part) {
+			return false;
+		}
+		part->map = map;
+		part->itv = (RInterval){ from, last - from + 1 };
+		if (!r_pvector_insert (skyline, i, part)) {
+			free (part);
+			return false;
+		}
+	}
+	return true;
+}
+
+// maps was put on top of all other maps
+static void _skyline_raise(RIO *io, RIOMap *map) {
+	ut64 from, last;
+	io->pskyline_dirty = true;
+	if (io->skyline_dirty || io->map_batch) {
+		io->skyline_dirty = true;
+		return;
+	}
+	_map_range (map, false, &from, &last);
+	if (!_skyline_cover (&io->map_skyline, from, last, map)) {
+		io->skyline_dirty = true;
+	}
+}
+
+#define SKYLINE_REPAINT_MAX 64
+
+// the maps stacked on [from, last] changed, rebuild that part of the skyline
+// from the maps overlapping it, or from scratch when there are many of them
+static void _skyline_repaint(RIO *io, ut64 from, ut64 last) {
+	SdbListIter *iter;
+	RIOMap *map;
+	ut64 mfrom, mlast;
+	int n = 0;
+	io->pskyline_dirty = true;
+	if (io->skyline_dirty || io->map_batch) {
+		io->skyline_dirty = true;
+		return;
+	}
+	ls_foreach (io->maps, iter, map) {
+		_map_range (map, false, &mfrom, &mlast);
+		if (mfrom <= last && from <= mlast && ++n > SKYLINE_REPAINT_MAX) {
+			r_io_map_calculate_skyline (io);
+			return;
+		}
+	}
+	bool ok = true;
+	(void)_skyline_cut (&io->map_skyline, from, last, &ok);
+	// lowest priority first, so the top map ends up painted last
+	ls_foreach (io->maps, iter, map) {
+		_map_range (map, false, &mfrom, &mlast);
+		if (ok && mfrom <= last && from <= mlast) {
+			ok = _skyline_cover (&io->map_skyline, R_MAX (from, mfrom), R_MIN (last, mlast), map);
+		}
+	}
+	if (!ok) {
+		r_io_map_calculate_skyline (io);
+	}
+}
+
+static inline void _skyline_repaint_map(RIO *io, RIOMap *map) {
+	ut64 from, last;
+	_map_range (map, false, &from, &last);
+	_skyline_repaint (io, from, last);
+}
+
+// Maps added between begin and end only get the skyline computed once at the
+// end, use it to load many maps at once (like bins with lots of sections)
+R_API void r_io_map_batch_begin(RIO *io) {
+	io->map_batch++;
+}
+
+R_API void r_io_map_batch_end(RIO *io) {
+	if (io->map_batch > 0 && !--io->map_batch && io->skyline_dirty) {
+		r_io_map_calculate_skyline (io);
+	}
+}
+
+R_API const RPVector *r_io_map_get_skyline(RIO *io) {
+	if (io->skyline_dirty) {
+		r_io_map_calculate_skyline (io);
+	}
+	return &io->map_skyline;
+}
+
 R_API RIOMap* r_io_map_new(RIO* io, int fd, int flags, ut64 delta, ut64 addr, ut64 size, bool do_skyline) {
 	if (!size || !io || !io->maps || !io->map_ids) {
 		return NULL;
@@ -163,23 +369,27 @@ R_API RIOMap* r_io_map_new(RIO* io, int fd, int flags, ut64 delta, ut64 addr, ut
 	map->delta = delta;
 	// new map lives on the top, being top the list's tail
 	ls_append (io->maps, map);
-	if (do_skyline) {
-		r_io_map_calculate_skyline (io);
-	}
+	// the skyline is kept up to date incrementally, do_skyline only matters
+	// for callers that batch the update with r_io_map_batch_begin/end
+	_skyline_raise (io, map);
 	return map;
 }
 
 R_API bool r_io_map_remap (RIO *io, ut32 id, ut64 addr) {
 	RIOMap *map = r_io_map_resolve (io, id);
 	if (map) {
-		ut64 size = map->itv.size;
+		ut64 size = map->itv.size, from, last;
+		_map_range (map, false, &from, &last);
 		map->itv.addr = addr;
 		if (UT64_MAX - size + 1 < addr) {
 			map->itv.size = -addr;
+		}
+		// whatever was under the old range shows up again
+		_skyline_repaint (io, from, last);
+		_skyline_repaint_map (io, map);
+		if (map->itv.size != size) {
 			r_io_map_new (io, map->fd, map->flags, map->delta - addr, 0, size + addr, true);
-			return true;
 		}
-		r_io_map_calculate_skyline (io);
 		return true;
 	}
 	return false;
@@ -263,27 +473,30 @@ R_API RIOMap* r_io_map_add(RIO* io, int fd, int flags, ut64 delta, ut64 addr, ut
 	return NULL;
 }
 
+// the skyline of the physical ranges is only built when someone asks for it
 R_API RIOMap* r_io_map_get_paddr(RIO* io, ut64 paddr) {
-	RIOMap* map;
-	SdbListIter* iter;
-	if (!io) {
+	if (!io || !io->maps) {
 		return NULL;
 	}
-	ls_foreach_prev (io->maps, iter, map) {
-		if (map->delta <= paddr && paddr <= map->delta + map->itv.size - 1) {
-			return map;
-		}
+	if (io->pskyline_dirty) {
+		_calculate_skyline (io, &io->map_pskyline, true);
+		io->pskyline_dirty = false;
 	}
-	return NULL;
+	return _skyline_find (&io->map_pskyline, paddr);
 }
 
 // gets first map where addr fits in
 R_API RIOMap* r_io_map_get(RIO* io, ut64 addr) {
 	RIOMap* map;
 	SdbListIter* iter;
-	if (!io) {
+	if (!io || !io->maps) {
 		return NULL;
 	}
+	if (!io->skyline_dirty) {
+		// the skyline part holding addr belongs to the map with highest priority
+		return _skyline_find (&io->map_skyline, addr);
+	}
+	// do not rebuild the whole skyline for every lookup while batching
 	ls_foreach_prev (io->maps, iter, map) {
 		if (r_itv_contain (map->itv, addr)) {
 			return map;
@@ -304,9 +517,11 @@ R_API bool r_io_map_del(RIO* io, ut32 id) {
 		SdbListIter* iter;
 		ls_foreach (io->maps, iter, map) {
 			if (map->id == id) {
+				ut64 from, last;
+				_map_range (map, false, &from, &last);
 				ls_delete (io->maps, iter);
 				r_id_pool_kick_id (io->map_ids, id);
-				r_io_map_calculate_skyline (io);
+				_skyline_repaint (io, from, last);
 				return true;
 			}
 		}
@@ -349,7 +564,7 @@ R_API bool r_io_map_priorize(RIO* io, ut32 id) {
 			if (map->id == id) {
 				ls_split_iter (io->maps, iter);
 				ls_append (io->maps, map);
-				r_io_map_calculate_skyline (io);
+				_skyline_raise (io, map);
 				return true;
 			}
 		}
@@ -366,7 +581,7 @@ R_API bool r_io_map_depriorize(RIO* io, ut32 id) {
 			if (map->id == id) {
 				ls_split_iter (io->maps, iter);
 				ls_prepend (io->maps, map);
-				r_io_map_calculate_skyline (io);
+				_skyline_repaint_map (io, map);
 				return true;
 			}
 		}
@@ -441,6 +656,9 @@ R_API void r_io_map_fini(RIO* io) {
 	r_id_pool_free (io->map_ids);
 	io->map_ids = NULL;
 	r_pvector_clear (&io->map_skyline);
+	r_pvector_clear (&io->map_pskyline);
+	io->skyline_dirty = false;
+	io->pskyline_dirty = false;
 }
 
 R_API void r_io_map_set_name(RIOMap* map, const char* name) {
@@ -520,13 +738,17 @@ R_API bool r_io_map_resize(RIO *io, ut32 id, ut64 newsize) {
 	if (!newsize || !(map = r_io_map_resolve (io, id))) {
 		return false;
 	}
-	ut64 addr = map->itv.addr;
+	ut64 addr = map->itv.addr, from, last;
+	_map_range (map, false, &from, &last);
 	if (UT64_MAX - newsize + 1 < addr) {
 		map->itv.size = -addr;
+		_skyline_repaint (io, from, last);
+		_skyline_repaint_map (io, map);
 		r_io_map_new (io, map->fd, map->flags, map->delta - addr, 0, newsize + addr, true);
 		return true;
 	}
 	map->itv.size = newsize;
-	r_io_map_calculate_skyline (io);
+	_skyline_repaint (io, from, last);
+	_skyline_repaint_map (io, map);
 	return true;
 }
@@ -52,7 +52,8 @@ static ut64 r_io_def_mmap_seek(RIO *io, RIOMMapFileObj *mmo, ut64 offset, int wh
 		return UT64_MAX;
 	}
 	if (mmo->rawio) {
-		return lseek (mmo->fd, offset, whence);
+		// the read callback works at io->off, like in the mmapped case
+		return io->off = lseek (mmo->fd, offset, whence);
 	}
 	if (!mmo->buf) {
 		return UT64_MAX;
@@ -358,6 +359,16 @@ static int __read(RIO *io, RIODesc *fd, ut8 *buf, int len) {
 	return r_io_def_mmap_read (io, fd, buf, len);
 }
 
+static const ut8 *__view(RIO *io, RIODesc *fd, ut64 addr, ut64 *len) {
+	RIOMMapFileObj *mmo = fd? fd->data: NULL;
+	if (!mmo || mmo->rawio || !mmo->buf || !mmo->buf->buf || mmo->buf->empty
+			|| addr >= mmo->buf->length) {
+		return NULL;
+	}
+	*len = R_MIN (*len, mmo->buf->length - addr);
+	return mmo->buf->buf + addr;
+}
+
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int len) {
 	return r_io_def_mmap_write(io, fd, buf, len);
 }
@@ -407,6 +418,7 @@ RIOPlugin r_io_plugin_default = {
 	.open = __open_default,
 	.close = __close,
 	.read = __read,
+	.view = __view,
 	.check = __plugin_open_default,
 	.lseek = __lseek,
 	.write = __write,
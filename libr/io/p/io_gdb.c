@@ -173,6 +173,49 @@ static int __read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
 	return debug_gdb_read_at (buf, count, addr);
 }
 
+// requests closer than this are merged into a single 'm' packet
+#define GDB_VEC_GAP 64
+
+static bool __read_vec(RIO *io, RIODesc *fd, RIOReadVec *vec, int count) {
+	int i, j, k;
+	if (!desc || !desc->data) {
+		return false;
+	}
+	int max = R_MAX (desc->stub_features.pkt_sz, GDB_MAX_PKTSZ) / 2;
+	ut8 *tmp = malloc (max);
+	if (!tmp) {
+		return false;
+	}
+	for (i = 0; i < count; i = j) {
+		ut64 from = vec[i].addr, to = vec[i].addr + vec[i].len;
+		for (j = i + 1; j < count && vec[j].addr <= to + GDB_VEC_GAP; j++) {
+			ut64 end = R_MAX (to, vec[j].addr + vec[j].len);
+			if (end - from > max) {
+				break;
+			}
+			to = end;
+		}
+		if (j > i + 1) {
+			int len = (int)(to - from);
+			memset (tmp, 0xff, len);
+			if (debug_gdb_read_at (tmp, len, from) == len) {
+				for (k = i; k < j; k++) {
+					memcpy (vec[k].buf, tmp + (vec[k].addr - from), vec[k].len);
+					vec[k].ret = vec[k].len;
+				}
+				continue;
+			}
+		}
+		// alone or the merged range hit something unreadable
+		for (k = i; k < j; k++) {
+			memset (vec[k].buf, 0xff, vec[k].len);
+			vec[k].ret = debug_gdb_read_at (vec[k].buf, vec[k].len, vec[k].addr);
+		}
+	}
+	free (tmp);
+	return true;
+}
+
 static int __close(RIODesc *fd) {
 	if (fd) {
 		R_FREE (fd->name);
@@ -355,6 +398,7 @@ RIOPlugin r_io_plugin_gdb = {
 	.open = __open,
 	.close = __close,
 	.read = __read,
+	.read_vec = __read_vec,
 	.write = __write,
 	.check = __plugin_open,
 	.lseek = __lseek,
@@ -6,21 +6,94 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
+// reads are served through a checkpoint index of the compressed file, the
+// data is only inflated in memory once something writes to it
 typedef struct {
 	ut8 *buf;
-	ut32 size;
+	ut64 size;
 	ut64 offset;
+	RZran *z;
+	int fd;
+	bool isize; // size is the ISIZE of the gzip trailer, a guess
+	char *zidx; // where the index is kept when io.zindex is set
 } RIOGzip;
 
-static inline ut32 _io_malloc_sz(RIODesc *desc) {
+static int gzip_read(void *user, ut64 off, ut8 *buf, int len) {
+	RIOGzip *mal = (RIOGzip*)user;
+	if (r_sandbox_lseek (mal->fd, off, SEEK_SET) < 0) {
+		return -1;
+	}
+	return r_sandbox_read (mal->fd, buf, len);
+}
+
+static void gzip_index_free(RIOGzip *mal) {
+	r_zran_free (mal->z);
+	mal->z = NULL;
+	if (mal->fd != -1) {
+		r_sandbox_close (mal->fd);
+		mal->fd = -1;
+	}
+}
+
+// ISIZE is the size modulo 4GB of the last member, right for the usual
+// single member gzip files. The stream is only inflated to the end to learn
+// the size when exact is set, there is no ISIZE (zlib) or the data already
+// went past it
+static ut64 gzip_size(RIOGzip *mal, bool exact) {
+	RZran *z = mal->z;
+	if (z && !z->complete && (exact || !mal->isize || z->size > mal->size)) {
+		(void)r_zran_size (z);
+		if (mal->zidx) {
+			(void)r_zran_save (z, mal->zidx);
+		}
+	}
+	if (z && z->complete) {
+		mal->size = z->size;
+		mal->isize = false;
+	}
+	return mal->size;
+}
+
+static void gzip_isize(RIOGzip *mal, ut64 insz) {
+	ut8 b[4];
+	if (mal->z->trailer == 8 && insz >= 18 && gzip_read (mal, insz - 4, b, 4) == 4) {
+		mal->size = r_read_le32 (b);
+		mal->isize = true;
+	}
+}
+
+// inflates the whole file in memory to let it be modified
+static bool gzip_load(RIOGzip *mal) {
+	if (!mal->z) {
+		return true;
+	}
+	ut64 size = gzip_size (mal, true);
+	if (size > ST32_MAX) {
+		eprintf ("Cannot modify gzipped files bigger than 2GB\n");
+		return false;
+	}
+	ut8 *buf = malloc (size? size: 1);
+	if (!buf) {
+		return false;
+	}
+	if (r_zran_read (mal->z, 0, buf, (int)size) != (int)size) {
+		free (buf);
+		return false;
+	}
+	mal->buf = buf;
+	gzip_index_free (mal);
+	return true;
+}
+
+static inline ut64 _io_malloc_sz(RIODesc *desc) {
 	if (!desc) {
 		return 0;
 	}
 	RIOGzip *mal = (RIOGzip*)desc->data;
-	return mal? mal->size: 0;
+	return mal? gzip_size (mal, false): 0;
 } 
 
-static inline void _io_malloc_set_sz(RIODesc *desc, ut32 sz) {
+static inline void _io_malloc_set_sz(RIODesc *desc, ut64 sz) {
 	if (!desc) {
 		return;
 	}
@@ -64,7 +137,7 @@ static inline void _io_malloc_set_off(RIODesc *desc, ut64 off) {
 }
 
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
-	if (!fd || !buf || count < 0 || !fd->data) {
+	if (!fd || !buf || count < 0 || !fd->data || !gzip_load (fd->data)) {
 		return -1;
 	}
 	if (_io_malloc_off (fd) > _io_malloc_sz (fd)) {
@@ -83,10 +156,10 @@ static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 
 static bool __resize(RIO *io, RIODesc *fd, ut64 count) {
 	ut8 * new_buf = NULL;
-	if (!fd || !fd->data || count == 0) {
+	if (!fd || !fd->data || count == 0 || !gzip_load (fd->data)) {
 		return false;
 	}
-	ut32 mallocsz = _io_malloc_sz (fd);
+	ut64 mallocsz = _io_malloc_sz (fd);
 	if (_io_malloc_off (fd) > mallocsz) {
 		return false;
 	}
@@ -109,7 +182,11 @@ static int __read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
 	if (!fd || !fd->data) {
 		return -1;
 	}
-	ut32 mallocsz = _io_malloc_sz (fd);
+	RIOGzip *mal = (RIOGzip*)fd->data;
+	if (mal->z) {
+		return r_zran_read (mal->z, mal->offset, buf, count);
+	}
+	ut64 mallocsz = _io_malloc_sz (fd);
 	if (_io_malloc_off (fd) > mallocsz) {
 		return -1;
 	}
@@ -126,9 +203,13 @@ static int __close(RIODesc *fd) {
 		return -1;
 	}
 	riom = fd->data;
+	if (!riom->z) {
+		eprintf ("TODO: Writing changes into gzipped files is not yet supported\n");
+	}
+	gzip_index_free (riom);
+	R_FREE (riom->zidx);
 	R_FREE (riom->buf);
 	R_FREE (fd->data);
-	eprintf ("TODO: Writing changes into gzipped files is not yet supported\n");
 	return 0;
 }
 
@@ -137,7 +218,13 @@ static ut64 __lseek(RIO* io, RIODesc *fd, ut64 offset, int whence) {
 	if (!fd || !fd->data) {
 		return offset;
 	}
-	ut32 mallocsz = _io_malloc_sz (fd);
+	RIOGzip *mal = (RIOGzip*)fd->data;
+	ut64 mallocsz = _io_malloc_sz (fd);
+	ut64 to = (whence == SEEK_CUR)? _io_malloc_off (fd) + offset: offset;
+	if (mal->isize && whence != SEEK_END && to > mallocsz) {
+		// a guessed size is checked before stopping the seek at it
+		mallocsz = gzip_size (mal, true);
+	}
 	switch (whence) {
 	case SEEK_SET:
 		r_offset = (offset <= mallocsz) ? offset : mallocsz;
@@ -163,15 +250,29 @@ static RIODesc *__open(RIO *io, const char *pathname, int rw, int mode) {
 		if (!mal) {
 			return NULL;
 		}
-		int len;
-		ut8 *data = (ut8*)r_file_slurp (pathname+7, &len);	//memleak here?
-		int *size = (int*)&mal->size;
-		mal->buf = r_inflate (data, len, NULL, size);
-		if (mal->buf) {
+		const char *file = pathname + 7;
+		ut64 insz = r_file_size (file);
+		ut8 b;
+		mal->fd = r_sandbox_open (file, O_RDONLY | O_BINARY, 0);
+		if (mal->fd != -1) {
+			// keep about 256 checkpoints, but no closer than 1MB
+			mal->z = r_zran_new (gzip_read, mal, insz, R_ZRAN_AUTO, R_MAX (R_ZRAN_SPAN, insz / 256));
+		}
+		if (mal->z && io->zindex) {
+			mal->zidx = r_str_newf ("%s.zidx", file);
+			if (r_zran_load (mal->z, mal->zidx)) {
+				mal->size = mal->z->size;
+			}
+		}
+		if (mal->z && !mal->z->complete) {
+			gzip_isize (mal, insz);
+		}
+		if (mal->z && r_zran_read (mal->z, 0, &b, 1) == 1) {
 			return r_io_desc_new (io, &r_io_plugin_gzip, pathname, rw, mode, mal);
 		}
-		free (data);
-		eprintf ("Cannot allocate (%s) %d byte(s)\n", pathname+9, mal->size);
+		eprintf ("Cannot open (%s) as gzip\n", file);
+		gzip_index_free (mal);
+		free (mal->zidx);
 		free (mal);
 	}
 	return NULL;
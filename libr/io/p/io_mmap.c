@@ -172,6 +172,16 @@ static int __read(RIO *io, RIODesc *fd, ut8 *buf, int len) {
 	return r_io_mmap_read (io, fd, buf, len);
 }
 
+static const ut8 *__view(RIO *io, RIODesc *fd, ut64 addr, ut64 *len) {
+	RIOMMapFileObj *mmo = fd? fd->data: NULL;
+	if (!mmo || !mmo->buf || !mmo->buf->buf || mmo->buf->empty
+			|| addr >= mmo->buf->length) {
+		return NULL;
+	}
+	*len = R_MIN (*len, mmo->buf->length - addr);
+	return mmo->buf->buf + addr;
+}
+
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int len) {
 	return r_io_mmap_write(io, fd, buf, len);
 }
@@ -198,6 +208,7 @@ struct r_io_plugin_t r_io_plugin_mmap = {
 	.open = __open,
 	.close = __close,
 	.read = __read,
+	.view = __view,
 	.check = __plugin_open,
 	.lseek = __lseek,
 	.write = __write,
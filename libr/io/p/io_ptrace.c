@@ -13,12 +13,31 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <errno.h>
+#if __linux__
+#include <sys/uio.h>
+#endif
+
+#if __linux__
+// a range of /proc/pid/maps
+typedef struct {
+	ut64 from;
+	ut64 to;
+	int perm;
+} RIOPtraceMap;
+#endif
 
 typedef struct {
 	int pid;
 	int tid;
 	int fd;
 	int opid;
+#if __linux__
+	bool vm; // process_vm_readv/writev work on this target
+	// page validity cache, maps sorted by address, reloaded when it lies
+	RIOPtraceMap *maps;
+	int nmaps;
+	bool maps_stale;
+#endif
 } RIOPtrace;
 #define RIOPTRACE_OPID(x) (((RIOPtrace*)x->data)->opid)
 #define RIOPTRACE_PID(x) (((RIOPtrace*)x->data)->pid)
@@ -70,6 +89,178 @@ static int debug_os_read_at(int pid, ut32 *buf, int sz, ut64 addr) {
 	return sz;
 }
 
+#if __linux__
+#define PTRACE_IOV_MAX 1024
+#define PTRACE_PAGE 0x1000
+
+extern ssize_t process_vm_readv(pid_t pid, const struct iovec *local_iov,
+	unsigned long liovcnt, const struct iovec *remote_iov,
+	unsigned long riovcnt, unsigned long flags);
+extern ssize_t process_vm_writev(pid_t pid, const struct iovec *local_iov,
+	unsigned long liovcnt, const struct iovec *remote_iov,
+	unsigned long riovcnt, unsigned long flags);
+
+static void maps_load(RIOPtrace *iop) {
+	char path[32], line[512], perm[8];
+	ut64 from, to;
+	int size = 0;
+	FILE *fd;
+	R_FREE (iop->maps);
+	iop->nmaps = 0;
+	iop->maps_stale = false;
+	snprintf (path, sizeof (path), "/proc/%d/maps", iop->pid);
+	if (!(fd = r_sandbox_fopen (path, "r"))) {
+		// no procfs, no way to tell the valid pages
+		iop->vm = false;
+		return;
+	}
+	while (fgets (line, sizeof (line), fd)) {
+		if (sscanf (line, "%"PFMT64x"-%"PFMT64x" %7s", &from, &to, perm) != 3 || from >= to) {
+			continue;
+		}
+		if (iop->nmaps == size) {
+			size = size? size * 2: 64;
+			RIOPtraceMap *maps = realloc (iop->maps, size * sizeof (RIOPtraceMap));
+			if (!maps) {
+				break;
+			}
+			iop->maps = maps;
+		}
+		RIOPtraceMap *m = &iop->maps[iop->nmaps++];
+		m->from = from;
+		m->to = to;
+		m->perm = (perm[0] == 'r'? R_IO_READ: 0) | (perm[1] == 'w'? R_IO_WRITE: 0);
+	}
+	fclose (fd);
+}
+
+// returns how many bytes from addr (up to len) share the same kind of
+// memory, which is stored in *perm: -1 when unmapped, else the map perms
+static ut64 maps_span(RIOPtrace *iop, ut64 addr, ut64 len, int *perm) {
+	int lo = 0, hi;
+	if (iop->maps_stale) {
+		maps_load (iop);
+	}
+	hi = iop->nmaps;
+	// first map ending after addr
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (iop->maps[mid].to <= addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == iop->nmaps) {
+		*perm = -1;
+		return len;
+	}
+	RIOPtraceMap *m = &iop->maps[lo];
+	if (addr < m->from) {
+		*perm = -1;
+		return R_MIN (len, m->from - addr);
+	}
+	*perm = m->perm;
+	// adjacent maps with the same perms make a single span
+	ut64 to = m->to;
+	for (lo++; lo < iop->nmaps && iop->maps[lo].from == to && iop->maps[lo].perm == m->perm; lo++) {
+		to = iop->maps[lo].to;
+	}
+	return R_MIN (len, to - addr);
+}
+
+// the maps say nothing is there, probe one word per page instead of
+// letting ptrace fail on every word of it
+static void read_unmapped(RIOPtrace *iop, ut8 *buf, int len, ut64 addr) {
+	while (len > 0) {
+		int n = R_MIN (len, PTRACE_PAGE - (addr & (PTRACE_PAGE - 1)));
+		errno = 0;
+		(void)debug_read_raw (iop->pid, (void*)(size_t)addr);
+		if (errno) {
+			memset (buf, 0xff, n);
+		} else {
+			// mapped since the maps were read
+			iop->maps_stale = true;
+			debug_os_read_at (iop->pid, (ut32*)buf, n, addr);
+		}
+		buf += n;
+		addr += n;
+		len -= n;
+	}
+}
+
+// reads the n requests with as few process_vm_readv calls as possible, the
+// kernel stops at the first request it can not read, ptrace takes that one
+static void vm_readv(RIOPtrace *iop, struct iovec *local, struct iovec *remote, int n) {
+	int i = 0;
+	while (i < n && iop->vm) {
+		ssize_t done = process_vm_readv (iop->pid, local + i, n - i, remote + i, n - i, 0);
+		if (done < 0 && (errno == ENOSYS || errno == EPERM)) {
+			iop->vm = false;
+			break;
+		}
+		for (; i < n && done >= (ssize_t)local[i].iov_len; i++) {
+			done -= local[i].iov_len;
+		}
+		if (i < n) {
+			done = R_MAX (done, 0);
+			iop->maps_stale = true;
+			debug_os_read_at (iop->pid, (ut32*)((ut8*)local[i].iov_base + done),
+				local[i].iov_len - done, (size_t)remote[i].iov_base + done);
+			i++;
+		}
+	}
+	for (; i < n; i++) {
+		debug_os_read_at (iop->pid, (ut32*)local[i].iov_base, local[i].iov_len, (size_t)remote[i].iov_base);
+	}
+}
+
+// splits every request at the map boundaries: readable spans are batched
+// into process_vm_readv, unmapped ones are probed page by page and the
+// rest (PROT_NONE, exec only..) goes through ptrace which ignores perms
+static void ptrace_read_vec(RIOPtrace *iop, RIOReadVec *vec, int count) {
+	struct iovec local[PTRACE_IOV_MAX], remote[PTRACE_IOV_MAX];
+	int i, perm, n = 0;
+	for (i = 0; i < count; i++) {
+		ut64 addr = vec[i].addr, left = vec[i].len;
+		ut8 *buf = vec[i].buf;
+		while (left > 0) {
+			ut64 span = maps_span (iop, addr, left, &perm);
+			if (perm == -1) {
+				read_unmapped (iop, buf, span, addr);
+			} else if (!(perm & R_IO_READ) || !iop->vm) {
+				debug_os_read_at (iop->pid, (ut32*)buf, span, addr);
+			} else {
+				if (n == PTRACE_IOV_MAX) {
+					vm_readv (iop, local, remote, n);
+					n = 0;
+				}
+				local[n].iov_base = buf;
+				local[n].iov_len = span;
+				remote[n].iov_base = (void*)(size_t)addr;
+				remote[n].iov_len = span;
+				n++;
+			}
+			buf += span;
+			addr += span;
+			left -= span;
+		}
+		vec[i].ret = vec[i].len;
+	}
+	if (n > 0) {
+		vm_readv (iop, local, remote, n);
+	}
+}
+
+static bool __read_vec(RIO *io, RIODesc *desc, RIOReadVec *vec, int count) {
+	if (!desc || !desc->data || !((RIOPtrace*)desc->data)->vm) {
+		return false;
+	}
+	ptrace_read_vec ((RIOPtrace*)desc->data, vec, count);
+	return true;
+}
+#endif
+
 static int __read(RIO *io, RIODesc *desc, ut8 *buf, int len) {
 #if USE_PROC_PID_MEM
 	int ret, fd;
@@ -97,6 +288,14 @@ static int __read(RIO *io, RIODesc *desc, ut8 *buf, int len) {
 			if (ret != -1) return ret;
 		}
 	}
+#endif
+#if __linux__
+	RIOPtrace *iop = (RIOPtrace*)desc->data;
+	if (iop->vm && len > 0 && addr != UT64_MAX) {
+		RIOReadVec v = { addr, buf, len, 0 };
+		ptrace_read_vec (iop, &v, 1);
+		return len;
+	}
 #endif
 	return debug_os_read_at (RIOPTRACE_PID (desc), (ut32*)buf, len, addr);
 }
@@ -126,10 +325,45 @@ static int ptrace_write_at(int pid, const ut8 *pbuf, int sz, ut64 addr) {
 	return sz;
 }
 
+#if __linux__
+// process_vm_writev honours the page perms, so only writable spans take it,
+// breakpoints and patches in the text still go through POKEDATA
+static int vm_write_at(RIOPtrace *iop, const ut8 *buf, int len, ut64 addr) {
+	int perm, done = 0;
+	while (done < len) {
+		ut64 span = maps_span (iop, addr + done, len - done, &perm);
+		ssize_t ret = -1;
+		if (iop->vm && perm != -1 && (perm & R_IO_WRITE)) {
+			struct iovec local = { (void*)(buf + done), span };
+			struct iovec remote = { (void*)(size_t)(addr + done), span };
+			ret = process_vm_writev (iop->pid, &local, 1, &remote, 1, 0);
+			if (ret < 0 && (errno == ENOSYS || errno == EPERM)) {
+				iop->vm = false;
+			}
+		}
+		if (ret != (ssize_t)span) {
+			ret = R_MAX (ret, 0);
+			int w = ptrace_write_at (iop->pid, buf + done + ret, span - ret, addr + done + ret);
+			if (w != span - ret) {
+				return done + ret + R_MAX (w, 0);
+			}
+		}
+		done += span;
+	}
+	return len;
+}
+#endif
+
 static int __write(RIO *io, RIODesc *fd, const ut8 *buf, int len) {
 	if (!fd || !fd->data) {
 		return -1;
 	}
+#if __linux__
+	RIOPtrace *iop = (RIOPtrace*)fd->data;
+	if (iop->vm && len > 0 && io->off != UT64_MAX) {
+		return vm_write_at (iop, buf, len, io->off);
+	}
+#endif
 	return ptrace_write_at (RIOPTRACE_PID (fd), buf, len, io->off);
 }
 
@@ -199,6 +433,10 @@ static RIODesc *__open(RIO *io, const char *file, int rw, int mode) {
 				return NULL;
 			}
 			riop->pid = riop->tid = pid;
+#if __linux__
+			riop->vm = true;
+			riop->maps_stale = true;
+#endif
 			open_pidmem (riop);
 			desc = r_io_desc_new (io, &r_io_plugin_ptrace, file, rw | R_IO_EXEC, mode, riop);
 			desc->name = r_sys_pid_to_path (pid);
@@ -232,6 +470,9 @@ static int __close(RIODesc *desc) {
 	if (fd != -1) {
 		close (fd);
 	}
+#if __linux__
+	free (((RIOPtrace*)desc->data)->maps);
+#endif
 	free (desc->data);
 	desc->data = NULL;
 	return ptrace (PTRACE_DETACH, pid, 0, 0);
@@ -263,6 +504,9 @@ static char *__system(RIO *io, RIODesc *fd, const char *cmd) {
 					(void)ptrace (PTRACE_ATTACH, pid, 0, 0);
 					// TODO: do not set pid if attach fails?
 					iop->pid = iop->tid = pid;
+#if __linux__
+					iop->maps_stale = true;
+#endif
 				}
 			} else {
 				io->cb_printf ("%d\n", iop->pid);
@@ -291,6 +535,9 @@ RIOPlugin r_io_plugin_ptrace = {
 	.open = __open,
 	.close = __close,
 	.read = __read,
+#if __linux__
+	.read_vec = __read_vec,
+#endif
 	.check = __plugin_open,
 	.lseek = __lseek,
 	.system = __system,
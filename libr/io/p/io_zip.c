@@ -41,6 +41,13 @@ static RIOZipConstURI ZIP_ALL_URIS[] = {
 	{NULL, 0}
 };
 
+// the archive is opened once for all the members read from it
+typedef struct r_io_zip_archive_t {
+	int fd;
+	int refs;
+	SdbHash *lho; // member name => offset of its local header, read once
+} RIOZipArchive;
+
 typedef struct r_io_zfo_t {
 	char * name;
 	char * archivename;
@@ -55,8 +62,23 @@ typedef struct r_io_zfo_t {
 	char *password;
 	ut8 encryption_value;
 	RIO * io_backref;
+	// stored and deflated members are read in place from the archive until
+	// they are written to, through a checkpoint index for the deflated ones
+	bool lazy;
+	RIOZipArchive *arch;
+	ut64 data_off;
+	ut64 csize;
+	ut64 usize;
+	RZran *z;
 } RIOZipFileObj;
 
+#define ZIP_EOCD_SIG 0x06054b50
+#define ZIP_CDIR_SIG 0x02014b50
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CDIR_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+
 static int r_io_zip_has_uri_substr(const char *file) {
 	return (file && strstr (file, "://"));
 }
@@ -122,6 +144,212 @@ struct zip *r_io_zip_open_archive(const char *archivename, ut32 flags, int mode,
 	return NULL;
 }
 
+static int r_io_zip_pread(int fd, ut64 off, ut8 *buf, int len) {
+	if (r_sandbox_lseek (fd, off, SEEK_SET) < 0) {
+		return -1;
+	}
+	return r_sandbox_read (fd, buf, len);
+}
+
+static int r_io_zip_zran_read(void *user, ut64 off, ut8 *buf, int len) {
+	RIOZipFileObj *zfo = (RIOZipFileObj *)user;
+	if (off >= zfo->csize) {
+		return 0;
+	}
+	len = (int)R_MIN (len, zfo->csize - off);
+	return r_io_zip_pread (zfo->arch->fd, zfo->data_off + off, buf, len);
+}
+
+static void r_io_zip_lho_free_kv(HtKv *kv) {
+	free (kv->key);
+	free (kv);
+}
+
+// the offsets of the local headers of all the members, from one walk of the
+// central directory. zip64 archives are left to libzip
+static SdbHash *r_io_zip_read_cdir(int fd) {
+	ut8 *cd = NULL, *tail;
+	ut64 size = r_sandbox_lseek (fd, 0, SEEK_END);
+	SdbHash *ht;
+	int i, n;
+	if (size == UT64_MAX || size < ZIP_EOCD_SIZE) {
+		return NULL;
+	}
+	// the end of central directory record is followed by up to 64K of comment
+	n = (int)R_MIN (size, ZIP_EOCD_SIZE + 0xffff);
+	if (!(tail = malloc (n)) || r_io_zip_pread (fd, size - n, tail, n) != n) {
+		free (tail);
+		return NULL;
+	}
+	for (i = n - ZIP_EOCD_SIZE; i >= 0 && r_read_le32 (tail + i) != ZIP_EOCD_SIG; i--) {
+		;
+	}
+	if (i < 0) {
+		free (tail);
+		return NULL;
+	}
+	ut32 cd_size = r_read_le32 (tail + i + 12);
+	ut32 cd_off = r_read_le32 (tail + i + 16);
+	free (tail);
+	if (cd_off == UT32_MAX || (ut64)cd_off + cd_size > size || !(cd = malloc (cd_size + 1))
+			|| r_io_zip_pread (fd, cd_off, cd, cd_size) != cd_size) {
+		free (cd);
+		return NULL;
+	}
+	if (!(ht = ht_new (NULL, r_io_zip_lho_free_kv, NULL))) {
+		free (cd);
+		return NULL;
+	}
+	for (i = 0; i + ZIP_CDIR_SIZE <= cd_size && r_read_le32 (cd + i) == ZIP_CDIR_SIG; ) {
+		ut16 elen = r_read_le16 (cd + i + 30), clen = r_read_le16 (cd + i + 32);
+		ut16 len = r_read_le16 (cd + i + 28);
+		ut32 lho = r_read_le32 (cd + i + 42);
+		if (i + ZIP_CDIR_SIZE + len > cd_size) {
+			break;
+		}
+		if (lho != UT32_MAX) {
+			char *name = r_str_ndup ((const char *)cd + i + ZIP_CDIR_SIZE, len);
+			// the first member of a name wins, as in libzip
+			if (name && strlen (name) == len) {
+				ht_insert (ht, name, (void *)(size_t)lho);
+			}
+			free (name);
+		}
+		i += ZIP_CDIR_SIZE + len + elen + clen;
+	}
+	free (cd);
+	return ht;
+}
+
+// finds where the data of the member called name starts in the archive
+static bool r_io_zip_data_offset(RIOZipArchive *arch, const char *name, ut64 *data_off) {
+	ut8 hdr[ZIP_LOCAL_SIZE];
+	bool found = false;
+	if (!arch->lho && !(arch->lho = r_io_zip_read_cdir (arch->fd))) {
+		return false;
+	}
+	ut32 lho = (ut32)(size_t)ht_find (arch->lho, name, &found);
+	if (!found || r_io_zip_pread (arch->fd, lho, hdr, ZIP_LOCAL_SIZE) != ZIP_LOCAL_SIZE
+			|| r_read_le32 (hdr) != ZIP_LOCAL_SIG) {
+		return false;
+	}
+	*data_off = (ut64)lho + ZIP_LOCAL_SIZE + r_read_le16 (hdr + 26) + r_read_le16 (hdr + 28);
+	return true;
+}
+
+static RIOZipArchive *r_io_zip_archive_open(const char *archivename) {
+	RIOZipArchive *arch = R_NEW0 (RIOZipArchive);
+	if (!arch) {
+		return NULL;
+	}
+	arch->fd = r_sandbox_open (archivename, O_RDONLY | O_BINARY, 0);
+	if (arch->fd == -1) {
+		free (arch);
+		return NULL;
+	}
+	arch->refs = 1;
+	return arch;
+}
+
+static void r_io_zip_archive_unref(RIOZipArchive *arch) {
+	if (arch && --arch->refs < 1) {
+		r_sandbox_close (arch->fd);
+		ht_free (arch->lho);
+		free (arch);
+	}
+}
+
+static void r_io_zip_lazy_free(RIOZipFileObj *zfo) {
+	r_zran_free (zfo->z);
+	zfo->z = NULL;
+	if (zfo->lazy) {
+		r_io_zip_archive_unref (zfo->arch);
+		zfo->arch = NULL;
+		zfo->lazy = false;
+	}
+}
+
+// serves the member from the archive without inflating it all at once,
+// reading through arch when given or opening the archive otherwise
+static bool r_io_zip_open_lazy(RIOZipFileObj *zfo, struct zip_stat *sb, RIOZipArchive *arch) {
+	const ut64 big = UT32_MAX;
+	if (!(sb->valid & ZIP_STAT_COMP_METHOD) || !(sb->valid & ZIP_STAT_COMP_SIZE)
+			|| !(sb->valid & ZIP_STAT_SIZE) || sb->encryption_method != ZIP_EM_NONE
+			|| sb->size >= big || sb->comp_size >= big) {
+		return false;
+	}
+	if (sb->comp_method != ZIP_CM_STORE && sb->comp_method != ZIP_CM_DEFLATE) {
+		return false;
+	}
+	if (arch) {
+		arch->refs++;
+	} else if (!(arch = r_io_zip_archive_open (zfo->archivename))) {
+		return false;
+	}
+	zfo->arch = arch;
+	zfo->lazy = true;
+	zfo->csize = sb->comp_size;
+	zfo->usize = sb->size;
+	if (!r_io_zip_data_offset (arch, sb->name, &zfo->data_off)) {
+		r_io_zip_lazy_free (zfo);
+		return false;
+	}
+	if (sb->comp_method == ZIP_CM_DEFLATE) {
+		zfo->z = r_zran_new (r_io_zip_zran_read, zfo, zfo->csize, R_ZRAN_RAW,
+			R_MAX (R_ZRAN_SPAN, zfo->csize / 256));
+		if (!zfo->z) {
+			r_io_zip_lazy_free (zfo);
+			return false;
+		}
+		if (zfo->io_backref && zfo->io_backref->zindex) {
+			char *zidx = r_str_newf ("%s.%"PFMT64d".zidx", zfo->archivename, zfo->entry);
+			if (!r_zran_load (zfo->z, zidx)) {
+				r_zran_size (zfo->z);
+				(void)r_zran_save (zfo->z, zidx);
+			}
+			free (zidx);
+		}
+	}
+	zfo->opened = true;
+	return true;
+}
+
+static int r_io_zip_lazy_read(RIOZipFileObj *zfo, ut64 off, ut8 *buf, int len) {
+	if (off >= zfo->usize) {
+		return 0;
+	}
+	len = (int)R_MIN (len, zfo->usize - off);
+	if (zfo->z) {
+		return r_zran_read (zfo->z, off, buf, len);
+	}
+	return r_io_zip_pread (zfo->arch->fd, zfo->data_off + off, buf, len);
+}
+
+// brings the whole member in memory to let it be modified
+static bool r_io_zip_load(RIOZipFileObj *zfo) {
+	if (!zfo->lazy) {
+		return true;
+	}
+	ut8 *buf = malloc (zfo->usize + 1);
+	if (!buf) {
+		return false;
+	}
+	if (r_io_zip_lazy_read (zfo, 0, buf, (int)zfo->usize) != (int)zfo->usize) {
+		free (buf);
+		return false;
+	}
+	ut64 cur = zfo->b->cur;
+	r_buf_set_bytes (zfo->b, buf, zfo->usize);
+	zfo->b->cur = cur;
+	free (buf);
+	r_io_zip_lazy_free (zfo);
+	return true;
+}
+
+static ut64 r_io_zip_size(RIOZipFileObj *zfo) {
+	return zfo->lazy? zfo->usize: zfo->b->length;
+}
+
 static int r_io_zip_slurp_file(RIOZipFileObj *zfo) {
 	struct zip_file *zFile = NULL;
 	struct zip *zipArch;
@@ -215,15 +443,17 @@ static void r_io_zip_free_zipfileobj(RIOZipFileObj *zfo) {
 	if (zfo->modified) {
 		r_io_zip_flush_file (zfo);
 	}
+	r_io_zip_lazy_free (zfo);
 	free (zfo->name);
 	free (zfo->password);
 	r_buf_free (zfo->b);
 	free (zfo);
 }
 
-RIOZipFileObj *r_io_zip_create_new_file(const char *archivename, const char *filename, struct zip_stat *sb, ut32 flags, int mode, int rw) {
+RIOZipFileObj *r_io_zip_create_new_file(RIO *io, const char *archivename, const char *filename, struct zip_stat *sb, ut32 flags, int mode, int rw) {
 	RIOZipFileObj *zfo = R_NEW0 (RIOZipFileObj);
 	if (zfo) {
+		zfo->io_backref = io;
 		zfo->b = r_buf_new ();
 		zfo->archivename = strdup (archivename);
 		zfo->name = strdup (sb? sb->name: filename);
@@ -236,8 +466,16 @@ RIOZipFileObj *r_io_zip_create_new_file(const char *archivename, const char *fil
 	return zfo;
 }
 
+static RIOZipFileObj *r_io_zip_alloc_entry(RIO *io, RIOZipArchive *arch, const char *archivename, struct zip_stat *sb, ut32 flags, int mode, int rw) {
+	RIOZipFileObj *zfo = r_io_zip_create_new_file (io, archivename, sb->name, sb, flags, mode, rw);
+	if (zfo && !r_io_zip_open_lazy (zfo, sb, arch)) {
+		r_io_zip_slurp_file (zfo);
+	}
+	return zfo;
+}
+
 /* The file can be a file in the archive or ::[num].  */
-RIOZipFileObj* r_io_zip_alloc_zipfileobj(const char *archivename, const char *filename, ut32 flags, int mode, int rw) {
+RIOZipFileObj* r_io_zip_alloc_zipfileobj(RIO *io, RIOZipArchive *arch, const char *archivename, const char *filename, ut32 flags, int mode, int rw) {
 	RIOZipFileObj *zfo = NULL;
 	ut64 i, num_entries;
 	struct zip_stat sb;
@@ -250,16 +488,13 @@ RIOZipFileObj* r_io_zip_alloc_zipfileobj(const char *archivename, const char *fi
 		zip_stat_index (zipArch, i, 0, &sb);
 		if (sb.name != NULL) {
 			if (strcmp (sb.name, filename) == 0) {
-				zfo = r_io_zip_create_new_file (
-					archivename, filename, &sb,
-					flags, mode, rw);
-				r_io_zip_slurp_file (zfo);
+				zfo = r_io_zip_alloc_entry (io, arch, archivename, &sb, flags, mode, rw);
 				break;
 			}
 		}
 	}
 	if (!zfo) {
-		zfo = r_io_zip_create_new_file (archivename,
+		zfo = r_io_zip_create_new_file (io, archivename,
 			filename, NULL, flags, mode, rw);
 	}
 	zip_close (zipArch);
@@ -269,11 +504,13 @@ RIOZipFileObj* r_io_zip_alloc_zipfileobj(const char *archivename, const char *fi
 // Below this line are the r_io_zip plugin APIs
 static RList *r_io_zip_open_many(RIO *io, const char *file, int rw, int mode) {
 	RList *list_fds = NULL;
-	RListIter *iter;
-	RList *filenames = NULL;
 	RIODesc *res = NULL;
 	RIOZipFileObj *zfo = NULL;
-	char *filename_in_zipfile, *zip_filename = NULL, *zip_uri;
+	RIOZipArchive *arch;
+	struct zip *zipArch;
+	struct zip_stat sb;
+	ut64 i, num_entries;
+	char *zip_filename = NULL, *zip_uri;
 
 	if (!r_io_zip_plugin_open (io, file, true)) {
 		return NULL;
@@ -294,25 +531,27 @@ static RList *r_io_zip_open_many(RIO *io, const char *file, int rw, int mode) {
 		return NULL;
 	}
 
-	filenames = r_io_zip_get_files(zip_filename, 0, mode, rw );
-
-	if (!filenames) {
+	// the members are walked by index in one libzip handle, looking each
+	// of them up by name would scan the directory again for every one
+	zipArch = r_io_zip_open_archive (zip_filename, ZIP_CREATE, mode, rw);
+	if (!zipArch) {
 		free (zip_uri);
 		return NULL;
 	}
 
 	list_fds = r_list_new ();
-	r_list_foreach (filenames, iter, filename_in_zipfile) {
-		size_t v = strlen (filename_in_zipfile);
-
-		if (filename_in_zipfile[v-1] == '/') continue;
-
-		zfo = r_io_zip_alloc_zipfileobj (zip_filename,
-			filename_in_zipfile, ZIP_CREATE, mode, rw);
+	arch = r_io_zip_archive_open (zip_filename);
+	num_entries = zip_get_num_files (zipArch);
+	for (i = 0; i < num_entries; i++) {
+		zip_stat_init (&sb);
+		if (zip_stat_index (zipArch, i, 0, &sb) || !sb.name) {
+			continue;
+		}
+		size_t v = strlen (sb.name);
 
+		if (!v || sb.name[v-1] == '/') continue;
 
-		if (zfo && zfo->entry == -1)
-			eprintf ("Warning: File did not exist, creating a new one.\n");
+		zfo = r_io_zip_alloc_entry (io, arch, zip_filename, &sb, ZIP_CREATE, mode, rw);
 
 		if (zfo) {
 			zfo->io_backref = io;
@@ -322,8 +561,9 @@ static RList *r_io_zip_open_many(RIO *io, const char *file, int rw, int mode) {
 		r_list_append (list_fds, res);
 	}
 
+	zip_close (zipArch);
+	r_io_zip_archive_unref (arch);
 	free(zip_uri);
-	r_list_free (filenames);
 	return list_fds;
 }
 
@@ -474,7 +714,7 @@ static RIODesc *r_io_zip_open(RIO *io, const char *file, int rw, int mode) {
 	//eprintf("After parsing the given uri: %s\n", file);
 	//eprintf("Zip filename the given uri: %s\n", zip_filename);
 	//eprintf("File in the zip: %s\n", filename_in_zipfile);
-	zfo = r_io_zip_alloc_zipfileobj (zip_filename,
+	zfo = r_io_zip_alloc_zipfileobj (io, NULL, zip_filename,
 		filename_in_zipfile, ZIP_CREATE, mode, rw);
 
 	if (zfo) {
@@ -510,20 +750,21 @@ static ut64 r_io_zip_lseek(RIO *io, RIODesc *fd, ut64 offset, int whence) {
 
 	zfo = fd->data;
 	seek_val = zfo->b->cur;
+	ut64 length = r_io_zip_size (zfo);
 
 	switch (whence) {
 	case SEEK_SET:
-		seek_val = (zfo->b->length < offset) ?
-			zfo->b->length : offset;
+		seek_val = (length < offset) ?
+			length : offset;
 		zfo->b->cur = io->off = seek_val;
 		return seek_val;
 	case SEEK_CUR:
-		seek_val = (zfo->b->length < (offset + zfo->b->cur)) ?
-			zfo->b->length : offset + zfo->b->cur;
+		seek_val = (length < (offset + zfo->b->cur)) ?
+			length : offset + zfo->b->cur;
 		zfo->b->cur = io->off = seek_val;
 		return seek_val;
 	case SEEK_END:
-		seek_val = zfo->b->length;
+		seek_val = length;
 		zfo->b->cur = io->off = seek_val;
 		return seek_val;
 	}
@@ -535,6 +776,9 @@ static int r_io_zip_read(RIO *io, RIODesc *fd, ut8 *buf, int count) {
 	if (!fd || !fd->data || !buf)
 		return -1;
 	zfo = fd->data;
+	if (zfo->lazy) {
+		return r_io_zip_lazy_read (zfo, io->off, buf, count);
+	}
 	if (zfo->b->length < io->off)
 		io->off = zfo->b->length;
 	return r_buf_read_at (zfo->b, io->off, buf, count);
@@ -589,7 +833,7 @@ static bool r_io_zip_resize(RIO *io, RIODesc *fd, ut64 size) {
 		return false;
 	}
 	zfo = fd->data;
-	if (r_io_zip_truncate_buf (zfo, size)) {
+	if (r_io_zip_load (zfo) && r_io_zip_truncate_buf (zfo, size)) {
 		zfo->modified = 1;
 		r_io_zip_flush_file (zfo);
 		return true;
@@ -604,7 +848,7 @@ static int r_io_zip_write(RIO *io, RIODesc *fd, const ut8 *buf, int count) {
 		return -1;
 	}
 	zfo = fd->data;
-	if (!(zfo->flags & R_IO_WRITE)) {
+	if (!(zfo->flags & R_IO_WRITE) || !r_io_zip_load (zfo)) {
 		return -1;
 	}
 	if (zfo->b->cur + count >= zfo->b->length) {
@@ -4,84 +4,125 @@
 #include <r_types.h>
 #include <string.h>
 
-const ut64 cleanup_masks[] = {
-	0x0000000000000001,
-	0x0000000000000003,
-	0x0000000000000007,
-	0x000000000000000f,
-	0x000000000000001f,
-	0x000000000000003f,
-	0x000000000000007f,
-	0x00000000000000ff,
-	0x00000000000001ff,
-	0x00000000000003ff,
-	0x00000000000007ff,
-	0x0000000000000fff,
-	0x0000000000001fff,
-	0x0000000000003fff,
-	0x0000000000007fff,
-	0x000000000000ffff,
-	0x000000000001ffff,
-	0x000000000003ffff,
-	0x000000000007ffff,
-	0x00000000000fffff,
-	0x00000000001fffff,
-	0x00000000003fffff,
-	0x00000000007fffff,
-	0x0000000000ffffff,
-	0x0000000001ffffff,
-	0x0000000003ffffff,
-	0x0000000007ffffff,
-	0x000000000fffffff,
-	0x000000001fffffff,
-	0x000000003fffffff,
-	0x000000007fffffff,
-	0x00000000ffffffff,
-	0x00000001ffffffff,
-	0x00000003ffffffff,
-	0x00000007ffffffff,
-	0x0000000fffffffff,
-	0x0000001fffffffff,
-	0x0000003fffffffff,
-	0x0000007fffffffff,
-	0x000000ffffffffff,
-	0x000001ffffffffff,
-	0x000003ffffffffff,
-	0x000007ffffffffff,
-	0x00000fffffffffff,
-	0x00001fffffffffff,
-	0x00003fffffffffff,
-	0x00007fffffffffff,
-	0x0000ffffffffffff,
-	0x0001ffffffffffff,
-	0x0003ffffffffffff,
-	0x0007ffffffffffff,
-	0x000fffffffffffff,
-	0x001fffffffffffff,
-	0x003fffffffffffff,
-	0x007fffffffffffff,
-	0x00ffffffffffffff,
-	0x01ffffffffffffff,
-	0x03ffffffffffffff,
-	0x07ffffffffffffff,
-	0x0fffffffffffffff,
-	0x1fffffffffffffff,
-	0x3fffffffffffffff,
-	0x7fffffffffffffff
-};
+// The desc cache is a radix page table keyed by paddr >> R_IO_DESC_CACHE_SHIFT.
+// Inner nodes hold R_IO_DESC_CACHE_FANOUT slots, the leaves are RIODescCache
+// pages carrying a bitmap of the bytes written in them. The tree only grows
+// as high as needed to cover the biggest cached page index.
+
+#define FANOUT_BITS 6
+#define FANOUT_MASK (R_IO_DESC_CACHE_FANOUT - 1)
+#define LEVEL_IDX(key, level) (((key) >> (FANOUT_BITS * (level))) & FANOUT_MASK)
+
+typedef bool (*PageCallback)(RIODesc *desc, ut64 key, RIODescCache *page, void *user);
+
+static inline bool table_covers(RIODescCacheTable *t, ut64 key) {
+	return t->height * FANOUT_BITS >= 64 || !(key >> (t->height * FANOUT_BITS));
+}
+
+static RIODescCache *page_get(RIODescCacheTable *t, ut64 key) {
+	RIODescCacheNode *node = t->root;
+	int level;
+	if (!node || !table_covers (t, key)) {
+		return NULL;
+	}
+	for (level = t->height - 1; level > 0; level--) {
+		node = node->slot[LEVEL_IDX (key, level)];
+		if (!node) {
+			return NULL;
+		}
+	}
+	return node->slot[LEVEL_IDX (key, 0)];
+}
+
+static RIODescCache *page_get_or_create(RIODescCacheTable *t, ut64 key) {
+	RIODescCacheNode *node;
+	int level;
+	if (!t->root) {
+		if (!(t->root = R_NEW0 (RIODescCacheNode))) {
+			return NULL;
+		}
+		t->height = 1;
+	}
+	while (!table_covers (t, key)) {
+		if (!(node = R_NEW0 (RIODescCacheNode))) {
+			return NULL;
+		}
+		node->slot[0] = t->root;
+		node->used = 1;
+		t->root = node;
+		t->height++;
+	}
+	node = t->root;
+	for (level = t->height - 1; level > 0; level--) {
+		RIODescCacheNode **child = (RIODescCacheNode **)&node->slot[LEVEL_IDX (key, level)];
+		if (!*child) {
+			if (!(*child = R_NEW0 (RIODescCacheNode))) {
+				return NULL;
+			}
+			node->used++;
+		}
+		node = *child;
+	}
+	RIODescCache **page = (RIODescCache **)&node->slot[LEVEL_IDX (key, 0)];
+	if (!*page) {
+		if (!(*page = R_NEW0 (RIODescCache))) {
+			return NULL;
+		}
+		node->used++;
+		t->pages++;
+	}
+	return *page;
+}
+
+// walks the pages in ascending address order, the callback may free the page
+// it is given by returning false, empty nodes are released on the way back
+static void node_walk(RIODesc *desc, RIODescCacheNode *node, int level, ut64 prefix, PageCallback cb, void *user) {
+	int i;
+	for (i = 0; i < R_IO_DESC_CACHE_FANOUT; i++) {
+		if (!node->slot[i]) {
+			continue;
+		}
+		ut64 key = (prefix << FANOUT_BITS) | i;
+		if (level) {
+			RIODescCacheNode *child = node->slot[i];
+			node_walk (desc, child, level - 1, key, cb, user);
+			if (!child->used) {
+				free (child);
+				node->slot[i] = NULL;
+				node->used--;
+			}
+		} else if (!cb (desc, key, node->slot[i], user)) {
+			free (node->slot[i]);
+			node->slot[i] = NULL;
+			node->used--;
+			desc->cache->pages--;
+		}
+	}
+}
+
+static void table_walk(RIODesc *desc, PageCallback cb, void *user) {
+	RIODescCacheTable *t = desc->cache;
+	if (!t || !t->root) {
+		return;
+	}
+	node_walk (desc, t->root, t->height - 1, 0, cb, user);
+	if (!t->root->used) {
+		R_FREE (t->root);
+		t->height = 0;
+	}
+}
 
 R_API bool r_io_desc_cache_init(RIODesc *desc) {
 	if (!desc || desc->cache) {
 		return false;
 	}
-	return (desc->cache = sdb_new0 ()) ? true : false;
+	return (desc->cache = R_NEW0 (RIODescCacheTable)) ? true : false;
 }
 
 R_API int r_io_desc_cache_write(RIODesc *desc, ut64 paddr, const ut8 *buf, int len) {
 	RIODescCache *cache;
 	ut64 caddr, desc_sz = r_io_desc_size (desc);
-	char k[64];
-	int cbaddr, written = 0;
+	int cbaddr, chunk, written = 0;
 	if ((len < 1) || !desc || (desc_sz <= paddr) ||
 	    !desc->io || (!desc->cache && !r_io_desc_cache_init (desc))) {
 		return 0;
@@ -92,41 +133,16 @@ R_API int r_io_desc_cache_write(RIODesc *desc, ut64 paddr, const ut8 *buf, int l
 	if (paddr > (desc_sz - len)) {
 		len = (int)(desc_sz - paddr);
 	}
-	caddr = paddr / R_IO_DESC_CACHE_SIZE;
-	cbaddr = paddr % R_IO_DESC_CACHE_SIZE;
+	caddr = paddr >> R_IO_DESC_CACHE_SHIFT;
+	cbaddr = paddr & (R_IO_DESC_CACHE_SIZE - 1);
 	while (written < len) {
-		sdb_itoa (caddr, k, 10);
-		//get an existing desc-cache, if it exists
-		if (!(cache = (RIODescCache *)(size_t)sdb_num_get (desc->cache, k, NULL))) {
-			//create new desc-cache
-			cache = R_NEW0 (RIODescCache);
-			if (!cache) {
-				return 0;
-			}
-			//feed sdb with the new desc-cache
-			sdb_num_set (desc->cache, k, (ut64)(size_t)cache, 0);
-		}
-		//check if the remaining data fits into the cache
-		if ((len - written) > (R_IO_DESC_CACHE_SIZE - cbaddr)) {
-			written += (R_IO_DESC_CACHE_SIZE - cbaddr);
-			//this can be optimized
-			for (; cbaddr < R_IO_DESC_CACHE_SIZE; cbaddr++) {
-				//write to cache
-				cache->cdata[cbaddr] = *buf;
-				//save, that its cached
-				cache->cached |= (0x1ULL << cbaddr);
-				buf++;
-			}
-		} else {
-			//XXX this looks like very suspicious
-			do {
-				cache->cdata[cbaddr] = *buf;
-				cache->cached |= (0x1ULL << cbaddr);
-				buf++;
-				written++;
-				cbaddr++;
-			} while (len > written);
+		if (!(cache = page_get_or_create (desc->cache, caddr))) {
+			return written;
 		}
+		chunk = R_MIN (len - written, R_IO_DESC_CACHE_SIZE - cbaddr);
+		memcpy (cache->cdata + cbaddr, buf + written, chunk);
+		cache->cached |= (UT64_MAX >> (64 - chunk)) << cbaddr;
+		written += chunk;
 		caddr++;
 		cbaddr = 0;
 	}
@@ -135,11 +151,9 @@ R_API int r_io_desc_cache_write(RIODesc *desc, ut64 paddr, const ut8 *buf, int l
 
 R_API int r_io_desc_cache_read(RIODesc *desc, ut64 paddr, ut8 *buf, int len) {
 	RIODescCache *cache;
-	char k[64];
-	ut8 *ptr = buf;
 	ut64 caddr, desc_sz = r_io_desc_size (desc);
-	int cbaddr, amount = 0;
-	if ((len < 1) || !desc || (desc_sz <= paddr) || !desc->io || !desc->cache) {
+	int cbaddr, chunk, i, amount = 0;
+	if ((len < 1) || !desc || (desc_sz <= paddr) || !desc->io) {
 		return 0;
 	}
 	if (len > desc_sz) {
@@ -148,41 +162,64 @@ R_API int r_io_desc_cache_read(RIODesc *desc, ut64 paddr, ut8 *buf, int len) {
 	if (paddr > (desc_sz - len)) {
 		len = (int)(desc_sz - paddr);
 	}
-	caddr = paddr / R_IO_DESC_CACHE_SIZE;
-	cbaddr = paddr % R_IO_DESC_CACHE_SIZE;
+	if (!desc->cache || !desc->cache->pages) {
+		// nothing to overlay
+		return len;
+	}
+	caddr = paddr >> R_IO_DESC_CACHE_SHIFT;
+	cbaddr = paddr & (R_IO_DESC_CACHE_SIZE - 1);
 	while (amount < len) {
-		sdb_itoa (caddr, k, 10);
-		// get an existing desc-cache, if it exists
-		if (!(cache = (RIODescCache *)(size_t)sdb_num_get (desc->cache, k, NULL))) {	
-			amount += (R_IO_DESC_CACHE_SIZE - cbaddr);
-			ptr += (R_IO_DESC_CACHE_SIZE - cbaddr);
-			goto beach;
-		}
-		if ((len - amount) > (R_IO_DESC_CACHE_SIZE - cbaddr)) {
-			amount += (R_IO_DESC_CACHE_SIZE - cbaddr);
-			for (; cbaddr < R_IO_DESC_CACHE_SIZE; cbaddr++) {
-				if (cache->cached & (0x1ULL << cbaddr)) {
-					*ptr = cache->cdata[cbaddr];
+		chunk = R_MIN (len - amount, R_IO_DESC_CACHE_SIZE - cbaddr);
+		if ((cache = page_get (desc->cache, caddr))) {
+			ut64 mask = cache->cached >> cbaddr;
+			if (mask == (UT64_MAX >> cbaddr) && chunk == R_IO_DESC_CACHE_SIZE - cbaddr) {
+				memcpy (buf + amount, cache->cdata + cbaddr, chunk);
+			} else {
+				for (i = 0; i < chunk; i++) {
+					if (mask & (1ULL << i)) {
+						buf[amount + i] = cache->cdata[cbaddr + i];
+					}
 				}
-				ptr++;
 			}
-		} else {
-			do {
-				if (cache->cached & (0x1ULL << cbaddr)) {
-					*ptr = cache->cdata[cbaddr];
-				}
-				ptr++;
-				amount++;
-				cbaddr++;
-			} while (len > amount);
 		}
-beach:
+		amount += chunk;
 		caddr++;
 		cbaddr = 0;
 	}
 	return amount;
 }
 
+// true if any page with a key in [from, last] exists below node
+static bool node_overlaps(RIODescCacheNode *node, int level, ut64 prefix, ut64 from, ut64 last) {
+	int i, shift = FANOUT_BITS * level;
+	for (i = 0; i < R_IO_DESC_CACHE_FANOUT; i++) {
+		if (!node->slot[i]) {
+			continue;
+		}
+		ut64 key = (prefix << FANOUT_BITS) | i;
+		ut64 lo = key << shift;
+		ut64 hi = lo | ((shift < 64)? (1ULL << shift) - 1: UT64_MAX);
+		if (hi < from || lo > last) {
+			continue;
+		}
+		if (!level || node_overlaps (node->slot[i], level - 1, key, from, last)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// true if the desc cache holds written bytes in [paddr, paddr + len)
+R_API bool r_io_desc_cache_overlaps(RIODesc *desc, ut64 paddr, ut64 len) {
+	RIODescCacheTable *t;
+	if (!desc || !(t = desc->cache) || !t->root || !t->pages || !len) {
+		return false;
+	}
+	ut64 last = (len - 1 > UT64_MAX - paddr)? UT64_MAX: paddr + len - 1;
+	return node_overlaps (t->root, t->height - 1, 0,
+		paddr >> R_IO_DESC_CACHE_SHIFT, last >> R_IO_DESC_CACHE_SHIFT);
+}
+
 static void __riocache_free(void *user) {
 	RIOCache *cache = (RIOCache *) user;
 	if (cache) {
@@ -192,57 +229,47 @@ static void __riocache_free(void *user) {
 	free (cache);
 }
 
-static int __desc_cache_list_cb(void *user, const char *k, const char *v) {
-	RList *writes = (RList *)user;
-	RIODescCache *dcache;
-	RIOCache *cache = NULL;
-	ut64 blockaddr;
-	int byteaddr, i;
-	if (!writes) {
-		return false;
+typedef struct {
+	RList *writes;
+	RIOCache *run;	// consecutive cached bytes, may span several pages
+} PCacheList;
+
+static void __desc_cache_list_run_end(PCacheList *pl) {
+	if (pl->run) {
+		r_list_push (pl->writes, pl->run);
+		pl->run = NULL;
 	}
-	dcache = (RIODescCache *)(size_t)sdb_atoi (v);
-	if (!dcache) {
-		return false;
+}
+
+static bool __desc_cache_list_cb(RIODesc *desc, ut64 key, RIODescCache *dcache, void *user) {
+	PCacheList *pl = (PCacheList *)user;
+	ut64 blockaddr = key << R_IO_DESC_CACHE_SHIFT;
+	int byteaddr;
+	if (pl->run && r_itv_end (pl->run->itv) != blockaddr) {
+		__desc_cache_list_run_end (pl);
 	}
-	blockaddr = sdb_atoi (k) * R_IO_DESC_CACHE_SIZE;
-	for (i = byteaddr = 0; byteaddr < R_IO_DESC_CACHE_SIZE; byteaddr++) {
-		if (dcache->cached & (0x1LL << byteaddr)) {
-			if (!cache) {
-				cache = R_NEW0 (RIOCache);
-				if (!cache) {
-					return false;
+	for (byteaddr = 0; byteaddr < R_IO_DESC_CACHE_SIZE; byteaddr++) {
+		if (dcache->cached & (1ULL << byteaddr)) {
+			if (!pl->run) {
+				if (!(pl->run = R_NEW0 (RIOCache))) {
+					return true;
 				}
-				cache->data = malloc (R_IO_DESC_CACHE_SIZE - byteaddr);
-				if (!cache->data) {
-					free (cache);
-					return false;
-				}
-				cache->itv.addr = blockaddr + byteaddr;
+				pl->run->itv.addr = blockaddr + byteaddr;
 			}
-			cache->data[i] = dcache->cdata[byteaddr];
-			i++;
-		} else if (cache) {
-			ut8 *data = realloc (cache->data, i);
-			if (!data) {
-				__riocache_free ((void *) cache);
-				return false;
+			if (!(pl->run->itv.size % R_IO_DESC_CACHE_SIZE)) {
+				ut8 *data = realloc (pl->run->data, pl->run->itv.size + R_IO_DESC_CACHE_SIZE);
+				if (!data) {
+					__riocache_free (pl->run);
+					pl->run = NULL;
+					return true;
+				}
+				pl->run->data = data;
 			}
-			cache->data = data;
-			cache->itv.size = i;
-			i = 0;
-			r_list_push (writes, cache);
-			cache = NULL;
+			pl->run->data[pl->run->itv.size++] = dcache->cdata[byteaddr];
+		} else {
+			__desc_cache_list_run_end (pl);
 		}
 	}
-	if (cache) {
-#if 0
-		cache->size = i;
-		cache->to = blockaddr + R_IO_DESC_CACHE_SIZE;
-#endif
-		cache->itv.size = i;
-		r_list_push (writes, cache);
-	}
 	return true;
 }
 
@@ -250,46 +277,40 @@ R_API RList *r_io_desc_cache_list(RIODesc *desc) {
 	if (!desc || !desc->io || !desc->io->desc || !desc->io->p_cache || !desc->cache) {
 		return NULL;
 	}
-	RList *writes = r_list_newf ((RListFree)__riocache_free);
-	if (!writes) {
+	PCacheList pl = { r_list_newf ((RListFree)__riocache_free), NULL };
+	if (!pl.writes) {
 		return NULL;
 	}
-	sdb_foreach (desc->cache, __desc_cache_list_cb, writes);
+	table_walk (desc, __desc_cache_list_cb, &pl);
+	__desc_cache_list_run_end (&pl);
 	RIODesc *current = desc->io->desc;
+	int p_cache = desc->io->p_cache;
 	desc->io->desc = desc;
-	desc->io->p_cache = false;
+	desc->io->p_cache = 0;
 
 	RIOCache *c;
 	RListIter *iter;
-	r_list_foreach (writes, iter, c) {
+	r_list_foreach (pl.writes, iter, c) {
 		const ut64 itvSize = r_itv_size (c->itv);
 		c->odata = calloc (1, itvSize);
 		if (!c->odata) {
-			r_list_free (writes);
-			return NULL;
+			r_list_free (pl.writes);
+			pl.writes = NULL;
+			break;
 		}
 		r_io_pread_at (desc->io, r_itv_begin (c->itv), c->odata, itvSize);
 	}
-	desc->io->p_cache = true;
+	desc->io->p_cache = p_cache;
 	desc->io->desc = current;
-	return writes;
+	return pl.writes;
 }
 
-static int __desc_cache_commit_cb(void *user, const char *k, const char *v) {
-	RIODesc *desc = (RIODesc *)user;
-	ut64 blockaddr;
+static bool __desc_cache_commit_cb(RIODesc *desc, ut64 key, RIODescCache *dcache, void *user) {
+	ut64 blockaddr = key << R_IO_DESC_CACHE_SHIFT;
 	int byteaddr, i;
 	ut8 buf[R_IO_DESC_CACHE_SIZE] = {0};
-	if (!desc || !desc->io) {
-		return false;
-	}
-	RIODescCache *dcache = (RIODescCache *)(size_t)sdb_atoi (v);
-	if (!dcache) {
-		return false;
-	}
-	blockaddr = R_IO_DESC_CACHE_SIZE * sdb_atoi (k);
 	for (i = byteaddr = 0; byteaddr < R_IO_DESC_CACHE_SIZE; byteaddr++) {
-		if (dcache->cached & (0x1LL << byteaddr)) {
+		if (dcache->cached & (1ULL << byteaddr)) {
 			buf[i] = dcache->cdata[byteaddr];
 			i++;
 		} else if (i > 0) {
@@ -300,12 +321,12 @@ static int __desc_cache_commit_cb(void *user, const char *k, const char *v) {
 	if (i > 0) {
 		r_io_pwrite_at (desc->io, blockaddr + R_IO_DESC_CACHE_SIZE - i, buf, i);
 	}
-	free (dcache);
-	return true;
+	return false;
 }
 
 R_API bool r_io_desc_cache_commit(RIODesc *desc) {
 	RIODesc *current;
+	int p_cache;
 	if (!desc || !(desc->flags & R_IO_WRITE) || !desc->io || !desc->io->files || !desc->io->p_cache) {
 		return false;
 	}
@@ -313,58 +334,45 @@ R_API bool r_io_desc_cache_commit(RIODesc *desc) {
 		return true;
 	}
 	current = desc->io->desc;
+	p_cache = desc->io->p_cache;
 	desc->io->desc = desc;
-	desc->io->p_cache = false;
-	sdb_foreach (desc->cache, __desc_cache_commit_cb, desc);
-	sdb_free (desc->cache);
-	desc->cache = NULL;
-	desc->io->p_cache = true;
+	desc->io->p_cache = 0;
+	table_walk (desc, __desc_cache_commit_cb, NULL);
+	R_FREE (desc->cache);
+	desc->io->p_cache = p_cache;
 	desc->io->desc = current;
 	return true;
 }
 
-static int __desc_cache_cleanup_cb(void *user, const char *k, const char *v) {
-	RIODesc *desc = (RIODesc *)user;
-	RIODescCache *cache;
-	ut64 size, blockaddr;
-	int byteaddr;
-	if (!desc || !desc->cache) {
-		return false;
-	}
-	cache = (RIODescCache *) (size_t)sdb_atoi (v);
-	blockaddr = R_IO_DESC_CACHE_SIZE * sdb_atoi (k);
-	size = r_io_desc_size (desc);
+static bool __desc_cache_cleanup_cb(RIODesc *desc, ut64 key, RIODescCache *cache, void *user) {
+	ut64 size = *(ut64 *)user;
+	ut64 blockaddr = key << R_IO_DESC_CACHE_SHIFT;
 	if (size <= blockaddr) {
-		free (cache);
-		sdb_unset (desc->cache, k, 0);
-		return true;
+		return false;
 	}
-	if (size <= (blockaddr + R_IO_DESC_CACHE_SIZE - 1)) {
-		//this looks scary, but it isn't
-		byteaddr = (int)(size - blockaddr) - 1;		
-		cache->cached &= cleanup_masks[byteaddr];
+	if (size < blockaddr + R_IO_DESC_CACHE_SIZE) {
+		// keep only the bytes below the new end of the desc
+		cache->cached &= UT64_MAX >> (64 - (int)(size - blockaddr));
 	}
-	return true;
+	return cache->cached != 0;
 }
 
 R_API void r_io_desc_cache_cleanup(RIODesc *desc) {
 	if (desc && desc->cache) {
-		sdb_foreach (desc->cache, __desc_cache_cleanup_cb, desc);
+		ut64 size = r_io_desc_size (desc);
+		table_walk (desc, __desc_cache_cleanup_cb, &size);
 	}
 }
 
-static int __desc_cache_free_cb(void *user, const char* k, const char *v) {
-	RIODescCache *cache = (RIODescCache *)(size_t)sdb_atoi (v);
-	free (cache);
-	return true;
+static bool __desc_cache_free_cb(RIODesc *desc, ut64 key, RIODescCache *cache, void *user) {
+	return false;
 }
 
 static bool __desc_fini_cb (void *user, void *data, ut32 id) {
 	RIODesc *desc = (RIODesc *)data;
 	if (desc->cache) {
-		sdb_foreach (desc->cache, __desc_cache_free_cb, NULL);
-		sdb_free (desc->cache);
-		desc->cache = NULL;
+		table_walk (desc, __desc_cache_free_cb, NULL);
+		R_FREE (desc->cache);
 	}
 	return true;
 }
@@ -132,6 +132,12 @@ R_API int r_io_plugin_read(RIODesc *desc, ut8 *buf, int len) {
 	if (!desc->plugin->read) {
 		return -1;
 	}
+	if (desc->io && desc->io->prof.enabled) {
+		ut64 t = r_io_prof_now ();
+		int ret = desc->plugin->read (desc->io, desc, buf, len);
+		r_io_prof_backend (desc, false, ret, r_io_prof_now () - t);
+		return ret;
+	}
 	return desc->plugin->read (desc->io, desc, buf, len);
 }
 
@@ -142,6 +148,12 @@ R_API int r_io_plugin_write(RIODesc *desc, const ut8 *buf, int len) {
 	if (!desc->plugin->write) {
 		return -1;
 	}
+	if (desc->io && desc->io->prof.enabled) {
+		ut64 t = r_io_prof_now ();
+		int ret = desc->plugin->write (desc->io, desc, buf, len);
+		r_io_prof_backend (desc, true, ret, r_io_prof_now () - t);
+		return ret;
+	}
 	return desc->plugin->write (desc->io, desc, buf, len);
 }
 
@@ -0,0 +1,231 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Opt-in profiler of the io backends (e io.prof). Every plugin read and
+// write is timed and accounted to the plugin, to the command that caused it
+// and, when it went through a map, to that map.
+
+#include "r_io.h"
+
+typedef struct {
+	RIOProfStat read;
+	RIOProfStat write;
+} RIOProfEntry;
+
+static void prof_free_kv(HtKv *kv) {
+	free (kv->key);
+	free (kv->value);
+	free (kv);
+}
+
+R_API ut64 r_io_prof_now(void) {
+#if __UNIX__ && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	if (!clock_gettime (CLOCK_MONOTONIC, &ts)) {
+		return (ut64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+#endif
+	ut64 now = r_sys_now ();
+	return (now >> 20) * 1000000 + (now & 0xfffff);
+}
+
+R_API void r_io_prof_init(RIO *io) {
+	memset (&io->prof, 0, sizeof (io->prof));
+	io->prof.ht = ht_new (NULL, prof_free_kv, NULL);
+}
+
+R_API void r_io_prof_fini(RIO *io) {
+	ht_free (io->prof.ht);
+	io->prof.ht = NULL;
+	io->prof.enabled = false;
+}
+
+R_API void r_io_prof_enable(RIO *io, bool enable) {
+	io->prof.enabled = enable && io->prof.ht;
+}
+
+R_API void r_io_prof_reset(RIO *io) {
+	memset (&io->prof.read, 0, sizeof (RIOProfStat));
+	memset (&io->prof.write, 0, sizeof (RIOProfStat));
+	if (io->prof.ht) {
+		ht_free (io->prof.ht);
+		io->prof.ht = ht_new (NULL, prof_free_kv, NULL);
+	}
+}
+
+static void stat_add(RIOProfStat *st, int len, ut64 usec) {
+	int i = 0;
+	st->calls++;
+	if (len > 0) {
+		st->bytes += len;
+	}
+	st->usec += usec;
+	if (usec > st->max) {
+		st->max = usec;
+	}
+	while (i < R_IO_PROF_HIST - 1 && usec >= (1ULL << i)) {
+		i++;
+	}
+	st->hist[i]++;
+}
+
+static void entry_add(RIO *io, const char *key, bool write, int len, ut64 usec) {
+	RIOProfEntry *e = ht_find (io->prof.ht, key, NULL);
+	if (!e) {
+		if (!(e = R_NEW0 (RIOProfEntry))) {
+			return;
+		}
+		ht_insert (io->prof.ht, key, e);
+	}
+	stat_add (write? &e->write: &e->read, len, usec);
+}
+
+// the first word of the running command names it, "aac" for "aac @ main"
+static void cmd_key(const char *cmd, char *key, int size) {
+	int n = strlen ("cmd:");
+	memcpy (key, "cmd:", n);
+	while (*cmd == ' ' || *cmd == '\t') {
+		cmd++;
+	}
+	for (; *cmd && n < size - 1 && !strchr (" \t@;|>~`", *cmd); cmd++) {
+		key[n++] = *cmd;
+	}
+	if (n == strlen ("cmd:")) {
+		// io done outside of any command, like loading the file
+		key[n++] = '-';
+	}
+	key[n] = 0;
+}
+
+// accounts one call to the plugin of desc, len is what it returned
+R_API void r_io_prof_backend(RIODesc *desc, bool write, int len, ut64 usec) {
+	RIO *io = desc->io;
+	char key[64];
+	stat_add (write? &io->prof.write: &io->prof.read, len, usec);
+	snprintf (key, sizeof (key), "plugin:%s", desc->plugin->name);
+	entry_add (io, key, write, len, usec);
+	cmd_key (io->prof.cmd? io->prof.cmd: "", key, sizeof (key));
+	entry_add (io, key, write, len, usec);
+}
+
+R_API void r_io_prof_map(RIO *io, RIOMap *map, bool write, int len, ut64 usec) {
+	char key[32];
+	snprintf (key, sizeof (key), "map:%d", map->id);
+	entry_add (io, key, write, len, usec);
+}
+
+typedef struct {
+	RIOProfEntry *e;
+	const char *key;
+} ProfRow;
+
+static bool collect_cb(void *user, const char *k, void *v) {
+	ProfRow *row = R_NEW0 (ProfRow);
+	if (row) {
+		row->key = k;
+		row->e = v;
+		r_list_append (user, row);
+	}
+	return true;
+}
+
+// groups the kinds together, then puts the most expensive rows first
+static int row_cmp(const void *a, const void *b) {
+	const ProfRow *ra = a, *rb = b;
+	const char *ca = strchr (ra->key, ':'), *cb = strchr (rb->key, ':');
+	int ka = ca? (int)(ca - ra->key): 0, kb = cb? (int)(cb - rb->key): 0;
+	int ret = strncmp (ra->key, rb->key, R_MIN (ka, kb) + 1);
+	if (ret) {
+		return ret;
+	}
+	ut64 ta = ra->e->read.usec + ra->e->write.usec;
+	ut64 tb = rb->e->read.usec + rb->e->write.usec;
+	return (ta < tb)? 1: (ta > tb)? -1: strcmp (ra->key, rb->key);
+}
+
+static void stat_json(RIO *io, const char *name, RIOProfStat *st) {
+	int i;
+	io->cb_printf ("\"%s\":{\"calls\":%"PFMT64d",\"bytes\":%"PFMT64d
+		",\"usec\":%"PFMT64d",\"max\":%"PFMT64d",\"hist\":[",
+		name, st->calls, st->bytes, st->usec, st->max);
+	for (i = 0; i < R_IO_PROF_HIST; i++) {
+		io->cb_printf ("%s%"PFMT64d, i? ",": "", st->hist[i]);
+	}
+	io->cb_printf ("]}");
+}
+
+static void stat_row(RIO *io, const char *kind, const char *name, const char *op, RIOProfStat *st) {
+	if (st->calls) {
+		io->cb_printf ("%-7s %-16s %-5s %10"PFMT64d" %12"PFMT64d" %12"PFMT64d" %8"PFMT64d" %10"PFMT64d"\n",
+			kind, name, op, st->calls, st->bytes, st->usec, st->usec / st->calls, st->max);
+	}
+}
+
+static void stat_hist(RIO *io, const char *op, RIOProfStat *st) {
+	int i;
+	if (!st->calls) {
+		return;
+	}
+	io->cb_printf ("%s latency:\n", op);
+	for (i = 0; i < R_IO_PROF_HIST; i++) {
+		if (!st->hist[i]) {
+			continue;
+		}
+		int pct = (int)((st->hist[i] * 100) / st->calls);
+		if (i == R_IO_PROF_HIST - 1) {
+			io->cb_printf ("  >= %7"PFMT64d"us %10"PFMT64d" %3d%%\n", 1ULL << (i - 1), st->hist[i], pct);
+		} else {
+			io->cb_printf ("  <  %7"PFMT64d"us %10"PFMT64d" %3d%%\n", 1ULL << i, st->hist[i], pct);
+		}
+	}
+}
+
+R_API void r_io_prof_dump(RIO *io, int mode) {
+	RListIter *iter;
+	ProfRow *row;
+	RList *rows = r_list_newf (free);
+	if (!rows) {
+		return;
+	}
+	if (io->prof.ht) {
+		ht_foreach (io->prof.ht, collect_cb, rows);
+	}
+	r_list_sort (rows, row_cmp);
+	if (mode == 'j') {
+		io->cb_printf ("{\"enabled\":%s,", r_str_bool (io->prof.enabled));
+		stat_json (io, "read", &io->prof.read);
+		io->cb_printf (",");
+		stat_json (io, "write", &io->prof.write);
+		io->cb_printf (",\"entries\":[");
+		r_list_foreach (rows, iter, row) {
+			const char *name = strchr (row->key, ':');
+			io->cb_printf ("%s{\"kind\":\"%.*s\",\"name\":\"%s\",", iter->p? ",": "",
+				(int)(name - row->key), row->key, name + 1);
+			stat_json (io, "read", &row->e->read);
+			io->cb_printf (",");
+			stat_json (io, "write", &row->e->write);
+			io->cb_printf ("}");
+		}
+		io->cb_printf ("]}\n");
+		r_list_free (rows);
+		return;
+	}
+	if (!io->prof.enabled && !io->prof.read.calls && !io->prof.write.calls) {
+		io->cb_printf ("io.prof is disabled\n");
+		r_list_free (rows);
+		return;
+	}
+	io->cb_printf ("%-7s %-16s %-5s %10s %12s %12s %8s %10s\n",
+		"kind", "name", "op", "calls", "bytes", "usec", "avg", "max");
+	stat_row (io, "total", "", "read", &io->prof.read);
+	stat_row (io, "total", "", "write", &io->prof.write);
+	r_list_foreach (rows, iter, row) {
+		char kind[16];
+		const char *name = strchr (row->key, ':');
+		r_str_ncpy (kind, row->key, R_MIN ((int)sizeof (kind), (int)(name - row->key) + 1));
+		stat_row (io, kind, name + 1, "read", &row->e->read);
+		stat_row (io, kind, name + 1, "write", &row->e->write);
+	}
+	stat_hist (io, "read", &io->prof.read);
+	stat_hist (io, "write", &io->prof.write);
+	r_list_free (rows);
+}
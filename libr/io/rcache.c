@@ -0,0 +1,273 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Page granular LRU cache of backend reads. It sits between the skyline
+// dispatcher and RIOPlugin->read, so slow plugins (gdb, rap, r2pipe,
+// ptrace, http..) are asked for whole pages instead of every small read.
+
+#include "r_io.h"
+
+#define RCACHE_DEFAULT_BSIZE 0x1000
+#define RCACHE_DEFAULT_PAGES 256
+
+static inline ut32 page_hash(RIORCache *rc, int fd, ut64 addr) {
+	ut64 h = (addr / rc->bsize) * 0x9e3779b97f4a7c15ULL;
+	return (ut32)((h >> 32) ^ h ^ (ut32)fd) & (rc->nbuckets - 1);
+}
+
+static void lru_unlink(RIORCache *rc, RIORCachePage *p) {
+	if (p->prev) {
+		p->prev->next = p->next;
+	} else {
+		rc->head = p->next;
+	}
+	if (p->next) {
+		p->next->prev = p->prev;
+	} else {
+		rc->tail = p->prev;
+	}
+	p->prev = p->next = NULL;
+}
+
+static void lru_push(RIORCache *rc, RIORCachePage *p) {
+	p->prev = NULL;
+	p->next = rc->head;
+	if (rc->head) {
+		rc->head->prev = p;
+	}
+	rc->head = p;
+	if (!rc->tail) {
+		rc->tail = p;
+	}
+}
+
+static void hash_unlink(RIORCache *rc, RIORCachePage *p) {
+	RIORCachePage **pp = &rc->buckets[page_hash (rc, p->fd, p->addr)];
+	for (; *pp; pp = &(*pp)->hnext) {
+		if (*pp == p) {
+			*pp = p->hnext;
+			break;
+		}
+	}
+	p->hnext = NULL;
+}
+
+static RIORCachePage *page_find(RIORCache *rc, int fd, ut64 addr) {
+	RIORCachePage *p = rc->buckets[page_hash (rc, fd, addr)];
+	for (; p; p = p->hnext) {
+		if (p->addr == addr && p->fd == fd) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static void page_free(RIORCachePage *p) {
+	if (p) {
+		free (p->buf);
+		free (p);
+	}
+}
+
+static void page_drop(RIORCache *rc, RIORCachePage *p) {
+	hash_unlink (rc, p);
+	lru_unlink (rc, p);
+	page_free (p);
+	rc->count--;
+}
+
+// reads the page at addr from the plugin, recycling the least recently used
+// page when the cache is full. Returns NULL if the backend gave us nothing.
+static RIORCachePage *page_fill(RIODesc *desc, ut64 addr) {
+	RIORCache *rc = &desc->io->rcache;
+	RIORCachePage *p;
+	if (rc->count >= rc->pages && rc->tail) {
+		p = rc->tail;
+		hash_unlink (rc, p);
+		lru_unlink (rc, p);
+		rc->count--;
+		rc->evictions++;
+	} else {
+		p = R_NEW0 (RIORCachePage);
+		if (!p) {
+			return NULL;
+		}
+		p->buf = malloc (rc->bsize);
+		if (!p->buf) {
+			free (p);
+			return NULL;
+		}
+	}
+	p->len = r_io_plugin_read_at (desc, addr, p->buf, rc->bsize);
+	if (p->len < 1) {
+		page_free (p);
+		return NULL;
+	}
+	p->fd = desc->fd;
+	p->addr = addr;
+	ut32 h = page_hash (rc, p->fd, addr);
+	p->hnext = rc->buckets[h];
+	rc->buckets[h] = p;
+	lru_push (rc, p);
+	rc->count++;
+	return p;
+}
+
+R_API void r_io_rcache_init(RIO *io) {
+	memset (&io->rcache, 0, sizeof (io->rcache));
+	(void)r_io_rcache_setup (io, RCACHE_DEFAULT_BSIZE, RCACHE_DEFAULT_PAGES);
+}
+
+R_API void r_io_rcache_fini(RIO *io) {
+	r_io_rcache_flush (io);
+	R_FREE (io->rcache.buckets);
+	io->rcache.nbuckets = 0;
+	io->rcache.enabled = false;
+}
+
+// bsize must be a power of two, changing the geometry drops all cached pages
+R_API bool r_io_rcache_setup(RIO *io, ut32 bsize, ut32 pages) {
+	RIORCache *rc = &io->rcache;
+	ut32 nbuckets = 1;
+	if (!bsize || (bsize & (bsize - 1)) || !pages) {
+		return false;
+	}
+	while (nbuckets < pages * 2) {
+		nbuckets <<= 1;
+	}
+	RIORCachePage **buckets = calloc (nbuckets, sizeof (RIORCachePage *));
+	if (!buckets) {
+		return false;
+	}
+	r_io_rcache_flush (io);
+	free (rc->buckets);
+	rc->buckets = buckets;
+	rc->nbuckets = nbuckets;
+	rc->bsize = bsize;
+	rc->pages = pages;
+	return true;
+}
+
+R_API void r_io_rcache_enable(RIO *io, bool enable) {
+	if (!enable) {
+		r_io_rcache_flush (io);
+	}
+	io->rcache.enabled = enable;
+}
+
+// true if reads from desc must be served through the page cache
+R_API bool r_io_rcache_active(RIODesc *desc) {
+	RIO *io = desc->io;
+	// cachemode feeds io.cache from the raw desc reads, keep it on the slow path
+	return io && io->rcache.enabled && io->rcache.buckets && !desc->nocache
+		&& !io->cachemode && (desc->flags & R_IO_READ);
+}
+
+// returns the number of bytes of the read prefix, like r_io_desc_read
+R_API int r_io_rcache_read(RIODesc *desc, ut64 paddr, ut8 *buf, int len) {
+	RIORCache *rc = &desc->io->rcache;
+	int done = 0;
+	while (done < len) {
+		ut64 addr = paddr + done;
+		ut64 base = addr & ~((ut64)rc->bsize - 1);
+		int delta = (int)(addr - base);
+		RIORCachePage *p = page_find (rc, desc->fd, base);
+		if (p) {
+			rc->hits++;
+			if (p != rc->head) {
+				lru_unlink (rc, p);
+				lru_push (rc, p);
+			}
+		} else {
+			rc->misses++;
+			if (!(p = page_fill (desc, base))) {
+				// the backend refuses whole pages here, ask for the exact range
+				int ret = r_io_plugin_read_at (desc, addr, buf + done, len - done);
+				return (ret > 0)? done + ret: (done? done: ret);
+			}
+		}
+		if (delta >= p->len) {
+			break;
+		}
+		int n = R_MIN (p->len - delta, len - done);
+		memcpy (buf + done, p->buf + delta, n);
+		done += n;
+		if (p->len < rc->bsize) {
+			break;
+		}
+	}
+	return done;
+}
+
+// drops the cached pages of fd overlapping [paddr, paddr + size)
+R_API void r_io_rcache_invalidate(RIO *io, int fd, ut64 paddr, ut64 size) {
+	RIORCache *rc = &io->rcache;
+	RIORCachePage *p, *next;
+	if (!rc->count || !size) {
+		return;
+	}
+	ut64 from = paddr & ~((ut64)rc->bsize - 1);
+	ut64 last = (size > UT64_MAX - paddr)? UT64_MAX: paddr + size - 1;
+	if ((last - from) / rc->bsize >= rc->count) {
+		for (p = rc->head; p; p = next) {
+			next = p->next;
+			if (p->fd == fd && p->addr <= last && p->addr + rc->bsize - 1 >= paddr) {
+				page_drop (rc, p);
+				rc->invalidations++;
+			}
+		}
+		return;
+	}
+	ut64 addr = from;
+	do {
+		if ((p = page_find (rc, fd, addr))) {
+			page_drop (rc, p);
+			rc->invalidations++;
+		}
+		addr += rc->bsize;
+	} while (addr && addr <= last);
+}
+
+R_API void r_io_rcache_flush_fd(RIO *io, int fd) {
+	r_io_rcache_invalidate (io, fd, 0, UT64_MAX);
+}
+
+R_API void r_io_rcache_flush(RIO *io) {
+	RIORCache *rc = &io->rcache;
+	RIORCachePage *p, *next;
+	for (p = rc->head; p; p = next) {
+		next = p->next;
+		page_free (p);
+	}
+	if (rc->buckets) {
+		memset (rc->buckets, 0, rc->nbuckets * sizeof (RIORCachePage *));
+	}
+	rc->head = rc->tail = NULL;
+	rc->count = 0;
+}
+
+R_API void r_io_rcache_reset_stats(RIO *io) {
+	RIORCache *rc = &io->rcache;
+	rc->hits = rc->misses = rc->evictions = rc->invalidations = 0;
+}
+
+R_API void r_io_rcache_stats(RIO *io, int mode) {
+	RIORCache *rc = &io->rcache;
+	ut64 total = rc->hits + rc->misses;
+	int ratio = total? (int)((rc->hits * 100) / total): 0;
+	if (mode == 'j') {
+		io->cb_printf ("{\"enabled\":%s,\"bsize\":%u,\"pages\":%u,\"used\":%u,"
+			"\"hits\":%"PFMT64d",\"misses\":%"PFMT64d",\"evictions\":%"PFMT64d
+			",\"invalidations\":%"PFMT64d",\"ratio\":%d}\n",
+			r_str_bool (rc->enabled), rc->bsize, rc->pages, rc->count,
+			rc->hits, rc->misses, rc->evictions, rc->invalidations, ratio);
+		return;
+	}
+	io->cb_printf ("enabled       %s\n", r_str_bool (rc->enabled));
+	io->cb_printf ("bsize         0x%x\n", rc->bsize);
+	io->cb_printf ("pages         %u/%u\n", rc->count, rc->pages);
+	io->cb_printf ("hits          %"PFMT64d"\n", rc->hits);
+	io->cb_printf ("misses        %"PFMT64d"\n", rc->misses);
+	io->cb_printf ("evictions     %"PFMT64d"\n", rc->evictions);
+	io->cb_printf ("invalidations %"PFMT64d"\n", rc->invalidations);
+	io->cb_printf ("ratio         %d%%\n", ratio);
+}
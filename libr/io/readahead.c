@@ -0,0 +1,347 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Sequential block iterator for scans. Blocks are handed out in order from
+// one of three sources, picked when the iterator is created:
+//  - views of mmapped backends, with the kernel asked to page in the next one
+//  - a ring of buffers filled ahead of the consumer by a thread reading the
+//    backing files of io_default descs through its own file descriptors
+//  - plain r_io_read_at calls on the consumer thread for everything else
+// RIO keeps per-desc seek state, so the worker never calls into it. The range
+// must not be written while it is being scanned.
+
+#include "r_io.h"
+#include <r_th.h>
+
+#define RA_DEFAULT_DEPTH 3
+
+enum {
+	RA_SYNC,
+	RA_VIEW,
+	RA_THREAD,
+};
+
+typedef struct {
+	ut64 from;	// [from, to) in the iterated address space
+	ut64 to;
+	ut64 delta;	// file offset of from
+	int iofd;	// RIODesc the bytes come from
+	int fd;		// private descriptor of its backing file
+	bool owned;	// fd is closed with this segment
+} RIORASeg;
+
+struct r_io_read_ahead_t {
+	RIO *io;
+	int mode;
+	ut64 from;
+	ut64 to;
+	ut64 next;	// address of the next block handed out
+	int bsize;
+	ut8 *buf;	// sync reads and views shorter than the block
+	bool failed;	// the last block handed out couldn't be read
+	// RA_THREAD
+	RIORASeg *segs;
+	int nsegs;
+	int depth;
+	ut8 *ring;	// depth slots of bsize bytes
+	bool *bad;	// per slot, the read of its block failed
+	int head;	// slot of the oldest filled block
+	int count;	// filled slots, including the one held by the consumer
+	bool held;
+	bool stop;
+	ut64 fill;	// address of the next block the worker reads
+	ut8 pad;
+	RThread *th;
+	RThreadLock *lock;
+	RThreadCond *cond;
+};
+
+static int ra_block_len(RIOReadAhead *ra, ut64 addr) {
+	return (int)R_MIN ((ut64)ra->bsize, ra->to - addr);
+}
+
+#if __UNIX__ && HAVE_PTHREAD
+// false when some bytes of a segment couldn't be read
+static bool ra_pread(RIOReadAhead *ra, ut64 addr, ut8 *buf, int len) {
+	bool ok = true;
+	int i;
+	memset (buf, ra->pad, len);
+	for (i = 0; i < ra->nsegs; i++) {
+		RIORASeg *s = &ra->segs[i];
+		if (s->to <= addr) {
+			continue;
+		}
+		if (s->from >= addr + len) {
+			break;
+		}
+		ut64 at = R_MAX (s->from, addr);
+		ut64 n = R_MIN (s->to, addr + len) - at;
+		ut8 *dst = buf + (at - addr);
+		ut64 off = s->delta + (at - s->from);
+		while (n > 0) {
+			ssize_t r = pread (s->fd, dst, (size_t)n, (off_t)off);
+			if (r < 1) {
+				ok = false;
+				break;
+			}
+			dst += r;
+			off += r;
+			n -= r;
+		}
+	}
+	return ok;
+}
+
+static int ra_worker(RThread *th) {
+	RIOReadAhead *ra = th->user;
+	r_th_lock_enter (ra->lock);
+	while (!ra->stop && ra->fill < ra->to) {
+		if (ra->count == ra->depth) {
+			r_th_cond_wait (ra->cond, ra->lock);
+			continue;
+		}
+		ut64 addr = ra->fill;
+		int slot = (ra->head + ra->count) % ra->depth;
+		int len = ra_block_len (ra, addr);
+		// the slot is free, nobody else touches it until count grows
+		r_th_lock_leave (ra->lock);
+		bool ok = ra_pread (ra, addr, ra->ring + (size_t)slot * ra->bsize, len);
+		r_th_lock_enter (ra->lock);
+		ra->bad[slot] = !ok;
+		ra->fill += len;
+		ra->count++;
+		r_th_cond_signal_all (ra->cond);
+	}
+	r_th_lock_leave (ra->lock);
+	return false;
+}
+
+static void ra_private_fd(RIOReadAhead *ra, RIORASeg *s, RIODesc *desc) {
+	int i;
+	// pread keeps no file position, segments of one desc share a descriptor
+	for (i = 0; i < ra->nsegs; i++) {
+		if (ra->segs[i].iofd == desc->fd) {
+			s->fd = ra->segs[i].fd;
+			s->owned = false;
+			return;
+		}
+	}
+	s->fd = r_sandbox_open (desc->uri, O_RDONLY, 0);
+	s->owned = true;
+}
+
+static bool ra_add_seg(RIOReadAhead *ra, RIODesc *desc, ut64 from, ut64 to, ut64 delta) {
+	RIORASeg *segs;
+	// only io_default reads straight from a file, and the p_cache overlay
+	// depends on how much of each read the plugin returned
+	if (!desc || !desc->plugin || !desc->uri || strcmp (desc->plugin->name, "default")
+			|| !(desc->flags & R_IO_READ) || (ra->io->p_cache & 1)) {
+		return false;
+	}
+	if (!(segs = realloc (ra->segs, (ra->nsegs + 1) * sizeof (RIORASeg)))) {
+		return false;
+	}
+	ra->segs = segs;
+	RIORASeg *s = &segs[ra->nsegs];
+	s->from = from;
+	s->to = to;
+	s->delta = delta;
+	s->iofd = desc->fd;
+	ra_private_fd (ra, s, desc);
+	if (s->fd == -1) {
+		return false;
+	}
+	ra->nsegs++;
+	return true;
+}
+
+// snapshots where the bytes of [from, to) live, failing if any of them is
+// not in a plain file
+static bool ra_plan(RIOReadAhead *ra) {
+	RIO *io = ra->io;
+	if (!io->va) {
+		ut64 size = r_io_desc_size (io->desc);
+		if (ra->from >= size) {
+			return true;
+		}
+		return ra_add_seg (ra, io->desc, ra->from, R_MIN (ra->to, size), ra->from);
+	}
+	const RPVector *skyline = r_io_map_get_skyline (io);
+	size_t i;
+	for (i = 0; i < r_pvector_len (skyline); i++) {
+		const RIOMapSkyline *part = r_pvector_at (skyline, i);
+		ut64 end = r_itv_end (part->itv);
+		if ((end && end <= ra->from) || part->itv.addr >= ra->to) {
+			continue;
+		}
+		if (!(part->map->flags & R_IO_READ) && !io->p_cache) {
+			continue;
+		}
+		ut64 from = R_MAX (part->itv.addr, ra->from);
+		ut64 to = end? R_MIN (end, ra->to): ra->to;
+		ut64 delta = part->map->delta + from - part->map->itv.addr;
+		if (!ra_add_seg (ra, r_io_desc_get (io, part->map->fd), from, to, delta)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool ra_start(RIOReadAhead *ra, int depth) {
+	RIO *io = ra->io;
+	if (io->cachemode || !ra_plan (ra) || !ra->nsegs) {
+		return false;
+	}
+	ra->depth = depth;
+	ra->ring = malloc ((size_t)depth * ra->bsize);
+	ra->bad = calloc (depth, sizeof (bool));
+	ra->lock = r_th_lock_new (false);
+	ra->cond = r_th_cond_new ();
+	if (!ra->ring || !ra->bad || !ra->lock || !ra->cond) {
+		return false;
+	}
+	ra->pad = io->ff? io->Oxff: 0;
+	ra->fill = ra->from;
+	ra->th = r_th_new (ra_worker, ra, 0);
+	return ra->th != NULL;
+}
+#endif
+
+static void ra_stop(RIOReadAhead *ra) {
+	int i;
+	if (ra->th) {
+		r_th_lock_enter (ra->lock);
+		ra->stop = true;
+		r_th_cond_signal_all (ra->cond);
+		r_th_lock_leave (ra->lock);
+		r_th_free (ra->th);
+		ra->th = NULL;
+	}
+	r_th_cond_free (ra->cond);
+	r_th_lock_free (ra->lock);
+	ra->cond = NULL;
+	ra->lock = NULL;
+	for (i = 0; i < ra->nsegs; i++) {
+		if (ra->segs[i].owned) {
+			close (ra->segs[i].fd);
+		}
+	}
+	R_FREE (ra->segs);
+	R_FREE (ra->ring);
+	R_FREE (ra->bad);
+	ra->nsegs = 0;
+}
+
+static void ra_prefetch(RIOReadAhead *ra, ut64 addr) {
+#if __UNIX__ && defined(POSIX_MADV_WILLNEED)
+	if (addr < ra->to) {
+		ut64 n = ra_block_len (ra, addr);
+		const ut8 *v = r_io_view (ra->io, addr, &n);
+		if (v) {
+			size_t pgsz = 0x1000;
+			ut8 *p = (ut8 *)((size_t)v & ~(pgsz - 1));
+			(void)posix_madvise (p, (size_t)(v + n - p), POSIX_MADV_WILLNEED);
+		}
+	}
+#endif
+}
+
+// Iterates [from, to) in bsize blocks, keeping up to depth of them read ahead
+// when the backend allows it. depth < 2 picks the default.
+R_API RIOReadAhead *r_io_ra_new(RIO *io, ut64 from, ut64 to, int bsize, int depth) {
+	if (!io || from >= to || bsize < 1) {
+		return NULL;
+	}
+	RIOReadAhead *ra = R_NEW0 (RIOReadAhead);
+	if (!ra) {
+		return NULL;
+	}
+	ra->io = io;
+	ra->from = ra->next = from;
+	ra->to = to;
+	ra->bsize = bsize;
+	if (!(ra->buf = malloc (bsize))) {
+		free (ra);
+		return NULL;
+	}
+	ra->mode = RA_SYNC;
+	if (!io->buffer_enabled) {
+		ut64 n = ra_block_len (ra, from);
+		if (r_io_view (io, from, &n)) {
+			ra->mode = RA_VIEW;
+#if __UNIX__ && HAVE_PTHREAD
+		} else if (ra_start (ra, depth < 2? RA_DEFAULT_DEPTH: depth)) {
+			ra->mode = RA_THREAD;
+#endif
+		} else {
+			ra_stop (ra);
+		}
+	}
+	return ra;
+}
+
+// Returns the next block, or NULL past the end. It stays valid until the
+// following call. addr and len are optional.
+R_API const ut8 *r_io_ra_next(RIOReadAhead *ra, ut64 *addr, int *len) {
+	const ut8 *ret = NULL;
+	if (!ra || ra->next >= ra->to) {
+		return NULL;
+	}
+	ut64 at = ra->next;
+	int n = ra_block_len (ra, at);
+	switch (ra->mode) {
+	case RA_VIEW: {
+		ut64 vlen = n;
+		ret = r_io_view (ra->io, at, &vlen);
+		ra->failed = false;
+		if (!ret || vlen != n) {
+			ra->failed = !r_io_read_at (ra->io, at, ra->buf, n);
+			ret = ra->buf;
+		}
+		ra_prefetch (ra, at + n);
+		break;
+	}
+	case RA_THREAD:
+		r_th_lock_enter (ra->lock);
+		if (ra->held) {
+			ra->head = (ra->head + 1) % ra->depth;
+			ra->count--;
+			r_th_cond_signal_all (ra->cond);
+		}
+		while (!ra->count) {
+			r_th_cond_wait (ra->cond, ra->lock);
+		}
+		ra->held = true;
+		ret = ra->ring + (size_t)ra->head * ra->bsize;
+		ra->failed = ra->bad[ra->head];
+		r_th_lock_leave (ra->lock);
+		if (ra->io->cached & R_IO_READ) {
+			(void)r_io_cache_read (ra->io, at, (ut8 *)ret, n);
+		}
+		break;
+	default:
+		ra->failed = !r_io_read_at (ra->io, at, ra->buf, n);
+		ret = ra->buf;
+		break;
+	}
+	ra->next += n;
+	if (addr) {
+		*addr = at;
+	}
+	if (len) {
+		*len = n;
+	}
+	return ret;
+}
+
+// true when the block returned by the last r_io_ra_next couldn't be read
+R_API bool r_io_ra_failed(RIOReadAhead *ra) {
+	return ra && ra->failed;
+}
+
+R_API void r_io_ra_free(RIOReadAhead *ra) {
+	if (ra) {
+		ra_stop (ra);
+		free (ra->buf);
+		free (ra);
+	}
+}
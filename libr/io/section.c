@@ -636,13 +636,14 @@ R_API bool r_io_section_apply_bin(RIO *io, ut32 bin_id, RIOSectionApplyMethod me
 	if (!io || !io->sections) {
 		return false;
 	}
+	r_io_map_batch_begin (io);
 	ls_foreach_prev (io->sections, iter, sec) {
 		if (sec && (sec->bin_id == bin_id)) {
 			ret = true;
 			_section_apply (io, sec, method);
 		}
 	}
-	r_io_map_calculate_skyline (io);
+	r_io_map_batch_end (io);
 	return ret;
 }
 
@@ -654,9 +655,7 @@ R_API bool r_io_section_reapply(RIO *io, ut32 id, RIOSectionApplyMethod method)
 	if (!(sec = r_io_section_get_i (io, id))) {
 		return false;
 	}
-	bool ret = _section_reapply (io, sec, method);
-	r_io_map_calculate_skyline (io);
-	return ret;
+	return _section_reapply (io, sec, method);
 }
 
 R_API bool r_io_section_reapply_bin(RIO *io, ut32 binid, RIOSectionApplyMethod method) {
@@ -666,12 +665,13 @@ R_API bool r_io_section_reapply_bin(RIO *io, ut32 binid, RIOSectionApplyMethod m
 	if (!io || !io->sections) {
 		return false;
 	}
+	r_io_map_batch_begin (io);
 	ls_foreach_prev (io->sections, iter,  sec) {
 		if (sec && (sec->bin_id == binid)) {
 			ret = true;
 			_section_reapply (io, sec, method);
 		}
 	}
-	r_io_map_calculate_skyline (io);
+	r_io_map_batch_end (io);
 	return ret;
 }
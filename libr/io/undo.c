@@ -1,6 +1,7 @@
 /* radare - LGPL - Copyright 2007-2018 - pancake */
 
 #include <r_io.h>
+#include <lz4.h>
 
 #if 0
 * TODO:
@@ -9,6 +10,14 @@
 * - Per-fd history log
 #endif
 
+static void wundo_free(RIOUndoWrite *u) {
+	if (u) {
+		free (u->o);
+		free (u->n);
+		free (u);
+	}
+}
+
 R_API int r_io_undo_init(RIO *io) {
 	/* seek undo */
 	r_io_sundo_reset (io);
@@ -16,8 +25,9 @@ R_API int r_io_undo_init(RIO *io) {
 	/* write undo */
 	io->undo.w_init = 0;
 	io->undo.w_enable = 0;
-	io->undo.w_enable = 0;
-	io->undo.w_list = r_list_new ();
+	io->undo.w_tree = NULL;
+	io->undo.w_size = 0;
+	io->undo.w_list = r_list_newf ((RListFree)wundo_free);
 
 	return true;
 }
@@ -192,10 +202,174 @@ R_API RList *r_io_sundo_list(RIO *io, int mode) {
 
 /* undo writez */
 
+// The write journal is an RList in write order, owning the entries, plus an
+// interval tree over the same entries to find the ones touching a range.
+// Consecutive writes to adjacent bytes are merged into one entry, entries
+// that stop being the last one are lz4 compressed when they are big enough
+// and the oldest ones are dropped once the journal takes more than w_limit.
+
+#define WUNDO_MERGE_MAX 0x10000
+#define WUNDO_PACK_MIN 0x1000
+#define WUNDO_CONTAINER(x) container_of ((RBNode*)x, RIOUndoWrite, rb)
+
+static int wundo_tree_cmp(const void *a_, const RBNode *b_) {
+	const RIOUndoWrite *a = a_;
+	const RIOUndoWrite *b = WUNDO_CONTAINER (b_);
+	if (a->off != b->off) {
+		return a->off < b->off? -1: 1;
+	}
+	// many entries may start at the same offset
+	return (size_t)a < (size_t)b? -1: (size_t)a > (size_t)b? 1: 0;
+}
+
+static void wundo_tree_calc_max_addr(RBNode *node) {
+	int i;
+	RIOUndoWrite *u = WUNDO_CONTAINER (node);
+	u->rb_max_addr = u->off + u->len - 1;
+	for (i = 0; i < 2; i++) {
+		if (node->child[i]) {
+			RIOUndoWrite *u1 = WUNDO_CONTAINER (node->child[i]);
+			if (u1->rb_max_addr > u->rb_max_addr) {
+				u->rb_max_addr = u1->rb_max_addr;
+			}
+		}
+	}
+}
+
+static void wundo_tree_insert(RIO *io, RIOUndoWrite *u) {
+	r_rbtree_aug_insert (&io->undo.w_tree, u, &u->rb, wundo_tree_cmp, wundo_tree_calc_max_addr);
+}
+
+static void wundo_tree_delete(RIO *io, RIOUndoWrite *u) {
+	// the list owns the entries
+	r_rbtree_aug_delete (&io->undo.w_tree, u, wundo_tree_cmp, NULL, wundo_tree_calc_max_addr);
+}
+
+// appends the entries intersecting [from, to] in address order
+static void wundo_tree_collect(RBNode *node, ut64 from, ut64 to, RList *list) {
+	if (!node) {
+		return;
+	}
+	RIOUndoWrite *u = WUNDO_CONTAINER (node);
+	if (u->rb_max_addr < from) {
+		return;
+	}
+	wundo_tree_collect (node->child[0], from, to, list);
+	if (u->off > to) {
+		return;
+	}
+	if (u->off + u->len - 1 >= from) {
+		r_list_append (list, u);
+	}
+	wundo_tree_collect (node->child[1], from, to, list);
+}
+
+static ut64 wundo_cost(RIOUndoWrite *u) {
+	return sizeof (RIOUndoWrite) + u->olen + u->nlen;
+}
+
+// compresses buf in place when that saves memory, returns its stored size
+static int wundo_pack_buf(ut8 **buf, int len) {
+	int bound = LZ4_compressBound (len);
+	ut8 *z = malloc (bound);
+	if (!z) {
+		return len;
+	}
+	int zlen = LZ4_compress_default ((const char *)*buf, (char *)z, len, bound);
+	if (zlen < 1 || zlen >= len) {
+		free (z);
+		return len;
+	}
+	ut8 *zz = realloc (z, zlen);
+	free (*buf);
+	*buf = zz? zz: z;
+	return zlen;
+}
+
+static void wundo_pack(RIO *io, RIOUndoWrite *u) {
+	if (u->len < WUNDO_PACK_MIN || u->olen != u->len || u->nlen != u->len) {
+		return;
+	}
+	io->undo.w_size -= wundo_cost (u);
+	u->olen = wundo_pack_buf (&u->o, u->len);
+	u->nlen = wundo_pack_buf (&u->n, u->len);
+	io->undo.w_size += wundo_cost (u);
+}
+
+// returns the first len bytes of an entry buffer, free it when it is not buf
+static ut8 *wundo_unpack_buf(ut8 *buf, int blen, int ulen, int len) {
+	if (blen == ulen) {
+		return buf;
+	}
+	ut8 *out = malloc (ulen);
+	if (out && LZ4_decompress_safe_partial ((const char *)buf, (char *)out, blen, len, ulen) < len) {
+		R_FREE (out);
+	}
+	return out;
+}
+
+static void wundo_drop_oldest(RIO *io) {
+	RIOUndoWrite *u = r_list_get_bottom (io->undo.w_list);
+	if (u) {
+		wundo_tree_delete (io, u);
+		io->undo.w_size -= wundo_cost (u);
+		r_list_delete (io->undo.w_list, r_list_head (io->undo.w_list));
+	}
+}
+
+// grows the last entry to also cover this write, if it is next to it
+static bool wundo_merge(RIO *io, RIOUndoWrite *last, ut64 off, const ut8 *data, int len) {
+	if (!last || !last->set || last->olen != last->len || last->nlen != last->len) {
+		return false;
+	}
+	ut64 last_end = last->off + last->len;
+	if (off > last_end || off + len < last->off) {
+		return false;
+	}
+	ut64 from = R_MIN (off, last->off);
+	ut64 to = R_MAX (off + len, last_end);
+	if (to - from > WUNDO_MERGE_MAX) {
+		return false;
+	}
+	int ulen = (int)(to - from);
+	ut8 *o = malloc (ulen);
+	ut8 *n = malloc (ulen);
+	if (!o || !n) {
+		free (o);
+		free (n);
+		return false;
+	}
+	memset (o, 0xff, ulen);
+	(void)r_io_read_at (io, from, o, ulen);
+	memcpy (n, o, ulen);
+	memcpy (o + (last->off - from), last->o, last->len);
+	memcpy (n + (last->off - from), last->n, last->len);
+	memcpy (n + (off - from), data, len);
+	wundo_tree_delete (io, last);
+	io->undo.w_size -= wundo_cost (last);
+	free (last->o);
+	free (last->n);
+	last->o = o;
+	last->n = n;
+	last->off = from;
+	last->len = last->olen = last->nlen = ulen;
+	io->undo.w_size += wundo_cost (last);
+	wundo_tree_insert (io, last);
+	return true;
+}
+
 R_API void r_io_wundo_new(RIO *io, ut64 off, const ut8 *data, int len) {
-	RIOUndoWrite *uw;
-	if (!io->undo.w_enable)
+	RIOUndoWrite *uw, *last;
+	if (!io->undo.w_enable || len < 1) {
 		return;
+	}
+	if (!io->undo.w_list) {
+		io->undo.w_list = r_list_newf ((RListFree)wundo_free);
+	}
+	last = r_list_get_top (io->undo.w_list);
+	if (wundo_merge (io, last, off, data, len)) {
+		goto trim;
+	}
 	/* undo write changes */
 	uw = R_NEW0 (RIOUndoWrite);
 	if (!uw) {
@@ -203,26 +377,45 @@ R_API void r_io_wundo_new(RIO *io, ut64 off, const ut8 *data, int len) {
 	}
 	uw->set = true;
 	uw->off = off;
-	uw->len = len;
+	uw->len = uw->olen = uw->nlen = len;
 	uw->n = (ut8*) malloc (len);
-	if (!uw->n) {
-		free (uw);
-		return;
-	}
-	memcpy (uw->n, data, len);
 	uw->o = (ut8*) malloc (len);
-	if (!uw->o) {
-		R_FREE (uw);
+	if (!uw->n || !uw->o) {
+		wundo_free (uw);
 		return;
 	}
+	memcpy (uw->n, data, len);
 	memset (uw->o, 0xff, len);
 	r_io_read_at (io, off, uw->o, len);
+	if (last) {
+		wundo_pack (io, last);
+	}
 	r_list_append (io->undo.w_list, uw);
+	wundo_tree_insert (io, uw);
+	io->undo.w_size += wundo_cost (uw);
+	io->undo.w_init = true;
+trim:
+	// the newest write is always kept
+	while (io->undo.w_limit && io->undo.w_size > io->undo.w_limit
+			&& r_list_length (io->undo.w_list) > 1) {
+		wundo_drop_oldest (io);
+	}
 }
 
 R_API void r_io_wundo_clear(RIO *io) {
-	// XXX memory leak
-	io->undo.w_list = r_list_new ();
+	io->undo.w_tree = NULL;
+	io->undo.w_size = 0;
+	if (io->undo.w_list) {
+		r_list_purge (io->undo.w_list);
+	}
+}
+
+// caps the memory taken by the journal, 0 means no limit
+R_API void r_io_wundo_set_limit(RIO *io, ut64 limit) {
+	io->undo.w_limit = limit;
+	while (limit && io->undo.w_size > limit && r_list_length (io->undo.w_list) > 1) {
+		wundo_drop_oldest (io);
+	}
 }
 
 // rename to r_io_undo_length ?
@@ -230,6 +423,17 @@ R_API int r_io_wundo_size(RIO *io) {
 	return r_list_length (io->undo.w_list);
 }
 
+// returns the journal entries touching [addr, addr + len) sorted by offset,
+// the list does not own them
+R_API RList *r_io_wundo_at(RIO *io, ut64 addr, int len) {
+	RList *list = r_list_new ();
+	if (list && len > 0) {
+		ut64 to = addr + len - 1;
+		wundo_tree_collect (io->undo.w_tree, addr, to < addr? UT64_MAX: to, list);
+	}
+	return list;
+}
+
 // TODO: Deprecate or so? iterators must be language-wide, but helpers are useful
 R_API void r_io_wundo_list(RIO *io) {
 #define BW 8 /* byte wrap */
@@ -239,29 +443,48 @@ R_API void r_io_wundo_list(RIO *io) {
 
 	if (io->undo.w_init)
 	r_list_foreach (io->undo.w_list, iter, u) {
-		io->cb_printf ("%02d %c %d %08"PFMT64x": ", i, u->set?'+':'-', u->len, u->off);
 		len = (u->len>BW)?BW:u->len;
-		for (j=0;j<len;j++) io->cb_printf ("%02x ", u->o[j]);
+		ut8 *o = wundo_unpack_buf (u->o, u->olen, u->len, len);
+		ut8 *n = wundo_unpack_buf (u->n, u->nlen, u->len, len);
+		if (!o || !n) {
+			goto next;
+		}
+		io->cb_printf ("%02d %c %d %08"PFMT64x": ", i, u->set?'+':'-', u->len, u->off);
+		for (j=0;j<len;j++) io->cb_printf ("%02x ", o[j]);
 		if (len == BW) io->cb_printf (".. ");
 		io->cb_printf ("=> ");
-		for (j=0;j<len;j++) io->cb_printf ("%02x ", u->n[j]);
+		for (j=0;j<len;j++) io->cb_printf ("%02x ", n[j]);
 		if (len == BW) io->cb_printf (".. ");
+		if (u->olen != u->len || u->nlen != u->len) {
+			io->cb_printf ("(lz4 %d)", u->olen + u->nlen);
+		}
 		io->cb_printf ("\n");
+next:
+		if (o != u->o) {
+			free (o);
+		}
+		if (n != u->n) {
+			free (n);
+		}
 		i++;
 	}
 }
 
 R_API int r_io_wundo_apply(RIO *io, RIOUndoWrite *u, int set) {
 	int orig = io->undo.w_enable;
-	io->undo.w_enable = 0;
-	if (set) {
-		r_io_write_at (io, u->off, u->n, u->len);
-		u->set = true;
-	} else {
-		r_io_write_at (io, u->off, u->o, u->len);
-		u->set = false;
+	ut8 *buf = set
+		? wundo_unpack_buf (u->n, u->nlen, u->len, u->len)
+		: wundo_unpack_buf (u->o, u->olen, u->len, u->len);
+	if (!buf) {
+		return -1;
 	}
+	io->undo.w_enable = 0;
+	r_io_write_at (io, u->off, buf, u->len);
+	u->set = set? true: false;
 	io->undo.w_enable = orig;
+	if (buf != u->n && buf != u->o) {
+		free (buf);
+	}
 	return 0;
 }
 
@@ -269,9 +492,17 @@ R_API void r_io_wundo_apply_all(RIO *io, int set) {
 	RListIter *iter;
 	RIOUndoWrite *u;
 
+	// undo from the newest write, redo from the oldest one
+	if (set) {
+		r_list_foreach (io->undo.w_list, iter, u) {
+			r_io_wundo_apply (io, u, set);
+			eprintf ("redo 0x%08"PFMT64x"\n", u->off);
+		}
+		return;
+	}
 	r_list_foreach_prev (io->undo.w_list, iter, u) {
 		r_io_wundo_apply (io, u, set); //UNDO_WRITE_UNSET);
-		eprintf ("%s 0x%08"PFMT64x"\n", set?"redo":"undo", u->off);
+		eprintf ("undo 0x%08"PFMT64x"\n", u->off);
 	}
 }
 
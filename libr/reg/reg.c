@@ -130,6 +130,14 @@ R_API const char* r_reg_get_role(int role) {
 R_API void r_reg_free_internal(RReg* reg, bool init) {
 	int i;
 
+	reg->profile_gen++;
+	ht_free (reg->ht);
+	reg->ht = NULL;
+	R_FREE (reg->items);
+	reg->nitems = 0;
+	r_list_free (reg->allregs);
+	reg->allregs = NULL;
+
 	R_FREE (reg->reg_profile_str);
 	R_FREE (reg->reg_profile_cmt);
 
@@ -157,6 +165,13 @@ static int regcmp(RRegItem* a, RRegItem* b) {
 	return offa > offb;
 }
 
+static void regs_kv_free(HtKv* kv) {
+	free (kv->key);
+	free (kv);
+}
+
+// numbers the registers and builds the tables used by r_reg_get and
+// r_reg_index_get, lookups walk the lists when they couldn't be allocated
 R_API void r_reg_reindex(RReg* reg) {
 	int i, index;
 	RListIter* iter;
@@ -168,9 +183,21 @@ R_API void r_reg_reindex(RReg* reg) {
 		}
 	}
 	r_list_sort (all, (RListComparator) regcmp);
+	ht_free (reg->ht);
+	reg->ht = ht_new (NULL, regs_kv_free, NULL);
+	free (reg->items);
+	reg->items = calloc (R_MAX (r_list_length (all), 1), sizeof (RRegItem *));
+	reg->nitems = 0;
 	index = 0;
 	r_list_foreach (all, iter, r) {
 		r->index = index++;
+		if (reg->items) {
+			reg->items[reg->nitems++] = r;
+		}
+		if (reg->ht && r->name && !ht_insert (reg->ht, r->name, r)) {
+			ht_free (reg->ht);
+			reg->ht = NULL;
+		}
 	}
 	r_list_free (reg->allregs);
 	reg->allregs = all;
@@ -185,6 +212,9 @@ R_API RRegItem* r_reg_index_get(RReg* reg, int idx) {
 	if (!reg->allregs) {
 		r_reg_reindex (reg);
 	}
+	if (reg->items) {
+		return (idx < reg->nitems)? reg->items[idx]: NULL;
+	}
 	r_list_foreach (reg->allregs, iter, r) {
 		if (r->index == idx) {
 			return r;
@@ -204,7 +234,6 @@ R_API void r_reg_free(RReg* reg) {
 		r_list_free (reg->regset[i].pool);
 		reg->regset[i].pool = NULL;
 	}
-	r_list_free (reg->allregs);
 	r_reg_free_internal (reg, false);
 	free (reg);
 }
@@ -253,6 +282,10 @@ R_API RRegItem* r_reg_get(RReg* reg, const char* name, int type) {
 	if (type == R_REG_TYPE_FLG) {
 		type = R_REG_TYPE_GPR;
 	}
+	if (reg->ht) {
+		r = ht_find (reg->ht, name, NULL);
+		return (r && (type == -1 || r->arena == type))? r: NULL;
+	}
 	if (type == -1) {
 		i = 0;
 		e = R_REG_TYPE_LAST;
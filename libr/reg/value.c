@@ -138,6 +138,25 @@ R_API bool r_reg_set_value(RReg *reg, RRegItem *item, ut64 value) {
 		eprintf ("r_reg_set_value: item is NULL\n");
 		return false;
 	}
+	// byte aligned registers are written in place
+	RRegArena *arena = reg->regset[item->arena].arena;
+	if (!(item->offset & 7) && arena->bytes && (item->offset + item->size) / 8 <= arena->size) {
+		ut8 *dst = arena->bytes + item->offset / 8;
+		switch (item->size) {
+		case 64:
+			r_write_ble64 (dst, value, reg->big_endian);
+			return true;
+		case 32:
+			r_write_ble32 (dst, (ut32)value, reg->big_endian);
+			return true;
+		case 16:
+			r_write_ble16 (dst, (ut16)value, reg->big_endian);
+			return true;
+		case 8:
+			*dst = (ut8)value;
+			return true;
+		}
+	}
 	switch (item->size) {
 	case 80:
 	case 96: // long floating value
@@ -169,13 +188,12 @@ R_API bool r_reg_set_value(RReg *reg, RRegItem *item, ut64 value) {
 		break;
 	case 1:
 		if (value) {
-			ut8 *buf = reg->regset[item->arena].arena->bytes + (item->offset / 8);
+			ut8 *buf = arena->bytes + (item->offset / 8);
 			int bit = (item->offset % 8);
 			ut8 mask = (1 << bit);
 			buf[0] = (buf[0] & (0xff ^ mask)) | mask;
 		} else {
 			int idx = item->offset / 8;
-			RRegArena *arena = reg->regset[item->arena].arena;
 			if (idx + item->size > arena->size) {
 				eprintf ("RRegSetOverflow %d vs %d\n", idx + item->size, arena->size);
 				return false;
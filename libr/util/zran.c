@@ -0,0 +1,403 @@
+/* radare - LGPL - Copyright 2018 - pancake */
+
+// Random access to deflate streams, in the spirit of zlib's examples/zran.c.
+// The first time the stream is inflated a restart point is taken every span
+// bytes of output at a deflate block boundary, keeping the window needed to
+// resume from there. Later reads only inflate from the closest point before
+// them, so memory stays bounded by the number of points.
+
+#include <r_util.h>
+#include <zlib.h>
+
+#define CHUNK 0x4000
+#define MAGIC "R2ZRAN01"
+#define HDRSIZE 40
+#define PTSIZE 20
+#define TAILSIZE 4096
+
+typedef struct {
+	z_stream zs;
+	ut64 in;	// offset of the next compressed byte to load
+	ut64 out;	// offset of the next uncompressed byte
+	ut64 last;	// out of the last point taken
+	bool raw;	// resumed from a point, member trailers are not parsed
+	bool end;
+	int wpos;
+	ut8 window[R_ZRAN_WINSIZE];	// circular, holds the last output
+	ut8 inbuf[CHUNK];
+} ZranStream;
+
+static bool is_header(const ut8 *b) {
+	if (b[0] == 0x1f && b[1] == 0x8b) {
+		return true;
+	}
+	return (b[0] & 0x0f) == Z_DEFLATED && !(((b[0] << 8) | b[1]) % 31);
+}
+
+static void stream_free(ZranStream *s) {
+	if (s) {
+		inflateEnd (&s->zs);
+		free (s);
+	}
+}
+
+// starts inflating at p, or at the beginning of the stream if p is NULL
+static ZranStream *stream_new(RZran *z, RZranPoint *p) {
+	ZranStream *s = R_NEW0 (ZranStream);
+	if (!s) {
+		return NULL;
+	}
+	int wbits = (!p && z->format == R_ZRAN_AUTO)? MAX_WBITS + 32: -MAX_WBITS;
+	if (inflateInit2 (&s->zs, wbits) != Z_OK) {
+		free (s);
+		return NULL;
+	}
+	if (p) {
+		s->raw = true;
+		s->in = p->in;
+		s->out = s->last = p->out;
+		if (p->bits) {
+			ut8 c;
+			if (z->read (z->user, p->in - 1, &c, 1) != 1) {
+				stream_free (s);
+				return NULL;
+			}
+			inflatePrime (&s->zs, p->bits, c >> (8 - p->bits));
+		}
+		inflateSetDictionary (&s->zs, p->window, R_ZRAN_WINSIZE);
+	}
+	return s;
+}
+
+static bool stream_feed(RZran *z, ZranStream *s) {
+	if (s->in >= z->in_size) {
+		return false;
+	}
+	int n = z->read (z->user, s->in, s->inbuf, (int)R_MIN (CHUNK, z->in_size - s->in));
+	if (n < 1) {
+		return false;
+	}
+	s->zs.next_in = s->inbuf;
+	s->zs.avail_in = n;
+	s->in += n;
+	return true;
+}
+
+// a member just ended, resets s if another one follows
+static bool stream_next_member(RZran *z, ZranStream *s) {
+	ut8 magic[2];
+	if (z->format != R_ZRAN_AUTO) {
+		return false;
+	}
+	ut64 at = s->in - s->zs.avail_in;
+	if (s->raw) {
+		// raw inflate stops right before the member trailer
+		at += z->trailer;
+	}
+	if (at + 2 > z->in_size || z->read (z->user, at, magic, 2) != 2 || !is_header (magic)) {
+		return false;
+	}
+	if (inflateReset2 (&s->zs, MAX_WBITS + 32) != Z_OK) {
+		return false;
+	}
+	s->in = at;
+	s->zs.avail_in = 0;
+	s->raw = false;
+	return true;
+}
+
+static void add_point(RZran *z, ZranStream *s) {
+	RZranPoint *p;
+	if (z->npoints == z->points_size) {
+		int size = z->points_size? z->points_size * 2: 64;
+		if (!(p = realloc (z->points, size * sizeof (RZranPoint)))) {
+			return;
+		}
+		z->points = p;
+		z->points_size = size;
+	}
+	ut8 *w = malloc (R_ZRAN_WINSIZE);
+	if (!w) {
+		return;
+	}
+	// the oldest byte of the circular window is at wpos
+	memcpy (w, s->window + s->wpos, R_ZRAN_WINSIZE - s->wpos);
+	memcpy (w + R_ZRAN_WINSIZE - s->wpos, s->window, s->wpos);
+	p = &z->points[z->npoints++];
+	p->out = s->out;
+	p->in = s->in - s->zs.avail_in;
+	p->bits = s->zs.data_type & 7;
+	p->window = w;
+	s->last = s->out;
+}
+
+// inflates the next len bytes into dst, or drops them if dst is NULL, taking
+// points on the way when building. Returns the amount of bytes produced
+static ut64 stream_inflate(RZran *z, ZranStream *s, ut8 *dst, ut64 len, bool build) {
+	ut64 done = 0;
+	while (done < len && !s->end) {
+		if (!s->zs.avail_in && !stream_feed (z, s)) {
+			s->end = true;
+			break;
+		}
+		int room = (int)R_MIN (R_ZRAN_WINSIZE - s->wpos, len - done);
+		ut8 *at = s->window + s->wpos;
+		s->zs.next_out = at;
+		s->zs.avail_out = room;
+		int ret = inflate (&s->zs, build? Z_BLOCK: Z_NO_FLUSH);
+		int n = room - s->zs.avail_out;
+		if (n > 0) {
+			if (dst) {
+				memcpy (dst + done, at, n);
+			}
+			done += n;
+			s->out += n;
+			s->wpos = (s->wpos + n) % R_ZRAN_WINSIZE;
+		}
+		if (ret == Z_STREAM_END) {
+			if (!stream_next_member (z, s)) {
+				s->end = true;
+			}
+			continue;
+		}
+		if (ret != Z_OK && (ret != Z_BUF_ERROR || (!n && s->zs.avail_in))) {
+			// corrupted data
+			s->end = true;
+			break;
+		}
+		if (build && (s->zs.data_type & 128) && !(s->zs.data_type & 64)
+				&& s->out - s->last >= z->span) {
+			add_point (z, s);
+		}
+	}
+	return done;
+}
+
+static void build_done(RZran *z) {
+	ZranStream *s = z->build;
+	z->size = s->out;
+	if (s->end) {
+		z->complete = true;
+		stream_free (s);
+		z->build = NULL;
+	}
+}
+
+// inflates the stream for the first time up to off
+static bool build_to(RZran *z, ut64 off) {
+	if (z->complete) {
+		return true;
+	}
+	if (!z->build && !(z->build = stream_new (z, NULL))) {
+		return false;
+	}
+	if (z->size >= off) {
+		return true;
+	}
+	stream_inflate (z, z->build, NULL, off - z->size, true);
+	build_done (z);
+	return true;
+}
+
+static RZranPoint *find_point(RZran *z, ut64 off) {
+	int lo = 0, hi = z->npoints;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (z->points[mid].out <= off) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo? &z->points[lo - 1]: NULL;
+}
+
+R_API RZran *r_zran_new(RZranRead read, void *user, ut64 in_size, RZranFormat format, ut64 span) {
+	ut8 magic[2];
+	if (!read) {
+		return NULL;
+	}
+	RZran *z = R_NEW0 (RZran);
+	if (!z) {
+		return NULL;
+	}
+	z->read = read;
+	z->user = user;
+	z->in_size = in_size;
+	z->format = format;
+	z->span = R_MAX (span? span: R_ZRAN_SPAN, R_ZRAN_WINSIZE);
+	if (format == R_ZRAN_AUTO) {
+		bool gz = read (user, 0, magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+		z->trailer = gz? 8: 4;
+	}
+	return z;
+}
+
+static void points_free(RZran *z) {
+	int i;
+	for (i = 0; i < z->npoints; i++) {
+		free (z->points[i].window);
+	}
+	R_FREE (z->points);
+	z->npoints = z->points_size = 0;
+}
+
+R_API void r_zran_free(RZran *z) {
+	if (z) {
+		points_free (z);
+		stream_free (z->build);
+		stream_free (z->cursor);
+		free (z);
+	}
+}
+
+// returns the amount of bytes read, less than len past the end of the data
+R_API int r_zran_read(RZran *z, ut64 off, ut8 *buf, int len) {
+	ZranStream *s;
+	int ret;
+	if (!z || !buf || len < 1) {
+		return 0;
+	}
+	if (!z->complete && off >= z->size) {
+		// first pass over this part, read it straight from the builder
+		if (!build_to (z, off) || !(s = z->build) || s->out != off) {
+			return 0;
+		}
+		ret = (int)stream_inflate (z, s, buf, len, true);
+		build_done (z);
+		return ret;
+	}
+	RZranPoint *p = find_point (z, off);
+	s = z->cursor;
+	// keep inflating the last stream on sequential reads
+	if (!s || s->out > off || (p && s->out < p->out)) {
+		stream_free (s);
+		if (!(s = z->cursor = stream_new (z, p))) {
+			return 0;
+		}
+	}
+	stream_inflate (z, s, NULL, off - s->out, false);
+	if (s->out != off) {
+		return 0;
+	}
+	return (int)stream_inflate (z, s, buf, len, false);
+}
+
+// inflates the whole stream once if needed
+R_API ut64 r_zran_size(RZran *z) {
+	if (!z) {
+		return 0;
+	}
+	build_to (z, UT64_MAX);
+	return z->size;
+}
+
+// identifies the compressed data the index belongs to
+static ut32 tail_crc(RZran *z) {
+	ut8 buf[TAILSIZE];
+	int n = (int)R_MIN (TAILSIZE, z->in_size);
+	n = z->read (z->user, z->in_size - n, buf, n);
+	return n > 0? crc32 (0, buf, n): 0;
+}
+
+R_API bool r_zran_save(RZran *z, const char *file) {
+	ut8 hdr[HDRSIZE], pt[PTSIZE];
+	bool ret = true;
+	int i;
+	if (!z || !file || !z->complete) {
+		return false;
+	}
+	FILE *fd = r_sandbox_fopen (file, "wb");
+	if (!fd) {
+		return false;
+	}
+	memcpy (hdr, MAGIC, 8);
+	r_write_le64 (hdr + 8, z->in_size);
+	r_write_le64 (hdr + 16, z->size);
+	r_write_le64 (hdr + 24, z->span);
+	r_write_le32 (hdr + 32, z->npoints);
+	r_write_le32 (hdr + 36, tail_crc (z));
+	if (fwrite (hdr, HDRSIZE, 1, fd) != 1) {
+		ret = false;
+	}
+	for (i = 0; ret && i < z->npoints; i++) {
+		RZranPoint *p = &z->points[i];
+		r_write_le64 (pt, p->out);
+		r_write_le64 (pt + 8, p->in);
+		r_write_le32 (pt + 16, p->bits);
+		if (fwrite (pt, PTSIZE, 1, fd) != 1 || fwrite (p->window, R_ZRAN_WINSIZE, 1, fd) != 1) {
+			ret = false;
+		}
+	}
+	fclose (fd);
+	if (!ret) {
+		r_file_rm (file);
+	}
+	return ret;
+}
+
+// loads an index saved for the same compressed data, making z complete.
+// z is left as it was when the file doesn't hold a valid index
+R_API bool r_zran_load(RZran *z, const char *file) {
+	ut8 hdr[HDRSIZE], pt[PTSIZE];
+	RZran tmp = { 0 };
+	ut32 i;
+	if (!z || !file) {
+		return false;
+	}
+	FILE *fd = r_sandbox_fopen (file, "rb");
+	if (!fd) {
+		return false;
+	}
+	if (fread (hdr, HDRSIZE, 1, fd) != 1 || memcmp (hdr, MAGIC, 8)
+			|| r_read_le64 (hdr + 8) != z->in_size || r_read_le32 (hdr + 36) != tail_crc (z)) {
+		fclose (fd);
+		return false;
+	}
+	ut32 npoints = r_read_le32 (hdr + 32);
+	ut64 size = r_read_le64 (hdr + 16);
+	// the file size bounds npoints before allocating anything
+	if (npoints > INT_MAX / 2 || r_file_size (file) != HDRSIZE + (ut64)npoints * (PTSIZE + R_ZRAN_WINSIZE)
+			|| !(tmp.points = calloc (R_MAX (npoints, 1), sizeof (RZranPoint)))) {
+		fclose (fd);
+		return false;
+	}
+	tmp.points_size = R_MAX (npoints, 1);
+	for (i = 0; i < npoints; i++) {
+		RZranPoint *p = &tmp.points[i];
+		RZranPoint *prev = i? p - 1: NULL;
+		if (fread (pt, PTSIZE, 1, fd) != 1) {
+			break;
+		}
+		p->out = r_read_le64 (pt);
+		p->in = r_read_le64 (pt + 8);
+		p->bits = r_read_le32 (pt + 16) & 7;
+		// points go forward in both streams and stay inside them
+		if (p->out > size || p->in > z->in_size || (p->bits && !p->in)
+				|| (prev && (p->out <= prev->out || p->in < prev->in))) {
+			break;
+		}
+		if (!(p->window = malloc (R_ZRAN_WINSIZE)) || fread (p->window, R_ZRAN_WINSIZE, 1, fd) != 1) {
+			free (p->window);
+			p->window = NULL;
+			break;
+		}
+		tmp.npoints++;
+	}
+	fclose (fd);
+	if (tmp.npoints != npoints) {
+		points_free (&tmp);
+		return false;
+	}
+	points_free (z);
+	z->points = tmp.points;
+	z->npoints = tmp.npoints;
+	z->points_size = tmp.points_size;
+	stream_free (z->build);
+	stream_free (z->cursor);
+	z->build = z->cursor = NULL;
+	z->size = size;
+	z->span = r_read_le64 (hdr + 24);
+	z->complete = true;
+	return true;
+}
@@ -1 +1,2 @@
 LINK+=$(SHLR)/lz4/liblz4.$(EXT_AR)
+CFLAGS+=-I$(SHLR)/lz4